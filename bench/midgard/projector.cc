@@ -0,0 +1,64 @@
+#include <benchmark/benchmark.h>
+#include <limits>
+#include <random>
+#include <vector>
+
+#include "midgard/util.h"
+
+using namespace valhalla::midgard;
+
+namespace {
+
+// A random walk of the given number of points around Utrecht, like an edge shape
+std::vector<PointLL> make_shape(size_t count) {
+  std::mt19937 generator(42);
+  std::uniform_real_distribution<double> step(-0.0005, 0.0005);
+  std::vector<PointLL> shape{{5.11, 52.09}};
+  while (shape.size() < count) {
+    shape.emplace_back(shape.back().lng() + step(generator), shape.back().lat() + step(generator));
+  }
+  return shape;
+}
+
+// Projecting one segment at a time like loki and meili used to
+void BM_ProjectSegments(benchmark::State& state) {
+  const auto shape = make_shape(state.range(0));
+  projector_t project(PointLL(5.112, 52.091));
+  for (auto _ : state) {
+    double closest = std::numeric_limits<double>::max();
+    size_t segment = 0;
+    for (size_t i = 0; i + 1 < shape.size(); ++i) {
+      auto sq_distance = project.approx.DistanceSquared(project(shape[i], shape[i + 1]));
+      if (sq_distance < closest) {
+        closest = sq_distance;
+        segment = i;
+      }
+    }
+    benchmark::DoNotOptimize(closest);
+    benchmark::DoNotOptimize(segment);
+  }
+  state.SetItemsProcessed(state.iterations() * (shape.size() - 1));
+}
+
+// Projecting onto the whole shape at once, as many segments per instruction as the target allows
+void BM_ProjectShape(benchmark::State& state) {
+  const auto shape = make_shape(state.range(0));
+  shape_buffer_t buffer;
+  for (const auto& point : shape) {
+    buffer.lngs.push_back(point.lng());
+    buffer.lats.push_back(point.lat());
+  }
+  projector_t project(PointLL(5.112, 52.091));
+  for (auto _ : state) {
+    auto projection = project(buffer.lngs.data(), buffer.lats.data(), buffer.size());
+    benchmark::DoNotOptimize(projection);
+  }
+  state.SetItemsProcessed(state.iterations() * (shape.size() - 1));
+}
+
+BENCHMARK(BM_ProjectSegments)->RangeMultiplier(4)->Range(4, 1024);
+BENCHMARK(BM_ProjectShape)->RangeMultiplier(4)->Range(4, 1024);
+
+} // namespace
+
+BENCHMARK_MAIN();
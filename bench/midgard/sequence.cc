@@ -0,0 +1,61 @@
+#include <benchmark/benchmark.h>
+#include <cstdio>
+#include <random>
+#include <string>
+
+#include "midgard/sequence.h"
+#include "mjolnir/osmdata.h"
+
+using namespace valhalla::midgard;
+using valhalla::mjolnir::OSMWayNode;
+
+namespace {
+
+constexpr size_t kWayNodes = 1 << 20;
+const std::string kFile = "bench_sequence_way_nodes.bin";
+
+// Way nodes in the order the parser writes them, ways one after the other with random node ids
+void write_way_nodes() {
+  std::mt19937_64 generator(42);
+  sequence<OSMWayNode> way_nodes(kFile, true);
+  OSMWayNode way_node{};
+  for (size_t i = 0; i < kWayNodes; ++i) {
+    way_node.node.osmid_ = generator() % (kWayNodes * 4);
+    way_node.way_index = i / 8;
+    way_node.way_shape_node_index = i % 8;
+    way_nodes.push_back(way_node);
+  }
+}
+
+// Sorts the way nodes by node id like the parser does before parsing the nodes. The first argument
+// is how many runs the buffer size makes, 1 sorts everything at once, the second is the concurrency
+void BM_SortWayNodes(benchmark::State& state) {
+  const size_t buffer_size = kWayNodes / state.range(0);
+  const auto concurrency = static_cast<unsigned int>(state.range(1));
+  for (auto _ : state) {
+    state.PauseTiming();
+    write_way_nodes();
+    sequence<OSMWayNode> way_nodes(kFile, false);
+    state.ResumeTiming();
+    way_nodes.sort(
+        [](const OSMWayNode& a, const OSMWayNode& b) { return a.node.osmid_ < b.node.osmid_; },
+        buffer_size, concurrency);
+  }
+  state.SetItemsProcessed(state.iterations() * kWayNodes);
+  state.SetBytesProcessed(state.iterations() * kWayNodes * sizeof(OSMWayNode));
+  std::remove(kFile.c_str());
+}
+
+void SortArguments(benchmark::internal::Benchmark* benchmark) {
+  for (int runs : {1, 16}) {
+    for (int concurrency : {1, 2, 4, 8}) {
+      benchmark->Args({runs, concurrency});
+    }
+  }
+}
+
+BENCHMARK(BM_SortWayNodes)->Apply(SortArguments)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+} // namespace
+
+BENCHMARK_MAIN();
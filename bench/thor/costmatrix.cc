@@ -7,8 +7,10 @@
 #include "baldr/graphreader.h"
 #include "loki/search.h"
 #include "midgard/pointll.h"
+#include "mjolnir/contractionbuilder.h"
 #include "sif/autocost.h"
 #include "sif/costfactory.h"
+#include "thor/bucketmatrix.h"
 #include "thor/costmatrix.h"
 #include <valhalla/proto/options.pb.h>
 
@@ -60,11 +62,9 @@ const auto config = json_to_pt(R"({
 
 constexpr float kMaxRange = 256;
 
-static void BM_UtrechtCostMatrix(benchmark::State& state) {
-  const int size = state.range(0);
-  baldr::GraphReader reader(config.get_child("mjolnir"));
-
-  // Generate N random locations within the Utrect bounding box;
+// Snaps N random locations within the Utrecht bounding box
+google::protobuf::RepeatedPtrField<valhalla::Location>
+make_locations(const int size, baldr::GraphReader& reader, const sif::cost_ptr_t& cost) {
   std::vector<valhalla::baldr::Location> locations;
   const double min_lon = 5.0163;
   const double max_lon = 5.1622;
@@ -80,25 +80,44 @@ static void BM_UtrechtCostMatrix(benchmark::State& state) {
     locations.emplace_back(midgard::PointLL{lng_distribution(gen), lat_distribution(gen)});
   }
 
-  Options options;
-  options.set_costing_type(Costing::auto_);
-  rapidjson::Document doc;
-  sif::ParseCosting(doc, "/costing_options", options);
-  sif::TravelMode mode;
-  auto costs = sif::CostFactory().CreateModeCosting(options, mode);
-  auto cost = costs[static_cast<size_t>(mode)];
-
   const auto projections = loki::Search(locations, reader, cost);
   if (projections.size() == 0) {
     throw std::runtime_error("Found no matching locations");
   }
 
   google::protobuf::RepeatedPtrField<valhalla::Location> sources;
-
   for (const auto& projection : projections) {
     auto* p = sources.Add();
     baldr::PathLocation::toPBF(projection.second, p, reader);
   }
+  return sources;
+}
+
+// The contraction hierarchy of the Utrecht tiles, built on first use
+std::shared_ptr<const baldr::ContractionHierarchy> utrecht_hierarchy() {
+  static const auto hierarchy = []() {
+    auto pt = config;
+    pt.put("mjolnir.contraction_hierarchy", "test/data/utrecht_tiles/contraction_hierarchy.bin");
+    mjolnir::ContractionBuilder::Build(pt);
+    return std::make_shared<const baldr::ContractionHierarchy>(
+        pt.get<std::string>("mjolnir.contraction_hierarchy"));
+  }();
+  return hierarchy;
+}
+
+static void BM_UtrechtCostMatrix(benchmark::State& state) {
+  const int size = state.range(0);
+  baldr::GraphReader reader(config.get_child("mjolnir"));
+
+  Options options;
+  options.set_costing_type(Costing::auto_);
+  rapidjson::Document doc;
+  sif::ParseCosting(doc, "/costing_options", options);
+  sif::TravelMode mode;
+  auto costs = sif::CostFactory().CreateModeCosting(options, mode);
+  auto cost = costs[static_cast<size_t>(mode)];
+
+  const auto sources = make_locations(size, reader, cost);
 
   std::size_t result_size = 0;
 
@@ -116,6 +135,34 @@ BENCHMARK(BM_UtrechtCostMatrix)
     ->RangeMultiplier(2)
     ->Range(1, kMaxRange);
 
+static void BM_UtrechtBucketMatrix(benchmark::State& state) {
+  const int size = state.range(0);
+  baldr::GraphReader reader(config.get_child("mjolnir"));
+
+  Options options;
+  options.set_costing_type(Costing::auto_);
+  rapidjson::Document doc;
+  sif::ParseCosting(doc, "/costing_options", options);
+  sif::TravelMode mode;
+  auto costs = sif::CostFactory().CreateModeCosting(options, mode);
+  auto cost = costs[static_cast<size_t>(mode)];
+
+  const auto sources = make_locations(size, reader, cost);
+
+  std::size_t result_size = 0;
+
+  thor::BucketMatrix matrix;
+  matrix.set_hierarchy(utrecht_hierarchy());
+  for (auto _ : state) {
+    auto result = matrix.SourceToTarget(sources, sources, reader, costs, mode, 100000.);
+    matrix.clear();
+    result_size += result.size();
+  }
+  state.counters["Routes"] = benchmark::Counter(size, benchmark::Counter::kIsIterationInvariantRate);
+}
+
+BENCHMARK(BM_UtrechtBucketMatrix)->Unit(benchmark::kMillisecond)->Arg(100)->Arg(500)->Arg(2000);
+
 } // namespace
 
 BENCHMARK_MAIN();
@@ -0,0 +1,87 @@
+#include <benchmark/benchmark.h>
+#include <string>
+
+#include "loki/worker.h"
+#include "thor/worker.h"
+
+#include "test.h"
+
+using namespace valhalla;
+
+namespace {
+
+// Queue types to compare, the range argument of the benchmarks indexes into this
+const std::string kQueueTypes[] = {"double_bucket", "radix"};
+
+boost::property_tree::ptree make_config(benchmark::State& state) {
+  auto config =
+      test::make_config("test/data/utrecht_tiles", {},
+                        {{"additional_data", "mjolnir.traffic_extract", "mjolnir.tile_extract"}});
+  config.put("thor.queue_type", kQueueTypes[state.range(0)]);
+  state.SetLabel(kQueueTypes[state.range(0)]);
+  return config;
+}
+
+// A route across Utrecht, long enough for the bidirectional search to settle a fair share of it
+void BM_QueueRoute(benchmark::State& state) {
+  const auto config = make_config(state);
+  loki::loki_worker_t loki_worker(config);
+  thor::thor_worker_t thor_worker(config);
+
+  const std::string request_json =
+      R"({"locations":[{"lat":52.099247,"lon":5.115873},{"lat":52.067372,"lon":5.025595}],
+          "costing":"auto"})";
+  for (auto _ : state) {
+    Api request;
+    ParseApi(request_json, Options::route, request);
+    loki_worker.route(request);
+    thor_worker.route(request);
+    thor_worker.cleanup();
+  }
+}
+
+// A small matrix, runs the CostMatrix with one adjacency list per location
+void BM_QueueMatrix(benchmark::State& state) {
+  const auto config = make_config(state);
+  loki::loki_worker_t loki_worker(config);
+  thor::thor_worker_t thor_worker(config);
+
+  const std::string request_json =
+      R"({"sources":[{"lat":52.099247,"lon":5.115873},{"lat":52.101841,"lon":5.114576},
+                     {"lat":52.074073,"lon":5.112481},{"lat":52.110116,"lon":5.135983}],
+          "targets":[{"lat":52.108956,"lon":5.095273},{"lat":52.062043,"lon":5.110077},
+                     {"lat":52.067372,"lon":5.025595},{"lat":52.103607,"lon":5.114598}],
+          "costing":"auto"})";
+  for (auto _ : state) {
+    Api request;
+    ParseApi(request_json, Options::sources_to_targets, request);
+    loki_worker.matrix(request);
+    thor_worker.matrix(request);
+    thor_worker.cleanup();
+  }
+}
+
+// An isochrone, the whole expansion goes through the queue so this is where it matters the most
+void BM_QueueIsochrone(benchmark::State& state) {
+  const auto config = make_config(state);
+  loki::loki_worker_t loki_worker(config);
+  thor::thor_worker_t thor_worker(config);
+
+  const std::string request_json =
+      R"({"locations":[{"lat":52.078937,"lon":5.115321}],"costing":"auto",
+          "contours":[{"time":30}],"polygons":false,"denoise":1,"generalize":20})";
+  Api request;
+  ParseApi(request_json, Options::isochrone, request);
+  loki_worker.isochrones(request);
+  for (auto _ : state) {
+    thor_worker.isochrones(request);
+  }
+}
+
+BENCHMARK(BM_QueueRoute)->Unit(benchmark::kMillisecond)->DenseRange(0, 1);
+BENCHMARK(BM_QueueMatrix)->Unit(benchmark::kMillisecond)->DenseRange(0, 1);
+BENCHMARK(BM_QueueIsochrone)->Unit(benchmark::kMillisecond)->DenseRange(0, 1);
+
+} // namespace
+
+BENCHMARK_MAIN();
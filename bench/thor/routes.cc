@@ -309,6 +309,66 @@ void BM_GlobalFixedRandom(benchmark::State& state, const std::string& planet_pat
   }
 }
 
+/*
+ * Route latency with a cold tile cache. Every iteration starts with a new reader so every tile the
+ * routes touch is loaded from the tile files or extract again, which is what differs between them
+ */
+static void BM_UtrechtColdCacheRoutes(benchmark::State& state, const std::string& extract) {
+  auto config = test::make_config("test/data/utrecht_tiles", {},
+                                  {{"mjolnir.traffic_extract", "mjolnir.tile_extract"}});
+  if (!extract.empty()) {
+    config.put("mjolnir.tile_extract", "test/data/utrecht_tiles/" + extract);
+  }
+  auto reader = test::make_clean_graphreader(config.get_child("mjolnir"));
+
+  Options options;
+  create_costing_options(options);
+  sif::TravelMode mode;
+  auto costs = sif::CostFactory().CreateModeCosting(options, mode);
+  auto cost = costs[static_cast<size_t>(mode)];
+
+  // Routes from one end of Utrecht to the other so that they need most of the tiles
+  std::vector<valhalla::baldr::Location> locations = {midgard::PointLL{5.115873, 52.099247},
+                                                      midgard::PointLL{5.025595, 52.067372},
+                                                      midgard::PointLL{5.135983, 52.110116},
+                                                      midgard::PointLL{5.110077, 52.062043},
+                                                      midgard::PointLL{5.095273, 52.108956}};
+  const auto projections = loki::Search(locations, *reader, cost);
+  std::vector<valhalla::Location> pbf_locations;
+  for (const auto& location : locations) {
+    auto found = projections.find(location);
+    if (found == projections.cend()) {
+      state.SkipWithError("Found no matching locations");
+      return;
+    }
+    pbf_locations.emplace_back();
+    baldr::PathLocation::toPBF(found->second, &pbf_locations.back(), *reader);
+  }
+
+  thor::BidirectionalAStar astar;
+  for (auto _ : state) {
+    state.PauseTiming();
+    reader = test::make_clean_graphreader(config.get_child("mjolnir"));
+    state.ResumeTiming();
+    for (size_t i = 0; i + 1 < pbf_locations.size(); ++i) {
+      auto result = astar.GetBestPath(pbf_locations[i], pbf_locations[i + 1], *reader, costs,
+                                      sif::TravelMode::kDrive);
+      astar.Clear();
+      benchmark::DoNotOptimize(result);
+    }
+  }
+  state.counters["Routes"] = benchmark::Counter(state.iterations() * (pbf_locations.size() - 1),
+                                                benchmark::Counter::kIsRate);
+}
+
+BENCHMARK_CAPTURE(BM_UtrechtColdCacheRoutes, tile_dir, std::string())
+    ->Unit(benchmark::kMillisecond);
+BENCHMARK_CAPTURE(BM_UtrechtColdCacheRoutes, tar_extract, std::string("tiles.tar"))
+    ->Unit(benchmark::kMillisecond);
+BENCHMARK_CAPTURE(BM_UtrechtColdCacheRoutes, compressed_extract,
+                  std::string("tiles_compressed.tar"))
+    ->Unit(benchmark::kMillisecond);
+
 /** Benchmarks the GetSpeed function */
 static void BM_GetSpeed(benchmark::State& state) {
 
@@ -0,0 +1,84 @@
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#include <string>
+
+#include <benchmark/benchmark.h>
+#include <boost/property_tree/ptree.hpp>
+
+#include "baldr/rapidjson_utils.h"
+#include "midgard/logging.h"
+#include "tyr/actor.h"
+#include "tyr/serializers.h"
+
+#if !defined(VALHALLA_SOURCE_DIR)
+#define VALHALLA_SOURCE_DIR
+#endif
+
+// Count every heap allocation in the process so the benchmark can report how many the serializer
+// needs per response
+namespace {
+std::atomic<size_t> allocations{0};
+} // namespace
+
+void* operator new(std::size_t size) {
+  ++allocations;
+  if (void* p = std::malloc(size ? size : 1))
+    return p;
+  throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept {
+  std::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept {
+  std::free(p);
+}
+
+using namespace valhalla;
+
+namespace {
+
+// A cross town route through Utrecht with enough maneuvers to make the response non trivial
+const std::string kRequest =
+    R"({"locations":[{"lat":52.10205,"lon":5.114651},{"lat":52.0887,"lon":5.13412},
+    {"lat":52.07583,"lon":5.10378}],"costing":"auto","linear_references":true})";
+
+// Computes the route once and then only times turning the finished Api into a response
+void serialize(benchmark::State& state, Options::Format format) {
+  logging::Configure({{"type", ""}});
+  boost::property_tree::ptree config;
+  rapidjson::read_json(VALHALLA_SOURCE_DIR "bench/meili/config.json", config);
+  tyr::actor_t actor(config, true);
+
+  Api api;
+  actor.route(kRequest, nullptr, &api);
+  api.mutable_options()->set_format(format);
+
+  size_t bytes = 0, allocated = 0;
+  for (auto _ : state) {
+    size_t before = allocations.load(std::memory_order_relaxed);
+    auto response = tyr::serializeDirections(api);
+    allocated += allocations.load(std::memory_order_relaxed) - before;
+    bytes += response.size();
+    benchmark::DoNotOptimize(response);
+  }
+  state.SetBytesProcessed(bytes);
+  state.counters["allocs_per_route"] =
+      benchmark::Counter(allocated, benchmark::Counter::kAvgIterations);
+}
+
+void BM_SerializeOSRM(benchmark::State& state) {
+  serialize(state, Options::osrm);
+}
+BENCHMARK(BM_SerializeOSRM);
+
+void BM_SerializeValhalla(benchmark::State& state) {
+  serialize(state, Options::json);
+}
+BENCHMARK(BM_SerializeValhalla);
+
+} // namespace
+
+BENCHMARK_MAIN();
@@ -0,0 +1,92 @@
+#include "baldr/contractionhierarchy.h"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <sys/stat.h>
+
+namespace {
+
+// each array in the file starts at a multiple of 8 bytes
+size_t align(size_t offset) {
+  return (offset + 7) & ~static_cast<size_t>(7);
+}
+
+} // namespace
+
+namespace valhalla {
+namespace baldr {
+
+ContractionHierarchy::ContractionHierarchy(const std::string& file_name) {
+  struct stat s;
+  if (stat(file_name.c_str(), &s) || s.st_size < static_cast<off_t>(sizeof(ContractionHeader))) {
+    throw std::runtime_error("Contraction hierarchy " + file_name + " is missing or truncated");
+  }
+  memory_.map_readonly(file_name, s.st_size);
+
+  header_ = reinterpret_cast<const ContractionHeader*>(memory_.get());
+  if (std::memcmp(header_->magic, magic(), sizeof(header_->magic)) != 0 ||
+      header_->version != kContractionHierarchyVersion) {
+    throw std::runtime_error("Contraction hierarchy " + file_name + " has an unsupported format");
+  }
+
+  // work out where each array starts and make sure the file is big enough to hold them all
+  size_t offset = align(sizeof(ContractionHeader));
+  auto next = [&](size_t bytes) {
+    const char* start = memory_.get() + offset;
+    offset = align(offset + bytes);
+    return start;
+  };
+  nodes_ = reinterpret_cast<const uint64_t*>(next(header_->node_count * sizeof(uint64_t)));
+  forward_offsets_ =
+      reinterpret_cast<const uint32_t*>(next((header_->node_count + 1) * sizeof(uint32_t)));
+  forward_ = reinterpret_cast<const uint32_t*>(next(header_->forward_count * sizeof(uint32_t)));
+  reverse_offsets_ =
+      reinterpret_cast<const uint32_t*>(next((header_->node_count + 1) * sizeof(uint32_t)));
+  reverse_ = reinterpret_cast<const uint32_t*>(next(header_->reverse_count * sizeof(uint32_t)));
+  arcs_ = reinterpret_cast<const ContractionArc*>(next(header_->arc_count * sizeof(ContractionArc)));
+  if (offset > static_cast<size_t>(s.st_size)) {
+    throw std::runtime_error("Contraction hierarchy " + file_name + " is truncated");
+  }
+}
+
+uint32_t ContractionHierarchy::node(const GraphId& node) const {
+  const auto* end = nodes_ + header_->node_count;
+  const auto* found = std::lower_bound(nodes_, end, node.value);
+  return found == end || *found != node.value ? kInvalidContractionIndex : found - nodes_;
+}
+
+bool ContractionHierarchy::matches(const Options& options) const {
+  if (options.costing_type() != Costing::auto_) {
+    return false;
+  }
+  auto found = options.costings().find(Costing::auto_);
+  return found != options.costings().end() &&
+         hash_profile(found->second.SerializeAsString()) == profile();
+}
+
+void ContractionHierarchy::unpack(const uint32_t index, std::vector<GraphId>& edges) const {
+  std::vector<uint32_t> stack{index};
+  while (!stack.empty()) {
+    const auto& arc = arcs_[stack.back()];
+    stack.pop_back();
+    if (arc.is_shortcut()) {
+      stack.push_back(arc.second);
+      stack.push_back(arc.first);
+    } else if (GraphId(arc.edgeid).Is_Valid()) {
+      edges.push_back(GraphId(arc.edgeid));
+    }
+  }
+}
+
+uint64_t ContractionHierarchy::hash_profile(const std::string& bytes) {
+  uint64_t hash = 14695981039346656037ull;
+  for (const auto c : bytes) {
+    hash ^= static_cast<uint8_t>(c);
+    hash *= 1099511628211ull;
+  }
+  return hash;
+}
+
+} // namespace baldr
+} // namespace valhalla
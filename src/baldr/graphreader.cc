@@ -1,8 +1,16 @@
+#include <atomic>
+#include <cmath>
+#include <fcntl.h>
 #include <fstream>
 #include <iostream>
 #include <string>
 #include <sys/stat.h>
+#include <thread>
 #include <utility>
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
 
 #include "baldr/connectivity_map.h"
 #include "baldr/curl_tilegetter.h"
@@ -20,13 +28,74 @@ namespace {
 constexpr size_t DEFAULT_MAX_CACHE_SIZE = 1073741824; // 1 gig
 constexpr size_t AVERAGE_TILE_SIZE = 2097152;         // 2 megs
 constexpr size_t AVERAGE_MM_TILE_SIZE = 1024;         // 1k
+// a tile file mapped on its own costs the cache a mapping rather than the tile bytes, this keeps
+// the number of mappings at the default cache size well below the usual vm.max_map_count
+constexpr size_t MAPPED_TILE_SIZE = 65536; // 64k
 
 struct tile_index_entry {
   uint64_t offset;  // byte offset from the beginning of the tar
   uint32_t tile_id; // just level and tileindex hence fitting in 32bits
-  uint32_t size;    // size of the tile in bytes
+  uint32_t size;    // size of the tile in bytes, the size of its frame for a compressed extract
 };
 
+// Tiles in a compressed extract are LZ4 frames of their own. A tile can't start with the frame
+// magic number 0x184D2204, the level in the low bits of its header's graph id would be 4
+bool is_lz4_frame(const std::pair<char*, size_t>& tile) {
+  return tile.second > 4 && static_cast<unsigned char>(tile.first[0]) == 0x04 &&
+         static_cast<unsigned char>(tile.first[1]) == 0x22 &&
+         static_cast<unsigned char>(tile.first[2]) == 0x4d &&
+         static_cast<unsigned char>(tile.first[3]) == 0x18;
+}
+
+constexpr size_t DEFAULT_CONCURRENT_CACHE_SHARDS = 64;
+
+// Readers of the ConcurrentTileCache announce the epoch they entered in one of these slots. Each
+// slot lives on its own cache line so that announcing never contends with another reader
+struct alignas(64) reader_epoch_t {
+  std::atomic<uint64_t> epoch{0};
+  std::atomic<bool> taken{false};
+};
+constexpr size_t kMaxEpochReaders = 512;
+reader_epoch_t reader_epochs[kMaxEpochReaders];
+std::atomic<uint64_t> global_epoch{1};
+
+// Claims a reader slot for the lifetime of the calling thread, slot is nullptr if all are taken
+struct reader_slot_t {
+  reader_slot_t() {
+    for (auto& reader : reader_epochs) {
+      bool expected = false;
+      if (reader.taken.compare_exchange_strong(expected, true)) {
+        slot = &reader;
+        break;
+      }
+    }
+  }
+  ~reader_slot_t() {
+    if (slot) {
+      slot->epoch.store(0);
+      slot->taken.store(false);
+    }
+  }
+  reader_epoch_t* slot = nullptr;
+};
+
+reader_epoch_t* this_thread_reader() {
+  thread_local reader_slot_t reader;
+  return reader.slot;
+}
+
+// Moves to a new epoch and blocks until no reader is left in an older one. After this returns
+// nothing detached before the call can still be referenced by a reader
+void synchronize_readers() {
+  const auto epoch = ++global_epoch;
+  for (const auto& reader : reader_epochs) {
+    uint64_t entered;
+    while ((entered = reader.epoch.load()) != 0 && entered < epoch) {
+      std::this_thread::yield();
+    }
+  }
+}
+
 } // namespace
 
 namespace valhalla {
@@ -109,7 +178,9 @@ GraphReader::tile_extract_t::tile_extract_t(const boost::property_tree::ptree& p
         archive.reset();
       } // loaded ok but with possibly bad blocks
       else {
-        LOG_INFO("Tile extract successfully loaded with tile count: " + std::to_string(tiles.size()));
+        compressed = is_lz4_frame(tiles.begin()->second);
+        LOG_INFO(std::string(compressed ? "Compressed tile" : "Tile") +
+                 " extract successfully loaded with tile count: " + std::to_string(tiles.size()));
         if (archive->corrupt_blocks) {
           LOG_WARN("Tile extract had " + std::to_string(archive->corrupt_blocks) + " corrupt blocks");
         }
@@ -427,6 +498,174 @@ graph_tile_ptr SynchronizedTileCache::Put(const GraphId& graphid, graph_tile_ptr
   return cache_.Put(graphid, std::move(tile), size);
 }
 
+// ----------------------------------------------------------------------------
+// ConcurrentTileCache implementation
+// ----------------------------------------------------------------------------
+
+struct ConcurrentTileCache::store_t {
+  struct entry_t {
+    graph_tile_ptr tile;
+    size_t size;
+  };
+
+  struct shard_t {
+    // serializes the writers of this shard and the readers that didnt get an epoch slot
+    std::mutex mutex;
+    // which slots are currently occupied by tiles of this shard
+    std::vector<uint32_t> occupied;
+  };
+
+  store_t(size_t max_size, size_t shard_count)
+      : shards(new shard_t[std::max<size_t>(shard_count, 1)]),
+        shard_count(std::max<size_t>(shard_count, 1)), cache_size(0), max_cache_size(max_size),
+        trim_cursor(0) {
+    index_offsets[0] = 0;
+    index_offsets[1] = index_offsets[0] + TileHierarchy::levels()[0].tiles.TileCount();
+    index_offsets[2] = index_offsets[1] + TileHierarchy::levels()[1].tiles.TileCount();
+    index_offsets[3] = index_offsets[2] + TileHierarchy::levels()[2].tiles.TileCount();
+    slot_count = index_offsets[3] + TileHierarchy::GetTransitLevel().tiles.TileCount();
+    slots.reset(new std::atomic<entry_t*>[slot_count]);
+    for (size_t i = 0; i < slot_count; ++i) {
+      slots[i].store(nullptr, std::memory_order_relaxed);
+    }
+  }
+
+  ~store_t() {
+    // no one can be reading anymore since all the caches sharing this store are gone
+    for (size_t i = 0; i < slot_count; ++i) {
+      delete slots[i].load(std::memory_order_relaxed);
+    }
+  }
+
+  uint32_t get_offset(const GraphId& graphid) const {
+    return graphid.level() < 4 ? index_offsets[graphid.level()] + graphid.tileid() : slot_count;
+  }
+
+  shard_t& get_shard(const GraphId& graphid) const {
+    // neighbouring tiles land on different shards which spreads out the writers of a hot region
+    return shards[(graphid.tileid() + graphid.level()) % shard_count];
+  }
+
+  // detaches all the tiles of a shard and frees them once no reader can see them anymore
+  size_t evict(shard_t& shard) {
+    std::vector<entry_t*> evicted;
+    {
+      std::lock_guard<std::mutex> lock(shard.mutex);
+      evicted.reserve(shard.occupied.size());
+      for (auto offset : shard.occupied) {
+        evicted.push_back(slots[offset].exchange(nullptr));
+      }
+      shard.occupied.clear();
+    }
+    if (evicted.empty()) {
+      return 0;
+    }
+
+    synchronize_readers();
+    size_t freed = 0;
+    for (auto* entry : evicted) {
+      freed += entry->size;
+      delete entry;
+    }
+    cache_size -= freed;
+    return freed;
+  }
+
+  std::unique_ptr<std::atomic<entry_t*>[]> slots;
+  size_t slot_count;
+  std::array<uint32_t, 8> index_offsets;
+  std::unique_ptr<shard_t[]> shards;
+  size_t shard_count;
+  std::atomic<size_t> cache_size;
+  size_t max_cache_size;
+  std::atomic<size_t> trim_cursor;
+};
+
+// Constructor.
+ConcurrentTileCache::ConcurrentTileCache(size_t max_size, size_t shard_count)
+    : store_(std::make_shared<store_t>(max_size, shard_count)) {
+}
+
+// Reserves enough cache to hold (max_cache_size / tile_size) items.
+void ConcurrentTileCache::Reserve(size_t tile_size) {
+  const auto per_shard = store_->max_cache_size / tile_size / store_->shard_count + 1;
+  for (size_t i = 0; i < store_->shard_count; ++i) {
+    std::lock_guard<std::mutex> lock(store_->shards[i].mutex);
+    store_->shards[i].occupied.reserve(per_shard);
+  }
+}
+
+// Checks if tile exists in the cache.
+bool ConcurrentTileCache::Contains(const GraphId& graphid) const {
+  auto offset = store_->get_offset(graphid);
+  return offset < store_->slot_count && store_->slots[offset].load() != nullptr;
+}
+
+// Lets you know if the cache is too large.
+bool ConcurrentTileCache::OverCommitted() const {
+  return store_->cache_size > store_->max_cache_size;
+}
+
+// Clears the cache.
+void ConcurrentTileCache::Clear() {
+  for (size_t i = 0; i < store_->shard_count; ++i) {
+    store_->evict(store_->shards[i]);
+  }
+}
+
+void ConcurrentTileCache::Trim() {
+  // we rotate through the shards so that repeated trims dont always hit the same tiles
+  for (size_t i = 0; i < store_->shard_count && OverCommitted(); ++i) {
+    store_->evict(store_->shards[store_->trim_cursor++ % store_->shard_count]);
+  }
+}
+
+// Get a pointer to a graph tile object given a GraphId.
+graph_tile_ptr ConcurrentTileCache::Get(const GraphId& graphid) const {
+  auto offset = store_->get_offset(graphid);
+  if (offset >= store_->slot_count) {
+    return nullptr;
+  }
+
+  // more threads than epoch slots, these ones have to read under the writer lock
+  auto* reader = this_thread_reader();
+  if (!reader) {
+    std::lock_guard<std::mutex> lock(store_->get_shard(graphid).mutex);
+    const auto* entry = store_->slots[offset].load();
+    return entry ? entry->tile : nullptr;
+  }
+
+  // enter the current epoch so the entry we load cant be freed until we have our own reference
+  graph_tile_ptr tile;
+  reader->epoch.store(global_epoch.load());
+  if (const auto* entry = store_->slots[offset].load()) {
+    tile = entry->tile;
+  }
+  reader->epoch.store(0, std::memory_order_release);
+  return tile;
+}
+
+// Puts a copy of a tile of into the cache.
+graph_tile_ptr ConcurrentTileCache::Put(const GraphId& graphid, graph_tile_ptr tile, size_t size) {
+  auto offset = store_->get_offset(graphid);
+  if (offset >= store_->slot_count) {
+    return tile;
+  }
+
+  auto& shard = store_->get_shard(graphid);
+  std::lock_guard<std::mutex> lock(shard.mutex);
+  auto& slot = store_->slots[offset];
+  // someone beat us to it, keep theirs so every thread shares the same copy
+  if (const auto* existing = slot.load(std::memory_order_relaxed)) {
+    return existing->tile;
+  }
+  auto* entry = new store_t::entry_t{std::move(tile), size};
+  slot.store(entry);
+  shard.occupied.push_back(offset);
+  store_->cache_size += size;
+  return entry->tile;
+}
+
 // Constructs tile cache.
 TileCache* TileCacheFactory::createTileCache(const boost::property_tree::ptree& pt) {
   size_t max_cache_size = pt.get<size_t>("max_cache_size", DEFAULT_MAX_CACHE_SIZE);
@@ -438,6 +677,24 @@ TileCache* TileCacheFactory::createTileCache(const boost::property_tree::ptree&
 
   bool use_simple_cache = pt.get<bool>("use_simple_mem_cache", false);
 
+  // one lock free cache shared by every reader in the process
+  if (pt.get<bool>("use_concurrent_mem_cache", false)) {
+#ifndef ENABLE_THREAD_SAFE_TILE_REF_COUNT
+    LOG_WARN("use_concurrent_mem_cache requires ENABLE_THREAD_SAFE_TILE_REF_COUNT when the "
+             "cache is shared between threads");
+#endif
+    static std::unique_ptr<ConcurrentTileCache> globalConcurrentCache_;
+    static std::mutex factoryMutex;
+    std::lock_guard<std::mutex> lock(factoryMutex);
+    if (!globalConcurrentCache_) {
+      globalConcurrentCache_.reset(
+          new ConcurrentTileCache(max_cache_size,
+                                  pt.get<size_t>("concurrent_mem_cache_shards",
+                                                 DEFAULT_CONCURRENT_CACHE_SHARDS)));
+    }
+    return new ConcurrentTileCache(*globalConcurrentCache_);
+  }
+
   // wrap tile cache with thread-safe version
   if (pt.get<bool>("global_synchronized_cache", false)) {
     // Handle synchronization of cache
@@ -476,6 +733,9 @@ GraphReader::GraphReader(const boost::property_tree::ptree& pt,
                          std::unique_ptr<tile_getter_t>&& tile_getter)
     : tile_extract_(new tile_extract_t(pt)),
       tile_dir_(tile_extract_->tiles.empty() ? pt.get<std::string>("tile_dir", "") : ""),
+      mmap_tile_files_(pt.get<bool>("mmap_tile_files", false)),
+      tile_prefetch_(pt.get<bool>("tile_prefetch", false)), prefetch_issued_(0), prefetch_hits_(0),
+      prefetch_misses_(0),
       tile_getter_(std::move(tile_getter)),
       max_concurrent_users_(pt.get<size_t>("max_concurrent_reader_users", 1)),
       tile_url_(pt.get<std::string>("tile_url", "")), cache_(TileCacheFactory::createTileCache(pt)) {
@@ -491,9 +751,13 @@ GraphReader::GraphReader(const boost::property_tree::ptree& pt,
   if (!tile_url_.empty() && tile_url_.find(GraphTile::kTilePathPattern) == std::string::npos)
     throw std::runtime_error("Not found tilePath pattern in tile url");
 
-  // Reserve cache (based on whether using individual tile files or shared,
-  // mmap'd file
-  cache_->Reserve(tile_extract_->tiles.empty() ? AVERAGE_TILE_SIZE : AVERAGE_MM_TILE_SIZE);
+  // Reserve cache (based on whether using individual tile files, individually
+  // mmap'd tile files or shared, mmap'd file
+  if (!tile_extract_->tiles.empty()) {
+    cache_->Reserve(tile_extract_->compressed ? AVERAGE_TILE_SIZE : AVERAGE_MM_TILE_SIZE);
+  } else {
+    cache_->Reserve(mmap_tile_files_ ? MAPPED_TILE_SIZE : AVERAGE_TILE_SIZE);
+  }
 
   // Initialize the incident cache singleton if we have any kind of configuration to do so. if the
   // configuration is wrong or any kind of problem occurs this throws. the call below will spawn a
@@ -542,6 +806,10 @@ public:
     size = position.second;
   }
 
+  bool mapped() const override {
+    return true;
+  }
+
 private:
   const std::shared_ptr<midgard::tar> archive_;
 };
@@ -569,15 +837,27 @@ graph_tile_ptr GraphReader::GetGraphTile(const GraphId& graphid) {
       // LOG_DEBUG("Memory map cache miss " + GraphTile::FileSuffix(base));
       return nullptr;
     }
-    auto memory = std::make_unique<TarballGraphMemory>(tile_extract_->archive, t->second);
-
     auto traffic_ptr = tile_extract_->traffic_tiles.find(base);
     auto traffic_memory = traffic_ptr != tile_extract_->traffic_tiles.end()
                               ? std::make_unique<TarballGraphMemory>(tile_extract_->traffic_archive,
                                                                      traffic_ptr->second)
                               : nullptr;
 
+    CountPrefetch(base);
+
+    // Tiles of a compressed extract are decoded onto the heap and cost the cache what they hold
+    if (is_lz4_frame(t->second)) {
+      auto tile = GraphTile::DecompressLZ4(base, t->second.first, t->second.second,
+                                           std::move(traffic_memory));
+      if (!tile) {
+        return nullptr;
+      }
+      const size_t size = tile->header()->end_offset();
+      return cache_->Put(base, std::move(tile), size);
+    }
+
     // This initializes the tile from mmap
+    auto memory = std::make_unique<TarballGraphMemory>(tile_extract_->archive, t->second);
     auto tile = GraphTile::Create(base, std::move(memory), std::move(traffic_memory));
     if (!tile) {
       // LOG_DEBUG("Memory map cache miss " + GraphTile::FileSuffix(base));
@@ -597,7 +877,9 @@ graph_tile_ptr GraphReader::GetGraphTile(const GraphId& graphid) {
                               : nullptr;
 
     // Try to get it from disk and if we cant..
-    graph_tile_ptr tile = GraphTile::Create(tile_dir_, base, std::move(traffic_memory));
+    CountPrefetch(base);
+    graph_tile_ptr tile =
+        GraphTile::Create(tile_dir_, base, std::move(traffic_memory), mmap_tile_files_);
     if (!tile || !tile->header()) {
       if (!tile_getter_) {
         return nullptr;
@@ -624,12 +906,105 @@ graph_tile_ptr GraphReader::GetGraphTile(const GraphId& graphid) {
       // LOG_DEBUG("Disk cache hit " + GraphTile::FileSuffix(base));
     }
 
-    // Keep a copy in the cache and return it
-    const size_t size = tile->header()->end_offset();
+    // Keep a copy in the cache and return it. The bytes of a mapped tile are in the page cache
+    // where the kernel can drop them, evicting it from our cache only gives back the mapping
+    const size_t size = tile->mapped() ? MAPPED_TILE_SIZE : tile->header()->end_offset();
     return cache_->Put(base, std::move(tile), size);
   }
 }
 
+// Read ahead the tiles around ll in the direction of target
+void GraphReader::Prefetch(const midgard::PointLL& ll,
+                           const midgard::PointLL& target,
+                           const uint8_t level) {
+  if (!tile_prefetch_ || level >= TileHierarchy::levels().size()) {
+    return;
+  }
+
+  // step a tile size towards the target, straight ahead and 45 degrees to either side
+  const auto& tiles = TileHierarchy::levels()[level].tiles;
+  float dx = target.lng() - ll.lng();
+  float dy = target.lat() - ll.lat();
+  const float norm = std::sqrt(dx * dx + dy * dy);
+  if (norm == 0.f) {
+    return;
+  }
+  dx *= tiles.TileSize() / norm;
+  dy *= tiles.TileSize() / norm;
+  constexpr float kDiagonal = 0.70710678f;
+  const int32_t current = tiles.TileId(ll);
+  for (const auto& ahead : {midgard::PointLL(ll.lng() + dx, ll.lat() + dy),
+                            midgard::PointLL(ll.lng() + (dx - dy) * kDiagonal,
+                                             ll.lat() + (dy + dx) * kDiagonal),
+                            midgard::PointLL(ll.lng() + (dx + dy) * kDiagonal,
+                                             ll.lat() + (dy - dx) * kDiagonal)}) {
+    const int32_t tileid = tiles.TileId(ahead);
+    if (tileid >= 0 && tileid != current) {
+      ReadAhead(GraphId(tileid, level, 0));
+    }
+  }
+}
+
+void GraphReader::ReadAhead(const GraphId& base) {
+  if (cache_->Contains(base)) {
+    return;
+  }
+
+  // where the bytes of the tile are, if we have it at all
+  const std::pair<char*, size_t>* extract_tile = nullptr;
+  std::string file_name;
+  if (!tile_extract_->tiles.empty()) {
+    auto t = tile_extract_->tiles.find(base);
+    if (t == tile_extract_->tiles.cend()) {
+      return;
+    }
+    extract_tile = &t->second;
+  } else if (!tile_dir_.empty()) {
+    file_name = tile_dir_ + filesystem::path::preferred_separator + GraphTile::FileSuffix(base);
+  } else {
+    return;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(prefetched_lock_);
+    if (!prefetched_.insert(base).second) {
+      return;
+    }
+  }
+  ++prefetch_issued_;
+
+  // the kernel reads the pages in the background, we don't wait for them
+  if (extract_tile) {
+#ifdef POSIX_MADV_WILLNEED
+    static const uintptr_t page_size = sysconf(_SC_PAGESIZE);
+    const auto begin = reinterpret_cast<uintptr_t>(extract_tile->first);
+    const auto aligned = begin & ~(page_size - 1);
+    posix_madvise(reinterpret_cast<void*>(aligned), begin - aligned + extract_tile->second,
+                  POSIX_MADV_WILLNEED);
+#endif
+  } else {
+#ifdef POSIX_FADV_WILLNEED
+    int fd = open(file_name.c_str(), O_RDONLY);
+    if (fd >= 0) {
+      posix_fadvise(fd, 0, 0, POSIX_FADV_WILLNEED);
+      close(fd);
+    }
+#endif
+  }
+}
+
+void GraphReader::CountPrefetch(const GraphId& base) {
+  if (!tile_prefetch_) {
+    return;
+  }
+  bool prefetched;
+  {
+    std::lock_guard<std::mutex> lock(prefetched_lock_);
+    prefetched = prefetched_.erase(base) > 0;
+  }
+  ++(prefetched ? prefetch_hits_ : prefetch_misses_);
+}
+
 // Convenience method to get an opposing directed edge graph Id.
 GraphId GraphReader::GetOpposingEdgeId(const GraphId& edgeid, graph_tile_ptr& opp_tile) {
   // If you cant get the tile you get an invalid id
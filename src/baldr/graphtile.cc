@@ -8,9 +8,11 @@
 #include "filesystem.h"
 #include "midgard/aabb2.h"
 #include "midgard/pointll.h"
+#include "midgard/sequence.h"
 #include "midgard/tiles.h"
 
 #include <boost/algorithm/string.hpp>
+#include <lz4frame.h>
 #include <chrono>
 #include <cmath>
 #include <cstdio>
@@ -56,29 +58,63 @@ private:
   const std::vector<char> memory_;
 };
 
+class MappedGraphMemory final : public GraphMemory {
+public:
+  MappedGraphMemory(const std::string& file_name, size_t file_size) {
+    memory_.map_readonly(file_name, file_size);
+    data = memory_.get();
+    size = memory_.size();
+  }
+
+  bool mapped() const override {
+    return true;
+  }
+
+private:
+  midgard::mem_map<char> memory_;
+};
+
 graph_tile_ptr GraphTile::DecompressTile(const GraphId& graphid,
                                          const std::vector<char>& compressed) {
+  return Decompress(graphid, compressed.data(), compressed.size());
+}
+
+graph_tile_ptr GraphTile::Decompress(const GraphId& graphid,
+                                     const char* compressed,
+                                     size_t compressed_size,
+                                     std::unique_ptr<const GraphMemory>&& traffic_memory) {
   // for setting where to read compressed data from
-  auto src_func = [&compressed](z_stream& s) -> void {
-    s.next_in =
-        const_cast<Byte*>(static_cast<const Byte*>(static_cast<const void*>(compressed.data())));
-    s.avail_in = static_cast<unsigned int>(compressed.size());
+  auto src_func = [compressed, compressed_size](z_stream& s) -> void {
+    s.next_in = const_cast<Byte*>(static_cast<const Byte*>(static_cast<const void*>(compressed)));
+    s.avail_in = static_cast<unsigned int>(compressed_size);
   };
 
+  // gzip ends with the inflated size, with it we can allocate the tile once. one extra byte so
+  // the buffer isnt full when the stream ends, that would make us grow it for nothing
+  size_t inflated_size = static_cast<size_t>(compressed_size * COMPRESSION_HINT);
+  if (compressed_size > 18 && static_cast<unsigned char>(compressed[0]) == 0x1f &&
+      static_cast<unsigned char>(compressed[1]) == 0x8b) {
+    uint32_t isize;
+    std::memcpy(&isize, compressed + compressed_size - sizeof(isize), sizeof(isize));
+    inflated_size = static_cast<size_t>(isize) + 1;
+  }
+
   // for setting where to write the uncompressed data to
   std::vector<char> data;
-  auto dst_func = [&data, &compressed](z_stream& s) -> int {
+  auto dst_func = [&data, inflated_size, compressed_size](z_stream& s) -> int {
     // if the whole buffer wasn't used we are done
     auto size = data.size();
     if (s.total_out < size)
       data.resize(s.total_out);
     // we need more space
     else {
-      // assume we need 3.5x the space
-      data.resize(size + (compressed.size() * COMPRESSION_HINT));
+      // the first time around use the size we expect, after that assume we need 3.5x the space
+      size_t grow =
+          size == 0 ? inflated_size : static_cast<size_t>(compressed_size * COMPRESSION_HINT);
+      data.resize(size + grow);
       // set the pointer to the next spot
       s.next_out = static_cast<Byte*>(static_cast<void*>(data.data() + size));
-      s.avail_out = compressed.size() * COMPRESSION_HINT;
+      s.avail_out = grow;
     }
     return Z_NO_FLUSH;
   };
@@ -89,14 +125,66 @@ graph_tile_ptr GraphTile::DecompressTile(const GraphId& graphid,
     return nullptr;
   }
 
-  return graph_tile_ptr{
-      new GraphTile(graphid, std::make_unique<const VectorGraphMemory>(std::move(data)))};
+  return graph_tile_ptr{new GraphTile(graphid,
+                                      std::make_unique<const VectorGraphMemory>(std::move(data)),
+                                      std::move(traffic_memory))};
+}
+
+graph_tile_ptr GraphTile::DecompressLZ4(const GraphId& graphid,
+                                        const char* compressed,
+                                        size_t compressed_size,
+                                        std::unique_ptr<const GraphMemory>&& traffic_memory) {
+  LZ4F_decompressionContext_t decode;
+  if (LZ4F_isError(LZ4F_createDecompressionContext(&decode, LZ4F_VERSION))) {
+    LOG_ERROR("Failed to create an lz4 decompression context");
+    return nullptr;
+  }
+
+  // the frame header holds the decoded size if the writer stored it, with it we can allocate the
+  // tile once
+  LZ4F_frameInfo_t info{};
+  size_t consumed = compressed_size;
+  size_t result = LZ4F_getFrameInfo(decode, &info, compressed, &consumed);
+  std::vector<char> data;
+  if (!LZ4F_isError(result)) {
+    data.resize(info.contentSize ? static_cast<size_t>(info.contentSize)
+                                 : static_cast<size_t>(compressed_size * COMPRESSION_HINT));
+  }
+
+  // decode the blocks, growing the buffer if the size wasn't stored
+  size_t in = consumed, out = 0;
+  while (!LZ4F_isError(result) && result != 0) {
+    if (out == data.size()) {
+      data.resize(data.size() + static_cast<size_t>(compressed_size * COMPRESSION_HINT));
+    }
+    size_t src_size = compressed_size - in;
+    size_t dst_size = data.size() - out;
+    result = LZ4F_decompress(decode, data.data() + out, &dst_size, compressed + in, &src_size,
+                             nullptr);
+    in += src_size;
+    out += dst_size;
+    // the frame ended early
+    if (!LZ4F_isError(result) && result != 0 && in == compressed_size && dst_size == 0) {
+      break;
+    }
+  }
+  LZ4F_freeDecompressionContext(decode);
+  if (result != 0) {
+    LOG_ERROR("Failed to decode " + GraphTile::FileSuffix(graphid) + " from lz4");
+    return nullptr;
+  }
+  data.resize(out);
+
+  return graph_tile_ptr{new GraphTile(graphid,
+                                      std::make_unique<const VectorGraphMemory>(std::move(data)),
+                                      std::move(traffic_memory))};
 }
 
 // Constructor given a filename. Reads the graph data into memory.
 graph_tile_ptr GraphTile::Create(const std::string& tile_dir,
                                  const GraphId& graphid,
-                                 std::unique_ptr<const GraphMemory>&& traffic_memory) {
+                                 std::unique_ptr<const GraphMemory>&& traffic_memory,
+                                 const bool mmap) {
   if (!graphid.Is_Valid()) {
     LOG_ERROR("Failed to build GraphTile. Error: GraphId is invalid");
     return nullptr;
@@ -117,8 +205,19 @@ graph_tile_ptr GraphTile::Create(const std::string& tile_dir,
       tile_dir + filesystem::path::preferred_separator + FileSuffix(graphid.Tile_Base());
   std::ifstream file(file_location, std::ios::in | std::ios::binary | std::ios::ate);
   if (file.is_open()) {
-    // Read binary file into memory. TODO - protect against failure to allocate memory
+    // Map the file so the tile bytes only live in the page cache, if that fails read it after all
     size_t filesize = file.tellg();
+    if (mmap && filesize > 0) {
+      try {
+        auto memory = std::make_unique<const MappedGraphMemory>(file_location, filesize);
+        return graph_tile_ptr{
+            new GraphTile(graphid, std::move(memory), std::move(traffic_memory))};
+      } catch (const std::exception& e) {
+        LOG_WARN("Failed to mmap " + file_location + ", reading it instead: " + e.what());
+      }
+    }
+
+    // Read binary file into memory. TODO - protect against failure to allocate memory
 
     std::vector<char> data(filesize);
     file.seekg(0, std::ios::beg);
@@ -16,7 +16,9 @@ def dict_or_str(func):
             return func(*args)
 
         if isinstance(args[1], dict):
-            return json.loads(func(args[0], json.dumps(args[1])))
+            response = func(args[0], json.dumps(args[1]))
+            # pbf responses come back as bytes which we hand back untouched
+            return json.loads(response) if isinstance(response, str) else response
         elif not isinstance(args[1], str):
             raise ValueError("Request must be either of type str or dict")
         return func(*args)
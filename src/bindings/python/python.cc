@@ -1,4 +1,5 @@
 #include <pybind11/pybind11.h>
+#include <pybind11/stl.h>
 
 #include "baldr/rapidjson_utils.h"
 #include <boost/make_shared.hpp>
@@ -36,43 +37,101 @@ const boost::property_tree::ptree configure(const std::string& config) {
 
   return pt;
 }
-} // namespace
 
 namespace py = pybind11;
 
+using action_t = std::string (vt::actor_t::*)(const std::string&,
+                                               const std::function<void()>*,
+                                               valhalla::Api*);
+
+// pbf responses are bytes, handing them back as str would have python decode them as utf-8
+py::object to_python(const std::string& response, bool pbf) {
+  if (pbf)
+    return py::bytes(response);
+  return py::str(response);
+}
+
+// binds one of the actions of the actor, the parsed request tells us what format came back
+std::function<py::object(vt::actor_t&, const std::string&)> bind_action(action_t action) {
+  return [action](vt::actor_t& self, const std::string& req) {
+    valhalla::Api api;
+    auto response = (self.*action)(req, nullptr, &api);
+    return to_python(response, api.options().format() == valhalla::Options::pbf);
+  };
+}
+
+// the batch calls dont hand back their requests so we peek at the format ourselves
+bool wants_pbf(const std::string& req) {
+  rapidjson::Document doc;
+  doc.Parse(req.c_str());
+  return !doc.HasParseError() && doc.IsObject() &&
+         rapidjson::get<std::string>(doc, "/format", std::string()) == "pbf";
+}
+} // namespace
+
 PYBIND11_MODULE(python_valhalla, m) {
   py::class_<vt::actor_t>(m, "_Actor", "Valhalla Actor class")
       .def(py::init<>([](std::string config) { return vt::actor_t(configure(config), true); }))
-      .def("route", [](vt::actor_t& self, std::string& req) { return self.route(req); },
-           "Calculates a route.")
-      .def("locate", [](vt::actor_t& self, std::string& req) { return self.locate(req); },
-           "Provides information about nodes and edges.")
-      .def("optimized_route",
-           [](vt::actor_t& self, std::string& req) { return self.optimized_route(req); },
+      .def("route", bind_action(&vt::actor_t::route), "Calculates a route.")
+      .def("locate", bind_action(&vt::actor_t::locate), "Provides information about nodes and edges.")
+      .def("optimized_route", bind_action(&vt::actor_t::optimized_route),
            "Optimizes the order of a set of waypoints by time.")
       .def(
-          "matrix", [](vt::actor_t& self, std::string& req) { return self.matrix(req); },
+          "matrix", bind_action(&vt::actor_t::matrix),
           "Computes the time and distance between a set of locations and returns them as a matrix table.")
-      .def("isochrone", [](vt::actor_t& self, std::string& req) { return self.isochrone(req); },
+      .def("isochrone", bind_action(&vt::actor_t::isochrone),
            "Calculates isochrones and isodistances.")
-      .def("trace_route", [](vt::actor_t& self, std::string& req) { return self.trace_route(req); },
+      .def("trace_route", bind_action(&vt::actor_t::trace_route),
            "Map-matching for a set of input locations, e.g. from a GPS.")
       .def(
-          "trace_attributes",
-          [](vt::actor_t& self, std::string& req) { return self.trace_attributes(req); },
+          "trace_attributes", bind_action(&vt::actor_t::trace_attributes),
           "Returns detailed attribution along each portion of a route calculated from a set of input locations, e.g. from a GPS trace.")
-      .def("height", [](vt::actor_t& self, std::string& req) { return self.height(req); },
+      .def(
+          "trace_attributes_batch",
+          [](vt::actor_t& self, const std::vector<std::string>& reqs) {
+            std::vector<std::string> results(reqs.size());
+            {
+              py::gil_scoped_release release;
+              self.trace_attributes_batch(reqs, [&results](size_t i, const std::string& result) {
+                results[i] = result;
+              });
+            }
+            py::list responses;
+            for (size_t i = 0; i < results.size(); ++i)
+              responses.append(to_python(results[i], wants_pbf(reqs[i])));
+            return responses;
+          },
+          "Returns the trace_attributes of many traces at once, matching them in parallel.")
+      .def(
+          "locate_batch",
+          [](vt::actor_t& self, const std::string& req) {
+            std::vector<std::pair<std::vector<size_t>, std::string>> results;
+            {
+              py::gil_scoped_release release;
+              self.locate_batch(req, [&results](const std::vector<size_t>& indices,
+                                                const std::string& result) {
+                results.emplace_back(indices, result);
+              });
+            }
+            py::list responses;
+            bool pbf = wants_pbf(req);
+            for (const auto& result : results)
+              responses.append(py::make_tuple(result.first, to_python(result.second, pbf)));
+            return responses;
+          },
+          "Returns the locate results of many locations at once, as (location indices, result) "
+          "pairs of chunks of neighbouring locations located in parallel.")
+      .def("height", bind_action(&vt::actor_t::height),
            "Provides elevation data for a set of input geometries.")
       .def(
-          "transit_available",
-          [](vt::actor_t& self, std::string& req) { return self.transit_available(req); },
+          "transit_available", bind_action(&vt::actor_t::transit_available),
           "Lookup if transit stops are available in a defined radius around a set of input locations.")
       .def(
-          "expansion", [](vt::actor_t& self, std::string& req) { return self.expansion(req); },
+          "expansion", bind_action(&vt::actor_t::expansion),
           "Returns all road segments which were touched by the routing algorithm during the graph traversal.")
       .def(
-          "centroid", [](vt::actor_t& self, std::string& req) { return self.centroid(req); },
+          "centroid", bind_action(&vt::actor_t::centroid),
           "Returns routes from all the input locations to the minimum cost meeting point of those paths.")
-      .def("status", [](vt::actor_t& self, std::string& req) { return self.status(req); },
+      .def("status", bind_action(&vt::actor_t::status),
            "Returns nothing or optionally details about Valhalla's configuration.");
 }
@@ -10,6 +10,7 @@
 #include <cmath>
 #include <iterator>
 #include <list>
+#include <tuple>
 #include <unordered_set>
 
 using namespace valhalla::midgard;
@@ -247,6 +248,7 @@ struct bin_handler_t {
   std::shared_ptr<DynamicCost> costing;
   unsigned int max_reach_limit;
   std::vector<candidate_t> bin_candidates;
+  shape_buffer_t shape_points;
   std::unordered_set<uint64_t> correlated_edges;
   Reach reach_finder;
 
@@ -546,31 +548,26 @@ struct bin_handler_t {
       // get some shape of the edge
       auto edge_info = std::make_shared<const EdgeInfo>(tile->edgeinfo(edge));
       auto shape = edge_info->lazy_shape();
-      PointLL v;
-      if (!shape.empty()) {
-        v = shape.pop();
-      }
+      shape_points.decode(shape);
 
-      // iterate along this edges segments projecting each of the points
-      for (size_t i = 0; !shape.empty(); ++i) {
-        auto u = v;
-        v = shape.pop();
-        // for each input point
-        c_itr = bin_candidates.begin();
-        for (p_itr = begin; p_itr != end; ++p_itr, ++c_itr) {
-          // skip updating this candidate because it was prefiltered
-          if (c_itr->prefiltered) {
-            continue;
-          }
-          // how close is the input to this segment
-          auto point = p_itr->project(u, v);
-          auto sq_distance = p_itr->project.approx.DistanceSquared(point);
-          // do we want to keep it
-          if (sq_distance < c_itr->sq_distance) {
-            c_itr->sq_distance = sq_distance;
-            c_itr->point = std::move(point);
-            c_itr->index = i;
-          }
+      // project each of the input points onto all of the segments of this edge
+      c_itr = bin_candidates.begin();
+      for (p_itr = begin; p_itr != end; ++p_itr, ++c_itr) {
+        // skip updating this candidate because it was prefiltered
+        if (c_itr->prefiltered) {
+          continue;
+        }
+        // how close is the input to this edge
+        PointLL point;
+        double sq_distance;
+        size_t index;
+        std::tie(point, sq_distance, index) =
+            p_itr->project(shape_points.lngs.data(), shape_points.lats.data(), shape_points.size());
+        // do we want to keep it
+        if (sq_distance < c_itr->sq_distance) {
+          c_itr->sq_distance = sq_distance;
+          c_itr->point = std::move(point);
+          c_itr->index = index;
         }
       }
 
@@ -661,32 +658,21 @@ struct bin_handler_t {
     }
   }
 
-  // Find the best range to do.  The given vector should be sorted for
-  // interesting grouping.  Returns the greatest range of non empty
-  // equal bins.
-  std::pair<std::vector<projector_wrapper>::iterator, std::vector<projector_wrapper>::iterator>
-  find_best_range(std::vector<projector_wrapper>& pps) const {
-    auto best = std::make_pair(pps.begin(), pps.begin());
-    auto cur = best;
-    while (cur.second != pps.end()) {
-      cur.first = cur.second;
-      cur.second = std::find_if_not(cur.first, pps.end(), [&cur](const projector_wrapper& pp) {
-        return cur.first->has_same_bin(pp);
-      });
-      if (cur.first->has_bin() && cur.second - cur.first > best.second - best.first) {
-        best = cur;
-      }
-    }
-    return best;
-  }
-
   // we keep the points sorted at each round such that unfinished ones
-  // are at the front of the sorted list
+  // are at the front of the sorted list. each round handles all the bins
+  // the points are waiting on, the points sharing a bin together, so that
+  // many points cost one sort per round rather than one per bin
   void search() {
     std::sort(pps.begin(), pps.end());
     while (pps.front().has_bin()) {
-      auto range = find_best_range(pps);
-      handle_bin(range.first, range.second);
+      auto begin = pps.begin();
+      while (begin != pps.end() && begin->has_bin()) {
+        auto end = std::find_if_not(begin, pps.end(), [&begin](const projector_wrapper& pp) {
+          return begin->has_same_bin(pp);
+        });
+        handle_bin(begin, end);
+        begin = end;
+      }
       std::sort(pps.begin(), pps.end());
     }
   }
@@ -0,0 +1,152 @@
+#include "meili/candidate_index.h"
+#include "baldr/tilehierarchy.h"
+#include "meili/grid_traversal.h"
+
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <tuple>
+
+using namespace valhalla::midgard;
+
+namespace {
+
+// The indexes in use keyed by graph reader and cell size
+std::mutex indexes_lock;
+std::map<std::tuple<const valhalla::baldr::GraphReader*, float, float>,
+         std::weak_ptr<valhalla::meili::CandidateIndex>>
+    indexes;
+
+} // namespace
+
+namespace valhalla {
+namespace meili {
+
+CandidateIndex::CandidateIndex(float cell_width, float cell_height)
+    : cell_width_(cell_width), cell_height_(cell_height),
+      bin_level_(baldr::TileHierarchy::levels().back().level) {
+}
+
+std::shared_ptr<CandidateIndex>
+CandidateIndex::Get(const baldr::GraphReader& reader, float cell_width, float cell_height) {
+  std::lock_guard<std::mutex> lock(indexes_lock);
+  // forget the indexes nobody uses anymore, their reader may be gone too
+  for (auto it = indexes.begin(); it != indexes.end();) {
+    it = it->second.expired() ? indexes.erase(it) : std::next(it);
+  }
+  auto& index = indexes[std::make_tuple(&reader, cell_width, cell_height)];
+  auto shared = index.lock();
+  if (!shared) {
+    shared = std::make_shared<CandidateIndex>(cell_width, cell_height);
+    index = shared;
+  }
+  return shared;
+}
+
+size_t CandidateIndex::size() const {
+  std::lock_guard<std::mutex> lock(lock_);
+  return bins_.size();
+}
+
+void CandidateIndex::Clear() {
+  std::lock_guard<std::mutex> lock(lock_);
+  bins_.clear();
+}
+
+std::shared_ptr<const CandidateIndex::bin_t>
+CandidateIndex::GetBin(baldr::GraphReader& reader,
+                       const int32_t bin_id,
+                       const Tiles<PointLL>& tiles,
+                       const Tiles<PointLL>& bins) const {
+  {
+    std::lock_guard<std::mutex> lock(lock_);
+    const auto it = bins_.find(bin_id);
+    if (it != bins_.end()) {
+      return it->second;
+    }
+  }
+
+  // Not indexed yet. Get the tile the bin is in and the index of the bin within it (row-ordered)
+  int32_t ndiv = tiles.nsubdivisions();
+  auto rc = bins.GetRowColumn(bin_id);
+  int32_t tile_id = tiles.TileId(rc.second / ndiv, rc.first / ndiv);
+  auto tile = reader.GetGraphTile(baldr::GraphId(tile_id, bin_level_, 0));
+  if (!tile) {
+    return nullptr;
+  }
+  int32_t bin_index = (rc.first % ndiv) * ndiv + (rc.second % ndiv);
+
+  // Add the cells each line segment of the edges in the bin passes through. The segments
+  // outside of the bin are clipped away, they are indexed in the bins they are in. Only one
+  // direction of each edge is in a bin
+  auto bin = std::make_shared<bin_t>();
+  bin->bbox = bins.TileBounds(bin_id);
+  bin->ncols = std::max(1, static_cast<int32_t>(std::ceil(bin->bbox.Width() / cell_width_)));
+  bin->nrows = std::max(1, static_cast<int32_t>(std::ceil(bin->bbox.Height() / cell_height_)));
+  GridTraversal<PointLL> grid(bin->bbox.minx(), bin->bbox.miny(), cell_width_, cell_height_,
+                              bin->ncols, bin->nrows);
+  for (const auto& edge_id : tile->GetBin(bin_index)) {
+    // edges in a bin can be in a different tile if they pass through the tile
+    auto edge_tile = tile;
+    reader.GetGraphTile(edge_id, edge_tile);
+    if (edge_tile == nullptr) {
+      continue;
+    }
+    // NOTE: bins do not contain transition edges and transit connection edges
+    auto shape = edge_tile->edgeinfo(edge_tile->directededge(edge_id)).lazy_shape();
+    if (shape.empty()) {
+      continue;
+    }
+    PointLL v = shape.pop();
+    while (!shape.empty()) {
+      const PointLL u = v;
+      v = shape.pop();
+      for (const auto& square : grid.Traverse(u, v)) {
+        bin->cells.emplace_back(static_cast<uint32_t>(square.second * bin->ncols + square.first),
+                                edge_id);
+      }
+    }
+  }
+  std::sort(bin->cells.begin(), bin->cells.end());
+  bin->cells.erase(std::unique(bin->cells.begin(), bin->cells.end()), bin->cells.end());
+  bin->cells.shrink_to_fit();
+
+  // another thread may have indexed the same bin in the meantime, the first one is kept
+  std::lock_guard<std::mutex> lock(lock_);
+  return bins_.emplace(bin_id, std::move(bin)).first->second;
+}
+
+std::unordered_set<baldr::GraphId> CandidateIndex::Query(baldr::GraphReader& reader,
+                                                         const AABB2<PointLL>& range) const {
+  // Get the tiles object from the tile hierarchy and create the bin tiles
+  // (subdivisions within the tile)
+  const Tiles<PointLL>& tiles = baldr::TileHierarchy::levels().back().tiles;
+  Tiles<PointLL> bins(tiles.TileBounds(), tiles.SubdivisionSize());
+
+  std::unordered_set<baldr::GraphId> result;
+  for (auto bin_id : bins.TileList(range)) {
+    auto bin = GetBin(reader, bin_id, tiles, bins);
+    if (!bin) {
+      continue;
+    }
+
+    // the cells of the bin the range covers, the cells of a row are consecutive in the list
+    auto clamp = [](int32_t value, int32_t count) { return std::max(0, std::min(value, count - 1)); };
+    int32_t mincol = clamp(std::floor((range.minx() - bin->bbox.minx()) / cell_width_), bin->ncols);
+    int32_t maxcol = clamp(std::floor((range.maxx() - bin->bbox.minx()) / cell_width_), bin->ncols);
+    int32_t minrow = clamp(std::floor((range.miny() - bin->bbox.miny()) / cell_height_), bin->nrows);
+    int32_t maxrow = clamp(std::floor((range.maxy() - bin->bbox.miny()) / cell_height_), bin->nrows);
+    for (int32_t row = minrow; row <= maxrow; ++row) {
+      const uint32_t first = row * bin->ncols + mincol, last = row * bin->ncols + maxcol;
+      auto it = std::lower_bound(bin->cells.begin(), bin->cells.end(), first,
+                                 [](const auto& cell, uint32_t c) { return cell.first < c; });
+      for (; it != bin->cells.end() && it->first <= last; ++it) {
+        result.insert(it->second);
+      }
+    }
+  }
+  return result;
+}
+
+} // namespace meili
+} // namespace valhalla
@@ -1,5 +1,4 @@
 #include "meili/candidate_search.h"
-#include "baldr/tilehierarchy.h"
 #include "meili/geometry_helpers.h"
 
 using namespace valhalla::midgard;
@@ -128,104 +127,14 @@ CandidateCollector::WithinSquaredDistance(const midgard::PointLL& location,
   return candidates;
 }
 
-// Add each road linestring's line segments into grid. Only one side
-// of directed edges is added
-void IndexBin(const graph_tile_ptr& tile,
-              const int32_t bin_index,
-              baldr::GraphReader& reader,
-              CandidateGridQuery::grid_t& grid) {
-  assert(tile);
-
-  // Get the edges within the specified bin.
-  auto edge_ids = tile->GetBin(bin_index);
-  for (const auto& edge_id : edge_ids) {
-    // Get the right tile (edges in a bin can be in a different tile if they
-    // pass through the tile but do not start or end in the tile). Skip if
-    // tile is null.
-    auto bin_tile = tile;
-    reader.GetGraphTile(edge_id, bin_tile);
-    if (bin_tile == nullptr) {
-      continue;
-    }
-
-    // Get the edge shape and add to grid. Use lazy_shape to avoid allocations
-    // NOTE: bins do not contain transition edges and transit connection edges
-    auto shape = bin_tile->edgeinfo(bin_tile->directededge(edge_id)).lazy_shape();
-    if (!shape.empty()) {
-      PointLL v = shape.pop();
-      while (!shape.empty()) {
-        const PointLL u = v;
-        v = shape.pop();
-        grid.AddLineSegment(edge_id, {u, v});
-      }
-    }
-  }
-}
-
 CandidateGridQuery::CandidateGridQuery(baldr::GraphReader& reader,
                                        float cell_width,
                                        float cell_height)
-    : reader_(reader), cell_width_(cell_width), cell_height_(cell_height), grid_cache_() {
-  bin_level_ = baldr::TileHierarchy::levels().back().level;
+    : reader_(reader), index_(CandidateIndex::Get(reader, cell_width, cell_height)) {
 }
 
 CandidateGridQuery::~CandidateGridQuery() = default;
 
-inline const CandidateGridQuery::grid_t*
-CandidateGridQuery::GetGrid(const int32_t bin_id,
-                            const Tiles<PointLL>& tiles,
-                            const Tiles<PointLL>& bins) const {
-  // Check if the bin is in the cache
-  const auto it = grid_cache_.find(bin_id);
-  if (it != grid_cache_.end()) {
-    return &(it->second);
-  }
-
-  // Not in the cache. Get the tile and Index the bin within the tile.
-  int32_t ndiv = tiles.nsubdivisions();
-  auto rc = bins.GetRowColumn(bin_id);
-  int32_t tile_id = tiles.TileId(rc.second / ndiv, rc.first / ndiv);
-  baldr::GraphId tileid(tile_id, bin_level_, 0);
-  auto tile = reader_.GetGraphTile(tileid);
-  if (!tile) {
-    return nullptr;
-  }
-
-  // Compute bin index within the tile (row-ordered)
-  int32_t bin_row = rc.first % ndiv;
-  int32_t bin_col = rc.second % ndiv;
-  int32_t bin_index = (bin_row * ndiv) + bin_col;
-
-  // Insert the bin into the cache and index the bin
-  const auto inserted =
-      grid_cache_.emplace(bin_id, grid_t(tile->BoundingBox(), cell_width_, cell_height_));
-  IndexBin(tile, bin_index, reader_, inserted.first->second);
-  return &(inserted.first->second);
-}
-
-std::unordered_set<baldr::GraphId>
-CandidateGridQuery::RangeQuery(const AABB2<midgard::PointLL>& range) const {
-  // Get the tiles object from the tile hierarchy and create the bin tiles
-  // (subdivisions within the tile)
-  const Tiles<PointLL>& tiles = baldr::TileHierarchy::levels().back().tiles;
-  Tiles<PointLL> bins(tiles.TileBounds(), tiles.SubdivisionSize());
-
-  // Get a list of bins within the range. These are "tile Ids" that must
-  // be resolved to a Graph Id (tile) / bin combination
-  auto bin_list = bins.TileList(range);
-
-  // Iterate through the bins and query grids to get results
-  std::unordered_set<baldr::GraphId> result;
-  for (auto bin_id : bin_list) {
-    auto grid = GetGrid(bin_id, tiles, bins);
-    if (grid) {
-      const auto set = grid->Query(range);
-      result.insert(set.begin(), set.end());
-    }
-  }
-  return result;
-}
-
 std::vector<baldr::PathLocation> CandidateGridQuery::Query(const midgard::PointLL& location,
                                                            baldr::Location::StopType stop_type,
                                                            float sq_search_radius,
@@ -37,6 +37,7 @@ void Config::Read(const boost::property_tree::ptree& params) {
   transition_cost.Read(params);
   emission_cost.Read(params);
   routing.Read(params);
+  session.Read(params);
 }
 
 void Config::CandidateSearch::Read(const boost::property_tree::ptree& params) {
@@ -83,6 +84,8 @@ void Config::TransitionCost::Read(const boost::property_tree::ptree& params) {
   if (const auto node = params.get_child_optional("customizable")) {
     is_turn_penalty_factor_customizable = FindValue(*node, "turn_penalty_factor");
   }
+
+  ReadParamOptional(cache_routes, params, "default.cache_routes");
 }
 
 void Config::EmissionCost::Read(const boost::property_tree::ptree& params) {
@@ -108,5 +111,17 @@ void Config::Routing::Read(const boost::property_tree::ptree& params) {
   }
 }
 
+void Config::Session::Read(const boost::property_tree::ptree& params) {
+  ReadParamOptional(max_window, params, "session.max_window");
+  CHECK_THROWS(max_window >= 2, std::string("Expect 'max_window' to be at least 2 (got: ") +
+                                    std::to_string(max_window) + ")");
+
+  ReadParamOptional(ttl_seconds, params, "session.ttl");
+  CHECK_THROWS(ttl_seconds >= 0.f, NONNEGATIVE_VALUE_MSG(ttl_seconds, "ttl"));
+
+  ReadParamOptional(max_sessions, params, "session.max_sessions");
+  CHECK_THROWS(max_sessions > 0, POSITIVE_VALUE_MSG(max_sessions, "max_sessions"));
+}
+
 } // namespace meili
 } // namespace valhalla
\ No newline at end of file
@@ -17,43 +17,29 @@ namespace helpers {
 // snapped point, squared distance, segment index, offset
 std::tuple<PointLL, double, typename std::vector<PointLL>::size_type, double>
 Project(const projector_t& p, Shape7Decoder<midgard::PointLL>& shape, double snap_distance) {
-  PointLL first_point(shape.pop());
-  auto closest_point = first_point;
-  auto closest_segment_point = first_point;
-  double closest_distance = std::numeric_limits<double>::max();
-  size_t closest_segment = 0;
+  // decode the shape once for the vectorized projection onto all of its segments
+  thread_local shape_buffer_t points;
+  points.decode(shape);
+  PointLL closest_point;
+  double closest_distance;
+  size_t closest_segment;
+  std::tie(closest_point, closest_distance, closest_segment) =
+      p(points.lngs.data(), points.lats.data(), points.size());
+
+  // edge length and how far along it the closest segment begins
   double closest_partial_length = 0.0;
   double total_length = 0.0;
-
-  // for each segment
-  auto u = first_point;
-  size_t i = 0;
-  for (; !shape.empty(); ++i) {
-    // project a onto b where b is the origin vector representing this segment
-    // and a is the origin vector to the point we are projecting, (a.b/b.b)*b
-    auto v = shape.pop();
-
-    auto projection = p(u, v);
-
-    // check if this point is better
-    const auto distance = p.approx.DistanceSquared(projection);
-    if (distance < closest_distance) {
-      closest_point = std::move(projection);
-      closest_distance = distance;
-      closest_segment = i;
+  for (size_t i = 0; i + 1 < points.size(); ++i) {
+    if (i == closest_segment) {
       closest_partial_length = total_length;
-      closest_segment_point = u;
     }
-
-    // total edge length
-    total_length += u.Distance(v);
-    u = v;
+    total_length += points[i].Distance(points[i + 1]);
   }
 
   // percent_along is a double between 0 and 1 representing the location of
   // the closest point on LineString to the given Point, as a fraction
   // of total 2d line length.
-  closest_partial_length += closest_segment_point.Distance(closest_point);
+  closest_partial_length += points[closest_segment].Distance(closest_point);
   double percent_along =
       total_length > 0.0 ? static_cast<double>(closest_partial_length / total_length) : 0.0;
 
@@ -82,14 +68,14 @@ Project(const projector_t& p, Shape7Decoder<midgard::PointLL>& shape, double sna
 
   // Snap to nearest node using snap_distance
   if (total_length * percent_along <= snap_distance) {
-    closest_point = first_point;
+    closest_point = points[0];
     closest_distance = p.approx.DistanceSquared(closest_point);
     closest_segment = 0;
     percent_along = 0.f;
   } else if (total_length * (1.f - percent_along) <= snap_distance) {
-    closest_point = u;
+    closest_point = points[points.size() - 1];
     closest_distance = p.approx.DistanceSquared(closest_point);
-    closest_segment = i - 1;
+    closest_segment = points.size() - 2;
     percent_along = 1.f;
   }
 
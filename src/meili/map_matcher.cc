@@ -502,7 +502,8 @@ MapMatcher::MapMatcher(const Config& config,
                              container_,
                              mode_costing_,
                              travelmode_,
-                             config_.transition_cost) {
+                             config_.transition_cost),
+      online_finalized_(0), online_offset_(0) {
   vs_.set_emission_cost_model(emission_cost_model_);
   vs_.set_transition_cost_model(transition_cost_model_);
 }
@@ -517,6 +518,10 @@ void MapMatcher::Clear() {
   vs_.set_transition_cost_model(transition_cost_model_);
   ts_.Clear();
   container_.Clear();
+  transition_cost_model_.Clear();
+  online_measurements_.clear();
+  online_finalized_ = 0;
+  online_offset_ = 0;
 }
 
 void MapMatcher::RemoveRedundancies(const std::vector<StateId>& result,
@@ -789,6 +794,8 @@ std::vector<MatchResults> MapMatcher::OfflineMatch(const std::vector<Measurement
     // Construct a result
     auto segments = ConstructRoute(*this, best_path);
     MatchResults match_results(std::move(best_path), std::move(segments), accumulated_cost);
+    match_results.route_cache_hits = transition_cost_model_.route_cache().hits();
+    match_results.route_cache_misses = transition_cost_model_.route_cache().misses();
 
     // We'll keep it if we don't have a duplicate already
     auto found_path = std::find(best_paths.rbegin(), best_paths.rend(), match_results);
@@ -820,6 +827,173 @@ std::vector<MatchResults> MapMatcher::OfflineMatch(const std::vector<Measurement
   return best_paths;
 }
 
+MatchResults MapMatcher::OnlineMatch(const Measurement& measurement) {
+  const float sq_max_search_radius = config_.candidate_search.max_search_radius_meters *
+                                     config_.candidate_search.max_search_radius_meters;
+  std::vector<MatchResult> results;
+  std::vector<EdgeSegment> segments;
+
+  // Whatever an offline match left behind is of no use
+  if (online_measurements_.empty() && container_.size() > 0) {
+    Clear();
+  }
+
+  online_measurements_.push_back(measurement);
+  const auto time = AppendMeasurement(measurement, sq_max_search_radius);
+  const auto winner = vs_.SearchWinner(time);
+
+  // If the measurement has no candidates or no path leads to them the paths so far end here. They
+  // are final and we start over from this measurement
+  if (!winner.IsValid() || (time > 0 && !vs_.Predecessor(winner).IsValid())) {
+    if (time > 0) {
+      FinalizeOnline(vs_.SearchWinner(time - 1), time, results, segments);
+      if (!segments.empty()) {
+        segments.back().discontinuity = true;
+      }
+    }
+    const auto offset = online_offset_ + time;
+    Clear();
+    online_offset_ = offset;
+    online_measurements_.push_back(measurement);
+    AppendMeasurement(measurement, sq_max_search_radius);
+    // Without candidates there is nothing to continue from
+    if (!winner.IsValid()) {
+      FinalizeOnline({}, 1, results, segments);
+      Clear();
+      online_offset_ = offset + 1;
+    }
+    return MatchResults(std::move(results), std::move(segments), 0.f);
+  }
+
+  // Walk the paths the search can still continue back in time until they all go through the same
+  // state. Labels still in the queue aren't scanned so we keep their predecessors on the side
+  auto frontier = vs_.Frontier();
+  std::sort(frontier.begin(), frontier.end(), [](const StateLabel& a, const StateLabel& b) {
+    return a.stateid().time() > b.stateid().time();
+  });
+  std::unordered_map<StateId, StateId> queued;
+  for (const auto& label : frontier) {
+    queued.emplace(label.stateid(), label.predecessor());
+  }
+  const auto earliest = frontier.empty() ? time : frontier.back().stateid().time();
+  std::unordered_set<StateId> states, predecessors;
+  StateId converged;
+  auto label = frontier.cbegin();
+  for (StateId::Time t = time; t > online_finalized_; --t) {
+    for (; label != frontier.cend() && label->stateid().time() == t; ++label) {
+      states.insert(label->stateid());
+    }
+    if (t <= earliest && states.size() == 1) {
+      converged = *states.begin();
+      break;
+    }
+    predecessors.clear();
+    for (const auto& state : states) {
+      const auto it = queued.find(state);
+      const auto predecessor = it != queued.cend() ? it->second : vs_.Predecessor(state);
+      if (predecessor.IsValid()) {
+        predecessors.insert(predecessor);
+      }
+    }
+    states.swap(predecessors);
+  }
+
+  // Everything before the state all paths go through is final. If there is none and the window is
+  // full we settle for the best path so far for the older half of the window
+  StateId last;
+  bool forced = false;
+  if (converged.IsValid()) {
+    last = FinalizeOnline(converged, converged.time(), results, segments);
+  } else if (time + 1 - online_finalized_ > config_.session.max_window) {
+    last = FinalizeOnline(winner, time + 1 - config_.session.max_window / 2, results, segments);
+    forced = true;
+  }
+
+  // Drop the states of the final measurements, the forced ones also need pinning so that the paths
+  // found from now on start from them
+  if (last.IsValid() && (forced || online_finalized_ > config_.session.max_window / 2)) {
+    CompactOnline(last);
+  }
+
+  return MatchResults(std::move(results), std::move(segments), 0.f);
+}
+
+MatchResults MapMatcher::FinishOnlineMatch() {
+  std::vector<MatchResult> results;
+  std::vector<EdgeSegment> segments;
+  if (!online_measurements_.empty()) {
+    const StateId::Time time = online_measurements_.size() - 1;
+    FinalizeOnline(vs_.SearchWinner(time), time + 1, results, segments);
+  }
+  Clear();
+  return MatchResults(std::move(results), std::move(segments), 0.f);
+}
+
+StateId MapMatcher::FinalizeOnline(const StateId& last,
+                                   StateId::Time end,
+                                   std::vector<MatchResult>& results,
+                                   std::vector<EdgeSegment>& segments) {
+  if (end <= online_finalized_) {
+    return {};
+  }
+
+  // The states of the path leading to the last state, the results need the state that follows
+  std::vector<StateId> state_ids(std::max<size_t>(end, last.IsValid() ? last.time() + 1 : 0));
+  for (auto state_id = last; state_id.IsValid(); state_id = vs_.Predecessor(state_id)) {
+    state_ids[state_id.time()] = state_id;
+  }
+  auto path = FindMatchResults(*this, state_ids, graphreader_);
+
+  // The last final measurement goes first so the segments continue from where the last ones ended
+  const StateId::Time first = online_finalized_ > 0 ? online_finalized_ - 1 : 0;
+  std::vector<MatchResult> final_results(path.begin() + first, path.begin() + end);
+  auto route = ConstructRoute(*this, final_results);
+  const int offset = online_offset_ + first;
+  for (auto& segment : route) {
+    segment.first_match_idx += segment.first_match_idx >= 0 ? offset : 0;
+    segment.last_match_idx += segment.last_match_idx >= 0 ? offset : 0;
+  }
+  segments.insert(segments.end(), route.begin(), route.end());
+  results.insert(results.end(), final_results.begin() + (online_finalized_ > 0 ? 1 : 0),
+                 final_results.end());
+  online_finalized_ = end;
+  return state_ids[end - 1];
+}
+
+void MapMatcher::CompactOnline(const StateId& pinned) {
+  const float sq_max_search_radius = config_.candidate_search.max_search_radius_meters *
+                                     config_.candidate_search.max_search_radius_meters;
+
+  // Start over from the last final measurement
+  const auto candidate = container_.state(pinned).candidate();
+  std::vector<Measurement> measurements(online_measurements_.begin() + pinned.time(),
+                                        online_measurements_.end());
+  const auto offset = online_offset_ + pinned.time();
+  Clear();
+  for (const auto& measurement : measurements) {
+    AppendMeasurement(measurement, sq_max_search_radius);
+  }
+  online_measurements_ = std::move(measurements);
+  online_finalized_ = 1;
+  online_offset_ = offset;
+
+  // And pin it to the state it was matched to
+  const auto& column = container_.column(0);
+  const auto same = [&candidate](const State& state) {
+    const auto& edge = state.candidate().edges.front();
+    return edge.id == candidate.edges.front().id &&
+           edge.percent_along == candidate.edges.front().percent_along;
+  };
+  if (std::any_of(column.begin(), column.end(), same)) {
+    for (const auto& state : column) {
+      if (!same(state)) {
+        vs_.RemoveStateId(state.stateid());
+      }
+    }
+    vs_.ClearSearch();
+  }
+}
+
 std::unordered_map<StateId::Time, std::vector<Measurement>>
 MapMatcher::AppendMeasurements(const std::vector<Measurement>& measurements) {
   const float sq_max_search_radius = config_.candidate_search.max_search_radius_meters *
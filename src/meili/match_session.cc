@@ -0,0 +1,75 @@
+#include "meili/match_session.h"
+#include "meili/config.h"
+
+namespace {
+
+valhalla::meili::MatchResults NoResults() {
+  return valhalla::meili::MatchResults(std::vector<valhalla::meili::MatchResult>{},
+                                       std::vector<valhalla::meili::EdgeSegment>{}, 0.f);
+}
+
+} // namespace
+
+namespace valhalla {
+namespace meili {
+
+MatchSessions::MatchSessions(const boost::property_tree::ptree& config,
+                             const std::shared_ptr<baldr::GraphReader>& reader)
+    : factory_(config, reader) {
+  Config meili(config.get_child("meili"));
+  ttl_ = std::chrono::duration<float>(meili.session.ttl_seconds);
+  max_sessions_ = meili.session.max_sessions;
+}
+
+MatchResults
+MatchSessions::Push(const std::string& id, const Options& options, const Measurement& measurement) {
+  std::lock_guard<std::mutex> lock(lock_);
+  const auto now = clock_t::now();
+  Evict(now);
+
+  // Start the session or move it to the back of the line
+  auto found = sessions_.find(id);
+  if (found == sessions_.end()) {
+    std::unique_ptr<MapMatcher> matcher(factory_.Create(options));
+    order_.push_back(id);
+    found = sessions_.emplace(id, session_t{std::move(matcher), now, std::prev(order_.end())}).first;
+  } else {
+    order_.splice(order_.end(), order_, found->second.order);
+  }
+  found->second.last_push = now;
+
+  auto results = found->second.matcher->OnlineMatch(measurement);
+  Evict(now);
+  return results;
+}
+
+MatchResults MatchSessions::Finish(const std::string& id) {
+  std::lock_guard<std::mutex> lock(lock_);
+  auto found = sessions_.find(id);
+  if (found == sessions_.end()) {
+    return NoResults();
+  }
+  auto results = found->second.matcher->FinishOnlineMatch();
+  order_.erase(found->second.order);
+  sessions_.erase(found);
+  return results;
+}
+
+size_t MatchSessions::size() const {
+  std::lock_guard<std::mutex> lock(lock_);
+  return sessions_.size();
+}
+
+void MatchSessions::Evict(const clock_t::time_point& now) {
+  while (!order_.empty()) {
+    auto oldest = sessions_.find(order_.front());
+    if (sessions_.size() <= max_sessions_ && now - oldest->second.last_push <= ttl_) {
+      break;
+    }
+    sessions_.erase(oldest);
+    order_.pop_front();
+  }
+}
+
+} // namespace meili
+} // namespace valhalla
@@ -1,3 +1,5 @@
+#include <algorithm>
+#include <limits>
 #include <unordered_map>
 #include <unordered_set>
 #include <vector>
@@ -617,6 +619,261 @@ find_shortest_path(baldr::GraphReader& reader,
   return results;
 }
 
+namespace {
+
+// Whether any of the locations is at a node, the route cache only handles locations along edges
+bool at_node(const std::vector<valhalla::baldr::PathLocation>& locations) {
+  return std::any_of(locations.begin(), locations.end(), [](const auto& location) {
+    return std::any_of(location.edges.begin(), location.edges.end(),
+                       [](const auto& edge) { return edge.begin_node() || edge.end_node(); });
+  });
+}
+
+} // namespace
+
+bool RouteCache::find(baldr::GraphReader& reader,
+                      const std::vector<baldr::PathLocation>& locations,
+                      labelset_ptr_t& labelset,
+                      std::unordered_map<uint16_t, uint32_t>& results,
+                      const sif::cost_ptr_t& costing,
+                      const Label* edgelabel,
+                      const float max_dist,
+                      const float max_time) {
+  if (locations.empty() || at_node(locations)) {
+    ++misses_;
+    return false;
+  }
+  const sif::TravelMode travelmode = costing->travel_mode();
+  Label origin_label = edgelabel ? *edgelabel : Label();
+  origin_label.InitAsOrigin(travelmode, 0, {});
+
+  // The origin edges the search would leave on, see find_shortest_path
+  struct origin_t {
+    const baldr::PathLocation::PathEdge* edge;
+    const baldr::DirectedEdge* directededge;
+    float length;
+    float secs;
+    uint8_t restriction_idx;
+  };
+  const auto& origin = locations.front();
+  const bool allows_immediate_uturn = origin.stoptype_ == baldr::Location::StopType::BREAK ||
+                                      origin.stoptype_ == baldr::Location::StopType::VIA;
+  std::vector<origin_t> origins;
+  for (const auto& origin_edge : origin.edges) {
+    graph_tile_ptr tile;
+    const auto* directededge = reader.directededge(origin_edge.id, tile);
+    uint8_t restriction_idx = -1;
+    if (!directededge || !IsEdgeAllowed(directededge, origin_edge.id, costing, origin_label, tile,
+                                        restriction_idx)) {
+      continue;
+    }
+    if (!allows_immediate_uturn && origin_label.edgeid().Is_Valid() &&
+        origin_label.edgeid() != origin_edge.id &&
+        origin_label.opp_local_idx() == directededge->localedgeidx()) {
+      continue;
+    }
+    origins.push_back({&origin_edge, directededge, static_cast<float>(directededge->length()),
+                       costing->EdgeCost(directededge, tile).secs, restriction_idx});
+  }
+
+  // Pick the cheapest route to every destination, along an origin edge or via a cached route
+  struct winner_t {
+    const origin_t* origin = nullptr;
+    const baldr::PathLocation::PathEdge* edge = nullptr;
+    const baldr::DirectedEdge* directededge = nullptr;
+    const route_t* route = nullptr;
+    float secs = 0.f;
+  };
+  std::vector<winner_t> winners(locations.size());
+  for (uint16_t dest = 1; dest < locations.size(); ++dest) {
+    float best = std::numeric_limits<float>::max();
+    std::vector<float> bounds;
+    for (const auto& o : origins) {
+      const auto from = routes_.find(o.edge->id);
+      for (const auto& dest_edge : locations[dest].edges) {
+        graph_tile_ptr tile;
+        const auto* directededge = reader.directededge(dest_edge.id, tile);
+        if (!directededge) {
+          continue;
+        }
+
+        // Further along the origin edge
+        float cost, secs;
+        const route_t* route = nullptr;
+        if (o.edge->id == dest_edge.id && o.edge->percent_along <= dest_edge.percent_along) {
+          const float f = dest_edge.percent_along - o.edge->percent_along;
+          cost = o.length * f;
+          secs = o.secs * f;
+        } // Or from the end of the origin edge to the start of this one
+        else {
+          if (from == routes_.end()) {
+            ++misses_;
+            return false;
+          }
+          const auto to = from->second.find(dest_edge.id);
+          if (to == from->second.end()) {
+            ++misses_;
+            return false;
+          }
+          route = &to->second;
+          const float f = 1.f - o.edge->percent_along;
+          cost = o.length * f + directededge->length() * dest_edge.percent_along;
+          if (!route->known) {
+            bounds.push_back(cost + route->lower_bound);
+            continue;
+          }
+          cost += route->cost;
+          secs = o.secs * f + route->secs +
+                 costing->EdgeCost(directededge, tile).secs * dest_edge.percent_along;
+        }
+
+        // Over the time limit the search might have found a longer but quicker route
+        if (cost >= max_dist) {
+          continue;
+        }
+        if (max_time >= 0 && secs >= max_time) {
+          ++misses_;
+          return false;
+        }
+        if (cost < best) {
+          best = cost;
+          winners[dest] = {&o, &dest_edge, directededge, route, secs};
+        }
+      }
+    }
+
+    // The routes we only have a bound for have to lose, otherwise we can't tell who wins
+    const float limit = std::min(best, max_dist);
+    if (std::any_of(bounds.begin(), bounds.end(), [limit](float bound) { return bound < limit; })) {
+      ++misses_;
+      return false;
+    }
+  }
+
+  // Make the labels of the winning routes like the search would have
+  auto cached = std::make_shared<LabelSet>(1.f);
+  std::unordered_map<uint16_t, uint32_t> found;
+  found[0] = cached->append(origin_label);
+  for (uint16_t dest = 1; dest < locations.size(); ++dest) {
+    const auto& winner = winners[dest];
+    if (!winner.origin) {
+      continue;
+    }
+    const auto& o = *winner.origin;
+    const float source = o.edge->percent_along;
+    const float target = winner.edge->percent_along;
+    if (!winner.route) {
+      const float f = target - source;
+      sif::Cost cost(o.length * f, o.secs * f);
+      found[dest] = cached->append(Label({}, dest, o.edge->id, source, target, cost, 0.f, cost.cost,
+                                         found[0], o.directededge, travelmode, o.restriction_idx));
+      continue;
+    }
+
+    sif::Cost cost(o.length * (1.f - source), o.secs * (1.f - source));
+    float turn_cost = 0.f;
+    uint32_t idx = cached->append(Label(o.directededge->endnode(), kInvalidDestination, o.edge->id,
+                                        source, 1.f, cost, turn_cost, cost.cost, found[0],
+                                        o.directededge, travelmode, o.restriction_idx));
+    const auto& steps = winner.route->steps;
+    for (size_t i = 0; i + 1 < steps.size(); ++i) {
+      const auto& step = steps[i];
+      graph_tile_ptr tile;
+      const auto* directededge = reader.directededge(step.edgeid, tile);
+      if (!directededge) {
+        ++misses_;
+        return false;
+      }
+      cost += sif::Cost(step.cost, step.secs);
+      turn_cost += step.turn_cost;
+      idx = cached->append(Label(step.nodeid, kInvalidDestination, step.edgeid, 0.f, 1.f, cost,
+                                 turn_cost, cost.cost, idx, directededge, travelmode,
+                                 step.restriction_idx));
+    }
+    const auto& last = steps.back();
+    cost = sif::Cost(cost.cost + winner.directededge->length() * target, winner.secs);
+    turn_cost += last.turn_cost;
+    found[dest] = cached->append(Label({}, dest, last.edgeid, 0.f, target, cost, turn_cost,
+                                       cost.cost, idx, winner.directededge, travelmode,
+                                       last.restriction_idx));
+  }
+
+  ++hits_;
+  labelset = std::move(cached);
+  results = std::move(found);
+  return true;
+}
+
+void RouteCache::insert(baldr::GraphReader& reader,
+                        const std::vector<baldr::PathLocation>& locations,
+                        const LabelSet& labelset,
+                        const std::unordered_map<uint16_t, uint32_t>& results,
+                        const sif::cost_ptr_t& costing,
+                        const float max_dist) {
+  if (locations.empty() || at_node(locations)) {
+    return;
+  }
+
+  for (uint16_t dest = 1; dest < locations.size(); ++dest) {
+    // Remember the edges between the first and the last edge of the route that was found
+    float bound = max_dist;
+    const auto found = results.find(dest);
+    if (found != results.end()) {
+      bound = labelset.label(found->second).cost().cost;
+      std::vector<const Label*> chain;
+      for (auto label = RoutePathIterator(&labelset, found->second);
+           label != RoutePathIterator(&labelset); ++label) {
+        chain.push_back(&*label);
+      }
+      std::reverse(chain.begin(), chain.end());
+      // the origin, the origin edge and the destination edge are the least we need
+      if (chain.size() > 2) {
+        auto& route = routes_[chain[1]->edgeid()][chain.back()->edgeid()];
+        if (!route.known) {
+          route.known = true;
+          route.cost = route.secs = 0.f;
+          route.steps.clear();
+          for (size_t i = 2; i < chain.size(); ++i) {
+            const auto& label = *chain[i];
+            const auto& prev = *chain[i - 1];
+            const bool last = i + 1 == chain.size();
+            const float cost = last ? 0.f : label.cost().cost - prev.cost().cost;
+            const float secs = last ? 0.f : label.cost().secs - prev.cost().secs;
+            route.steps.push_back({label.edgeid(), label.nodeid(), cost, secs,
+                                   label.turn_cost() - prev.turn_cost(), label.restriction_idx()});
+            route.cost += cost;
+            route.secs += secs;
+          }
+        }
+      }
+    }
+
+    // Any other pair of edges costs at least that much, or the limit if nothing was found
+    for (const auto& origin_edge : locations.front().edges) {
+      graph_tile_ptr tile;
+      const auto* origin_directededge = reader.directededge(origin_edge.id, tile);
+      if (!origin_directededge) {
+        continue;
+      }
+      for (const auto& dest_edge : locations[dest].edges) {
+        if (origin_edge.id == dest_edge.id && origin_edge.percent_along <= dest_edge.percent_along) {
+          continue;
+        }
+        const auto* directededge = reader.directededge(dest_edge.id, tile);
+        if (!directededge) {
+          continue;
+        }
+        auto& route = routes_[origin_edge.id][dest_edge.id];
+        if (!route.known) {
+          const float partial = origin_directededge->length() * (1.f - origin_edge.percent_along) +
+                                directededge->length() * dest_edge.percent_along;
+          route.lower_bound = std::max(route.lower_bound, bound - partial);
+        }
+      }
+    }
+  }
+}
+
 } // namespace meili
 
 } // namespace valhalla
@@ -60,6 +60,7 @@ TransitionCostModel::TransitionCostModel(baldr::GraphReader& graphreader,
                           config.max_route_distance_factor,
                           config.max_route_time_factor,
                           config.turn_penalty_factor) {
+  cache_routes_ = config.cache_routes;
 }
 
 float TransitionCostModel::operator()(const StateId& lhs, const StateId& rhs) const {
@@ -149,11 +150,20 @@ void TransitionCostModel::UpdateRoute(const StateId& lhs, const StateId& rhs) co
     max_route_time = std::ceil(max_route_time);
   }
 
-  labelset_ptr_t labelset = std::make_shared<LabelSet>(max_route_distance);
-  const auto& results = find_shortest_path(graphreader_, locations, 0, labelset, approximator,
-                                           right_measurement.search_radius(),
-                                           mode_costing_[static_cast<size_t>(travelmode_)], edgelabel,
-                                           turn_cost_table_, max_route_distance, max_route_time);
+  // Dense traces route between the same edges over and over, try the routes we already have
+  const auto& costing = mode_costing_[static_cast<size_t>(travelmode_)];
+  labelset_ptr_t labelset;
+  std::unordered_map<uint16_t, uint32_t> results;
+  if (!cache_routes_ || !route_cache_.find(graphreader_, locations, labelset, results, costing,
+                                           edgelabel, max_route_distance, max_route_time)) {
+    labelset = std::make_shared<LabelSet>(max_route_distance);
+    results = find_shortest_path(graphreader_, locations, 0, labelset, approximator,
+                                 right_measurement.search_radius(), costing, edgelabel,
+                                 turn_cost_table_, max_route_distance, max_route_time);
+    if (cache_routes_) {
+      route_cache_.insert(graphreader_, locations, *labelset, results, costing, max_route_distance);
+    }
+  }
 
   left.SetRoute(unreached_stateids, results, labelset);
 }
@@ -444,6 +444,25 @@ double ViterbiSearch::AccumulatedCost(const StateId& stateid) const {
   }
 }
 
+std::vector<StateLabel> ViterbiSearch::Frontier() const {
+  std::vector<StateLabel> labels;
+  labels.reserve(queue_.size() + 1);
+  for (const auto& label : queue_) {
+    // Labels earlier than the earliest time are skipped by the search
+    if (label.stateid().time() >= earliest_time_) {
+      labels.push_back(label);
+    }
+  }
+  // The last winner is scanned but its successors are only queued by the next search
+  if (!winner_by_time.empty() && winner_by_time.back().IsValid()) {
+    const auto it = scanned_labels_.find(winner_by_time.back());
+    if (it != scanned_labels_.end()) {
+      labels.push_back(it->second);
+    }
+  }
+  return labels;
+}
+
 void ViterbiSearch::Clear() {
   IViterbiSearch::Clear();
   states_by_time.clear();
@@ -12,10 +12,12 @@
 #include <cmath>
 #include <cstdint>
 #include <fstream>
+#include <limits>
 #include <list>
 #include <sstream>
 #include <stdlib.h>
 #include <sys/stat.h>
+#include <tuple>
 #include <vector>
 
 #include <boost/archive/iterators/base64_from_binary.hpp>
@@ -23,8 +25,47 @@
 #include <boost/archive/iterators/remove_whitespace.hpp>
 #include <boost/archive/iterators/transform_width.hpp>
 
+// the widest instructions the compiler targets to project onto several segments at once
+#if defined(__AVX__)
+#include <immintrin.h>
+#define VALHALLA_PROJECT_AVX
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define VALHALLA_PROJECT_SSE2
+#endif
+
 namespace {
 
+#if defined(VALHALLA_PROJECT_AVX) || defined(VALHALLA_PROJECT_SSE2)
+// Keeps the closest of the projections the lanes found, ties go to the first segment like they
+// do when projecting one segment at a time
+void closest_lane(const double* sq_distance,
+                  const double* x,
+                  const double* y,
+                  const double* segment,
+                  size_t lanes,
+                  valhalla::midgard::PointLL& closest,
+                  double& closest_sq_distance,
+                  size_t& closest_segment) {
+  for (size_t lane = 0; lane < lanes; ++lane) {
+    auto index = static_cast<size_t>(segment[lane]);
+    if (sq_distance[lane] < closest_sq_distance ||
+        (sq_distance[lane] == closest_sq_distance && index < closest_segment)) {
+      closest = {x[lane], y[lane]};
+      closest_sq_distance = sq_distance[lane];
+      closest_segment = index;
+    }
+  }
+}
+#endif
+
+#if defined(VALHALLA_PROJECT_SSE2)
+// Picks b where the mask is set and a elsewhere, SSE2 has no blend
+inline __m128d select(__m128d a, __m128d b, __m128d mask) {
+  return _mm_or_pd(_mm_and_pd(mask, b), _mm_andnot_pd(mask, a));
+}
+#endif
+
 std::vector<valhalla::midgard::PointLL>
 resample_at_1hz(const std::vector<valhalla::midgard::gps_segment_t>& segments) {
   std::vector<valhalla::midgard::PointLL> resampled;
@@ -787,6 +828,125 @@ polygon_t to_boundary(const std::unordered_set<uint32_t>& region, const Tiles<Po
   return polygon;
 }
 
+std::tuple<PointLL, double, size_t>
+projector_t::operator()(const double* lngs, const double* lats, size_t count) const {
+  PointLL closest = count ? PointLL(lngs[0], lats[0]) : PointLL();
+  double closest_sq_distance = std::numeric_limits<double>::max();
+  size_t closest_segment = 0;
+  size_t i = 0;
+
+  // the same math as projecting one segment at a time, in the same order so that the results
+  // don't differ in the last bit. zero length segments end up at u since their scale is 0
+#if defined(VALHALLA_PROJECT_AVX)
+  // four segments at a time
+  if (count > 4) {
+    const __m256d lon_scale4 = _mm256_set1_pd(lon_scale), lng4 = _mm256_set1_pd(lng),
+                  lat4 = _mm256_set1_pd(lat), zero = _mm256_setzero_pd(),
+                  m_per_lat4 = _mm256_set1_pd(kMetersPerDegreeLat),
+                  m_per_lng4 = _mm256_set1_pd(m_per_lng_degree), four = _mm256_set1_pd(4);
+    __m256d segment = _mm256_set_pd(3, 2, 1, 0), best = _mm256_set1_pd(closest_sq_distance),
+            best_x = zero, best_y = zero, best_segment = zero;
+    for (; i + 4 < count; i += 4) {
+      const __m256d ux = _mm256_loadu_pd(lngs + i), uy = _mm256_loadu_pd(lats + i),
+                    vx = _mm256_loadu_pd(lngs + i + 1), vy = _mm256_loadu_pd(lats + i + 1);
+      const __m256d bx = _mm256_sub_pd(vx, ux), by = _mm256_sub_pd(vy, uy);
+      const __m256d bx2 = _mm256_mul_pd(bx, lon_scale4);
+      const __m256d sq = _mm256_add_pd(_mm256_mul_pd(bx2, bx2), _mm256_mul_pd(by, by));
+      const __m256d scale =
+          _mm256_add_pd(_mm256_mul_pd(_mm256_mul_pd(_mm256_sub_pd(lng4, ux), lon_scale4), bx2),
+                        _mm256_mul_pd(_mm256_sub_pd(lat4, uy), by));
+      // between u and v, after v or before u, in reverse order of precedence
+      const __m256d ratio = _mm256_div_pd(scale, sq);
+      __m256d x = _mm256_add_pd(ux, _mm256_mul_pd(bx, ratio));
+      __m256d y = _mm256_add_pd(uy, _mm256_mul_pd(by, ratio));
+      const __m256d after = _mm256_cmp_pd(scale, sq, _CMP_GE_OQ);
+      x = _mm256_blendv_pd(x, vx, after);
+      y = _mm256_blendv_pd(y, vy, after);
+      const __m256d before = _mm256_cmp_pd(scale, zero, _CMP_LE_OQ);
+      x = _mm256_blendv_pd(x, ux, before);
+      y = _mm256_blendv_pd(y, uy, before);
+      // squared distance like the approximator does it
+      const __m256d dy = _mm256_mul_pd(_mm256_sub_pd(y, lat4), m_per_lat4);
+      const __m256d dx = _mm256_mul_pd(_mm256_sub_pd(x, lng4), m_per_lng4);
+      const __m256d sq_distance = _mm256_add_pd(_mm256_mul_pd(dy, dy), _mm256_mul_pd(dx, dx));
+      // each lane keeps its first closest
+      const __m256d closer = _mm256_cmp_pd(sq_distance, best, _CMP_LT_OQ);
+      best = _mm256_blendv_pd(best, sq_distance, closer);
+      best_x = _mm256_blendv_pd(best_x, x, closer);
+      best_y = _mm256_blendv_pd(best_y, y, closer);
+      best_segment = _mm256_blendv_pd(best_segment, segment, closer);
+      segment = _mm256_add_pd(segment, four);
+    }
+    double lanes[4][4];
+    _mm256_storeu_pd(lanes[0], best);
+    _mm256_storeu_pd(lanes[1], best_x);
+    _mm256_storeu_pd(lanes[2], best_y);
+    _mm256_storeu_pd(lanes[3], best_segment);
+    closest_lane(lanes[0], lanes[1], lanes[2], lanes[3], 4, closest, closest_sq_distance,
+                 closest_segment);
+  }
+#elif defined(VALHALLA_PROJECT_SSE2)
+  // two segments at a time
+  if (count > 2) {
+    const __m128d lon_scale2 = _mm_set1_pd(lon_scale), lng2 = _mm_set1_pd(lng),
+                  lat2 = _mm_set1_pd(lat), zero = _mm_setzero_pd(),
+                  m_per_lat2 = _mm_set1_pd(kMetersPerDegreeLat),
+                  m_per_lng2 = _mm_set1_pd(m_per_lng_degree), two = _mm_set1_pd(2);
+    __m128d segment = _mm_set_pd(1, 0), best = _mm_set1_pd(closest_sq_distance), best_x = zero,
+            best_y = zero, best_segment = zero;
+    for (; i + 2 < count; i += 2) {
+      const __m128d ux = _mm_loadu_pd(lngs + i), uy = _mm_loadu_pd(lats + i),
+                    vx = _mm_loadu_pd(lngs + i + 1), vy = _mm_loadu_pd(lats + i + 1);
+      const __m128d bx = _mm_sub_pd(vx, ux), by = _mm_sub_pd(vy, uy);
+      const __m128d bx2 = _mm_mul_pd(bx, lon_scale2);
+      const __m128d sq = _mm_add_pd(_mm_mul_pd(bx2, bx2), _mm_mul_pd(by, by));
+      const __m128d scale = _mm_add_pd(_mm_mul_pd(_mm_mul_pd(_mm_sub_pd(lng2, ux), lon_scale2), bx2),
+                                       _mm_mul_pd(_mm_sub_pd(lat2, uy), by));
+      // between u and v, after v or before u, in reverse order of precedence
+      const __m128d ratio = _mm_div_pd(scale, sq);
+      __m128d x = _mm_add_pd(ux, _mm_mul_pd(bx, ratio));
+      __m128d y = _mm_add_pd(uy, _mm_mul_pd(by, ratio));
+      const __m128d after = _mm_cmpge_pd(scale, sq);
+      x = select(x, vx, after);
+      y = select(y, vy, after);
+      const __m128d before = _mm_cmple_pd(scale, zero);
+      x = select(x, ux, before);
+      y = select(y, uy, before);
+      // squared distance like the approximator does it
+      const __m128d dy = _mm_mul_pd(_mm_sub_pd(y, lat2), m_per_lat2);
+      const __m128d dx = _mm_mul_pd(_mm_sub_pd(x, lng2), m_per_lng2);
+      const __m128d sq_distance = _mm_add_pd(_mm_mul_pd(dy, dy), _mm_mul_pd(dx, dx));
+      // each lane keeps its first closest
+      const __m128d closer = _mm_cmplt_pd(sq_distance, best);
+      best = select(best, sq_distance, closer);
+      best_x = select(best_x, x, closer);
+      best_y = select(best_y, y, closer);
+      best_segment = select(best_segment, segment, closer);
+      segment = _mm_add_pd(segment, two);
+    }
+    double lanes[4][2];
+    _mm_storeu_pd(lanes[0], best);
+    _mm_storeu_pd(lanes[1], best_x);
+    _mm_storeu_pd(lanes[2], best_y);
+    _mm_storeu_pd(lanes[3], best_segment);
+    closest_lane(lanes[0], lanes[1], lanes[2], lanes[3], 2, closest, closest_sq_distance,
+                 closest_segment);
+  }
+#endif
+
+  // the rest of the segments one at a time
+  for (; i + 1 < count; ++i) {
+    auto point = (*this)(PointLL(lngs[i], lats[i]), PointLL(lngs[i + 1], lats[i + 1]));
+    auto sq_distance = approx.DistanceSquared(point);
+    if (sq_distance < closest_sq_distance) {
+      closest = point;
+      closest_sq_distance = sq_distance;
+      closest_segment = i;
+    }
+  }
+  return std::make_tuple(closest, closest_sq_distance, closest_segment);
+}
+
 constexpr char PADDING_ENCODED = '=';
 constexpr char ZERO_ENCODED = 'A';
 
@@ -0,0 +1,227 @@
+#include "mjolnir/buildprofiler.h"
+
+#include <algorithm>
+#include <atomic>
+#include <ctime>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+
+#include "midgard/logging.h"
+
+#ifndef _WIN32
+#include <sys/resource.h>
+#include <time.h>
+#endif
+
+using namespace valhalla::baldr;
+
+namespace {
+
+// The profiler of the build that is running, the worker threads report to it
+std::atomic<valhalla::mjolnir::BuildProfiler*> current_profiler(nullptr);
+
+// CPU time of all the threads of the process
+double process_cpu_seconds() {
+  return static_cast<double>(std::clock()) / CLOCKS_PER_SEC;
+}
+
+// CPU time of the calling thread
+double thread_cpu_seconds() {
+#ifndef _WIN32
+  timespec ts;
+  if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts) == 0) {
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+  }
+#endif
+  return 0;
+}
+
+// Peak resident memory of the process in bytes, 0 where it is not known
+uint64_t peak_memory() {
+#if defined(__linux__)
+  // Unlike the peak getrusage reports this one can be reset
+  std::ifstream status("/proc/self/status");
+  std::string line;
+  while (std::getline(status, line)) {
+    if (line.compare(0, 6, "VmHWM:") == 0) {
+      return std::stoull(line.substr(6)) * 1024;
+    }
+  }
+  return 0;
+#elif defined(_WIN32)
+  return 0;
+#else
+  struct rusage usage;
+  if (getrusage(RUSAGE_SELF, &usage) != 0) {
+    return 0;
+  }
+#if defined(__APPLE__)
+  return usage.ru_maxrss;
+#else
+  return usage.ru_maxrss * 1024;
+#endif
+#endif
+}
+
+// Reset the peak resident memory to the current one where the kernel allows it, so that each stage
+// reports its own peak rather than the largest one so far
+void reset_peak_memory() {
+#if defined(__linux__)
+  std::ofstream clear_refs("/proc/self/clear_refs");
+  clear_refs << "5";
+#endif
+}
+
+// Bytes the process read from and wrote to storage so far, 0 where it is not known
+void storage_io(uint64_t& read, uint64_t& written) {
+  read = written = 0;
+#if defined(__linux__)
+  std::ifstream io("/proc/self/io");
+  std::string line;
+  while (std::getline(io, line)) {
+    if (line.compare(0, 11, "read_bytes:") == 0) {
+      read = std::stoull(line.substr(11));
+    } else if (line.compare(0, 12, "write_bytes:") == 0) {
+      written = std::stoull(line.substr(12));
+    }
+  }
+#endif
+}
+
+std::string seconds(double seconds) {
+  std::ostringstream out;
+  out << std::fixed << std::setprecision(2) << seconds << " s";
+  return out.str();
+}
+
+std::string megabytes(uint64_t bytes) {
+  return std::to_string(bytes / (1024 * 1024)) + " MB";
+}
+
+json::fixed_t utilization(double cpu_seconds, double wall_seconds) {
+  return json::fixed_t{wall_seconds > 0 ? cpu_seconds / wall_seconds : 0, 2};
+}
+
+} // namespace
+
+namespace valhalla {
+namespace mjolnir {
+
+BuildProfiler::WorkerScope::WorkerScope(const std::string& name)
+    : name_(name), start_(std::chrono::steady_clock::now()), cpu_start_(thread_cpu_seconds()) {
+}
+
+BuildProfiler::WorkerScope::~WorkerScope() {
+  auto* profiler = current_profiler.load();
+  if (profiler == nullptr) {
+    return;
+  }
+  std::chrono::duration<double> wall = std::chrono::steady_clock::now() - start_;
+  double cpu = thread_cpu_seconds() - cpu_start_;
+  auto thread = std::this_thread::get_id();
+  std::lock_guard<std::mutex> lock(profiler->workers_lock_);
+  auto worker = std::find_if(profiler->workers_.begin(), profiler->workers_.end(),
+                             [this, thread](const Worker& w) {
+                               return w.thread == thread && w.name == name_;
+                             });
+  if (worker == profiler->workers_.end()) {
+    profiler->workers_.push_back({name_, thread, wall.count(), cpu});
+  } else {
+    worker->wall_seconds += wall.count();
+    worker->cpu_seconds += cpu;
+  }
+}
+
+BuildProfiler::BuildProfiler()
+    : start_(std::chrono::steady_clock::now()), cpu_start_(process_cpu_seconds()) {
+  storage_io(read_start_, written_start_);
+  reset_peak_memory();
+  current_profiler.store(this);
+}
+
+BuildProfiler::~BuildProfiler() {
+  BuildProfiler* self = this;
+  current_profiler.compare_exchange_strong(self, nullptr);
+}
+
+void BuildProfiler::EndStage(BuildStage stage) {
+  auto now = std::chrono::steady_clock::now();
+  double cpu = process_cpu_seconds();
+  uint64_t read, written;
+  storage_io(read, written);
+
+  Stage result{stage,
+               std::chrono::duration<double>(now - start_).count(),
+               cpu - cpu_start_,
+               peak_memory(),
+               read - read_start_,
+               written - written_start_,
+               {}};
+  {
+    std::lock_guard<std::mutex> lock(workers_lock_);
+    result.workers.swap(workers_);
+  }
+  LOG_INFO("Stage " + to_string(stage) + " took " + seconds(result.wall_seconds) + " wall and " +
+           seconds(result.cpu_seconds) + " cpu on " + std::to_string(result.workers.size()) +
+           " workers, peak memory " + megabytes(result.peak_memory) + ", read " +
+           megabytes(result.bytes_read) + ", written " + megabytes(result.bytes_written));
+  stages_.emplace_back(std::move(result));
+
+  // Start measuring the next stage
+  reset_peak_memory();
+  start_ = std::chrono::steady_clock::now();
+  cpu_start_ = process_cpu_seconds();
+  storage_io(read_start_, written_start_);
+}
+
+json::MapPtr BuildProfiler::ToJson() const {
+  double wall_seconds = 0, cpu_seconds = 0;
+  uint64_t peak = 0, bytes_read = 0, bytes_written = 0;
+  auto stages = json::array({});
+  for (const auto& stage : stages_) {
+    auto workers = json::array({});
+    for (const auto& worker : stage.workers) {
+      workers->emplace_back(
+          json::map({{"name", worker.name},
+                     {"wall_seconds", json::fixed_t{worker.wall_seconds, 3}},
+                     {"cpu_seconds", json::fixed_t{worker.cpu_seconds, 3}},
+                     {"utilization", utilization(worker.cpu_seconds, worker.wall_seconds)}}));
+    }
+    stages->emplace_back(
+        json::map({{"stage", to_string(stage.stage)},
+                   {"wall_seconds", json::fixed_t{stage.wall_seconds, 3}},
+                   {"cpu_seconds", json::fixed_t{stage.cpu_seconds, 3}},
+                   {"utilization", utilization(stage.cpu_seconds, stage.wall_seconds)},
+                   {"peak_memory", stage.peak_memory},
+                   {"bytes_read", stage.bytes_read},
+                   {"bytes_written", stage.bytes_written},
+                   {"workers", workers}}));
+    wall_seconds += stage.wall_seconds;
+    cpu_seconds += stage.cpu_seconds;
+    peak = std::max(peak, stage.peak_memory);
+    bytes_read += stage.bytes_read;
+    bytes_written += stage.bytes_written;
+  }
+  return json::map({{"stages", stages},
+                    {"wall_seconds", json::fixed_t{wall_seconds, 3}},
+                    {"cpu_seconds", json::fixed_t{cpu_seconds, 3}},
+                    {"utilization", utilization(cpu_seconds, wall_seconds)},
+                    {"peak_memory", peak},
+                    {"bytes_read", bytes_read},
+                    {"bytes_written", bytes_written}});
+}
+
+bool BuildProfiler::WriteReport(const std::string& file) const {
+  std::ofstream out(file, std::ios::trunc);
+  out << *ToJson() << std::endl;
+  if (!out) {
+    LOG_ERROR("Could not write the build report to " + file);
+    return false;
+  }
+  LOG_INFO("Wrote the build report to " + file);
+  return true;
+}
+
+} // namespace mjolnir
+} // namespace valhalla
@@ -0,0 +1,365 @@
+#include "mjolnir/contractionbuilder.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <limits>
+#include <queue>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "baldr/contractionhierarchy.h"
+#include "baldr/graphconstants.h"
+#include "baldr/graphreader.h"
+#include "baldr/rapidjson_utils.h"
+#include "baldr/tilehierarchy.h"
+#include "midgard/logging.h"
+#include "sif/costfactory.h"
+
+using namespace valhalla::baldr;
+
+namespace {
+
+// How many nodes a witness search may settle before it gives up and the shortcut is kept
+constexpr size_t kMaxWitnessSettled = 500;
+
+constexpr float kInfinity = std::numeric_limits<float>::max();
+
+// An arc as seen from one of its ends while contracting
+struct link_t {
+  uint32_t node;
+  uint32_t arc;
+};
+
+class contractor_t {
+public:
+  contractor_t(const size_t node_count, std::vector<ContractionArc>& arcs)
+      : arcs_(arcs), outbound_(node_count), inbound_(node_count), contracted_(node_count, false),
+        contracted_neighbors_(node_count, 0), distance_(node_count, kInfinity),
+        upward_forward_(node_count), upward_reverse_(node_count) {
+    for (uint32_t i = 0; i < arcs_.size(); ++i) {
+      link(i);
+    }
+  }
+
+  // contracts all the nodes, least important first
+  void contract() {
+    using entry_t = std::pair<int64_t, uint32_t>;
+    std::priority_queue<entry_t, std::vector<entry_t>, std::greater<entry_t>> queue;
+    for (uint32_t node = 0; node < outbound_.size(); ++node) {
+      queue.emplace(priority(node), node);
+    }
+
+    size_t contracted = 0;
+    while (!queue.empty()) {
+      auto node = queue.top().second;
+      queue.pop();
+
+      // the priorities of the neighbors of contracted nodes go stale, we only find out when we
+      // pop them and if it got worse we put the node back in line
+      auto current = priority(node);
+      if (!queue.empty() && current > queue.top().first) {
+        queue.emplace(current, node);
+        continue;
+      }
+
+      contract(node);
+      if (++contracted % 1000000 == 0) {
+        LOG_INFO("Contracted " + std::to_string(contracted) + " of " +
+                 std::to_string(outbound_.size()) + " nodes with " + std::to_string(arcs_.size()) +
+                 " arcs");
+      }
+    }
+  }
+
+  // the arcs leading from each node to nodes contracted after it
+  const std::vector<std::vector<uint32_t>>& upward_forward() const {
+    return upward_forward_;
+  }
+
+  // the arcs leading to each node from nodes contracted after it
+  const std::vector<std::vector<uint32_t>>& upward_reverse() const {
+    return upward_reverse_;
+  }
+
+protected:
+  // add an arc to the remaining graph, parallel arcs are collapsed into the cheapest one
+  void link(const uint32_t arc) {
+    const auto& a = arcs_[arc];
+    if (a.tail == a.head) {
+      return;
+    }
+    auto out = std::find_if(outbound_[a.tail].begin(), outbound_[a.tail].end(),
+                            [&a](const link_t& l) { return l.node == a.head; });
+    if (out == outbound_[a.tail].end()) {
+      outbound_[a.tail].push_back({a.head, arc});
+      inbound_[a.head].push_back({a.tail, arc});
+      return;
+    }
+    if (arcs_[out->arc].cost <= a.cost) {
+      return;
+    }
+    auto in = std::find_if(inbound_[a.head].begin(), inbound_[a.head].end(),
+                           [&a](const link_t& l) { return l.node == a.tail; });
+    out->arc = in->arc = arc;
+  }
+
+  // dijkstra from the source around the node being contracted, up to a cost limit
+  void witness_search(const uint32_t source, const uint32_t via, const float limit) {
+    for (auto node : touched_) {
+      distance_[node] = kInfinity;
+    }
+    touched_.clear();
+
+    using entry_t = std::pair<float, uint32_t>;
+    std::priority_queue<entry_t, std::vector<entry_t>, std::greater<entry_t>> queue;
+    distance_[source] = 0.f;
+    touched_.push_back(source);
+    queue.emplace(0.f, source);
+    size_t settled = 0;
+    while (!queue.empty() && settled < kMaxWitnessSettled) {
+      auto top = queue.top();
+      queue.pop();
+      if (top.first > distance_[top.second]) {
+        continue;
+      }
+      if (top.first > limit) {
+        break;
+      }
+      ++settled;
+      for (const auto& l : outbound_[top.second]) {
+        if (l.node == via) {
+          continue;
+        }
+        auto cost = top.first + arcs_[l.arc].cost;
+        if (cost < distance_[l.node]) {
+          if (distance_[l.node] == kInfinity) {
+            touched_.push_back(l.node);
+          }
+          distance_[l.node] = cost;
+          queue.emplace(cost, l.node);
+        }
+      }
+    }
+  }
+
+  // counts the shortcuts needed to contract the node, adding them if asked to
+  size_t shortcuts(const uint32_t node, const bool add) {
+    size_t count = 0;
+    for (size_t i = 0; i < inbound_[node].size(); ++i) {
+      const auto in = inbound_[node][i];
+      const auto in_cost = arcs_[in.arc].cost;
+      float limit = -1.f;
+      for (const auto& out : outbound_[node]) {
+        if (out.node != in.node) {
+          limit = std::max(limit, in_cost + arcs_[out.arc].cost);
+        }
+      }
+      if (limit < 0.f) {
+        continue;
+      }
+
+      witness_search(in.node, node, limit);
+      for (size_t j = 0; j < outbound_[node].size(); ++j) {
+        const auto out = outbound_[node][j];
+        const auto cost = in_cost + arcs_[out.arc].cost;
+        if (out.node == in.node || distance_[out.node] <= cost) {
+          continue;
+        }
+        ++count;
+        if (add) {
+          arcs_.push_back({in.node, out.node, cost, arcs_[in.arc].secs + arcs_[out.arc].secs, in.arc,
+                           out.arc, arcs_[in.arc].length + arcs_[out.arc].length, 0,
+                           static_cast<uint64_t>(kInvalidGraphId)});
+          link(arcs_.size() - 1);
+        }
+      }
+    }
+    return count;
+  }
+
+  // nodes that need fewer shortcuts than they remove arcs go first, spread out over the graph
+  int64_t priority(const uint32_t node) {
+    int64_t removed = inbound_[node].size() + outbound_[node].size();
+    int64_t added = shortcuts(node, false);
+    return 2 * (added - removed) + contracted_neighbors_[node];
+  }
+
+  // removes the node from the remaining graph, whatever it is still linked to ranks above it
+  void contract(const uint32_t node) {
+    shortcuts(node, true);
+    for (const auto& out : outbound_[node]) {
+      upward_forward_[node].push_back(out.arc);
+      ++contracted_neighbors_[out.node];
+      auto& links = inbound_[out.node];
+      links.erase(std::remove_if(links.begin(), links.end(),
+                                 [node](const link_t& l) { return l.node == node; }),
+                  links.end());
+    }
+    for (const auto& in : inbound_[node]) {
+      upward_reverse_[node].push_back(in.arc);
+      ++contracted_neighbors_[in.node];
+      auto& links = outbound_[in.node];
+      links.erase(std::remove_if(links.begin(), links.end(),
+                                 [node](const link_t& l) { return l.node == node; }),
+                  links.end());
+    }
+    contracted_[node] = true;
+    std::vector<link_t>().swap(outbound_[node]);
+    std::vector<link_t>().swap(inbound_[node]);
+  }
+
+  std::vector<ContractionArc>& arcs_;
+  std::vector<std::vector<link_t>> outbound_;
+  std::vector<std::vector<link_t>> inbound_;
+  std::vector<bool> contracted_;
+  std::vector<int64_t> contracted_neighbors_;
+  std::vector<float> distance_;
+  std::vector<uint32_t> touched_;
+  std::vector<std::vector<uint32_t>> upward_forward_;
+  std::vector<std::vector<uint32_t>> upward_reverse_;
+};
+
+// writes the array and pads the file to the next multiple of 8 bytes
+template <typename T> void write(std::ofstream& file, const T* data, const size_t count) {
+  file.write(reinterpret_cast<const char*>(data), count * sizeof(T));
+  const char padding[8] = {};
+  file.write(padding, (8 - (count * sizeof(T)) % 8) % 8);
+}
+
+// flattens the per node arc lists into offsets and indices
+void write(std::ofstream& file, const std::vector<std::vector<uint32_t>>& lists) {
+  std::vector<uint32_t> offsets{0};
+  std::vector<uint32_t> indices;
+  for (const auto& list : lists) {
+    indices.insert(indices.end(), list.begin(), list.end());
+    offsets.push_back(indices.size());
+  }
+  write(file, offsets.data(), offsets.size());
+  write(file, indices.data(), indices.size());
+}
+
+} // namespace
+
+namespace valhalla {
+namespace mjolnir {
+
+void ContractionBuilder::Build(const boost::property_tree::ptree& pt) {
+  const auto file_name = pt.get<std::string>("mjolnir.contraction_hierarchy", "");
+  if (file_name.empty()) {
+    LOG_INFO("Skipping contraction hierarchy builder");
+    return;
+  }
+  LOG_INFO("Building contraction hierarchy " + file_name);
+
+  // the profile is the default auto costing, thor uses the hierarchy for requests that match it
+  Options options;
+  options.set_costing_type(Costing::auto_);
+  rapidjson::Document doc;
+  sif::ParseCosting(doc, "/costing_options", options);
+  const auto& profile = options.costings().find(Costing::auto_)->second;
+  auto costing = sif::CostFactory().Create(profile);
+
+  // every node on the road levels, the sorted ids double as the index of the nodes
+  GraphReader reader(pt.get_child("mjolnir"));
+  std::vector<uint64_t> nodes;
+  for (const auto& level : TileHierarchy::levels()) {
+    for (const auto& tile_id : reader.GetTileSet(level.level)) {
+      auto tile = reader.GetGraphTile(tile_id);
+      for (uint32_t i = 0; i < tile->header()->nodecount(); ++i) {
+        nodes.push_back(GraphId(tile_id.tileid(), tile_id.level(), i).value);
+      }
+      if (reader.OverCommitted()) {
+        reader.Trim();
+      }
+    }
+  }
+  std::sort(nodes.begin(), nodes.end());
+  auto index = [&nodes](const GraphId& node) {
+    auto found = std::lower_bound(nodes.begin(), nodes.end(), node.value);
+    if (found == nodes.end() || *found != node.value) {
+      return kInvalidContractionIndex;
+    }
+    return static_cast<uint32_t>(found - nodes.begin());
+  };
+  LOG_INFO("Found " + std::to_string(nodes.size()) + " nodes");
+
+  // the arcs are the edges the costing allows with their costs and the transitions between levels
+  // for free. destination only edges are left out, the first pass of the a* does not use them
+  std::vector<ContractionArc> arcs;
+  for (uint32_t tail = 0; tail < nodes.size(); ++tail) {
+    GraphId node_id(nodes[tail]);
+    auto tile = reader.GetGraphTile(node_id);
+    const auto* node = tile->node(node_id);
+    if (!costing->Allowed(node)) {
+      continue;
+    }
+
+    GraphId edge_id(node_id.tileid(), node_id.level(), node->edge_index());
+    for (uint32_t i = 0; i < node->edge_count(); ++i, ++edge_id) {
+      const auto* edge = tile->directededge(edge_id);
+      if (edge->is_shortcut() || edge->destonly() || edge->surface() == Surface::kImpassable ||
+          !costing->Allowed(edge, tile)) {
+        continue;
+      }
+      auto head = index(edge->endnode());
+      if (head == kInvalidContractionIndex) {
+        continue;
+      }
+      auto cost = costing->EdgeCost(edge, tile);
+      arcs.push_back({tail, head, cost.cost, cost.secs, kInvalidContractionIndex,
+                      kInvalidContractionIndex, edge->length(), 0, edge_id.value});
+    }
+
+    for (uint32_t i = 0; i < node->transition_count(); ++i) {
+      auto head = index(tile->transition(node->transition_index() + i)->endnode());
+      if (head != kInvalidContractionIndex) {
+        arcs.push_back({tail, head, 0.f, 0.f, kInvalidContractionIndex, kInvalidContractionIndex, 0,
+                        0, static_cast<uint64_t>(kInvalidGraphId)});
+      }
+    }
+
+    if (reader.OverCommitted()) {
+      reader.Trim();
+    }
+  }
+  LOG_INFO("Found " + std::to_string(arcs.size()) + " arcs");
+
+  // contract the graph, this adds the shortcuts to the arcs
+  contractor_t contractor(nodes.size(), arcs);
+  contractor.contract();
+  LOG_INFO("Finished contraction with " + std::to_string(arcs.size()) + " arcs");
+
+  // write out the hierarchy
+  ContractionHeader header{};
+  std::memcpy(header.magic, ContractionHierarchy::magic(), sizeof(header.magic));
+  header.version = kContractionHierarchyVersion;
+  header.profile = ContractionHierarchy::hash_profile(profile.SerializeAsString());
+  header.node_count = nodes.size();
+  for (const auto& list : contractor.upward_forward()) {
+    header.forward_count += list.size();
+  }
+  for (const auto& list : contractor.upward_reverse()) {
+    header.reverse_count += list.size();
+  }
+  header.arc_count = arcs.size();
+
+  std::ofstream file(file_name, std::ios::binary | std::ios::trunc);
+  if (!file.is_open()) {
+    throw std::runtime_error("Unable to open " + file_name);
+  }
+  write(file, &header, 1);
+  write(file, nodes.data(), nodes.size());
+  write(file, contractor.upward_forward());
+  write(file, contractor.upward_reverse());
+  write(file, arcs.data(), arcs.size());
+  if (!file) {
+    throw std::runtime_error("Failed writing " + file_name);
+  }
+  LOG_INFO("Finished contraction hierarchy");
+}
+
+} // namespace mjolnir
+} // namespace valhalla
@@ -21,6 +21,7 @@
 #include "midgard/tiles.h"
 #include "midgard/util.h"
 #include "mjolnir/admin.h"
+#include "mjolnir/buildprofiler.h"
 #include "mjolnir/edgeinfobuilder.h"
 #include "mjolnir/ferry_connections.h"
 #include "mjolnir/graphbuilder.h"
@@ -40,17 +41,23 @@ namespace {
  * we also need to then update the edges that pointed to them
  *
  */
-std::map<GraphId, size_t> SortGraph(const std::string& nodes_file, const std::string& edges_file) {
+std::map<GraphId, size_t> SortGraph(const std::string& nodes_file,
+                                    const std::string& edges_file,
+                                    unsigned int concurrency) {
   LOG_INFO("Sorting graph...");
 
-  // Sort nodes by graphid then by osmid, so its basically a set of tiles
+  // Sort nodes by graphid then by osmid, so its basically a set of tiles. The sort is stable so the
+  // duplicates of a node keep the order they were written in. collect_node_edges depends on it as
+  // node_edges keeps only the first of two loops at the same node
   sequence<Node> nodes(nodes_file, false);
-  nodes.sort([](const Node& a, const Node& b) {
-    if (a.graph_id == b.graph_id) {
-      return a.node.osmid_ < b.node.osmid_;
-    }
-    return a.graph_id < b.graph_id;
-  });
+  nodes.sort(
+      [](const Node& a, const Node& b) {
+        if (a.graph_id == b.graph_id) {
+          return a.node.osmid_ < b.node.osmid_;
+        }
+        return a.graph_id < b.graph_id;
+      },
+      sequence<Node>::kSortBufferSize, concurrency);
 
   // run through the sorted nodes, going back to the edges they reference and updating each edge
   // to point to the first (out of the duplicates) nodes index. at the end of this there will be
@@ -393,6 +400,7 @@ void BuildTileSet(const std::string& ways_file,
                   const uint32_t tile_creation_date,
                   const boost::property_tree::ptree& pt,
                   std::promise<DataQuality>& result) {
+  BuildProfiler::WorkerScope worker("GraphBuilder");
 
   sequence<OSMWay> ways(ways_file, false);
   sequence<OSMWayNode> way_nodes(way_nodes_file, false);
@@ -1212,7 +1220,10 @@ std::map<GraphId, size_t> GraphBuilder::BuildEdges(const boost::property_tree::p
                  },
                  pt.get<bool>("mjolnir.data_processing.infer_turn_channels", true));
 
-  return SortGraph(nodes_file, edges_file);
+  return SortGraph(nodes_file, edges_file,
+                   std::max(static_cast<unsigned int>(1),
+                            pt.get<unsigned int>("mjolnir.concurrency",
+                                                 std::thread::hardware_concurrency())));
 }
 
 // Build the graph from the input
@@ -1,5 +1,6 @@
 #include "mjolnir/graphenhancer.h"
 #include "mjolnir/admin.h"
+#include "mjolnir/buildprofiler.h"
 #include "mjolnir/countryaccess.h"
 #include "mjolnir/graphtilebuilder.h"
 #include "mjolnir/util.h"
@@ -1316,6 +1317,7 @@ void enhance(const boost::property_tree::ptree& pt,
              std::queue<GraphId>& tilequeue,
              std::mutex& lock,
              std::promise<enhancer_stats>& result) {
+  BuildProfiler::WorkerScope worker("GraphEnhancer");
 
   auto less_than = [](const OSMAccess& a, const OSMAccess& b) { return a.way_id() < b.way_id(); };
   sequence<OSMAccess> access_tags(access_file, false);
@@ -1753,7 +1755,8 @@ namespace mjolnir {
 // Enhance the local level of the graph
 void GraphEnhancer::Enhance(const boost::property_tree::ptree& pt,
                             const OSMData& osmdata,
-                            const std::string& access_file) {
+                            const std::string& access_file,
+                            const std::unordered_set<GraphId>& tiles) {
   LOG_INFO("Enhancing local graph...");
 
   // A place to hold worker threads and their results, exceptions or otherwise
@@ -1771,7 +1774,9 @@ void GraphEnhancer::Enhance(const boost::property_tree::ptree& pt,
   GraphReader reader(hierarchy_properties);
   auto local_tiles = reader.GetTileSet(local_level);
   for (const auto& tile_id : local_tiles) {
-    tempqueue.emplace_back(tile_id);
+    if (tiles.empty() || tiles.count(tile_id)) {
+      tempqueue.emplace_back(tile_id);
+    }
   }
   std::random_device rd;
   std::shuffle(tempqueue.begin(), tempqueue.end(), std::mt19937(rd()));
@@ -1819,5 +1824,64 @@ void GraphEnhancer::Enhance(const boost::property_tree::ptree& pt,
 #endif
 }
 
+std::unordered_set<GraphId> GraphEnhancer::Reach(GraphReader& reader,
+                                                 const std::unordered_set<GraphId>& tiles) {
+  const auto& local_level = TileHierarchy::levels().back();
+  std::unordered_set<GraphId> reach(tiles);
+
+  // The density of a node sums up the roads within kDensityRadius of it
+  for (const auto& tile_id : tiles) {
+    auto bounds = local_level.tiles.TileBounds(tile_id.tileid());
+    double lat =
+        std::min(std::max(std::abs(bounds.miny()), std::abs(bounds.maxy())) + kDensityLatDeg, 89.0);
+    float lngdeg =
+        (kDensityRadius * kMetersPerKm) / DistanceApproximator<PointLL>::MetersPerLngDegree(lat);
+    AABB2<PointLL> bbox(Point2(bounds.minx() - lngdeg, bounds.miny() - kDensityLatDeg),
+                        Point2(bounds.maxx() + lngdeg, bounds.maxy() + kDensityLatDeg));
+    for (const auto t : local_level.tiles.TileList(bbox)) {
+      reach.emplace(t, local_level.level, 0);
+    }
+  }
+
+  // The not thru search expands up to kMaxNoThruTries nodes from the end node of an edge, the other
+  // checks read the end node of an edge. Every directed edge has an opposing one, so expanding the
+  // nodes of the tiles as many times finds every node whose checks may read them.
+  std::unordered_set<GraphId> visited;
+  std::vector<GraphId> expand;
+  for (const auto& tile_id : tiles) {
+    graph_tile_ptr tile = reader.GetGraphTile(tile_id);
+    for (uint32_t i = 0; tile && i < tile->header()->nodecount(); ++i) {
+      expand.emplace_back(tile_id.tileid(), tile_id.level(), i);
+      visited.insert(expand.back());
+    }
+  }
+  std::vector<GraphId> next;
+  for (uint32_t n = 0; n < kMaxNoThruTries && !expand.empty(); ++n) {
+    graph_tile_ptr tile;
+    for (const auto& node_id : expand) {
+      if (!tile || tile->id() != node_id.Tile_Base()) {
+        tile = reader.GetGraphTile(node_id);
+      }
+      if (!tile) {
+        continue;
+      }
+      const NodeInfo* node = tile->node(node_id);
+      const DirectedEdge* edge = tile->directededge(node->edge_index());
+      for (uint32_t i = 0; i < node->edge_count(); ++i, ++edge) {
+        if (edge->endnode().level() == local_level.level && visited.insert(edge->endnode()).second) {
+          next.push_back(edge->endnode());
+          reach.insert(edge->endnode().Tile_Base());
+        }
+      }
+      if (reader.OverCommitted()) {
+        reader.Trim();
+      }
+    }
+    expand.swap(next);
+    next.clear();
+  }
+  return reach;
+}
+
 } // namespace mjolnir
 } // namespace valhalla
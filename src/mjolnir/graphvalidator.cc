@@ -1,5 +1,6 @@
 
 #include "mjolnir/graphvalidator.h"
+#include "mjolnir/buildprofiler.h"
 #include "mjolnir/graphtilebuilder.h"
 #include "mjolnir/util.h"
 
@@ -251,6 +252,7 @@ void validate(
     std::mutex& lock,
     std::promise<std::tuple<std::vector<uint32_t>, std::vector<std::vector<float>>, tweeners_t>>&
         result) {
+  BuildProfiler::WorkerScope worker("GraphValidator");
   // Our local copy of edges binned to tiles that they pass through (dont start or end in)
   tweeners_t tweeners;
   // Local Graphreader
@@ -1,14 +1,18 @@
 #include "mjolnir/hierarchybuilder.h"
+#include "mjolnir/buildprofiler.h"
 #include "mjolnir/graphtilebuilder.h"
 
 #include <boost/format.hpp>
 #include <boost/property_tree/ptree.hpp>
 
+#include <algorithm>
 #include <iostream>
 #include <map>
+#include <memory>
 #include <ostream>
 #include <sstream>
 #include <string>
+#include <thread>
 #include <utility>
 #include <vector>
 
@@ -21,6 +25,8 @@
 #include "midgard/logging.h"
 #include "midgard/pointll.h"
 #include "midgard/sequence.h"
+#include "midgard/util.h"
+#include "mjolnir/util.h"
 
 using namespace valhalla::midgard;
 using namespace valhalla::baldr;
@@ -68,23 +74,29 @@ bool AddUpwardTransition(const GraphId& node, GraphTileBuilder* tilebuilder) {
   }
 }
 
-void SortSequences(const std::string& new_to_old_file, const std::string& old_to_new_file) {
+void SortSequences(const std::string& new_to_old_file,
+                   const std::string& old_to_new_file,
+                   unsigned int concurrency) {
   // Sort the new nodes. Sort so highway level is first
-  sequence<std::pair<GraphId, GraphId>> new_to_old(new_to_old_file, false);
-  new_to_old.sort([](const std::pair<GraphId, GraphId>& a, const std::pair<GraphId, GraphId>& b) {
-    if (a.first.level() == b.first.level()) {
-      if (a.first.tileid() == b.first.tileid()) {
-        return a.first.id() < b.first.id();
-      }
-      return a.first.tileid() < b.first.tileid();
-    }
-    return a.first.level() < b.first.level();
-  });
+  using new_to_old_t = std::pair<GraphId, GraphId>;
+  sequence<new_to_old_t> new_to_old(new_to_old_file, false);
+  new_to_old.sort(
+      [](const new_to_old_t& a, const new_to_old_t& b) {
+        if (a.first.level() == b.first.level()) {
+          if (a.first.tileid() == b.first.tileid()) {
+            return a.first.id() < b.first.id();
+          }
+          return a.first.tileid() < b.first.tileid();
+        }
+        return a.first.level() < b.first.level();
+      },
+      sequence<new_to_old_t>::kSortBufferSize, concurrency);
 
   // Sort old to new by node Id
   sequence<OldToNewNodes> old_to_new(old_to_new_file, false);
   old_to_new.sort(
-      [](const OldToNewNodes& a, const OldToNewNodes& b) { return a.node_id < b.node_id; });
+      [](const OldToNewNodes& a, const OldToNewNodes& b) { return a.node_id < b.node_id; },
+      sequence<OldToNewNodes>::kSortBufferSize, concurrency);
 }
 
 // Convenience method to find the node association.
@@ -121,16 +133,18 @@ bool OpposingEdgeInfoMatches(const graph_tile_ptr& tile, const DirectedEdge* edg
   return false;
 }
 
-// Form tiles in the new level.
-void FormTilesInNewLevel(GraphReader& reader,
-                         const std::string& new_to_old_file,
-                         const std::string& old_to_new_file) {
-  // Use the sequence that associate new nodes to old nodes
-  sequence<std::pair<GraphId, GraphId>> new_to_old(new_to_old_file, false);
-
-  // Use the sorted sequence that associates old nodes to new nodes
-  sequence<OldToNewNodes> old_to_new(old_to_new_file, false);
+// The new nodes of a tile in the new level, a range of the sorted new to old sequence
+struct NewTile {
+  GraphId tile_id;
+  size_t begin;
+  size_t end;
+};
 
+// Form a tile in the new level from its range of new nodes.
+void FormTileInNewLevel(GraphReader& reader,
+                        sequence<std::pair<GraphId, GraphId>>& new_to_old,
+                        sequence<OldToNewNodes>& old_to_new,
+                        const NewTile& new_tile) {
   // lambda to indicate whether a directed edge should be included
   auto include_edge = [&old_to_new](const DirectedEdge* directededge, const GraphId& base_node,
                                     const uint8_t current_level) {
@@ -158,39 +172,18 @@ void FormTilesInNewLevel(GraphReader& reader,
     }
   };
 
-  // Iterate through the new nodes. They have been sorted by level so that
-  // highway level is done first.
-  reader.Clear();
+  // New tilebuilder for the tile. Set the base ll for this tile
   bool added = false;
-  uint8_t current_level = std::numeric_limits<uint8_t>::max();
-  GraphId tile_id;
   std::hash<std::string> hasher;
-  PointLL base_ll;
-  GraphTileBuilder* tilebuilder = nullptr;
-  for (auto new_node = new_to_old.begin(); new_node != new_to_old.end(); new_node++) {
-    // Get the node - check if a new tile
+  uint8_t current_level = new_tile.tile_id.level();
+  GraphTileBuilder tilebuilder(reader.tile_dir(), new_tile.tile_id, false);
+  PointLL base_ll = TileHierarchy::get_tiling(current_level).Base(new_tile.tile_id.tileid());
+  tilebuilder.header_builder().set_base_ll(base_ll);
+
+  // Iterate through the new nodes of the tile
+  auto end = new_to_old.at(new_tile.end);
+  for (auto new_node = new_to_old.at(new_tile.begin); new_node != end; new_node++) {
     GraphId nodea = (*new_node).first;
-    if (nodea.Tile_Base() != tile_id) {
-      // Store the prior tile
-      if (tilebuilder != nullptr) {
-        tilebuilder->StoreTileData();
-        delete tilebuilder;
-      }
-
-      // New tilebuilder for the next tile. Update current level.
-      tile_id = nodea.Tile_Base();
-      tilebuilder = new GraphTileBuilder(reader.tile_dir(), tile_id, false);
-      current_level = nodea.level();
-
-      // Set the base ll for this tile
-      base_ll = TileHierarchy::get_tiling(current_level).Base(tile_id.tileid());
-      tilebuilder->header_builder().set_base_ll(base_ll);
-
-      // Check if we need to clear the base/local tile cache
-      if (reader.OverCommitted()) {
-        reader.Trim();
-      }
-    }
 
     // Get the node in the base level
     GraphId base_node = (*new_node).second;
@@ -201,25 +194,25 @@ void FormTilesInNewLevel(GraphReader& reader,
     }
 
     // Copy the data version
-    tilebuilder->header_builder().set_dataset_id(tile->header()->dataset_id());
+    tilebuilder.header_builder().set_dataset_id(tile->header()->dataset_id());
 
     // Copy node information and set the node lat,lon offsets within the new tile
     NodeInfo baseni = *(tile->node(base_node.id()));
-    tilebuilder->nodes().push_back(baseni);
+    tilebuilder.nodes().push_back(baseni);
     const auto& admin = tile->admininfo(baseni.admin_index());
-    NodeInfo& node = tilebuilder->nodes().back();
+    NodeInfo& node = tilebuilder.nodes().back();
     node.set_latlng(base_ll, baseni.latlng(tile->header()->base_ll()));
-    node.set_edge_index(tilebuilder->directededges().size());
+    node.set_edge_index(tilebuilder.directededges().size());
     node.set_timezone(baseni.timezone());
-    node.set_admin_index(tilebuilder->AddAdmin(admin.country_text(), admin.state_text(),
-                                               admin.country_iso(), admin.state_iso()));
+    node.set_admin_index(tilebuilder.AddAdmin(admin.country_text(), admin.state_text(),
+                                              admin.country_iso(), admin.state_iso()));
 
     // Update node LL based on tile base
     // Density at this node
     uint32_t density1 = baseni.density();
 
     // Current edge count
-    size_t edge_count = tilebuilder->directededges().size();
+    size_t edge_count = tilebuilder.directededges().size();
 
     // Iterate through directed edges of the base node to get remaining
     // directed edges (based on classification/importance cutoff)
@@ -273,13 +266,13 @@ void FormTilesInNewLevel(GraphReader& reader,
         if (signs.size() == 0) {
           LOG_ERROR("Base edge should have signs, but none found");
         }
-        tilebuilder->AddSigns(tilebuilder->directededges().size(), signs);
+        tilebuilder.AddSigns(tilebuilder.directededges().size(), signs);
       }
 
       // Get turn lanes from the base directed edge
       if (directededge->turnlanes()) {
         uint32_t offset = tile->turnlanes_offset(base_edge_id.id());
-        tilebuilder->AddTurnLanes(tilebuilder->directededges().size(), tile->GetName(offset));
+        tilebuilder.AddTurnLanes(tilebuilder.directededges().size(), tile->GetName(offset));
       }
 
       // Get access restrictions from the base directed edge. Add these to
@@ -288,8 +281,8 @@ void FormTilesInNewLevel(GraphReader& reader,
       if (directededge->access_restriction()) {
         auto restrictions = tile->GetAccessRestrictions(base_edge_id.id(), kAllAccess);
         for (const auto& res : restrictions) {
-          tilebuilder->AddAccessRestriction(AccessRestriction(tilebuilder->directededges().size(),
-                                                              res.type(), res.modes(), res.value()));
+          tilebuilder.AddAccessRestriction(AccessRestriction(tilebuilder.directededges().size(),
+                                                             res.type(), res.modes(), res.value()));
         }
       }
 
@@ -300,9 +293,9 @@ void FormTilesInNewLevel(GraphReader& reader,
           LOG_ERROR("Base edge should have lane connectivity, but none found");
         }
         for (auto& lc : laneconnectivity) {
-          lc.set_to(tilebuilder->directededges().size());
+          lc.set_to(tilebuilder.directededges().size());
         }
-        tilebuilder->AddLaneConnectivity(laneconnectivity);
+        tilebuilder.AddLaneConnectivity(laneconnectivity);
       }
 
       // Do we need to force adding edgeinfo (opposing edge could have diff names)?
@@ -319,43 +312,43 @@ void FormTilesInNewLevel(GraphReader& reader,
       std::string encoded_shape = edgeinfo.encoded_shape();
       uint32_t w = hasher(encoded_shape + std::to_string(edgeinfo.wayid()));
       uint32_t edge_info_offset =
-          tilebuilder->AddEdgeInfo(w, nodea, nodeb, edgeinfo.wayid(), edgeinfo.mean_elevation(),
-                                   edgeinfo.bike_network(), edgeinfo.speed_limit(), encoded_shape,
-                                   edgeinfo.GetNames(), edgeinfo.GetTaggedValues(),
-                                   edgeinfo.GetTaggedValues(true), edgeinfo.GetTypes(), added,
-                                   diff_names);
+          tilebuilder.AddEdgeInfo(w, nodea, nodeb, edgeinfo.wayid(), edgeinfo.mean_elevation(),
+                                  edgeinfo.bike_network(), edgeinfo.speed_limit(), encoded_shape,
+                                  edgeinfo.GetNames(), edgeinfo.GetTaggedValues(),
+                                  edgeinfo.GetTaggedValues(true), edgeinfo.GetTypes(), added,
+                                  diff_names);
 
       newedge.set_edgeinfo_offset(edge_info_offset);
 
       // Add directed edge
-      tilebuilder->directededges().emplace_back(std::move(newedge));
+      tilebuilder.directededges().emplace_back(std::move(newedge));
     }
 
     // Add node transitions
-    uint32_t index = tilebuilder->transitions().size();
+    uint32_t index = tilebuilder.transitions().size();
     auto new_nodes = find_nodes(old_to_new, base_node);
     if (current_level == 0) {
-      AddDownwardTransition(new_nodes.arterial_node, tilebuilder);
-      AddDownwardTransition(new_nodes.local_node, tilebuilder);
+      AddDownwardTransition(new_nodes.arterial_node, &tilebuilder);
+      AddDownwardTransition(new_nodes.local_node, &tilebuilder);
     } else if (current_level == 1) {
-      AddUpwardTransition(new_nodes.highway_node, tilebuilder);
-      AddDownwardTransition(new_nodes.local_node, tilebuilder);
+      AddUpwardTransition(new_nodes.highway_node, &tilebuilder);
+      AddDownwardTransition(new_nodes.local_node, &tilebuilder);
     } else if (current_level == 2) {
-      AddUpwardTransition(new_nodes.highway_node, tilebuilder);
-      AddUpwardTransition(new_nodes.arterial_node, tilebuilder);
+      AddUpwardTransition(new_nodes.highway_node, &tilebuilder);
+      AddUpwardTransition(new_nodes.arterial_node, &tilebuilder);
     } else {
       throw std::logic_error("current_level was never set");
     }
 
     // Set the node transition count and index
-    uint32_t count = tilebuilder->transitions().size() - index;
+    uint32_t count = tilebuilder.transitions().size() - index;
     if (count > 0) {
       node.set_transition_count(count);
       node.set_transition_index(index);
     }
 
     // Set the edge count for the new node
-    node.set_edge_count(tilebuilder->directededges().size() - edge_count);
+    node.set_edge_count(tilebuilder.directededges().size() - edge_count);
 
     // Get named signs from the base node
     if (baseni.named_intersection()) {
@@ -364,14 +357,128 @@ void FormTilesInNewLevel(GraphReader& reader,
         LOG_ERROR("Base node should have signs, but none found");
       }
       node.set_named_intersection(true);
-      tilebuilder->AddSigns(tilebuilder->nodes().size() - 1, signs);
+      tilebuilder.AddSigns(tilebuilder.nodes().size() - 1, signs);
     }
   }
 
-  // Delete the tile builder
-  if (tilebuilder != nullptr) {
-    tilebuilder->StoreTileData();
-    delete tilebuilder;
+  // Store the tile and check if we need to clear the base/local tile cache
+  tilebuilder.StoreTileData();
+  if (reader.OverCommitted()) {
+    reader.Trim();
+  }
+}
+
+// Form tiles in the new level. Each thread forms whole tiles with its own reader and sequences.
+void FormTilesInNewLevel(std::vector<std::unique_ptr<GraphReader>>& readers,
+                         const std::string& new_to_old_file,
+                         const std::string& old_to_new_file) {
+  // Find the range of new nodes of each tile. They have been sorted by level so that
+  // highway level is first
+  std::vector<NewTile> new_tiles;
+  {
+    sequence<std::pair<GraphId, GraphId>> new_to_old(new_to_old_file, false);
+    size_t index = 0;
+    for (auto new_node = new_to_old.begin(); new_node != new_to_old.end(); new_node++, index++) {
+      GraphId tile_id = (*new_node).first.Tile_Base();
+      if (new_tiles.empty() || new_tiles.back().tile_id != tile_id) {
+        new_tiles.push_back({tile_id, index, index});
+      }
+      new_tiles.back().end = index + 1;
+    }
+  }
+
+  // Use the sequence that associate new nodes to old nodes and the sorted sequence that associates
+  // old nodes to new nodes, one of each per thread
+  std::vector<std::unique_ptr<sequence<std::pair<GraphId, GraphId>>>> new_to_old;
+  std::vector<std::unique_ptr<sequence<OldToNewNodes>>> old_to_new;
+  for (auto& reader : readers) {
+    reader->Clear();
+    new_to_old.emplace_back(new sequence<std::pair<GraphId, GraphId>>(new_to_old_file, false));
+    old_to_new.emplace_back(new sequence<OldToNewNodes>(old_to_new_file, false));
+  }
+
+  // The local level tiles replace the base tiles they are formed from, so they can only be formed
+  // once the other levels are done reading the base tiles
+  auto local_level = TileHierarchy::levels().back().level;
+  auto local = std::find_if(new_tiles.begin(), new_tiles.end(), [local_level](const NewTile& t) {
+    return t.tile_id.level() == local_level;
+  });
+  size_t begin = 0;
+  for (size_t end : {static_cast<size_t>(local - new_tiles.begin()), new_tiles.size()}) {
+    parallel_for(readers.size(), end - begin, [&](size_t worker, size_t i) {
+      BuildProfiler::WorkerScope scope("HierarchyBuilder");
+      FormTileInNewLevel(*readers[worker], *new_to_old[worker], *old_to_new[worker],
+                         new_tiles[begin + i]);
+    });
+    begin = end;
+  }
+}
+
+// The levels a base node exists on and the tiles of its new nodes on the highway and arterial
+// levels, found by the threads before the new node ids are handed out in tile order
+struct NodeLevels {
+  GraphId highway_tile;
+  GraphId arterial_tile;
+  uint32_t density;
+  bool levels[3];
+};
+
+// Number of tiles per thread in a batch of CreateNodeAssociations
+constexpr size_t kAssociationBatchTiles = 64;
+
+// Find the levels of the nodes in a base tile.
+void GetNodeLevels(GraphReader& reader, const GraphId& base_tile_id, std::vector<NodeLevels>& nodes) {
+  // Get the graph tile. Skip if no tile exists or no nodes exist in the tile.
+  nodes.clear();
+  graph_tile_ptr tile = reader.GetGraphTile(base_tile_id);
+  if (!tile) {
+    return;
+  }
+
+  // Hierarchy level information
+  const auto& arterial_level = TileHierarchy::levels()[1];
+  uint32_t al = static_cast<uint32_t>(arterial_level.level);
+  const auto& highway_level = TileHierarchy::levels()[0];
+  uint32_t hl = static_cast<uint32_t>(highway_level.level);
+
+  // Iterate through the nodes. Add nodes to the new level when
+  // best road class <= the new level classification cutoff
+  uint32_t nodecount = tile->header()->nodecount();
+  nodes.resize(nodecount);
+  GraphId edgeid = base_tile_id;
+  PointLL base_ll = tile->header()->base_ll();
+  const NodeInfo* nodeinfo = tile->node(base_tile_id);
+  for (uint32_t i = 0; i < nodecount; i++, nodeinfo++) {
+    // Iterate through the edges to see which levels this node exists.
+    bool* levels = nodes[i].levels;
+    levels[0] = levels[1] = levels[2] = false;
+    for (uint32_t j = 0; j < nodeinfo->edge_count(); j++, ++edgeid) {
+      // Update the flag for the level of this edge (skip transit
+      // connection edges)
+      const DirectedEdge* directededge = tile->directededge(edgeid);
+      if (directededge->bss_connection()) {
+        // Despite the road class, Bike Share Stations' connections are always at local level
+        levels[2] = true;
+      } else if (directededge->use() != Use::kTransitConnection &&
+                 directededge->use() != Use::kEgressConnection &&
+                 directededge->use() != Use::kPlatformConnection) {
+        levels[TileHierarchy::get_level(directededge->classification())] = true;
+      }
+    }
+
+    // Tiles of the new nodes on the highway and arterial levels
+    if (levels[0]) {
+      nodes[i].highway_tile = GraphId(highway_level.tiles.TileId(nodeinfo->latlng(base_ll)), hl, 0);
+    }
+    if (levels[1]) {
+      nodes[i].arterial_tile = GraphId(arterial_level.tiles.TileId(nodeinfo->latlng(base_ll)), al, 0);
+    }
+    nodes[i].density = nodeinfo->density();
+  }
+
+  // Check if we need to clear the tile cache
+  if (reader.OverCommitted()) {
+    reader.Trim();
   }
 }
 
@@ -380,9 +487,11 @@ void FormTilesInNewLevel(GraphReader& reader,
  * hierarchy levels and the existing nodes on the base/local level. The
  * associations go both ways: from the "old" nodes on the base/local level
  * to new nodes (using a mapping in memory) and from new nodes to old nodes
- * using a sequence (file).
+ * using a sequence (file). The base tiles are read by the threads in batches,
+ * the new node ids are then handed out in tile order so that they don't depend
+ * on the number of threads.
  */
-void CreateNodeAssociations(GraphReader& reader,
+void CreateNodeAssociations(std::vector<std::unique_ptr<GraphReader>>& readers,
                             const std::string& new_to_old_file,
                             const std::string& old_to_new_file) {
   // Map of tiles vs. count of nodes. Used to construct new node Ids.
@@ -408,84 +517,54 @@ void CreateNodeAssociations(GraphReader& reader,
   // Create a sequence to associate new nodes to old nodes
   sequence<OldToNewNodes> old_to_new(old_to_new_file, true);
 
-  // Hierarchy level information
-  const auto& arterial_level = TileHierarchy::levels()[1];
-  uint32_t al = static_cast<uint32_t>(arterial_level.level);
-  const auto& highway_level = TileHierarchy::levels()[0];
-  uint32_t hl = static_cast<uint32_t>(highway_level.level);
-
-  // Iterate through all tiles in the local level
-  auto local_tiles = reader.GetTileSet();
-  for (const auto& base_tile_id : local_tiles) {
-    // We keep all transit data inside the transit hierarchy
-    if (base_tile_id.level() == TileHierarchy::GetTransitLevel().level) {
-      continue;
-    }
-
-    // Get the graph tile. Skip if no tile exists or no nodes exist in the tile.
-    graph_tile_ptr tile = reader.GetGraphTile(base_tile_id);
-    if (!tile) {
-      continue;
+  // All tiles in the local level. We keep all transit data inside the transit hierarchy
+  std::vector<GraphId> local_tiles;
+  for (const auto& base_tile_id : readers.front()->GetTileSet()) {
+    if (base_tile_id.level() != TileHierarchy::GetTransitLevel().level) {
+      local_tiles.push_back(base_tile_id);
     }
+  }
 
-    // Iterate through the nodes. Add nodes to the new level when
-    // best road class <= the new level classification cutoff
-    bool levels[3];
-    uint32_t nodecount = tile->header()->nodecount();
-    GraphId basenode = base_tile_id;
-    GraphId edgeid = base_tile_id;
-    PointLL base_ll = tile->header()->base_ll();
-    const NodeInfo* nodeinfo = tile->node(basenode);
-    for (uint32_t i = 0; i < nodecount; i++, nodeinfo++, ++basenode) {
-      // Iterate through the edges to see which levels this node exists.
-      levels[0] = levels[1] = levels[2] = false;
-      for (uint32_t j = 0; j < nodeinfo->edge_count(); j++, ++edgeid) {
-        // Update the flag for the level of this edge (skip transit
-        // connection edges)
-        const DirectedEdge* directededge = tile->directededge(edgeid);
-        if (directededge->bss_connection()) {
-          // Despite the road class, Bike Share Stations' connections are always at local level
-          levels[2] = true;
-        } else if (directededge->use() != Use::kTransitConnection &&
-                   directededge->use() != Use::kEgressConnection &&
-                   directededge->use() != Use::kPlatformConnection) {
-          levels[TileHierarchy::get_level(directededge->classification())] = true;
+  // Iterate through the tiles a batch at a time
+  std::vector<std::vector<NodeLevels>> batch(readers.size() * kAssociationBatchTiles);
+  for (size_t first = 0; first < local_tiles.size(); first += batch.size()) {
+    size_t count = std::min(batch.size(), local_tiles.size() - first);
+    parallel_for(readers.size(), count, [&](size_t worker, size_t i) {
+      BuildProfiler::WorkerScope scope("HierarchyBuilder");
+      GetNodeLevels(*readers[worker], local_tiles[first + i], batch[i]);
+    });
+
+    for (size_t i = 0; i < count; ++i) {
+      GraphId basenode = local_tiles[first + i];
+      for (const auto& node : batch[i]) {
+        // Associate new nodes to base nodes and base node to new nodes
+        GraphId highway_node, arterial_node, local_node;
+        if (node.levels[0]) {
+          // New node is on the highway level. Associate back to base/local node
+          highway_node = get_new_node(node.highway_tile);
+          new_to_old.push_back(std::make_pair(highway_node, basenode));
+        }
+        if (node.levels[1]) {
+          // New node is on the arterial level. Associate back to base/local node
+          arterial_node = get_new_node(node.arterial_tile);
+          new_to_old.push_back(std::make_pair(arterial_node, basenode));
+        }
+        if (node.levels[2]) {
+          // New node is on the local level. Associate back to base/local node
+          local_node = get_new_node(local_tiles[first + i]);
+          new_to_old.push_back(std::make_pair(local_node, basenode));
         }
-      }
 
-      // Associate new nodes to base nodes and base node to new nodes
-      GraphId highway_node, arterial_node, local_node;
-      if (levels[0]) {
-        // New node is on the highway level. Associate back to base/local node
-        GraphId new_tile(highway_level.tiles.TileId(nodeinfo->latlng(base_ll)), hl, 0);
-        highway_node = get_new_node(new_tile);
-        new_to_old.push_back(std::make_pair(highway_node, basenode));
-      }
-      if (levels[1]) {
-        // New node is on the arterial level. Associate back to base/local node
-        GraphId new_tile(arterial_level.tiles.TileId(nodeinfo->latlng(base_ll)), al, 0);
-        arterial_node = get_new_node(new_tile);
-        new_to_old.push_back(std::make_pair(arterial_node, basenode));
-      }
-      if (levels[2]) {
-        // New node is on the local level. Associate back to base/local node
-        local_node = get_new_node(base_tile_id);
-        new_to_old.push_back(std::make_pair(local_node, basenode));
-      }
+        if (!node.levels[0] && !node.levels[1] && !node.levels[2]) {
+          LOG_ERROR("No valid level for this node!");
+        }
 
-      if (!levels[0] && !levels[1] && !levels[2]) {
-        LOG_ERROR("No valid level for this node!");
+        // Associate the old node to the new node(s). Entries in the tuple
+        // that are invalid nodes indicate no node exists in the new level.
+        OldToNewNodes assoc(basenode, highway_node, arterial_node, local_node, node.density);
+        old_to_new.push_back(assoc);
+        ++basenode;
       }
-
-      // Associate the old node to the new node(s). Entries in the tuple
-      // that are invalid nodes indicate no node exists in the new level.
-      OldToNewNodes assoc(basenode, highway_node, arterial_node, local_node, nodeinfo->density());
-      old_to_new.push_back(assoc);
-    }
-
-    // Check if we need to clear the tile cache
-    if (reader.OverCommitted()) {
-      reader.Trim();
     }
   }
 }
@@ -585,23 +664,27 @@ namespace mjolnir {
 void HierarchyBuilder::Build(const boost::property_tree::ptree& pt,
                              const std::string& new_to_old_file,
                              const std::string& old_to_new_file) {
-
-  // TODO: thread this. Might be more possible now that we don't create
-  // shortcuts in the HierarchyBuilder
-
-  // Construct GraphReader
+  // Construct a GraphReader per thread, the tiles are only formed on several threads when asked to
   LOG_INFO("HierarchyBuilder");
-  GraphReader reader(pt.get_child("mjolnir"));
+  unsigned int concurrency =
+      std::max(static_cast<unsigned int>(1),
+               pt.get<unsigned int>("mjolnir.concurrency", std::thread::hardware_concurrency()));
+  unsigned int tile_concurrency = pt.get<bool>("mjolnir.parallel_hierarchy", false) ? concurrency : 1;
+  std::vector<std::unique_ptr<GraphReader>> readers;
+  for (unsigned int i = 0; i < tile_concurrency; ++i) {
+    readers.emplace_back(new GraphReader(pt.get_child("mjolnir")));
+  }
+  GraphReader& reader = *readers.front();
 
   // Association of old nodes to new nodes
-  CreateNodeAssociations(reader, new_to_old_file, old_to_new_file);
+  CreateNodeAssociations(readers, new_to_old_file, old_to_new_file);
 
   // Sort the sequences
-  SortSequences(new_to_old_file, old_to_new_file);
+  SortSequences(new_to_old_file, old_to_new_file, concurrency);
 
   // Iterate through the hierarchy (from highway down to local) and build
   // new tiles
-  FormTilesInNewLevel(reader, new_to_old_file, old_to_new_file);
+  FormTilesInNewLevel(readers, new_to_old_file, old_to_new_file);
 
   // Remove any base tiles that no longer have any data (nodes and edges
   // only exist on arterial and highway levels)
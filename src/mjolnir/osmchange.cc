@@ -0,0 +1,194 @@
+#include "mjolnir/osmchange.h"
+
+#include <cctype>
+#include <fstream>
+#include <stdexcept>
+#include <unordered_map>
+
+#include <boost/property_tree/ptree.hpp>
+
+#include "baldr/graphreader.h"
+#include "baldr/tilehierarchy.h"
+#include "midgard/logging.h"
+#include "midgard/sequence.h"
+#include "mjolnir/graphenhancer.h"
+#include "mjolnir/osmdata.h"
+#include "mjolnir/osmway.h"
+
+using namespace valhalla::baldr;
+using namespace valhalla::midgard;
+
+namespace {
+
+// Get the value of an attribute of a tag, empty if the tag does not have it
+std::string attribute(const std::string& tag, const std::string& name) {
+  const std::string key = name + "=";
+  for (size_t pos = tag.find(key); pos != std::string::npos; pos = tag.find(key, pos + 1)) {
+    // Skip matches on the end of another attribute's name
+    size_t quote_pos = pos + key.size();
+    if (pos == 0 || !std::isspace(static_cast<unsigned char>(tag[pos - 1])) ||
+        quote_pos >= tag.size()) {
+      continue;
+    }
+    char quote = tag[quote_pos];
+    if (quote != '"' && quote != '\'') {
+      continue;
+    }
+    size_t end = tag.find(quote, quote_pos + 1);
+    if (end != std::string::npos) {
+      return tag.substr(quote_pos + 1, end - quote_pos - 1);
+    }
+  }
+  return "";
+}
+
+} // namespace
+
+namespace valhalla {
+namespace mjolnir {
+
+OSMChange OSMChange::Read(const std::string& file) {
+  std::ifstream in(file);
+  if (!in.is_open()) {
+    throw std::runtime_error("Could not open osmChange file " + file);
+  }
+
+  // Every chunk up to a > holds one tag after any text between the tags
+  OSMChange change;
+  bool in_relation = false;
+  std::string chunk;
+  while (std::getline(in, chunk, '>')) {
+    size_t open = chunk.find('<');
+    if (open == std::string::npos) {
+      continue;
+    }
+    std::string tag = chunk.substr(open + 1);
+    size_t name_end = 0;
+    while (name_end < tag.size() && !std::isspace(static_cast<unsigned char>(tag[name_end])) &&
+           tag[name_end] != '/') {
+      ++name_end;
+    }
+    std::string name = tag.substr(0, name_end);
+    bool empty_element = !tag.empty() && tag.back() == '/';
+
+    if (name == "node") {
+      change.node_ids.insert(std::stoull(attribute(tag, "id")));
+      auto lat = attribute(tag, "lat");
+      auto lon = attribute(tag, "lon");
+      if (!lat.empty() && !lon.empty()) {
+        change.nodes.emplace_back(std::stod(lon), std::stod(lat));
+      }
+    } else if (name == "way") {
+      change.ways.insert(std::stoull(attribute(tag, "id")));
+    } else if (name == "relation") {
+      in_relation = !empty_element;
+    } else if (tag.compare(0, 9, "/relation") == 0) {
+      in_relation = false;
+    } else if (name == "member" && in_relation && attribute(tag, "type") == "way") {
+      change.ways.insert(std::stoull(attribute(tag, "ref")));
+    }
+  }
+
+  LOG_INFO("osmChange has " + std::to_string(change.nodes.size()) + " located nodes and " +
+           std::to_string(change.ways.size()) + " ways");
+  return change;
+}
+
+std::unordered_set<GraphId> OSMChange::AffectedTiles(const std::string& snapshot_dir,
+                                                     const std::string& ways_file,
+                                                     const std::string& way_nodes_file) {
+  const auto& local_level = TileHierarchy::levels().back();
+  std::unordered_set<GraphId> affected;
+  auto add = [&affected, &local_level](const PointLL& ll) {
+    int32_t tile_id = local_level.tiles.TileId(ll);
+    if (tile_id >= 0) {
+      affected.emplace(tile_id, local_level.level, 0);
+    }
+  };
+
+  // Tiles of the changed nodes
+  for (const auto& ll : nodes) {
+    add(ll);
+  }
+
+  // Tiles the changed ways go through in the new data
+  {
+    std::unordered_set<uint32_t> way_indices;
+    sequence<OSMWay> osm_ways(ways_file, false);
+    uint32_t index = 0;
+    for (auto way = osm_ways.begin(); way != osm_ways.end(); ++way, ++index) {
+      if (ways.count((*way).way_id())) {
+        way_indices.insert(index);
+      }
+    }
+
+    // A way that uses a changed node is changed too, it may have moved out of its previous tiles
+    sequence<OSMWayNode> way_nodes(way_nodes_file, false);
+    if (!node_ids.empty()) {
+      for (auto way_node = way_nodes.begin(); way_node != way_nodes.end(); ++way_node) {
+        const OSMWayNode node = *way_node;
+        if (node_ids.count(node.node.osmid_) && way_indices.insert(node.way_index).second) {
+          ways.insert((*osm_ways.at(node.way_index)).way_id());
+        }
+      }
+    }
+
+    for (auto way_node = way_nodes.begin(); way_node != way_nodes.end(); ++way_node) {
+      const OSMWayNode node = *way_node;
+      if (way_indices.count(node.way_index)) {
+        add(node.node.latlng());
+      }
+    }
+  }
+
+  // Tiles the changed ways went through in the previous build, and the tiles each previous tile
+  // has edges ending in
+  boost::property_tree::ptree config;
+  config.put("tile_dir", snapshot_dir);
+  GraphReader reader(config);
+  std::unordered_map<GraphId, std::unordered_set<GraphId>> end_tiles;
+  for (const auto& tile_id : reader.GetTileSet(local_level.level)) {
+    graph_tile_ptr tile = reader.GetGraphTile(tile_id);
+    if (!tile) {
+      continue;
+    }
+    auto& ends = end_tiles[tile_id];
+    for (const auto& edge : tile->GetDirectedEdges()) {
+      ends.insert(edge.endnode().Tile_Base());
+      if (ways.count(tile->edgeinfo(&edge).wayid())) {
+        affected.insert(tile_id);
+      }
+    }
+    if (reader.OverCommitted()) {
+      reader.Trim();
+    }
+  }
+
+  // The node ids of the affected tiles change so the tiles pointing into them are rebuilt too
+  std::unordered_set<GraphId> rebuild(affected);
+  for (const auto& tile : end_tiles) {
+    for (const auto& end : tile.second) {
+      if (affected.count(end)) {
+        rebuild.insert(tile.first);
+        break;
+      }
+    }
+  }
+  size_t pointing = rebuild.size() - affected.size();
+
+  // The enhancement of the tiles around them reads the affected tiles, they are rebuilt so that
+  // they are enhanced again from scratch
+  for (const auto& tile_id : GraphEnhancer::Reach(reader, affected)) {
+    if (end_tiles.count(tile_id)) {
+      rebuild.insert(tile_id);
+    }
+  }
+  LOG_INFO(std::to_string(affected.size()) + " local tiles changed, " + std::to_string(pointing) +
+           " more point into them and " +
+           std::to_string(rebuild.size() - affected.size() - pointing) +
+           " more are enhanced with them");
+  return rebuild;
+}
+
+} // namespace mjolnir
+} // namespace valhalla
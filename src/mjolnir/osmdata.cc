@@ -27,15 +27,6 @@ const std::string unique_names_file = "osmdata_unique_strings.bin";
 const std::string lane_connectivity_file = "osmdata_lane_connectivity.bin";
 
 // Data structures to assist writing and reading data
-struct TempRestriction {
-  uint64_t way_id;
-  OSMRestriction restriction;
-  TempRestriction() : way_id(0), restriction(OSMRestriction()) {
-  }
-  TempRestriction(const uint64_t w, const OSMRestriction& r) : way_id(w), restriction(r) {
-  }
-};
-
 struct TempWayRef {
   uint64_t way_id;
   uint32_t name_index;
@@ -45,51 +36,36 @@ struct TempWayRef {
   }
 };
 
-struct BikeRelation {
-  uint64_t way_id;
-  OSMBike relation;
-  BikeRelation() : way_id(0), relation(OSMBike()) {
-  }
-  BikeRelation(const uint64_t w, const OSMBike& r) : way_id(w), relation(r) {
-  }
-};
-
-struct TempAccessRestriction {
-  uint64_t way_id;
-  OSMAccessRestriction restriction;
-  TempAccessRestriction() : way_id(0), restriction(OSMAccessRestriction()) {
+// Whether a part of the data still fits on the heap within the memory budget. It is counted
+// against the budget if it does.
+bool fits(const size_t bytes, const size_t max_memory, size_t& used) {
+  if (max_memory == 0) {
+    return true;
   }
-  TempAccessRestriction(const uint64_t w, const OSMAccessRestriction& r) : way_id(w), restriction(r) {
+  if (used + bytes > max_memory) {
+    return false;
   }
-};
+  used += bytes;
+  return true;
+}
 
-struct TempLaneConnectivity {
-  uint64_t way_id;
-  OSMLaneConnectivity lane;
-  TempLaneConnectivity() : way_id(0), lane(OSMLaneConnectivity()) {
-  }
-  TempLaneConnectivity(const uint64_t w, const OSMLaneConnectivity& l) : way_id(w), lane(l) {
+template <class T>
+bool write_way_multimap(const std::string& filename, const WayIdMultiMap<T>& way_map) {
+  // Entries mapped from the file are in it already and truncating it would pull them from the map
+  if (way_map.file() == filename) {
+    return true;
   }
-};
 
-bool write_restrictions(const std::string& filename, const RestrictionsMultiMap& res_map) {
   // Open file and truncate
   std::ofstream file(filename.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
   if (!file.is_open()) {
-    LOG_ERROR("write_restrictions failed to open output file: " + filename);
+    LOG_ERROR("write_way_multimap failed to open output file: " + filename);
     return false;
   }
 
-  // Convert the multi map into a vector of TempRestriction
-  std::vector<TempRestriction> res;
-  for (auto it = res_map.cbegin(); it != res_map.cend(); ++it) {
-    res.emplace_back(it->first, it->second);
-  }
-
-  // Write the count and then the via ids
-  uint32_t sz = res.size();
-  file.write(reinterpret_cast<const char*>(&sz), sizeof(uint32_t));
-  file.write(reinterpret_cast<const char*>(res.data()), res.size() * sizeof(TempRestriction));
+  // Write nothing but the sorted entries so that the file can be mapped as they are
+  file.write(reinterpret_cast<const char*>(way_map.begin()),
+             way_map.size() * sizeof(typename WayIdMultiMap<T>::value_type));
   file.close();
   return true;
 }
@@ -118,53 +94,6 @@ bool write_viaset(const std::string& filename, const ViaSet& via_set) {
   return true;
 }
 
-bool write_access_restrictions(const std::string& filename,
-                               const AccessRestrictionsMultiMap& access_map) {
-  // Open file and truncate
-  std::ofstream file(filename.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
-  if (!file.is_open()) {
-    LOG_ERROR("write_access_restrictions failed to open output file: " + filename);
-    return false;
-  }
-
-  // Convert the multi map into a vector of TempAccessRestriction
-  std::vector<TempAccessRestriction> res;
-  for (auto it = access_map.cbegin(); it != access_map.cend(); ++it) {
-    res.emplace_back(it->first, it->second);
-  }
-
-  // Write the count and then the via ids
-  uint32_t sz = res.size();
-  file.write(reinterpret_cast<const char*>(&sz), sizeof(uint32_t));
-  file.write(reinterpret_cast<const char*>(res.data()), res.size() * sizeof(TempAccessRestriction));
-  file.close();
-  return true;
-}
-
-bool write_bike_relations(const std::string& filename, const BikeMultiMap& bike_relations) {
-  // Open file and truncate
-  std::stringstream in_mem;
-  std::ofstream file(filename.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
-  if (!file.is_open()) {
-    LOG_ERROR("write_bike_relations failed to open output file: " + filename);
-    return false;
-  }
-
-  // Create a vector of bike relations from the multimap
-  std::vector<BikeRelation> relations;
-  for (auto it = bike_relations.cbegin(); it != bike_relations.cend(); ++it) {
-    relations.emplace_back(it->first, it->second);
-  }
-
-  // Write the count and then the bike relations
-  uint32_t sz = relations.size();
-  file.write(reinterpret_cast<const char*>(&sz), sizeof(uint32_t));
-  file.write(reinterpret_cast<const char*>(relations.data()),
-             relations.size() * sizeof(BikeRelation));
-  file.close();
-  return true;
-}
-
 bool write_way_refs(const std::string& filename, const OSMStringMap& way_refs) {
   // Open file and truncate
   std::ofstream file(filename.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
@@ -191,41 +120,16 @@ bool write_way_refs(const std::string& filename, const OSMStringMap& way_refs) {
   return true;
 }
 
-bool write_node_names(const std::string& filename, const UniqueNames& names) {
-  // Open file and truncate
-  std::ofstream file(filename.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
-  if (!file.is_open()) {
-    LOG_ERROR("write_node_names failed to open output file: " + filename);
-    return false;
-  }
-
-  // Store a count of strings followed by an array of string lengths
-  uint32_t name_count = names.Size();
-  std::vector<uint32_t> lengths(name_count);
-  std::vector<char> namebuf;
-  for (uint32_t n = 0; n < name_count; ++n) {
-    const auto& str = names.name(n + 1); // Add 1 since the first name is blank
-    lengths[n] = str.length() + 1;       // Add 1 for the null terminator
-
-    // Copy the string to the namebuf and add a terminator
-    std::copy(str.c_str(), str.c_str() + str.length(), back_inserter(namebuf));
-    namebuf.push_back(0);
+bool write_names(const std::string& filename, const UniqueNames& names) {
+  // Names mapped from the file are in it already and truncating it would pull them from the map
+  if (names.File() == filename) {
+    return true;
   }
 
-  // Write to file
-  file.write(reinterpret_cast<const char*>(&name_count), sizeof(uint32_t));
-  file.write(reinterpret_cast<const char*>(lengths.data()), lengths.size() * sizeof(uint32_t));
-  uint32_t sz = namebuf.size();
-  file.write(reinterpret_cast<const char*>(&sz), sizeof(uint32_t));
-  file.write(reinterpret_cast<const char*>(namebuf.data()), namebuf.size());
-  return true;
-}
-
-bool write_unique_names(const std::string& filename, const UniqueNames& names) {
   // Open file and truncate
   std::ofstream file(filename.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
   if (!file.is_open()) {
-    LOG_ERROR("write_unique_names failed to open output file: " + filename);
+    LOG_ERROR("write_names failed to open output file: " + filename);
     return false;
   }
 
@@ -251,50 +155,32 @@ bool write_unique_names(const std::string& filename, const UniqueNames& names) {
   return true;
 }
 
-bool write_lane_connectivity(const std::string& filename,
-                             const OSMLaneConnectivityMultiMap& lane_map) {
-  // Open file and truncate
-  std::ofstream file(filename.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+template <class T>
+bool read_way_multimap(const std::string& filename,
+                       WayIdMultiMap<T>& way_map,
+                       const size_t max_memory,
+                       size_t& used) {
+  // Open file, the count of entries follows from its size
+  std::ifstream file(filename, std::ios::in | std::ios::binary | std::ios::ate);
   if (!file.is_open()) {
-    LOG_ERROR("write_lane_connectivity failed to open output file: " + filename);
+    LOG_ERROR("read_way_multimap failed to open input file: " + filename);
     return false;
   }
+  using value_type = typename WayIdMultiMap<T>::value_type;
+  size_t count = static_cast<size_t>(file.tellg()) / sizeof(value_type);
 
-  // Convert the multi map into a vector of TempLaneConnectivity
-  std::vector<TempLaneConnectivity> lanes;
-  for (auto it = lane_map.cbegin(); it != lane_map.cend(); ++it) {
-    lanes.emplace_back(it->first, it->second);
+  // Map the sorted entries from the file if they do not fit on the heap
+  if (!fits(count * sizeof(value_type), max_memory, used)) {
+    file.close();
+    way_map.map(filename, count);
+    return true;
   }
 
-  // Write the count and then the via ids
-  uint32_t sz = lanes.size();
-  file.write(reinterpret_cast<const char*>(&sz), sizeof(uint32_t));
-  file.write(reinterpret_cast<const char*>(lanes.data()),
-             lanes.size() * sizeof(TempLaneConnectivity));
+  std::vector<value_type> entries(count);
+  file.seekg(0);
+  file.read(reinterpret_cast<char*>(entries.data()), count * sizeof(value_type));
   file.close();
-  return true;
-  return true;
-}
-
-bool read_restrictions(const std::string& filename, RestrictionsMultiMap& res_map) {
-  // Open file and truncate
-  std::ifstream file(filename, std::ios::in | std::ios::binary);
-  if (!file.is_open()) {
-    LOG_ERROR("read_restrictions failed to open input file: " + filename);
-    return false;
-  }
-
-  // Read the count and then the temporary restriction list
-  uint32_t count = 0;
-  file.read(reinterpret_cast<char*>(&count), sizeof(uint32_t));
-  std::vector<TempRestriction> access_res(count);
-  file.read(reinterpret_cast<char*>(access_res.data()), count * sizeof(TempRestriction));
-  file.close();
-
-  // Iterate through the temporary restriction list and add to the restriction multi-map
-  for (const auto& r : access_res) {
-    res_map.insert({r.way_id, r.restriction});
-  }
+  way_map.assign(std::move(entries));
   return true;
 }
 
@@ -320,50 +206,6 @@ bool read_viaset(const std::string& filename, ViaSet& via_set) {
   return true;
 }
 
-bool read_access_restrictions(const std::string& filename, AccessRestrictionsMultiMap& access_map) {
-  // Open file and truncate
-  std::ifstream file(filename, std::ios::in | std::ios::binary);
-  if (!file.is_open()) {
-    LOG_ERROR("read_access_restrictions failed to open input file: " + filename);
-    return false;
-  }
-
-  // Read the count and then the temporary access restriction list
-  uint32_t count = 0;
-  file.read(reinterpret_cast<char*>(&count), sizeof(uint32_t));
-  std::vector<TempAccessRestriction> access_res(count);
-  file.read(reinterpret_cast<char*>(access_res.data()), count * sizeof(TempAccessRestriction));
-  file.close();
-
-  // Iterate through the temporary access restriction list and add to the restriction multi-map
-  for (const auto& r : access_res) {
-    access_map.insert({r.way_id, r.restriction});
-  }
-  return true;
-}
-
-bool read_bike_relations(const std::string& filename, BikeMultiMap& bike_relations) {
-  // Open file and truncate
-  std::ifstream file(filename, std::ios::in | std::ios::binary);
-  if (!file.is_open()) {
-    LOG_ERROR("read_bike_relations failed to open input file: " + filename);
-    return false;
-  }
-
-  // Read the count and then the bike relations list
-  uint32_t count = 0;
-  file.read(reinterpret_cast<char*>(&count), sizeof(uint32_t));
-  std::vector<BikeRelation> rel(count);
-  file.read(reinterpret_cast<char*>(rel.data()), count * sizeof(BikeRelation));
-  file.close();
-
-  // Iterate through the temporary bike relations list and add to the bike relations multi-map
-  for (const auto& r : rel) {
-    bike_relations.insert({r.way_id, r.relation});
-  }
-  return true;
-}
-
 bool read_way_refs(const std::string& filename, OSMStringMap& way_refs) {
   // Open file and truncate
   std::ifstream file(filename, std::ios::in | std::ios::binary);
@@ -385,11 +227,14 @@ bool read_way_refs(const std::string& filename, OSMStringMap& way_refs) {
   return true;
 }
 
-bool read_node_names(const std::string& filename, UniqueNames& names) {
+bool read_names(const std::string& filename,
+                UniqueNames& names,
+                const size_t max_memory,
+                size_t& used) {
   // Open file and truncate
   std::ifstream file(filename, std::ios::in | std::ios::binary);
   if (!file.is_open()) {
-    LOG_ERROR("read_node_names failed to open input file: " + filename);
+    LOG_ERROR("read_names failed to open input file: " + filename);
     return false;
   }
 
@@ -400,38 +245,31 @@ bool read_node_names(const std::string& filename, UniqueNames& names) {
   file.read(reinterpret_cast<char*>(lengths.data()), count * sizeof(uint32_t));
   uint32_t bufsize = 0;
   file.read(reinterpret_cast<char*>(&bufsize), sizeof(uint32_t));
-  std::vector<char> namebuf(bufsize);
-  file.read(reinterpret_cast<char*>(namebuf.data()), bufsize);
 
-  // Iterate through the temporary data and add the unique names
-  uint32_t offset = 0;
-  for (uint32_t n = 0; n < count; ++n) {
-    std::string name(&namebuf[offset]);
-    names.index(name);
-    offset += lengths[n];
-
-    if ((name.length() + 1) != lengths[n]) {
-      LOG_ERROR("name " + name + " length should be " + std::to_string(lengths[n]));
+  // With a memory budget the names go into an arena, which is mapped from the file if it does not
+  // fit on the heap
+  if (max_memory > 0) {
+    std::vector<uint32_t> offsets(count + 1, 0);
+    for (uint32_t n = 0; n < count; ++n) {
+      offsets[n + 1] = offsets[n] + lengths[n];
     }
-  }
-  return true;
-}
-
-bool read_unique_names(const std::string& filename, UniqueNames& names) {
-  // Open file and truncate
-  std::ifstream file(filename, std::ios::in | std::ios::binary);
-  if (!file.is_open()) {
-    LOG_ERROR("read_unique_names failed to open input file: " + filename);
-    return false;
+    if (offsets.back() != bufsize) {
+      LOG_ERROR("names in " + filename + " should take " + std::to_string(bufsize) + " bytes");
+      return false;
+    }
+    lengths = std::vector<uint32_t>();
+    if (!fits(bufsize + offsets.size() * sizeof(uint32_t), max_memory, used)) {
+      size_t begin = file.tellg();
+      file.close();
+      names.Map(filename, begin, std::move(offsets));
+      return true;
+    }
+    std::vector<char> arena(bufsize);
+    file.read(arena.data(), bufsize);
+    names.Assign(std::move(arena), std::move(offsets));
+    return true;
   }
 
-  // Read from file
-  uint32_t count = 0;
-  file.read(reinterpret_cast<char*>(&count), sizeof(uint32_t));
-  std::vector<uint32_t> lengths(count);
-  file.read(reinterpret_cast<char*>(lengths.data()), count * sizeof(uint32_t));
-  uint32_t bufsize = 0;
-  file.read(reinterpret_cast<char*>(&bufsize), sizeof(uint32_t));
   std::vector<char> namebuf(bufsize);
   file.read(reinterpret_cast<char*>(namebuf.data()), bufsize);
 
@@ -449,28 +287,6 @@ bool read_unique_names(const std::string& filename, UniqueNames& names) {
   return true;
 }
 
-bool read_lane_connectivity(const std::string& filename, OSMLaneConnectivityMultiMap& lane_map) {
-  // Open file and truncate
-  std::ifstream file(filename, std::ios::in | std::ios::binary);
-  if (!file.is_open()) {
-    LOG_ERROR("read_lane_connectivity failed to open input file: " + filename);
-    return false;
-  }
-
-  // Read the count and then the temporary lane connectivity list
-  uint32_t count = 0;
-  file.read(reinterpret_cast<char*>(&count), sizeof(uint32_t));
-  std::vector<TempLaneConnectivity> lanes(count);
-  file.read(reinterpret_cast<char*>(lanes.data()), count * sizeof(TempLaneConnectivity));
-  file.close();
-
-  // Iterate through the temporary lane connectivity list and add to the lane connectivity multi-map
-  for (const auto& l : lanes) {
-    lane_map.insert({l.way_id, l.lane});
-  }
-  return true;
-}
-
 } // namespace
 
 namespace valhalla {
@@ -498,22 +314,23 @@ bool OSMData::write_to_temp_files(const std::string& tile_dir) {
   file.write(reinterpret_cast<const char*>(&node_exit_to_count), sizeof(uint64_t));
   file.close();
 
-  // Write the rest of OSMData
-  bool status = write_restrictions(tile_dir + restrictions_file, restrictions) &&
+  // Write the rest of OSMData, sorted so the multimaps can be mapped from their files
+  sort();
+  bool status = write_way_multimap(tile_dir + restrictions_file, restrictions) &&
                 write_viaset(tile_dir + viaset_file, via_set) &&
-                write_access_restrictions(tile_dir + access_restrictions_file, access_restrictions) &&
-                write_bike_relations(tile_dir + bike_relations_file, bike_relations) &&
+                write_way_multimap(tile_dir + access_restrictions_file, access_restrictions) &&
+                write_way_multimap(tile_dir + bike_relations_file, bike_relations) &&
                 write_way_refs(tile_dir + way_ref_file, way_ref) &&
                 write_way_refs(tile_dir + way_ref_rev_file, way_ref_rev) &&
-                write_node_names(tile_dir + node_names_file, node_names) &&
-                write_unique_names(tile_dir + unique_names_file, name_offset_map) &&
-                write_lane_connectivity(tile_dir + lane_connectivity_file, lane_connectivity_map);
+                write_names(tile_dir + node_names_file, node_names) &&
+                write_names(tile_dir + unique_names_file, name_offset_map) &&
+                write_way_multimap(tile_dir + lane_connectivity_file, lane_connectivity_map);
   LOG_INFO("Done");
   return status;
 }
 
 // Read OSMData from temporary files
-bool OSMData::read_from_temp_files(const std::string& tile_dir) {
+bool OSMData::read_from_temp_files(const std::string& tile_dir, size_t max_memory) {
   LOG_INFO("Read OSMData from temp files");
 
   std::string tile_directory = tile_dir;
@@ -539,32 +356,145 @@ bool OSMData::read_from_temp_files(const std::string& tile_dir) {
   file.read(reinterpret_cast<char*>(&node_exit_to_count), sizeof(uint64_t));
   file.close();
 
-  // Read the other data
+  // Read the other data, the names first as they are looked up the most
+  size_t used = 0;
   bool status =
-      read_restrictions(tile_directory + restrictions_file, restrictions) &&
+      read_names(tile_directory + unique_names_file, name_offset_map, max_memory, used) &&
+      read_names(tile_directory + node_names_file, node_names, max_memory, used) &&
+      read_way_multimap(tile_directory + restrictions_file, restrictions, max_memory, used) &&
       read_viaset(tile_directory + viaset_file, via_set) &&
-      read_access_restrictions(tile_directory + access_restrictions_file, access_restrictions) &&
-      read_bike_relations(tile_directory + bike_relations_file, bike_relations) &&
+      read_way_multimap(tile_directory + access_restrictions_file, access_restrictions, max_memory,
+                        used) &&
+      read_way_multimap(tile_directory + bike_relations_file, bike_relations, max_memory, used) &&
       read_way_refs(tile_directory + way_ref_file, way_ref) &&
       read_way_refs(tile_directory + way_ref_rev_file, way_ref_rev) &&
-      read_node_names(tile_directory + node_names_file, node_names) &&
-      read_unique_names(tile_directory + unique_names_file, name_offset_map) &&
-      read_lane_connectivity(tile_directory + lane_connectivity_file, lane_connectivity_map);
+      read_way_multimap(tile_directory + lane_connectivity_file, lane_connectivity_map, max_memory,
+                        used);
   LOG_INFO("Done");
   initialized = status;
   return status;
 }
 
 // Read OSMData from temporary files
-bool OSMData::read_from_unique_names_file(const std::string& tile_dir) {
+bool OSMData::read_from_unique_names_file(const std::string& tile_dir, size_t max_memory) {
   LOG_INFO("Read OSMData unique_names from temp file");
 
   // Read the other data
-  bool status = read_unique_names(tile_dir + unique_names_file, name_offset_map);
+  size_t used = 0;
+  bool status = read_names(tile_dir + unique_names_file, name_offset_map, max_memory, used);
   LOG_INFO("Done");
   return status;
 }
 
+// Sort the multimaps so their entries can be looked up
+void OSMData::sort() {
+  restrictions.sort();
+  access_restrictions.sort();
+  bike_relations.sort();
+  lane_connectivity_map.sort();
+}
+
+// Estimate the heap memory of OSMData
+size_t OSMData::memory_usage() const {
+  // Hash containers take a pointer per bucket and a node per element with the next pointer and
+  // the cached hash besides the element
+  auto hash_usage = [](size_t bucket_count, size_t size, size_t element_size) {
+    return bucket_count * sizeof(void*) + size * (element_size + 2 * sizeof(void*));
+  };
+  return restrictions.memory_usage() + access_restrictions.memory_usage() +
+         bike_relations.memory_usage() + lane_connectivity_map.memory_usage() +
+         hash_usage(via_set.bucket_count(), via_set.size(), sizeof(ViaSet::value_type)) +
+         hash_usage(way_ref.bucket_count(), way_ref.size(), sizeof(OSMStringMap::value_type)) +
+         hash_usage(way_ref_rev.bucket_count(), way_ref_rev.size(),
+                    sizeof(OSMStringMap::value_type)) +
+         node_names.MemoryUsage() + name_offset_map.MemoryUsage();
+}
+
+// Move OSMData out of the heap when it takes more than the budget
+bool OSMData::fit_memory(const std::string& tile_dir, size_t max_memory, const OSMType parsed) {
+  size_t usage = memory_usage();
+  if (max_memory == 0 || usage <= max_memory) {
+    return true;
+  }
+  LOG_INFO("OSMData takes " + std::to_string(usage / (1024 * 1024)) + " MB, more than the " +
+           std::to_string(max_memory / (1024 * 1024)) + " MB budget");
+
+  // Ways add access restrictions and way names, relations add the restrictions, bike relations,
+  // lane connections and more way names, nodes add the node names
+  bool relations_done = parsed != OSMType::kWay;
+  bool nodes_done = parsed == OSMType::kNode;
+
+  // The hash maps of the names take several times the names themselves, moving the names into
+  // arenas is often enough
+  if (relations_done) {
+    name_offset_map.Compact();
+  }
+  if (nodes_done) {
+    node_names.Compact();
+  }
+  usage = memory_usage();
+  if (usage <= max_memory) {
+    LOG_INFO("OSMData takes " + std::to_string(usage / (1024 * 1024)) +
+             " MB of heap memory with the names in arenas");
+    return true;
+  }
+
+  // Write everything out and drop it before reading it back so that the two never add up
+  if (nodes_done) {
+    if (!write_to_temp_files(tile_dir)) {
+      return false;
+    }
+    restrictions.clear();
+    via_set = ViaSet();
+    access_restrictions.clear();
+    bike_relations.clear();
+    way_ref = OSMStringMap();
+    way_ref_rev = OSMStringMap();
+    node_names.Clear();
+    name_offset_map.Clear();
+    lane_connectivity_map.clear();
+    if (!read_from_temp_files(tile_dir, max_memory)) {
+      return false;
+    }
+    LOG_INFO("OSMData takes " + std::to_string(memory_usage() / (1024 * 1024)) +
+             " MB of heap memory with the rest mapped from files");
+    return true;
+  }
+
+  // While parsing the parts that are still added to stay on the heap, the complete ones are
+  // written out and read back within what is left of the budget
+  sort();
+  if (!write_way_multimap(tile_dir + access_restrictions_file, access_restrictions)) {
+    return false;
+  }
+  access_restrictions.clear();
+  if (relations_done) {
+    if (!write_way_multimap(tile_dir + restrictions_file, restrictions) ||
+        !write_way_multimap(tile_dir + bike_relations_file, bike_relations) ||
+        !write_way_multimap(tile_dir + lane_connectivity_file, lane_connectivity_map) ||
+        !write_names(tile_dir + unique_names_file, name_offset_map)) {
+      return false;
+    }
+    restrictions.clear();
+    bike_relations.clear();
+    lane_connectivity_map.clear();
+    name_offset_map.Clear();
+  }
+  size_t used = memory_usage();
+  bool status = (!relations_done ||
+                 (read_names(tile_dir + unique_names_file, name_offset_map, max_memory, used) &&
+                  read_way_multimap(tile_dir + restrictions_file, restrictions, max_memory, used) &&
+                  read_way_multimap(tile_dir + bike_relations_file, bike_relations, max_memory,
+                                    used) &&
+                  read_way_multimap(tile_dir + lane_connectivity_file, lane_connectivity_map,
+                                    max_memory, used))) &&
+                read_way_multimap(tile_dir + access_restrictions_file, access_restrictions,
+                                  max_memory, used);
+  LOG_INFO("OSMData takes " + std::to_string(memory_usage() / (1024 * 1024)) +
+           " MB of heap memory with the complete parts mapped from files");
+  return status;
+}
+
 // add the direction information to the forward or reverse map for relations.
 void OSMData::add_to_name_map(const uint64_t member_id,
                               const std::string& direction,
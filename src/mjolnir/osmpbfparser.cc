@@ -27,7 +27,14 @@
 
 // This is largely based off of: https://github.com/CanalTP/libosmpbfreader
 // there have been some minor changes for our own purposes but its largely the same
+#include <condition_variable>
 #include <cstdint>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
 #ifdef _MSC_VER
 #include <winsock2.h> // ntohl
 #else
@@ -49,7 +56,7 @@ namespace {
 // the maximum size of an uncompressed blob in bytes 32 MB
 #define MAX_UNCOMPRESSED_BLOB_SIZE 33554432
 
-BlobHeader read_header(char* buffer, std::ifstream& file, bool& finished) {
+BlobHeader read_header(std::string& buffer, std::ifstream& file, bool& finished) {
   BlobHeader result;
 
   // read the first 4 bytes of the file, this is the size of the blob-header
@@ -67,13 +74,14 @@ BlobHeader read_header(char* buffer, std::ifstream& file, bool& finished) {
   }
 
   // grab the blob header bytes
-  file.read(buffer, sz);
+  buffer.resize(sz);
+  file.read(&buffer[0], sz);
   if (!file.good()) {
     throw std::runtime_error("unable to read blob-header from file");
   }
 
   // turn the bytes into a protobuf object
-  if (!result.ParseFromArray(buffer, sz)) {
+  if (!result.ParseFromArray(buffer.data(), sz)) {
     throw std::runtime_error("unable to parse blob header");
   }
 
@@ -81,9 +89,7 @@ BlobHeader read_header(char* buffer, std::ifstream& file, bool& finished) {
   return result;
 }
 
-int32_t read_blob(char* buffer, char* unpack_buffer, std::ifstream& file, const BlobHeader& header) {
-  Blob blob;
-
+void read_blob(std::string& bytes, std::ifstream& file, const BlobHeader& header) {
   // is the size of the following blob sane
   int32_t sz = header.datasize();
   if (sz > MAX_UNCOMPRESSED_BLOB_SIZE) {
@@ -91,31 +97,45 @@ int32_t read_blob(char* buffer, char* unpack_buffer, std::ifstream& file, const
   }
 
   // pull out the bytes
-  if (!file.read(buffer, sz)) {
+  bytes.resize(sz);
+  if (!file.read(&bytes[0], sz)) {
     throw std::runtime_error("unable to read blob from file");
   }
+}
+
+int32_t unpack_blob(const std::string& bytes, std::vector<char>& unpack_buffer) {
+  Blob blob;
 
   // turn it into a protobuf object
-  if (!blob.ParseFromArray(buffer, sz)) {
+  if (!blob.ParseFromArray(bytes.data(), bytes.size())) {
     throw std::runtime_error("unable to parse blob");
   }
 
   // if the blob was uncompressed
   if (blob.has_raw()) {
     // check that raw_size is set correctly and move it to the final buffer
-    sz = blob.raw().size();
+    int32_t sz = blob.raw().size();
     if (sz != blob.raw_size()) {
       LOG_WARN("blob reports wrong raw_size: " + std::to_string(blob.raw_size()) + " bytes");
     }
-    memcpy(unpack_buffer, buffer, sz);
+    if (unpack_buffer.size() < static_cast<size_t>(sz)) {
+      unpack_buffer.resize(sz);
+    }
+    memcpy(unpack_buffer.data(), blob.raw().data(), sz);
     return sz;
   } // if the blob was zlib compressed
   else if (blob.has_zlib_data()) {
-    sz = blob.zlib_data().size();
+    if (blob.raw_size() > MAX_UNCOMPRESSED_BLOB_SIZE) {
+      throw std::runtime_error("uncompressed blob-size is bigger than allowed");
+    }
+    if (unpack_buffer.size() < static_cast<size_t>(blob.raw_size())) {
+      unpack_buffer.resize(blob.raw_size());
+    }
+    int32_t sz = blob.zlib_data().size();
     z_stream z;
     z.next_in = (unsigned char*)blob.zlib_data().c_str();
     z.avail_in = sz;
-    z.next_out = (unsigned char*)unpack_buffer;
+    z.next_out = (unsigned char*)unpack_buffer.data();
     z.avail_out = blob.raw_size();
     z.zalloc = Z_NULL;
     z.zfree = Z_NULL;
@@ -151,16 +171,18 @@ template <class T> OSMPBF::Tags get_tags(const T& object, const OSMPBF::Primitiv
   return result;
 }
 
-void parse_primitive_block(char* unpack_buffer,
-                           int32_t sz,
-                           const Interest interest,
-                           Callback& callback) {
+void decode_primitive_block(const std::vector<char>& unpack_buffer,
+                            int32_t sz,
+                            PrimitiveBlock& primblock) {
   // turn the blob bytes into a protobuf object
-  PrimitiveBlock primblock;
-  if (!primblock.ParseFromArray(unpack_buffer, sz)) {
+  if (!primblock.ParseFromArray(unpack_buffer.data(), sz)) {
     throw std::runtime_error("unable to parse primitive block");
   }
+}
 
+void parse_primitive_block(const PrimitiveBlock& primblock,
+                           const Interest interest,
+                           Callback& callback) {
   // for each primitive group
   for (const auto& primitive_group : primblock.primitivegroup()) {
 
@@ -262,36 +284,114 @@ void parse_primitive_block(char* unpack_buffer,
   }
 }
 
-void parse_header_block(char* unpack_buffer, int32_t sz) {
+void parse_header_block(const std::vector<char>& unpack_buffer, int32_t sz) {
   // turn the blob bytes into a protobuf object
   HeaderBlock header_block;
-  if (!header_block.ParseFromArray(unpack_buffer, sz)) {
+  if (!header_block.ParseFromArray(unpack_buffer.data(), sz)) {
     throw std::runtime_error("unable to parse header block");
   }
 
   // TODO: do something with replication information?
 }
 
-} // namespace
+// a blob read from the file that is decoded by one of the worker threads
+struct block_t {
+  BlobHeader header;
+  std::string bytes;
+  PrimitiveBlock primblock;
+  std::exception_ptr error;
+  bool decoded = false;
+};
+
+// inflates and decodes blobs on a pool of threads. the blobs are handed out in file order and the
+// caller waits for them in that same order so that the callbacks see exactly what a serial parse
+// would have given them
+class block_decoder_t {
+public:
+  block_decoder_t(const unsigned int threads) : stop_(false) {
+    threads_.reserve(threads);
+    for (unsigned int i = 0; i < threads; ++i) {
+      threads_.emplace_back(&block_decoder_t::work, this);
+    }
+  }
 
-// extend the protobuf osmpbf namespace
-namespace OSMPBF {
+  ~block_decoder_t() {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      stop_ = true;
+      queue_.clear();
+    }
+    work_cv_.notify_all();
+    for (auto& thread : threads_) {
+      thread.join();
+    }
+  }
 
-Member::Member(const Relation::MemberType type, const uint64_t id, const std::string& role)
-    : member_type(type), member_id(id), role(role) {
-}
+  // hand a blob to the workers, it must outlive this decoder or be waited for
+  void push(block_t* block) {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      queue_.push_back(block);
+    }
+    work_cv_.notify_one();
+  }
 
-Member::Member(Member&& other)
-    : member_type(other.member_type), member_id(other.member_id), role(std::move(other.role)) {
-}
+  // block until the blob has been decoded, rethrows whatever went wrong decoding it
+  void wait(block_t& block) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    done_cv_.wait(lock, [&block]() { return block.decoded; });
+    if (block.error) {
+      std::rethrow_exception(block.error);
+    }
+  }
 
-void Parser::parse(std::ifstream& file, const Interest interest, Callback& callback) {
-  char* buffer = new char[MAX_UNCOMPRESSED_BLOB_SIZE];
-  char* unpack_buffer = new char[MAX_UNCOMPRESSED_BLOB_SIZE];
+private:
+  void work() {
+    std::vector<char> unpack_buffer;
+    while (true) {
+      block_t* block;
+      {
+        std::unique_lock<std::mutex> lock(mutex_);
+        work_cv_.wait(lock, [this]() { return stop_ || !queue_.empty(); });
+        if (stop_) {
+          return;
+        }
+        block = queue_.front();
+        queue_.pop_front();
+      }
 
-  // start from the top
-  file.clear();
-  file.seekg(0, std::ios::beg);
+      try {
+        if (block->header.type() == "OSMData") {
+          int32_t sz = unpack_blob(block->bytes, unpack_buffer);
+          decode_primitive_block(unpack_buffer, sz, block->primblock);
+        } else if (block->header.type() == "OSMHeader") {
+          int32_t sz = unpack_blob(block->bytes, unpack_buffer);
+          parse_header_block(unpack_buffer, sz);
+        }
+      } catch (...) { block->error = std::current_exception(); }
+      // we are done with the compressed bytes
+      std::string().swap(block->bytes);
+
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        block->decoded = true;
+      }
+      done_cv_.notify_all();
+    }
+  }
+
+  std::mutex mutex_;
+  std::condition_variable work_cv_;
+  std::condition_variable done_cv_;
+  std::deque<block_t*> queue_;
+  bool stop_;
+  std::vector<std::thread> threads_;
+};
+
+void parse_serial(std::ifstream& file, const Interest interest, Callback& callback) {
+  std::string buffer;
+  std::vector<char> unpack_buffer;
+  PrimitiveBlock primblock;
 
   // while there is more to read
   while (!file.eof()) {
@@ -301,22 +401,97 @@ void Parser::parse(std::ifstream& file, const Interest interest, Callback& callb
     // if we didnt hit the end
     if (!finished) {
       // grab the blob that goes with the blob header
-      int32_t sz = read_blob(buffer, unpack_buffer, file, header);
+      read_blob(buffer, file, header);
       // if its data parse it
       if (header.type() == "OSMData") {
-        parse_primitive_block(unpack_buffer, sz, interest, callback);
+        int32_t sz = unpack_blob(buffer, unpack_buffer);
+        decode_primitive_block(unpack_buffer, sz, primblock);
+        parse_primitive_block(primblock, interest, callback);
         // if its something other than a header
       } else if (header.type() == "OSMHeader") {
+        int32_t sz = unpack_blob(buffer, unpack_buffer);
         parse_header_block(unpack_buffer, sz);
       } else {
         LOG_WARN("Unknown blob type: " + header.type());
       }
     }
   }
+}
+
+void parse_parallel(std::ifstream& file,
+                    const Interest interest,
+                    Callback& callback,
+                    const unsigned int threads) {
+  // blobs that were read but not yet handed to the callback, declared before the decoder so
+  // that its threads are joined before these go away
+  std::deque<std::unique_ptr<block_t>> in_flight;
+  block_decoder_t decoder(threads);
+  // keep a few blobs per thread queued so the workers dont starve while the callbacks run
+  const size_t max_in_flight = threads * 4;
+
+  // the callbacks happen here on the calling thread in file order
+  auto consume = [&]() {
+    auto& block = *in_flight.front();
+    decoder.wait(block);
+    if (block.header.type() == "OSMData") {
+      parse_primitive_block(block.primblock, interest, callback);
+    } else if (block.header.type() != "OSMHeader") {
+      LOG_WARN("Unknown blob type: " + block.header.type());
+    }
+    in_flight.pop_front();
+  };
+
+  // while there is more to read
+  std::string buffer;
+  while (!file.eof()) {
+    // grab the blob header
+    bool finished = false;
+    BlobHeader header = read_header(buffer, file, finished);
+    // if we didnt hit the end hand the blob off to be decoded
+    if (!finished) {
+      in_flight.emplace_back(new block_t);
+      in_flight.back()->header = std::move(header);
+      read_blob(in_flight.back()->bytes, file, in_flight.back()->header);
+      decoder.push(in_flight.back().get());
+    }
+    // make room for the next blob
+    if (in_flight.size() >= max_in_flight) {
+      consume();
+    }
+  }
 
-  // done with protobuf and buffers
-  delete[] buffer;
-  delete[] unpack_buffer;
+  // drain whatever is left
+  while (!in_flight.empty()) {
+    consume();
+  }
+}
+
+} // namespace
+
+// extend the protobuf osmpbf namespace
+namespace OSMPBF {
+
+Member::Member(const Relation::MemberType type, const uint64_t id, const std::string& role)
+    : member_type(type), member_id(id), role(role) {
+}
+
+Member::Member(Member&& other)
+    : member_type(other.member_type), member_id(other.member_id), role(std::move(other.role)) {
+}
+
+void Parser::parse(std::ifstream& file,
+                   const Interest interest,
+                   Callback& callback,
+                   const unsigned int threads) {
+  // start from the top
+  file.clear();
+  file.seekg(0, std::ios::beg);
+
+  if (threads > 1) {
+    parse_parallel(file, interest, callback, threads);
+  } else {
+    parse_serial(file, interest, callback);
+  }
 }
 
 void Parser::free() {
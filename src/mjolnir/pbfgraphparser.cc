@@ -3004,6 +3004,15 @@ public:
   Tags empty_relation_results_;
 };
 
+// The number of threads a parse pass inflates and decodes the blobs and sorts its output on. The
+// callbacks build up the OSMData in the order the objects appear in the files, so they stay on the
+// calling thread. Decoding is where the time goes and only that is spread over the threads, which
+// keeps the output the same no matter how many of them there are
+unsigned int parse_concurrency(const boost::property_tree::ptree& pt) {
+  return std::max(static_cast<unsigned int>(1),
+                  pt.get<unsigned int>("concurrency", std::thread::hardware_concurrency()));
+}
+
 } // namespace
 
 namespace valhalla {
@@ -3015,12 +3024,7 @@ OSMData PBFGraphParser::ParseWays(const boost::property_tree::ptree& pt,
                                   const std::string& way_nodes_file,
                                   const std::string& access_file,
                                   const std::string& pronunciation_file) {
-  // TODO: option 1: each one threads makes an osmdata and we splice them together at the end
-  // option 2: synchronize around adding things to a single osmdata. will have to test to see
-  // which is the least expensive (memory and speed). leaning towards option 2
-  //  unsigned int threads =
-  //      std::max(static_cast<unsigned int>(1),
-  //               pt.get<unsigned int>("concurrency", std::thread::hardware_concurrency()));
+  unsigned int threads = parse_concurrency(pt);
 
   // Create OSM data. Set the member pointer so that the parsing callback methods can use it.
   OSMData osmdata{};
@@ -3051,7 +3055,7 @@ OSMData PBFGraphParser::ParseWays(const boost::property_tree::ptree& pt,
     OSMPBF::Parser::parse(file_handle,
                           static_cast<OSMPBF::Interest>(OSMPBF::Interest::WAYS |
                                                         OSMPBF::Interest::CHANGESETS),
-                          callback);
+                          callback, threads);
   }
 
   // Clarifies types of loop roads and saves fixed ways.
@@ -3065,7 +3069,8 @@ OSMData PBFGraphParser::ParseWays(const boost::property_tree::ptree& pt,
   LOG_INFO("Sorting osm access tags by way id...");
   {
     sequence<OSMAccess> access(access_file, false);
-    access.sort([](const OSMAccess& a, const OSMAccess& b) { return a.way_id() < b.way_id(); });
+    access.sort([](const OSMAccess& a, const OSMAccess& b) { return a.way_id() < b.way_id(); },
+                sequence<OSMAccess>::kSortBufferSize, threads);
   }
 
   // we need to sort the pronunciation indexes so that we can easily find them.
@@ -3073,9 +3078,12 @@ OSMData PBFGraphParser::ParseWays(const boost::property_tree::ptree& pt,
   {
     sequence<OSMPronunciation> pronunciation(pronunciation_file, false);
     pronunciation.sort(
-        [](const OSMPronunciation& a, const OSMPronunciation& b) { return a.way_id() < b.way_id(); });
+        [](const OSMPronunciation& a, const OSMPronunciation& b) { return a.way_id() < b.way_id(); },
+        sequence<OSMPronunciation>::kSortBufferSize, threads);
   }
 
+  // Sort the access restrictions by way id so that they can be looked up
+  osmdata.sort();
   LOG_INFO("Finished");
 
   // Return OSM data
@@ -3088,12 +3096,7 @@ void PBFGraphParser::ParseRelations(const boost::property_tree::ptree& pt,
                                     const std::string& complex_restriction_from_file,
                                     const std::string& complex_restriction_to_file,
                                     OSMData& osmdata) {
-  // TODO: option 1: each one threads makes an osmdata and we splice them together at the end
-  // option 2: synchronize around adding things to a single osmdata. will have to test to see
-  // which is the least expensive (memory and speed). leaning towards option 2
-  //  unsigned int threads =
-  //      std::max(static_cast<unsigned int>(1),
-  //               pt.get<unsigned int>("concurrency", std::thread::hardware_concurrency()));
+  unsigned int threads = parse_concurrency(pt);
 
   // Create OSM data. Set the member pointer so that the parsing callback methods can use it.
   graph_callback callback(pt, osmdata);
@@ -3126,8 +3129,11 @@ void PBFGraphParser::ParseRelations(const boost::property_tree::ptree& pt,
     OSMPBF::Parser::parse(file_handle,
                           static_cast<OSMPBF::Interest>(OSMPBF::Interest::RELATIONS |
                                                         OSMPBF::Interest::CHANGESETS),
-                          callback);
+                          callback, threads);
   }
+  // Sort the restrictions, bike relations and lane connections by way id so that they can be
+  // looked up
+  osmdata.sort();
   LOG_INFO("Finished with " + std::to_string(osmdata.restrictions.size()) + " simple restrictions");
   LOG_INFO("Finished with " + std::to_string(osmdata.lane_connectivity_map.size()) +
            " lane connections");
@@ -3139,7 +3145,8 @@ void PBFGraphParser::ParseRelations(const boost::property_tree::ptree& pt,
   {
     sequence<OSMRestriction> complex_restrictions_from(complex_restriction_from_file, false);
     complex_restrictions_from.sort(
-        [](const OSMRestriction& a, const OSMRestriction& b) { return a < b; });
+        [](const OSMRestriction& a, const OSMRestriction& b) { return a < b; },
+        sequence<OSMRestriction>::kSortBufferSize, threads);
   }
 
   // Sort complex restrictions. Keep this scoped so the file handles are closed when done sorting.
@@ -3147,7 +3154,8 @@ void PBFGraphParser::ParseRelations(const boost::property_tree::ptree& pt,
   {
     sequence<OSMRestriction> complex_restrictions_to(complex_restriction_to_file, false);
     complex_restrictions_to.sort(
-        [](const OSMRestriction& a, const OSMRestriction& b) { return a < b; });
+        [](const OSMRestriction& a, const OSMRestriction& b) { return a < b; },
+        sequence<OSMRestriction>::kSortBufferSize, threads);
   }
   LOG_INFO("Finished");
 }
@@ -3157,12 +3165,7 @@ void PBFGraphParser::ParseNodes(const boost::property_tree::ptree& pt,
                                 const std::string& way_nodes_file,
                                 const std::string& bss_nodes_file,
                                 OSMData& osmdata) {
-  // TODO: option 1: each one threads makes an osmdata and we splice them together at the end
-  // option 2: synchronize around adding things to a single osmdata. will have to test to see
-  // which is the least expensive (memory and speed). leaning towards option 2
-  //  unsigned int threads =
-  //      std::max(static_cast<unsigned int>(1),
-  //               pt.get<unsigned int>("concurrency", std::thread::hardware_concurrency()));
+  unsigned int threads = parse_concurrency(pt);
 
   // Create OSM data. Set the member pointer so that the parsing callback methods can use it.
   graph_callback callback(pt, osmdata);
@@ -3194,7 +3197,7 @@ void PBFGraphParser::ParseNodes(const boost::property_tree::ptree& pt,
       callback.reset(nullptr, nullptr, nullptr, nullptr, nullptr, nullptr,
                      new sequence<OSMNode>(bss_nodes_file, create));
       OSMPBF::Parser::parse(file_handle, static_cast<OSMPBF::Interest>(OSMPBF::Interest::NODES),
-                            callback);
+                            callback, threads);
       create = false;
     }
     // Since the sequence must be flushed before reading it...
@@ -3211,7 +3214,8 @@ void PBFGraphParser::ParseNodes(const boost::property_tree::ptree& pt,
   {
     sequence<OSMWayNode> way_nodes(way_nodes_file, false);
     way_nodes.sort(
-        [](const OSMWayNode& a, const OSMWayNode& b) { return a.node.osmid_ < b.node.osmid_; });
+        [](const OSMWayNode& a, const OSMWayNode& b) { return a.node.osmid_ < b.node.osmid_; },
+        sequence<OSMWayNode>::kSortBufferSize, threads);
   }
 
   // Parse node in all the input files. Skip any that are not marked from
@@ -3228,7 +3232,7 @@ void PBFGraphParser::ParseNodes(const boost::property_tree::ptree& pt,
     OSMPBF::Parser::parse(file_handle,
                           static_cast<OSMPBF::Interest>(OSMPBF::Interest::NODES |
                                                         OSMPBF::Interest::CHANGESETS),
-                          callback);
+                          callback, threads);
   }
   uint64_t max_osm_id = callback.last_node_;
   callback.reset(nullptr, nullptr, nullptr, nullptr, nullptr, nullptr, nullptr);
@@ -3240,13 +3244,15 @@ void PBFGraphParser::ParseNodes(const boost::property_tree::ptree& pt,
   LOG_INFO("Sorting osm way node references by way index and node shape index...");
   {
     sequence<OSMWayNode> way_nodes(way_nodes_file, false);
-    way_nodes.sort([](const OSMWayNode& a, const OSMWayNode& b) {
-      if (a.way_index == b.way_index) {
-        // TODO: if its equal we have screwed something up, should we check and throw here?
-        return a.way_shape_node_index < b.way_shape_node_index;
-      }
-      return a.way_index < b.way_index;
-    });
+    way_nodes.sort(
+        [](const OSMWayNode& a, const OSMWayNode& b) {
+          if (a.way_index == b.way_index) {
+            // TODO: if its equal we have screwed something up, should we check and throw here?
+            return a.way_shape_node_index < b.way_shape_node_index;
+          }
+          return a.way_index < b.way_index;
+        },
+        sequence<OSMWayNode>::kSortBufferSize, threads);
   }
 
   // Some OSM extracts do not have changeset Ids. For these set the max changeset Id
@@ -1,5 +1,6 @@
 #include "mjolnir/util.h"
 
+#include "baldr/graphreader.h"
 #include "baldr/tilehierarchy.h"
 #include "filesystem.h"
 #include "midgard/aabb2.h"
@@ -7,12 +8,15 @@
 #include "midgard/point2.h"
 #include "midgard/polyline2.h"
 #include "mjolnir/bssbuilder.h"
+#include "mjolnir/buildprofiler.h"
+#include "mjolnir/contractionbuilder.h"
 #include "mjolnir/elevationbuilder.h"
 #include "mjolnir/graphbuilder.h"
 #include "mjolnir/graphenhancer.h"
 #include "mjolnir/graphfilter.h"
 #include "mjolnir/graphvalidator.h"
 #include "mjolnir/hierarchybuilder.h"
+#include "mjolnir/osmchange.h"
 #include "mjolnir/osmpbfparser.h"
 #include "mjolnir/pbfgraphparser.h"
 #include "mjolnir/restrictionbuilder.h"
@@ -23,6 +27,10 @@
 #include <boost/algorithm/string/split.hpp>
 #include <boost/property_tree/ptree.hpp>
 
+#include <fstream>
+#include <unordered_set>
+
+using namespace valhalla::baldr;
 using namespace valhalla::midgard;
 
 namespace {
@@ -58,6 +66,45 @@ const std::string old_to_new_file = "old_nodes_to_new_nodes.bin";
 const std::string intersections_file = "intersections.bin";
 const std::string shapes_file = "shapes.bin";
 
+// Take out tile_extract and tile_url from property tree as tiles must only use the tile_dir
+boost::property_tree::ptree tile_dir_config(const boost::property_tree::ptree& original_config) {
+  auto config = original_config;
+  config.get_child("mjolnir").erase("tile_extract");
+  config.get_child("mjolnir").erase("tile_url");
+  config.get_child("mjolnir").erase("traffic_extract");
+  return config;
+}
+
+// Copy a file, creating the directories it goes in
+void copy_file(const std::string& from, const std::string& to) {
+  filesystem::path target(to);
+  if (!filesystem::exists(target.parent_path())) {
+    filesystem::create_directories(target.parent_path());
+  }
+  std::ifstream in(from, std::ios::binary);
+  std::ofstream out(to, std::ios::binary | std::ios::trunc);
+  out << in.rdbuf();
+  if (!out) {
+    throw std::runtime_error("Could not copy " + from + " to " + to);
+  }
+}
+
+// Copy the local tiles of a tile directory to another one, except for the ones to skip
+void copy_local_tiles(const std::string& from,
+                      const std::string& to,
+                      const std::unordered_set<GraphId>& skip = {}) {
+  boost::property_tree::ptree config;
+  config.put("tile_dir", from);
+  GraphReader reader(config);
+  for (const auto& tile_id : reader.GetTileSet(TileHierarchy::levels().back().level)) {
+    if (!skip.count(tile_id)) {
+      auto suffix = GraphTile::FileSuffix(tile_id);
+      copy_file(from + filesystem::path::preferred_separator + suffix,
+                to + filesystem::path::preferred_separator + suffix);
+    }
+  }
+}
+
 } // namespace
 
 namespace valhalla {
@@ -184,10 +231,7 @@ bool build_tile_set(const boost::property_tree::ptree& original_config,
   };
 
   // Take out tile_extract and tile_url from property tree as tiles must only use the tile_dir
-  auto config = original_config;
-  config.get_child("mjolnir").erase("tile_extract");
-  config.get_child("mjolnir").erase("tile_url");
-  config.get_child("mjolnir").erase("traffic_extract");
+  auto config = tile_dir_config(original_config);
 
   // Get the tile directory (make sure it ends with the preferred separator
   std::string tile_dir = config.get<std::string>("mjolnir.tile_dir");
@@ -195,6 +239,9 @@ bool build_tile_set(const boost::property_tree::ptree& original_config,
     tile_dir.push_back(filesystem::path::preferred_separator);
   }
 
+  // Measure the resources each stage uses
+  BuildProfiler profiler;
+
   // During the initialize stage the tile directory will be purged (if it already exists)
   // and will be created if it does not already exist
   if (start_stage == BuildStage::kInitialize) {
@@ -217,6 +264,7 @@ bool build_tile_set(const boost::property_tree::ptree& original_config,
 
     // Create the directory if it does not exist
     filesystem::create_directories(tile_dir);
+    profiler.EndStage(BuildStage::kInitialize);
   }
 
   // Set up the temporary (*.bin) files used during processing
@@ -233,8 +281,9 @@ bool build_tile_set(const boost::property_tree::ptree& original_config,
   std::string new_to_old_bin = tile_dir + new_to_old_file;
   std::string old_to_new_bin = tile_dir + old_to_new_file;
 
-  // OSMData class
+  // OSMData class, kept within a memory budget from the end of each parse stage on
   OSMData osm_data{0};
+  size_t max_osmdata_memory = config.get<size_t>("mjolnir.max_osmdata_memory", 0);
 
   // Parse the ways
   if (start_stage <= BuildStage::kParseWays && BuildStage::kParseWays <= end_stage) {
@@ -247,10 +296,14 @@ bool build_tile_set(const boost::property_tree::ptree& original_config,
       OSMPBF::Parser::free();
     }
 
+    // Move what the next stages no longer add to out of the heap if it takes more than the budget
+    osm_data.fit_memory(tile_dir, max_osmdata_memory, OSMType::kWay);
+
     // Write the OSMData to files if the end stage is less than enhancing
     if (end_stage <= BuildStage::kEnhance) {
       osm_data.write_to_temp_files(tile_dir);
     }
+    profiler.EndStage(BuildStage::kParseWays);
   }
 
   // Parse OSM data
@@ -266,10 +319,14 @@ bool build_tile_set(const boost::property_tree::ptree& original_config,
       OSMPBF::Parser::free();
     }
 
+    // Move what the next stages no longer add to out of the heap if it takes more than the budget
+    osm_data.fit_memory(tile_dir, max_osmdata_memory, OSMType::kRelation);
+
     // Write the OSMData to files if the end stage is less than enhancing
     if (end_stage <= BuildStage::kEnhance) {
       osm_data.write_to_temp_files(tile_dir);
     }
+    profiler.EndStage(BuildStage::kParseRelations);
   }
 
   // Parse OSM data
@@ -284,31 +341,37 @@ bool build_tile_set(const boost::property_tree::ptree& original_config,
       OSMPBF::Parser::free();
     }
 
+    // Move what the next stages no longer add to out of the heap if it takes more than the budget
+    osm_data.fit_memory(tile_dir, max_osmdata_memory, OSMType::kNode);
+
     // Write the OSMData to files if the end stage is less than enhancing
     if (end_stage <= BuildStage::kEnhance) {
       osm_data.write_to_temp_files(tile_dir);
     }
+    profiler.EndStage(BuildStage::kParseNodes);
   }
 
   // Construct edges
   std::map<baldr::GraphId, size_t> tiles;
   if (start_stage <= BuildStage::kConstructEdges && BuildStage::kConstructEdges <= end_stage) {
 
-    // Read OSMData from files if construct edges is the first stage
+    // Read OSMData from files if construct edges is the first stage, parsing already kept it
+    // within the budget otherwise
     if (start_stage == BuildStage::kConstructEdges)
-      osm_data.read_from_temp_files(tile_dir);
+      osm_data.read_from_temp_files(tile_dir, max_osmdata_memory);
 
     tiles = GraphBuilder::BuildEdges(config, ways_bin, way_nodes_bin, nodes_bin, edges_bin);
     // Output manifest
     TileManifest manifest{tiles};
     manifest.LogToFile(tile_manifest);
+    profiler.EndStage(BuildStage::kConstructEdges);
   }
 
   // Build Valhalla routing tiles
   if (start_stage <= BuildStage::kBuild && BuildStage::kBuild <= end_stage) {
     if (start_stage == BuildStage::kBuild) {
       // Read OSMData from files if building tiles is the first stage
-      osm_data.read_from_temp_files(tile_dir);
+      osm_data.read_from_temp_files(tile_dir, max_osmdata_memory);
       if (filesystem::exists(tile_manifest)) {
         tiles = TileManifest::ReadFromFile(tile_manifest).tileset;
       } else {
@@ -322,6 +385,7 @@ bool build_tile_set(const boost::property_tree::ptree& original_config,
     // Build the graph using the OSMNodes and OSMWays from the parser
     GraphBuilder::Build(config, osm_data, ways_bin, way_nodes_bin, nodes_bin, edges_bin, cr_from_bin,
                         cr_to_bin, pronunciation_bin, tiles);
+    profiler.EndStage(BuildStage::kBuild);
   }
 
   // Enhance the local level of the graph. This adds information to the local
@@ -330,27 +394,43 @@ bool build_tile_set(const boost::property_tree::ptree& original_config,
   if (start_stage <= BuildStage::kEnhance && BuildStage::kEnhance <= end_stage) {
     // Read OSMData names from file if enhancing tiles is the first stage
     if (start_stage == BuildStage::kEnhance) {
-      osm_data.read_from_unique_names_file(tile_dir);
+      osm_data.read_from_unique_names_file(tile_dir, max_osmdata_memory);
     }
     GraphEnhancer::Enhance(config, osm_data, access_bin);
+
+    // Keep a copy of the enhanced local tiles for update_tile_set
+    auto incremental_dir = config.get_optional<std::string>("mjolnir.incremental_dir");
+    if (incremental_dir) {
+      LOG_INFO("Copying the local tiles to " + *incremental_dir);
+      auto local_dir = *incremental_dir + filesystem::path::preferred_separator +
+                       std::to_string(TileHierarchy::levels().back().level);
+      if (filesystem::exists(local_dir)) {
+        filesystem::remove_all(local_dir);
+      }
+      copy_local_tiles(tile_dir, *incremental_dir);
+    }
+    profiler.EndStage(BuildStage::kEnhance);
   }
 
   // Perform optional edge filtering (remove edges and nodes for specific access modes)
   if (start_stage <= BuildStage::kFilter && BuildStage::kFilter <= end_stage) {
     GraphFilter::Filter(config);
+    profiler.EndStage(BuildStage::kFilter);
   }
 
   // Add transit
   if (start_stage <= BuildStage::kTransit && BuildStage::kTransit <= end_stage) {
     TransitBuilder::Build(config);
+    profiler.EndStage(BuildStage::kTransit);
   }
 
   // Build bike share stations
   if (start_stage <= BuildStage::kBss && BuildStage::kBss <= end_stage) {
-    if (start_stage == BuildStage::kBss) {
-      osm_data.read_from_unique_names_file(tile_dir);
+    if (start_stage > BuildStage::kEnhance) {
+      osm_data.read_from_unique_names_file(tile_dir, max_osmdata_memory);
     }
     BssBuilder::Build(config, osm_data, bss_nodes_bin);
+    profiler.EndStage(BuildStage::kBss);
   }
 
   // Builds additional hierarchies if specified within config file. Connections
@@ -359,6 +439,7 @@ bool build_tile_set(const boost::property_tree::ptree& original_config,
   if (build_hierarchy) {
     if (start_stage <= BuildStage::kHierarchy && BuildStage::kHierarchy <= end_stage) {
       HierarchyBuilder::Build(config, new_to_old_bin, old_to_new_bin);
+      profiler.EndStage(BuildStage::kHierarchy);
     }
 
     // Build shortcuts if specified in the config file. Shortcuts can only be
@@ -367,6 +448,7 @@ bool build_tile_set(const boost::property_tree::ptree& original_config,
     if (build_shortcuts) {
       if (start_stage <= BuildStage::kShortcuts && BuildStage::kShortcuts <= end_stage) {
         ShortcutBuilder::Build(config);
+        profiler.EndStage(BuildStage::kShortcuts);
       }
     } else {
       LOG_INFO("Skipping shortcut builder");
@@ -378,6 +460,7 @@ bool build_tile_set(const boost::property_tree::ptree& original_config,
   // Add elevation to the tiles
   if (start_stage <= BuildStage::kElevation && BuildStage::kElevation <= end_stage) {
     ElevationBuilder::Build(config);
+    profiler.EndStage(BuildStage::kElevation);
   }
 
   // Build the Complex Restrictions
@@ -386,11 +469,19 @@ bool build_tile_set(const boost::property_tree::ptree& original_config,
   // within the tile. However, there is no serialization currently available for complex restrictions.
   if (start_stage <= BuildStage::kRestrictions && BuildStage::kRestrictions <= end_stage) {
     RestrictionBuilder::Build(config, cr_from_bin, cr_to_bin);
+    profiler.EndStage(BuildStage::kRestrictions);
   }
 
   // Validate the graph and add information that cannot be added until full graph is formed.
   if (start_stage <= BuildStage::kValidate && BuildStage::kValidate <= end_stage) {
     GraphValidator::Validate(config);
+    profiler.EndStage(BuildStage::kValidate);
+  }
+
+  // Build the optional contraction hierarchy. This needs the final graph so it comes last.
+  if (start_stage <= BuildStage::kContract && BuildStage::kContract <= end_stage) {
+    ContractionBuilder::Build(config);
+    profiler.EndStage(BuildStage::kContract);
   }
 
   // Cleanup bin files
@@ -409,9 +500,77 @@ bool build_tile_set(const boost::property_tree::ptree& original_config,
     remove_temp_file(old_to_new_bin);
     remove_temp_file(tile_manifest);
     OSMData::cleanup_temp_files(tile_dir);
+    profiler.EndStage(BuildStage::kCleanup);
+  }
+
+  // Write what each stage used if asked to
+  if (auto report = config.get_optional<std::string>("mjolnir.build_report")) {
+    profiler.WriteReport(*report);
   }
   return true;
 }
 
+bool update_tile_set(const boost::property_tree::ptree& original_config,
+                     const std::vector<std::string>& input_files,
+                     const std::string& osc_file) {
+  auto config = tile_dir_config(original_config);
+  auto incremental_dir = config.get_optional<std::string>("mjolnir.incremental_dir");
+  if (!incremental_dir || !filesystem::is_directory(*incremental_dir)) {
+    LOG_ERROR("mjolnir.incremental_dir must hold the local tiles of a previous build");
+    return false;
+  }
+  std::string tile_dir = config.get<std::string>("mjolnir.tile_dir");
+  if (tile_dir.back() != filesystem::path::preferred_separator) {
+    tile_dir.push_back(filesystem::path::preferred_separator);
+  }
+
+  try {
+    OSMChange change = OSMChange::Read(osc_file);
+
+    // Parse the new data, the edges and the node ids of all the tiles come from it
+    if (!build_tile_set(original_config, input_files, BuildStage::kInitialize,
+                        BuildStage::kConstructEdges)) {
+      return false;
+    }
+
+    // Reuse the local tiles of the previous build which the change does not touch and only build
+    // the others
+    auto region = change.AffectedTiles(*incremental_dir, tile_dir + ways_file,
+                                       tile_dir + way_nodes_file);
+    copy_local_tiles(*incremental_dir, tile_dir, region);
+    auto manifest = TileManifest::ReadFromFile(tile_dir + tile_manifest_file);
+    for (auto tile = manifest.tileset.begin(); tile != manifest.tileset.end();) {
+      tile = region.count(tile->first) ? std::next(tile) : manifest.tileset.erase(tile);
+    }
+    manifest.LogToFile(tile_dir + tile_manifest_file);
+    LOG_INFO("Rebuilding " + std::to_string(manifest.tileset.size()) + " local tiles");
+    if (!build_tile_set(original_config, input_files, BuildStage::kBuild, BuildStage::kBuild)) {
+      return false;
+    }
+
+    // Enhance the rebuilt tiles and keep them for the next update
+    OSMData osm_data{0};
+    osm_data.read_from_unique_names_file(tile_dir,
+                                         config.get<size_t>("mjolnir.max_osmdata_memory", 0));
+    GraphEnhancer::Enhance(config, osm_data, tile_dir + access_file, region);
+    for (const auto& tile_id : region) {
+      auto suffix = GraphTile::FileSuffix(tile_id);
+      auto kept = *incremental_dir + filesystem::path::preferred_separator + suffix;
+      if (filesystem::exists(kept)) {
+        filesystem::remove(kept);
+      }
+      if (filesystem::exists(tile_dir + suffix)) {
+        copy_file(tile_dir + suffix, kept);
+      }
+    }
+  } catch (const std::exception& e) {
+    LOG_ERROR("Failed to update the tiles with " + osc_file + ": " + e.what());
+    return false;
+  }
+
+  // The other levels span the whole graph so the rest of the pipeline runs over all of it
+  return build_tile_set(original_config, input_files, BuildStage::kFilter, BuildStage::kCleanup);
+}
+
 } // namespace mjolnir
 } // namespace valhalla
@@ -31,6 +31,7 @@ int main(int argc, char** argv) {
   std::vector<std::string> input_files;
   BuildStage start_stage = BuildStage::kInitialize;
   BuildStage end_stage = BuildStage::kCleanup;
+  std::string osc_file;
   boost::property_tree::ptree pt;
 
   try {
@@ -50,6 +51,7 @@ int main(int argc, char** argv) {
       ("i,inline-config", "Inline JSON config", cxxopts::value<std::string>())
       ("s,start", "Starting stage of the build pipeline", cxxopts::value<std::string>()->default_value("initialize"))
       ("e,end", "End stage of the build pipeline", cxxopts::value<std::string>()->default_value("cleanup"))
+      ("osc", "osmChange file from the data of the previous build to the input files. Only rebuilds the local tiles it touches, needs mjolnir.incremental_dir", cxxopts::value<std::string>(osc_file))
       ("input_files", "positional arguments", cxxopts::value<std::vector<std::string>>(input_files));
     // clang-format on
 
@@ -129,6 +131,14 @@ int main(int argc, char** argv) {
     std::cout << "Unable to parse command line options because: " << e.what() << std::endl;
   }
 
+  // Update the tiles of a previous build
+  if (!osc_file.empty()) {
+    if (start_stage != BuildStage::kInitialize || end_stage != BuildStage::kCleanup) {
+      LOG_WARN("Updating with an osmChange always runs every stage, ignoring start and end");
+    }
+    return update_tile_set(pt, input_files, osc_file) ? EXIT_SUCCESS : EXIT_FAILURE;
+  }
+
   // Build some tiles!
   if (build_tile_set(pt, input_files, start_stage, end_stage)) {
     return EXIT_SUCCESS;
@@ -1,5 +1,7 @@
 #include "skadi/sample.h"
 
+#include <algorithm>
+#include <atomic>
 #include <cmath>
 #include <cstddef>
 #include <fstream>
@@ -22,6 +24,14 @@
 #include "midgard/sequence.h"
 #include "valhalla/baldr/curl_tilegetter.h"
 
+#if defined(__AVX__)
+#include <immintrin.h>
+#define VALHALLA_SAMPLE_AVX
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define VALHALLA_SAMPLE_SSE2
+#endif
+
 namespace {
 // srtmgl1 holds 1x1 degree tiles but oversamples the egde of the tile
 // by .5 seconds on all sides. that means that the center of pixel 0 is
@@ -43,6 +53,147 @@ int16_t flip(int16_t value) {
   return ((value & 0xFF) << 8) | ((value >> 8) & 0xFF);
 }
 
+// Bilinear interpolation of one fractional pixel u,v given its integer pixel x,y and the four
+// pixels around it. Pixels out of range do not take part, which is also how a missing second row
+// is left out. The operations are in the same order as in tile_data::get so the results match
+inline double interpolate(double u,
+                          double v,
+                          double x,
+                          double y,
+                          double a,
+                          double b,
+                          double c,
+                          double d) {
+  double u_ratio = u - x;
+  double v_ratio = v - y;
+  double u_inv = 1 - u_ratio;
+  double v_inv = 1 - v_ratio;
+  double a_coef = out_of_range(a) ? 0 : u_inv * v_inv;
+  double b_coef = out_of_range(b) ? 0 : u_ratio * v_inv;
+  double c_coef = out_of_range(c) ? 0 : u_inv * v_ratio;
+  double d_coef = out_of_range(d) ? 0 : u_ratio * v_ratio;
+  double value = a * a_coef + b * b_coef;
+  double adjust = a_coef + b_coef;
+  value += c * c_coef + d * d_coef;
+  adjust += c_coef + d_coef;
+  return adjust == 0 ? NO_DATA_VALUE : value / adjust;
+}
+
+#if defined(VALHALLA_SAMPLE_AVX)
+using lanes_t = __m256d;
+constexpr size_t LANES = 4;
+inline lanes_t load(const double* p) {
+  return _mm256_loadu_pd(p);
+}
+inline void store(double* p, lanes_t a) {
+  _mm256_storeu_pd(p, a);
+}
+inline lanes_t broadcast(double a) {
+  return _mm256_set1_pd(a);
+}
+inline lanes_t add(lanes_t a, lanes_t b) {
+  return _mm256_add_pd(a, b);
+}
+inline lanes_t sub(lanes_t a, lanes_t b) {
+  return _mm256_sub_pd(a, b);
+}
+inline lanes_t mul(lanes_t a, lanes_t b) {
+  return _mm256_mul_pd(a, b);
+}
+inline lanes_t div(lanes_t a, lanes_t b) {
+  return _mm256_div_pd(a, b);
+}
+inline lanes_t in_range(lanes_t a) {
+  return _mm256_and_pd(_mm256_cmp_pd(a, broadcast(NO_DATA_HIGH), _CMP_LE_OQ),
+                       _mm256_cmp_pd(a, broadcast(NO_DATA_LOW), _CMP_GE_OQ));
+}
+inline lanes_t equal(lanes_t a, lanes_t b) {
+  return _mm256_cmp_pd(a, b, _CMP_EQ_OQ);
+}
+inline lanes_t mask(lanes_t a, lanes_t keep) {
+  return _mm256_and_pd(a, keep);
+}
+inline lanes_t select(lanes_t a, lanes_t b, lanes_t pick_b) {
+  return _mm256_blendv_pd(a, b, pick_b);
+}
+#elif defined(VALHALLA_SAMPLE_SSE2)
+using lanes_t = __m128d;
+constexpr size_t LANES = 2;
+inline lanes_t load(const double* p) {
+  return _mm_loadu_pd(p);
+}
+inline void store(double* p, lanes_t a) {
+  _mm_storeu_pd(p, a);
+}
+inline lanes_t broadcast(double a) {
+  return _mm_set1_pd(a);
+}
+inline lanes_t add(lanes_t a, lanes_t b) {
+  return _mm_add_pd(a, b);
+}
+inline lanes_t sub(lanes_t a, lanes_t b) {
+  return _mm_sub_pd(a, b);
+}
+inline lanes_t mul(lanes_t a, lanes_t b) {
+  return _mm_mul_pd(a, b);
+}
+inline lanes_t div(lanes_t a, lanes_t b) {
+  return _mm_div_pd(a, b);
+}
+inline lanes_t in_range(lanes_t a) {
+  return _mm_and_pd(_mm_cmple_pd(a, broadcast(NO_DATA_HIGH)),
+                    _mm_cmpge_pd(a, broadcast(NO_DATA_LOW)));
+}
+inline lanes_t equal(lanes_t a, lanes_t b) {
+  return _mm_cmpeq_pd(a, b);
+}
+inline lanes_t mask(lanes_t a, lanes_t keep) {
+  return _mm_and_pd(a, keep);
+}
+// SSE2 has no blend
+inline lanes_t select(lanes_t a, lanes_t b, lanes_t pick_b) {
+  return _mm_or_pd(_mm_and_pd(pick_b, b), _mm_andnot_pd(pick_b, a));
+}
+#endif
+
+// Interpolates count fractional pixels at once, the same as calling interpolate on each of them
+void interpolate(const double* u,
+                 const double* v,
+                 const double* x,
+                 const double* y,
+                 const double* a,
+                 const double* b,
+                 const double* c,
+                 const double* d,
+                 size_t count,
+                 double* values) {
+  size_t i = 0;
+#if defined(VALHALLA_SAMPLE_AVX) || defined(VALHALLA_SAMPLE_SSE2)
+  const lanes_t zero = broadcast(0);
+  const lanes_t one = broadcast(1);
+  const lanes_t no_data = broadcast(NO_DATA_VALUE);
+  for (; i + LANES <= count; i += LANES) {
+    lanes_t u_ratio = sub(load(u + i), load(x + i));
+    lanes_t v_ratio = sub(load(v + i), load(y + i));
+    lanes_t u_inv = sub(one, u_ratio);
+    lanes_t v_inv = sub(one, v_ratio);
+    lanes_t av = load(a + i), bv = load(b + i), cv = load(c + i), dv = load(d + i);
+    lanes_t a_coef = mask(mul(u_inv, v_inv), in_range(av));
+    lanes_t b_coef = mask(mul(u_ratio, v_inv), in_range(bv));
+    lanes_t c_coef = mask(mul(u_inv, v_ratio), in_range(cv));
+    lanes_t d_coef = mask(mul(u_ratio, v_ratio), in_range(dv));
+    lanes_t value = add(mul(av, a_coef), mul(bv, b_coef));
+    lanes_t adjust = add(a_coef, b_coef);
+    value = add(value, add(mul(cv, c_coef), mul(dv, d_coef)));
+    adjust = add(adjust, add(c_coef, d_coef));
+    store(values + i, select(div(value, adjust), no_data, equal(adjust, zero)));
+  }
+#endif
+  for (; i < count; ++i) {
+    values[i] = interpolate(u[i], v[i], x[i], y[i], a[i], b[i], c[i], d[i]);
+  }
+}
+
 uint64_t file_size(const std::string& file_name) {
   // TODO: detect gzip and actually validate the uncompressed size?
   struct stat s {};
@@ -61,15 +212,19 @@ class cache_item_t {
 private:
   format_t format;
   valhalla::midgard::mem_map<char> data;
-  int usages;
-  const char* unpacked;
 
 public:
-  cache_item_t() : format(format_t::UNKNOWN), usages(0), unpacked(nullptr) {
+  // the tile ready to sample, either the mapped raw data or the inflated compressed data. it is
+  // read without holding any lock and whoever samples it keeps it alive even if it gets evicted
+  std::shared_ptr<const int16_t> tile;
+  // when the tile was last sampled, to evict the least recently used inflated tiles
+  std::atomic<uint64_t> last_used;
+
+  cache_item_t() : format(format_t::UNKNOWN), last_used(0) {
   }
-  cache_item_t(cache_item_t&&) = default;
-  ~cache_item_t() {
-    free((void*)unpacked);
+  cache_item_t(cache_item_t&& other)
+      : format(other.format), data(std::move(other.data)), tile(std::move(other.tile)),
+        last_used(other.last_used.load()) {
   }
 
   bool init(const std::string& path, format_t format) {
@@ -90,23 +245,13 @@ public:
     return format;
   }
 
-  inline int& get_usages() {
-    return usages;
-  }
-
-  inline const char* get_unpacked() {
-    return unpacked;
+  // the compressed data turned out to be corrupt
+  inline void invalidate() {
+    format = format_t::UNKNOWN;
   }
 
-  inline const char* detach_unpacked() {
-    auto rv = unpacked;
-    unpacked = nullptr;
-    return rv;
-  }
-
-  bool unpack(const char* unpacked) {
-    this->unpacked = unpacked;
-
+  // inflates the compressed data into a buffer of HGT_BYTES
+  bool unpack(char* unpacked) const {
     if (format == format_t::GZIP) {
       // for setting where to read compressed data from
       auto src_func = [this](z_stream& s) -> void {
@@ -115,8 +260,8 @@ public:
       };
 
       // for setting where to write the uncompressed data to
-      auto dst_func = [this](z_stream& s) -> int {
-        s.next_out = (Byte*)(this->unpacked);
+      auto dst_func = [unpacked](z_stream& s) -> int {
+        s.next_out = (Byte*)(unpacked);
         s.avail_out = HGT_BYTES;
         return Z_FINISH; // we know the output will hold all the input
       };
@@ -124,7 +269,6 @@ public:
       // we have to unzip it
       if (!baldr::inflate(src_func, dst_func)) {
         LOG_WARN("Corrupt gzip elevation data");
-        format = format_t::UNKNOWN;
         return false;
       }
     } else if (format == format_t::LZ4) {
@@ -138,12 +282,10 @@ public:
       size_t result;
 
       do {
-        result = LZ4F_decompress(decode, const_cast<char*>(this->unpacked), &dest_size, data.get(),
-                                 &src_size, &options);
+        result = LZ4F_decompress(decode, unpacked, &dest_size, data.get(), &src_size, &options);
         if (LZ4F_isError(result)) {
           LZ4F_freeDecompressionContext(decode);
           LOG_WARN("Corrupt lz4 elevation data");
-          format = format_t::UNKNOWN;
           return false;
         }
       } while (result != 0);
@@ -151,7 +293,6 @@ public:
       LZ4F_freeDecompressionContext(decode);
     } else {
       LOG_WARN("Corrupt elevation data of unknown type");
-      format = format_t::UNKNOWN;
       return false;
     }
 
@@ -189,30 +330,15 @@ public:
 // tile_data object holds unpacked elevation tile data
 class tile_data {
 private:
-  cache_t* c;
-  const int16_t* data;
+  std::shared_ptr<const int16_t> data;
   uint16_t index;
-  bool reusable;
 
 public:
-  tile_data() : c(nullptr), index(TILE_COUNT), reusable(false), data(nullptr) {
-  }
-
-  tile_data(const tile_data& other) : c(nullptr) {
-    *this = other;
+  tile_data() : index(TILE_COUNT) {
   }
 
-  tile_data(cache_t* c, uint16_t index, bool reusable, const int16_t* data);
-  ~tile_data();
-  tile_data& operator=(const tile_data& other);
-
-  tile_data& operator=(tile_data&& other) {
-    std::swap(c, other.c);
-    std::swap(data, other.data);
-    std::swap(index, other.index);
-    std::swap(reusable, other.reusable);
-
-    return *this;
+  tile_data(uint16_t index, std::shared_ptr<const int16_t> data)
+      : data(std::move(data)), index(index) {
   }
 
   inline explicit operator bool() const {
@@ -224,6 +350,8 @@ public:
   }
 
   double get(double u, double v) const {
+    const int16_t* pixels = data.get();
+
     // integer pixel
     size_t x = std::floor(u);
     size_t y = std::floor(v);
@@ -240,8 +368,8 @@ public:
 
     // values
     double adjust = 0;
-    auto a = flip(data[y * HGT_DIM + x]);
-    auto b = flip(data[y * HGT_DIM + x + 1]);
+    auto a = flip(pixels[y * HGT_DIM + x]);
+    auto b = flip(pixels[y * HGT_DIM + x + 1]);
     if (out_of_range(a)) {
       a_coef = 0;
     }
@@ -257,8 +385,8 @@ public:
     // only need the second part if you aren't right on the row
     // this also protects from a corner case where you sample past the end of the image
     if (y < HGT_DIM - 1) {
-      auto c = flip(data[(y + 1) * HGT_DIM + x]);
-      auto d = flip(data[(y + 1) * HGT_DIM + x + 1]);
+      auto c = flip(pixels[(y + 1) * HGT_DIM + x]);
+      auto d = flip(pixels[(y + 1) * HGT_DIM + x + 1]);
       if (out_of_range(c)) {
         c_coef = 0;
       }
@@ -277,30 +405,65 @@ public:
     // if we were missing some we need to adjust by that
     return value / adjust;
   }
+
+  // Interpolates count fractional pixels at once, each the same as get(u, v) would
+  void get_all(const double* us, const double* vs, size_t count, double* values) const {
+    const int16_t* pixels = data.get();
+
+    // gather the pixels a block at a time, then interpolate the whole block in lanes
+    constexpr size_t BLOCK = 64;
+    double xs[BLOCK], ys[BLOCK], as[BLOCK], bs[BLOCK], cs[BLOCK], ds[BLOCK];
+    for (size_t start = 0; start < count; start += BLOCK) {
+      size_t block = std::min(BLOCK, count - start);
+      for (size_t i = 0; i < block; ++i) {
+        size_t x = std::floor(us[start + i]);
+        size_t y = std::floor(vs[start + i]);
+        xs[i] = x;
+        ys[i] = y;
+        as[i] = flip(pixels[y * HGT_DIM + x]);
+        bs[i] = flip(pixels[y * HGT_DIM + x + 1]);
+        // there is no second row past the end of the image, no data leaves it out
+        if (y < HGT_DIM - 1) {
+          cs[i] = flip(pixels[(y + 1) * HGT_DIM + x]);
+          ds[i] = flip(pixels[(y + 1) * HGT_DIM + x + 1]);
+        } else {
+          cs[i] = ds[i] = NO_DATA_VALUE;
+        }
+      }
+      interpolate(us + start, vs + start, xs, ys, as, bs, cs, ds, block, values + start);
+    }
+  }
+};
+
+// A view of some bytes to save them with filesystem::save
+struct bytes_t {
+  const char* bytes;
+  size_t count;
+  const char* data() const {
+    return bytes;
+  }
+  size_t size() const {
+    return count;
+  }
 };
 
 struct cache_t {
   // Cached tiles
   std::vector<cache_item_t> cache;
-  // Set of reusable tile indexes
-  std::unordered_set<uint16_t> reusable;
+  // Indexes of the tiles inflated into memory, at most max_unpacked of them
+  std::unordered_set<uint16_t> unpacked;
+  size_t max_unpacked = UNPACKED_TILES_COUNT;
+  // Ticks on every sample of a tile to know which was used least recently
+  std::atomic<uint64_t> clock{0};
   // Map of pending tiles. No matter how many requests received, only one inflate job per tile
   // started.
   std::unordered_map<uint16_t, std::shared_future<tile_data>> pending_tiles;
-  // Guards access to the pending_tiles
-  std::recursive_mutex mutex;
+  // Guards everything but the tiles ready to sample
+  std::mutex mutex;
   // Elevation tile path
   std::string data_source;
-
-  void increment_usages(uint16_t index) {
-    std::lock_guard<std::recursive_mutex> lock(mutex);
-    cache[index].get_usages()++;
-  }
-
-  void decrement_usages(uint16_t index) {
-    std::lock_guard<std::recursive_mutex> lock(mutex);
-    cache[index].get_usages()--;
-  }
+  // Where inflated tiles are kept as raw tiles to map them instead of inflating them again
+  std::string cache_dir;
 
   // no need for synchronization as size is constant(set in constructor
   // and never change after thatn)
@@ -311,24 +474,63 @@ struct cache_t {
   bool insert(int pos, const std::string& path, format_t format);
 
   tile_data source(uint16_t index);
+
+  tile_data ready(uint16_t index, std::shared_ptr<const int16_t> tile) {
+    cache[index].last_used.store(++clock, std::memory_order_relaxed);
+    return {index, std::move(tile)};
+  }
+
+  // drops the least recently used inflated tiles until there is room for one more, whoever is
+  // still sampling one of them keeps it until done
+  void make_room() {
+    while (!unpacked.empty() && unpacked.size() >= max_unpacked) {
+      auto lru = *std::min_element(unpacked.begin(), unpacked.end(), [this](uint16_t a, uint16_t b) {
+        return cache[a].last_used.load(std::memory_order_relaxed) <
+               cache[b].last_used.load(std::memory_order_relaxed);
+      });
+      std::atomic_store(&cache[lru].tile, std::shared_ptr<const int16_t>());
+      unpacked.erase(lru);
+    }
+  }
+
+  // keeps a raw copy of an inflated tile in the cache directory
+  bool save(uint16_t index, const int16_t* tile) const {
+    return filesystem::save(cache_dir + get_hgt_file_name(index),
+                            bytes_t{reinterpret_cast<const char*>(tile), HGT_BYTES});
+  }
 };
 
 bool cache_t::insert(int pos, const std::string& path, format_t format) {
   if (pos >= cache.size())
     return false;
 
-  std::lock_guard<std::recursive_mutex> lock(mutex);
+  std::lock_guard<std::mutex> lock(mutex);
   return cache[pos].init(path, format);
 }
 
 tile_data cache_t::source(uint16_t index) {
   // bail if it's out of bounds
-  if (index >= TILE_COUNT) {
+  if (index >= cache.size()) {
     return {};
   }
 
-  // if we don't have anything maybe it's lazy loaded
+  // the tile is ready to sample, this is the hot path and it doesn't take the cache mutex. the
+  // atomic shared_ptr load isn't lock free with libstdc++ but only hashes into its own small pool
+  // of mutexes for the duration of a reference count increment
   auto& item = cache[index];
+  auto tile = std::atomic_load(&item.tile);
+  if (tile) {
+    return ready(index, std::move(tile));
+  }
+
+  std::unique_lock<std::mutex> lock(mutex);
+  // someone else may have made it ready in the meantime
+  tile = std::atomic_load(&item.tile);
+  if (tile) {
+    return ready(index, std::move(tile));
+  }
+
+  // if we don't have anything maybe it's lazy loaded
   if (item.get_data() == nullptr) {
     auto f = data_source + get_hgt_file_name(index);
     item.init(f, format_t::RAW);
@@ -339,83 +541,48 @@ tile_data cache_t::source(uint16_t index) {
     return {};
   }
 
-  // we have it raw or we don't
+  // we have it raw, the mapping lives as long as the cache does
   if (item.get_format() == format_t::RAW) {
-    return {this, index, false, (const int16_t*)item.get_data()};
+    tile.reset(reinterpret_cast<const int16_t*>(item.get_data()), [](const int16_t*) {});
+    std::atomic_store(&item.tile, tile);
+    return ready(index, std::move(tile));
   }
 
   // we were able to load it but the format wasn't RAW, which only leaves compressed formats
-  mutex.lock();
   auto it = pending_tiles.find(index);
   if (it != pending_tiles.end()) {
     auto future = it->second;
-    mutex.unlock();
+    lock.unlock();
     return future.get();
   }
 
-  // item in cache is already unpacked
-  const char* unpacked = item.get_unpacked();
-  if (unpacked) {
-    auto rv = tile_data(this, index, true, (const int16_t*)unpacked);
-    mutex.unlock();
-    return rv;
-  }
-
   std::promise<tile_data> promise;
   it = pending_tiles.emplace(index, promise.get_future()).first;
-
-  if (reusable.size() >= UNPACKED_TILES_COUNT) {
-    for (auto i : reusable) {
-      if (cache[i].get_usages() <= 0) {
-        reusable.erase(i);
-        unpacked = cache[i].detach_unpacked();
-        break;
-      }
-    }
-  }
-  if (!unpacked) {
-    unpacked = (char*)malloc(HGT_BYTES);
+  lock.unlock();
+
+  // inflate it without holding the lock, keeping a raw copy to map next time if so configured
+  std::shared_ptr<int16_t> unpacked_tile(new int16_t[HGT_PIXELS], std::default_delete<int16_t[]>());
+  bool unpacked_ok = item.unpack(reinterpret_cast<char*>(unpacked_tile.get()));
+  if (unpacked_ok && !cache_dir.empty() && !save(index, unpacked_tile.get())) {
+    LOG_WARN("Could not keep unpacked elevation data in " + cache_dir);
+  }
+
+  lock.lock();
+  tile_data rv;
+  if (unpacked_ok) {
+    make_room();
+    tile = unpacked_tile;
+    std::atomic_store(&item.tile, tile);
+    unpacked.insert(index);
+    rv = ready(index, std::move(tile));
+  } else {
+    item.invalidate();
   }
-  reusable.insert(index);
-  auto rv = tile_data(this, index, true, (const int16_t*)unpacked);
-  mutex.unlock();
-
-  if (!item.unpack(unpacked)) {
-    rv = tile_data();
-  }
-
-  mutex.lock();
   promise.set_value(rv);
   pending_tiles.erase(it);
-  mutex.unlock();
   return rv;
 }
 
-tile_data::tile_data(cache_t* c, uint16_t index, bool reusable, const int16_t* data)
-    : c(c), data(data), index(index), reusable(reusable) {
-  if (reusable)
-    c->increment_usages(index);
-}
-
-tile_data::~tile_data() {
-  if (reusable)
-    c->decrement_usages(index);
-}
-
-tile_data& tile_data::operator=(const tile_data& other) {
-  if (c && reusable)
-    c->decrement_usages(index);
-
-  c = other.c;
-  data = other.data;
-  index = other.index;
-  reusable = other.reusable;
-
-  if (c && reusable)
-    c->increment_usages(index);
-  return *this;
-}
-
 sample::sample(const boost::property_tree::ptree& pt)
     : sample(pt.get<std::string>("additional_data.elevation", "")) {
   url_ = pt.get<std::string>("additional_data.elevation_url", "");
@@ -428,6 +595,36 @@ sample::sample(const boost::property_tree::ptree& pt)
 
   // this line used only for testing, for more details check elevation_builder.cc
   remote_path_ = pt.get<std::string>("additional_data.elevation_dir", "");
+
+  // how many inflated tiles fit in the memory budget, at least one
+  if (auto cache_mb = pt.get_optional<size_t>("additional_data.elevation_cache_mb")) {
+    cache_->max_unpacked = std::max<size_t>(*cache_mb * 1024 * 1024 / HGT_BYTES, 1);
+  }
+
+  // map the raw copies of compressed tiles we inflated before instead of inflating them again
+  cache_->cache_dir = pt.get<std::string>("additional_data.elevation_cache_dir", "");
+  while (cache_->cache_dir.size() &&
+         cache_->cache_dir.back() == filesystem::path::preferred_separator) {
+    cache_->cache_dir.pop_back();
+  }
+  if (!cache_->cache_dir.empty() && cache_->size()) {
+    for (const auto& f : filesystem::get_files(cache_->cache_dir)) {
+      auto data = cache_item_t::parse_hgt_name(f);
+      if (data && data->second == format_t::RAW) {
+        auto format = cache_->cache[data->first].get_format();
+        if ((format == format_t::GZIP || format == format_t::LZ4) &&
+            !cache_->insert(data->first, f, format_t::RAW)) {
+          LOG_WARN("Corrupt unpacked elevation data: " + f);
+        }
+      }
+    }
+  }
+
+  // inflate the rest of them now rather than on the first samples that need them
+  if (pt.get<bool>("additional_data.elevation_cache_unpack", false)) {
+    auto count = unpack_to_cache();
+    LOG_INFO("Unpacked " + std::to_string(count) + " elevation tiles into " + cache_->cache_dir);
+  }
 }
 
 sample::sample(const std::string& data_source) {
@@ -439,6 +636,14 @@ sample::sample(const std::string& data_source) {
 sample::~sample() {
 }
 
+tile_data sample::source(uint16_t index) {
+  auto tile = cache_->source(index);
+  if (!tile && fetch(index)) {
+    tile = cache_->source(index);
+  }
+  return tile;
+}
+
 template <class coord_t> double sample::get(const coord_t& coord, tile_data& tile) {
   // check the cache and load
   auto lon = std::floor(coord.first);
@@ -447,17 +652,8 @@ template <class coord_t> double sample::get(const coord_t& coord, tile_data& til
 
   // the caller can pass a cached tile, so we only fetch one if its not the one they already have
   if (index != tile.get_index()) {
-    {
-      std::lock_guard<std::mutex> _(cache_lck);
-      tile = cache_->source(index);
-    }
-    if (!tile) {
-      if (!fetch(index))
-        return get_no_data_value();
-
-      if (!(tile = cache_->source(index)))
-        return get_no_data_value();
-    }
+    if (!(tile = source(index)))
+      return get_no_data_value();
   }
 
   // figure out what row and column we need from the array of data
@@ -476,12 +672,50 @@ template <class coord_t> double sample::get(const coord_t& coord) {
 }
 
 template <class coords_t> std::vector<double> sample::get_all(const coords_t& coords) {
-  std::vector<double> values;
-  values.reserve(coords.size());
-
-  tile_data tile;
+  // the fractional pixel of every posting and the tile it is in
+  std::vector<double> us, vs;
+  us.reserve(coords.size());
+  vs.reserve(coords.size());
+  std::vector<std::pair<uint16_t, uint32_t>> postings;
+  postings.reserve(coords.size());
+  bool sorted = true;
   for (const auto& coord : coords) {
-    values.emplace_back(get(coord, tile));
+    auto lon = std::floor(coord.first);
+    auto lat = std::floor(coord.second);
+    uint16_t index = static_cast<uint16_t>(lat + 90) * 360 + static_cast<uint16_t>(lon + 180);
+    sorted = sorted && (postings.empty() || postings.back().first <= index);
+    postings.emplace_back(index, static_cast<uint32_t>(postings.size()));
+    us.push_back((coord.first - lon) * (HGT_DIM - 1));
+    vs.push_back((1.0 - (coord.second - lat)) * (HGT_DIM - 1));
+  }
+
+  // group the postings by tile so each tile is sourced once and all of its postings are
+  // interpolated together. polylines usually stay in a tile so most of the time this is a no-op
+  if (!sorted) {
+    std::sort(postings.begin(), postings.end());
+  }
+
+  std::vector<double> values(postings.size(), get_no_data_value());
+  std::vector<double> tile_us, tile_vs, tile_values;
+  for (auto begin = postings.cbegin(); begin != postings.cend();) {
+    auto end = std::find_if(begin, postings.cend(), [begin](const std::pair<uint16_t, uint32_t>& p) {
+      return p.first != begin->first;
+    });
+    auto tile = source(begin->first);
+    if (tile) {
+      tile_us.clear();
+      tile_vs.clear();
+      for (auto posting = begin; posting != end; ++posting) {
+        tile_us.push_back(us[posting->second]);
+        tile_vs.push_back(vs[posting->second]);
+      }
+      tile_values.resize(tile_us.size());
+      tile.get_all(tile_us.data(), tile_vs.data(), tile_us.size(), tile_values.data());
+      for (auto posting = begin; posting != end; ++posting) {
+        values[posting->second] = tile_values[posting - begin];
+      }
+    }
+    begin = end;
   }
 
   return values;
@@ -541,6 +775,36 @@ template <class coord_t> uint16_t sample::get_tile_index(const coord_t& coord) {
   return static_cast<uint16_t>(lat + 90) * 360 + static_cast<uint16_t>(lon + 180);
 }
 
+size_t sample::unpack_to_cache() {
+  if (cache_->cache_dir.empty()) {
+    return 0;
+  }
+
+  // one tile at a time into the same buffer, the tiles already there are left alone
+  std::vector<int16_t> unpacked(HGT_PIXELS);
+  size_t count = 0;
+  for (size_t index = 0; index < cache_->size(); ++index) {
+    format_t format;
+    {
+      std::lock_guard<std::mutex> lock(cache_->mutex);
+      format = cache_->cache[index].get_format();
+    }
+    if ((format != format_t::GZIP && format != format_t::LZ4) ||
+        filesystem::exists(cache_->cache_dir + get_hgt_file_name(index))) {
+      continue;
+    }
+    if (!cache_->cache[index].unpack(reinterpret_cast<char*>(unpacked.data()))) {
+      continue;
+    }
+    if (!cache_->save(index, unpacked.data())) {
+      LOG_WARN("Could not keep unpacked elevation data in " + cache_->cache_dir);
+      continue;
+    }
+    ++count;
+  }
+  return count;
+}
+
 void sample::add_single_tile(const std::string& path) {
   std::lock_guard<std::mutex> _(cache_lck);
   cache_->insert(0, path, format_t::RAW);
@@ -63,6 +63,10 @@ BidirectionalAStar::BidirectionalAStar(const boost::property_tree::ptree& config
   pruning_disabled_at_origin_ = false;
   pruning_disabled_at_destination_ = false;
   ignore_hierarchy_limits_ = false;
+  const auto queue_type =
+      baldr::to_queue_type(config.get<std::string>("queue_type", "double_bucket"));
+  adjacencylist_forward_.set_type(queue_type);
+  adjacencylist_reverse_.set_type(queue_type);
 }
 
 // Destructor
@@ -96,6 +100,8 @@ void BidirectionalAStar::Clear() {
   pruning_disabled_at_origin_ = false;
   pruning_disabled_at_destination_ = false;
   ignore_hierarchy_limits_ = false;
+  prefetched_tile_forward_ = {};
+  prefetched_tile_reverse_ = {};
 }
 
 // Initialize the A* heuristic and adjacency lists for both the forward
@@ -384,6 +390,16 @@ bool BidirectionalAStar::Expand(baldr::GraphReader& graphreader,
   }
   const NodeInfo* nodeinfo = tile->node(node);
 
+  // Once the frontier enters another tile have the reader read ahead the tiles towards the
+  // destination (origin in reverse) so we don't block on them one at a time
+  auto& prefetched_tile = FORWARD ? prefetched_tile_forward_ : prefetched_tile_reverse_;
+  if (graphreader.PrefetchEnabled() && node.Tile_Base() != prefetched_tile) {
+    prefetched_tile = node.Tile_Base();
+    const auto& heuristic = FORWARD ? astarheuristic_forward_ : astarheuristic_reverse_;
+    graphreader.Prefetch(nodeinfo->latlng(tile->header()->base_ll()), heuristic.target(),
+                         node.level());
+  }
+
   // Keep track of superseded edges
   uint32_t shortcuts = 0;
 
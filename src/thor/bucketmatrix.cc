@@ -0,0 +1,281 @@
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <tuple>
+#include <unordered_map>
+
+#include "midgard/logging.h"
+#include "thor/bucketmatrix.h"
+#include "thor/contraction_query.h"
+
+using namespace valhalla::baldr;
+using namespace valhalla::sif;
+
+namespace {
+
+// Labels to reserve for a search, upward searches of a hierarchy settle few nodes
+constexpr size_t kInitialLabelCount = 4096;
+
+bool equals(const valhalla::LatLng& a, const valhalla::LatLng& b) {
+  return a.has_lat_case() == b.has_lat_case() && a.has_lng_case() == b.has_lng_case() &&
+         (!a.has_lat_case() || a.lat() == b.lat()) && (!a.has_lng_case() || a.lng() == b.lng());
+}
+
+} // namespace
+
+namespace valhalla {
+namespace thor {
+
+BucketMatrix::BucketMatrix(const boost::property_tree::ptree& /*config*/)
+    : current_cost_threshold_(0) {
+}
+
+BucketMatrix::~BucketMatrix() {
+}
+
+void BucketMatrix::clear() {
+  buckets_.clear();
+  buckets_.shrink_to_fit();
+  target_seeds_.clear();
+  labels_.clear();
+  queue_ = decltype(queue_)();
+  costing_.reset();
+}
+
+std::vector<BucketMatrix::seed_t>
+BucketMatrix::Seed(GraphReader& graphreader, const valhalla::Location& location, const bool forward) {
+  // sources leave their edges at the end node, targets enter them at the begin node. edges where
+  // the location is right at that node are only used when there is nothing else
+  const auto& edges = location.correlation().edges();
+  bool has_other_edges = std::any_of(edges.begin(), edges.end(), [forward](const auto& e) {
+    return forward ? !e.end_node() : !e.begin_node();
+  });
+
+  std::vector<seed_t> seeds;
+  for (const auto& edge : edges) {
+    if (has_other_edges && (forward ? edge.end_node() : edge.begin_node())) {
+      continue;
+    }
+
+    GraphId edgeid(edge.graph_id());
+    graph_tile_ptr tile = graphreader.GetGraphTile(edgeid);
+    if (tile == nullptr) {
+      continue;
+    }
+    const DirectedEdge* directededge = tile->directededge(edgeid);
+    GraphId node = forward ? directededge->endnode() : graphreader.edge_startnode(edgeid, tile);
+    uint32_t index = node.Is_Valid() ? hierarchy_->node(node) : kInvalidContractionIndex;
+    if (index == kInvalidContractionIndex) {
+      continue;
+    }
+
+    float percent_along = edge.percent_along();
+    float percent = forward ? 1.0f - percent_along : percent_along;
+    float cost = costing_->EdgeCost(directededge, tile).cost * percent;
+    seeds.push_back({index,
+                     edgeid,
+                     percent_along,
+                     {cost, kInvalidContractionIndex, static_cast<uint32_t>(seeds.size())}});
+  }
+  return seeds;
+}
+
+template <typename settled_t>
+void BucketMatrix::Search(const std::vector<seed_t>& seeds,
+                          const bool forward,
+                          const settled_t& settled) {
+  labels_.clear();
+  queue_ = decltype(queue_)();
+  for (const auto& seed : seeds) {
+    auto inserted = labels_.emplace(seed.node, seed.label);
+    if (!inserted.second) {
+      if (seed.label.cost >= inserted.first->second.cost) {
+        continue;
+      }
+      inserted.first->second = seed.label;
+    }
+    queue_.emplace(seed.label.cost, seed.node);
+  }
+
+  while (!queue_.empty()) {
+    float cost;
+    uint32_t index;
+    std::tie(cost, index) = queue_.top();
+    queue_.pop();
+
+    // skip stale queue entries, stop once we are beyond the threshold
+    const auto label = labels_.find(index)->second;
+    if (cost > label.cost) {
+      continue;
+    }
+    if (cost > current_cost_threshold_) {
+      break;
+    }
+    settled(index, label);
+
+    // relax the arcs towards higher ranked nodes
+    auto arcs = forward ? hierarchy_->forward_arcs(index) : hierarchy_->reverse_arcs(index);
+    for (const auto* a = arcs.first; a != arcs.second; ++a) {
+      const auto& arc = hierarchy_->arc(*a);
+      label_t next{label.cost + arc.cost, *a, label.seed};
+      auto inserted = labels_.emplace(forward ? arc.head : arc.tail, next);
+      if (!inserted.second) {
+        if (next.cost >= inserted.first->second.cost) {
+          continue;
+        }
+        inserted.first->second = next;
+      }
+      queue_.emplace(next.cost, inserted.first->first);
+    }
+  }
+}
+
+std::vector<TimeDistance> BucketMatrix::SourceToTarget(
+    const google::protobuf::RepeatedPtrField<valhalla::Location>& source_location_list,
+    const google::protobuf::RepeatedPtrField<valhalla::Location>& target_location_list,
+    GraphReader& graphreader,
+    const sif::mode_costing_t& mode_costing,
+    const travel_mode_t mode,
+    const float max_matrix_distance) {
+  const size_t target_count = target_location_list.size();
+  std::vector<TimeDistance> td(source_location_list.size() * target_count,
+                               TimeDistance(kMaxCost, kMaxCost));
+  if (!hierarchy_) {
+    LOG_ERROR("BucketMatrix has no contraction hierarchy to search");
+    return td;
+  }
+
+  costing_ = mode_costing[static_cast<uint32_t>(mode)];
+  current_cost_threshold_ = max_matrix_distance / kCostThresholdAutoDivisor * 2.0f;
+  labels_.reserve(kInitialLabelCount);
+
+  // the backward search of every target leaves its buckets on the nodes it settles. remember
+  // which edges the targets are on, the hierarchy can't see a path along a single edge
+  std::unordered_map<uint64_t, std::vector<std::pair<uint32_t, double>>> target_edges;
+  for (uint32_t target = 0; target < target_count; ++target) {
+    const auto& location = target_location_list.Get(target);
+    for (const auto& edge : location.correlation().edges()) {
+      target_edges[edge.graph_id()].emplace_back(target, edge.percent_along());
+    }
+    target_seeds_.push_back(Seed(graphreader, location, false));
+    Search(target_seeds_.back(), false, [this, target](uint32_t node, const label_t& label) {
+      buckets_.push_back({node, target, label});
+    });
+  }
+  std::sort(buckets_.begin(), buckets_.end());
+
+  // the forward search of every source scans the buckets of the nodes it settles
+  std::vector<connection_t> row(target_count);
+  uint32_t source = 0;
+  for (const auto& location : source_location_list) {
+    std::fill(row.begin(), row.end(),
+              connection_t{kMaxCost, kInvalidContractionIndex, {}, 0.f, 0.f});
+    auto seeds = Seed(graphreader, location, true);
+    Search(seeds, true, [this, &row](uint32_t node, const label_t& label) {
+      auto range = std::equal_range(buckets_.begin(), buckets_.end(), bucket_t{node, 0, {}},
+                                    [](const bucket_t& a, const bucket_t& b) {
+                                      return a.node < b.node;
+                                    });
+      for (auto bucket = range.first; bucket != range.second; ++bucket) {
+        auto& connection = row[bucket->target];
+        if (label.cost + bucket->label.cost < connection.cost) {
+          connection = {label.cost + bucket->label.cost, node, {}, 0.f, 0.f};
+        }
+      }
+    });
+
+    // paths along a single edge
+    for (const auto& edge : location.correlation().edges()) {
+      auto found = target_edges.find(edge.graph_id());
+      if (found == target_edges.end()) {
+        continue;
+      }
+      graph_tile_ptr tile;
+      const DirectedEdge* directededge = graphreader.directededge(GraphId(edge.graph_id()), tile);
+      if (directededge == nullptr) {
+        continue;
+      }
+      auto cost = costing_->EdgeCost(directededge, tile);
+      for (const auto& target : found->second) {
+        float percent = target.second - edge.percent_along();
+        if (percent >= 0.f && cost.cost * percent < row[target.first].cost) {
+          row[target.first] = {cost.cost * percent, kInvalidContractionIndex,
+                               GraphId(edge.graph_id()), static_cast<float>(edge.percent_along()),
+                               static_cast<float>(target.second)};
+        }
+      }
+    }
+
+    // the hierarchy knows nothing of turn costs and restrictions, the real time and distance come
+    // from recosting the path with the request costing
+    auto* times = td.data() + source * target_count;
+    for (uint32_t target = 0; target < target_count; ++target) {
+      // the same locations have no cost
+      if (equals(location.ll(), target_location_list.Get(target).ll())) {
+        times[target] = TimeDistance(0, 0);
+        continue;
+      }
+      const auto& connection = row[target];
+      if (connection.cost == kMaxCost) {
+        continue;
+      }
+      float source_percent, target_percent;
+      const auto edges = FormPath(seeds, target, connection, source_percent, target_percent);
+      bool has_ferry = false;
+      const auto path = ContractionQuery::Recost(graphreader, *costing_, mode, edges,
+                                                 source_percent, target_percent, has_ferry);
+      if (path.empty()) {
+        LOG_DEBUG("Bucket matrix path rejected by the costing");
+        return {};
+      }
+      times[target] = TimeDistance(std::round(path.back().elapsed_cost.secs),
+                                   std::round(path.back().path_distance));
+    }
+    ++source;
+  }
+  return td;
+}
+
+std::vector<GraphId> BucketMatrix::FormPath(const std::vector<seed_t>& source_seeds,
+                                            const uint32_t target,
+                                            const connection_t& connection,
+                                            float& source_percent,
+                                            float& target_percent) const {
+  if (connection.meet == kInvalidContractionIndex) {
+    source_percent = connection.source_percent;
+    target_percent = connection.target_percent;
+    return {connection.edgeid};
+  }
+
+  // walk back to the source through the labels of its search and ahead to the target through its
+  // buckets collecting the arcs in path order
+  std::vector<uint32_t> arcs;
+  auto label = labels_.at(connection.meet);
+  while (label.arc != kInvalidContractionIndex) {
+    arcs.push_back(label.arc);
+    label = labels_.at(hierarchy_->arc(label.arc).tail);
+  }
+  const auto& source = source_seeds[label.seed];
+  std::reverse(arcs.begin(), arcs.end());
+  label = std::lower_bound(buckets_.begin(), buckets_.end(), bucket_t{connection.meet, target, {}})
+              ->label;
+  while (label.arc != kInvalidContractionIndex) {
+    arcs.push_back(label.arc);
+    label = std::lower_bound(buckets_.begin(), buckets_.end(),
+                             bucket_t{hierarchy_->arc(label.arc).head, target, {}})
+                ->label;
+  }
+  const auto& destination = target_seeds_[target][label.seed];
+
+  std::vector<GraphId> edges{source.edgeid};
+  for (auto a : arcs) {
+    hierarchy_->unpack(a, edges);
+  }
+  edges.push_back(destination.edgeid);
+  source_percent = source.percent_along;
+  target_percent = destination.percent_along;
+  return edges;
+}
+
+} // namespace thor
+} // namespace valhalla
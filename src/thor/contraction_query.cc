@@ -0,0 +1,299 @@
+#include "thor/contraction_query.h"
+#include "baldr/directededge.h"
+#include "baldr/graphid.h"
+#include "midgard/logging.h"
+#include "sif/edgelabel.h"
+#include "sif/recost.h"
+#include <algorithm>
+#include <limits>
+#include <tuple>
+
+using namespace valhalla::baldr;
+using namespace valhalla::sif;
+
+namespace {
+
+// Labels to reserve for each direction, the searches of a hierarchy settle few nodes
+constexpr size_t kInitialLabelCount = 4096;
+
+} // namespace
+
+namespace valhalla {
+namespace thor {
+
+ContractionQuery::ContractionQuery(const boost::property_tree::ptree& config)
+    : PathAlgorithm(config.get<uint32_t>("thor.max_reserved_labels_count", kInitialLabelCount),
+                    config.get<bool>("thor.clear_reserved_memory", false)),
+      mode_(sif::TravelMode::kDrive) {
+  auto file_name = config.get<std::string>("mjolnir.contraction_hierarchy", "");
+  if (file_name.empty()) {
+    return;
+  }
+  try {
+    hierarchy_ = std::make_shared<const ContractionHierarchy>(file_name);
+    LOG_INFO("Loaded contraction hierarchy " + file_name + " with " +
+             std::to_string(hierarchy_->node_count()) + " nodes");
+  } catch (const std::exception& e) {
+    LOG_WARN("Not using contraction hierarchy: " + std::string(e.what()));
+  }
+}
+
+ContractionQuery::~ContractionQuery() {
+}
+
+void ContractionQuery::Clear() {
+  auto reservation = clear_reserved_memory_ ? 0 : max_reserved_labels_count_;
+  if (forward_labels_.size() > reservation || reverse_labels_.size() > reservation) {
+    labels_t().swap(forward_labels_);
+    labels_t().swap(reverse_labels_);
+  }
+  forward_labels_.clear();
+  reverse_labels_.clear();
+  forward_queue_ = queue_t();
+  reverse_queue_ = queue_t();
+  origins_.clear();
+  destinations_.clear();
+  costing_.reset();
+  has_ferry_ = false;
+}
+
+bool ContractionQuery::Matches(const Options& options) const {
+  return hierarchy_ && hierarchy_->matches(options);
+}
+
+void ContractionQuery::Seed(GraphReader& graphreader,
+                            const valhalla::Location& location,
+                            bool forward) {
+  // the forward search leaves the origin edges at their end nodes, the reverse search enters the
+  // destination edges at their begin nodes, edges where the location is right at that node are
+  // only used when there is nothing else
+  const auto& edges = location.correlation().edges();
+  bool has_other_edges = std::any_of(edges.begin(), edges.end(), [forward](const auto& e) {
+    return forward ? !e.end_node() : !e.begin_node();
+  });
+
+  auto& seeds = forward ? origins_ : destinations_;
+  auto& labels = forward ? forward_labels_ : reverse_labels_;
+  auto& queue = forward ? forward_queue_ : reverse_queue_;
+  for (const auto& edge : edges) {
+    if (has_other_edges && (forward ? edge.end_node() : edge.begin_node())) {
+      continue;
+    }
+
+    GraphId edgeid(edge.graph_id());
+    graph_tile_ptr tile = graphreader.GetGraphTile(edgeid);
+    if (tile == nullptr) {
+      continue;
+    }
+    const DirectedEdge* directededge = tile->directededge(edgeid);
+    GraphId node =
+        forward ? directededge->endnode() : graphreader.edge_startnode(edgeid, tile);
+    uint32_t index = node.Is_Valid() ? hierarchy_->node(node) : kInvalidContractionIndex;
+    if (index == kInvalidContractionIndex) {
+      continue;
+    }
+
+    // cost of the part of the edge we travel plus the usual penalty for the distance to the edge
+    float percent = forward ? 1.0f - edge.percent_along() : edge.percent_along();
+    float cost = costing_->EdgeCost(directededge, tile).cost * percent + edge.distance();
+    seeds.push_back({edgeid, static_cast<float>(edge.percent_along())});
+    auto inserted =
+        labels.emplace(index, label_t{cost, kInvalidContractionIndex,
+                                      static_cast<uint32_t>(seeds.size() - 1)});
+    if (!inserted.second) {
+      if (cost >= inserted.first->second.cost) {
+        continue;
+      }
+      inserted.first->second = {cost, kInvalidContractionIndex,
+                                static_cast<uint32_t>(seeds.size() - 1)};
+    }
+    queue.emplace(cost, index);
+  }
+}
+
+std::vector<std::vector<PathInfo>>
+ContractionQuery::GetBestPath(valhalla::Location& origin,
+                              valhalla::Location& destination,
+                              GraphReader& graphreader,
+                              const sif::mode_costing_t& mode_costing,
+                              const sif::TravelMode mode,
+                              const Options& /*options*/) {
+  if (!hierarchy_) {
+    return {};
+  }
+
+  mode_ = mode;
+  costing_ = mode_costing[static_cast<uint32_t>(mode_)];
+  forward_labels_.reserve(kInitialLabelCount);
+  reverse_labels_.reserve(kInitialLabelCount);
+  Seed(graphreader, origin, true);
+  Seed(graphreader, destination, false);
+
+  // the searches only leave and enter edges at their nodes, so when the destination is ahead of
+  // the origin on the same edge the way along that edge is a candidate they never see. it is the
+  // path to beat, a detour through the hierarchy is only taken when it is cheaper
+  float best = std::numeric_limits<float>::max();
+  seed_t direct_source{}, direct_target{};
+  for (const auto& source : origin.correlation().edges()) {
+    for (const auto& target : destination.correlation().edges()) {
+      if (source.graph_id() != target.graph_id() || source.percent_along() > target.percent_along()) {
+        continue;
+      }
+      GraphId edgeid(source.graph_id());
+      graph_tile_ptr tile = graphreader.GetGraphTile(edgeid);
+      if (tile == nullptr) {
+        continue;
+      }
+      float cost = costing_->EdgeCost(tile->directededge(edgeid), tile).cost *
+                       (target.percent_along() - source.percent_along()) +
+                   source.distance() + target.distance();
+      if (cost < best) {
+        best = cost;
+        direct_source = {edgeid, static_cast<float>(source.percent_along())};
+        direct_target = {edgeid, static_cast<float>(target.percent_along())};
+      }
+    }
+  }
+
+  // alternate between the directions by always settling the cheaper of the two queue tops, once
+  // neither can improve on the best meeting point the path is optimal within the hierarchy
+  uint32_t meet = kInvalidContractionIndex;
+  size_t n = 0;
+  while (true) {
+    if (interrupt && (++n % kInterruptIterationsInterval) == 0) {
+      (*interrupt)();
+    }
+
+    float forward_min = forward_queue_.empty() ? std::numeric_limits<float>::max()
+                                               : forward_queue_.top().first;
+    float reverse_min = reverse_queue_.empty() ? std::numeric_limits<float>::max()
+                                               : reverse_queue_.top().first;
+    if (std::min(forward_min, reverse_min) >= best) {
+      break;
+    }
+
+    bool forward = forward_min <= reverse_min;
+    auto& queue = forward ? forward_queue_ : reverse_queue_;
+    auto& labels = forward ? forward_labels_ : reverse_labels_;
+    const auto& other = forward ? reverse_labels_ : forward_labels_;
+    float cost;
+    uint32_t index;
+    std::tie(cost, index) = queue.top();
+    queue.pop();
+
+    // skip stale queue entries
+    auto label = labels.find(index);
+    if (cost > label->second.cost) {
+      continue;
+    }
+    uint32_t seed = label->second.seed;
+
+    // did the other direction already get here
+    auto found = other.find(index);
+    if (found != other.end() && cost + found->second.cost < best) {
+      best = cost + found->second.cost;
+      meet = index;
+    }
+
+    // relax the arcs towards higher ranked nodes
+    auto arcs = forward ? hierarchy_->forward_arcs(index) : hierarchy_->reverse_arcs(index);
+    for (const auto* a = arcs.first; a != arcs.second; ++a) {
+      const auto& arc = hierarchy_->arc(*a);
+      uint32_t next = forward ? arc.head : arc.tail;
+      float next_cost = cost + arc.cost;
+      auto inserted = labels.emplace(next, label_t{next_cost, *a, seed});
+      if (!inserted.second) {
+        if (next_cost >= inserted.first->second.cost) {
+          continue;
+        }
+        inserted.first->second = {next_cost, *a, seed};
+      }
+      queue.emplace(next_cost, next);
+    }
+  }
+
+  if (meet == kInvalidContractionIndex && !direct_source.edgeid.Is_Valid()) {
+    return {};
+  }
+  auto path = meet == kInvalidContractionIndex
+                  ? Recost(graphreader, *costing_, mode_, {direct_source.edgeid},
+                           direct_source.percent_along, direct_target.percent_along, has_ferry_)
+                  : FormPath(graphreader, meet);
+  if (path.empty()) {
+    return {};
+  }
+  return {std::move(path)};
+}
+
+std::vector<PathInfo> ContractionQuery::FormPath(GraphReader& graphreader, uint32_t meet) {
+  // walk back to the origin and ahead to the destination collecting the arcs in path order
+  std::vector<uint32_t> arcs;
+  auto label = forward_labels_.find(meet);
+  while (label->second.arc != kInvalidContractionIndex) {
+    arcs.push_back(label->second.arc);
+    label = forward_labels_.find(hierarchy_->arc(label->second.arc).tail);
+  }
+  const auto& source = origins_[label->second.seed];
+  std::reverse(arcs.begin(), arcs.end());
+  label = reverse_labels_.find(meet);
+  while (label->second.arc != kInvalidContractionIndex) {
+    arcs.push_back(label->second.arc);
+    label = reverse_labels_.find(hierarchy_->arc(label->second.arc).head);
+  }
+  const auto& target = destinations_[label->second.seed];
+
+  // unpack the shortcuts into the graph edges between the origin and destination edges
+  std::vector<GraphId> edges{source.edgeid};
+  for (auto a : arcs) {
+    hierarchy_->unpack(a, edges);
+  }
+  edges.push_back(target.edgeid);
+  return Recost(graphreader, *costing_, mode_, edges, source.percent_along, target.percent_along,
+                has_ferry_);
+}
+
+std::vector<PathInfo> ContractionQuery::Recost(GraphReader& graphreader,
+                                               const sif::DynamicCost& costing,
+                                               const sif::TravelMode mode,
+                                               const std::vector<GraphId>& edges,
+                                               const float source_percent,
+                                               const float target_percent,
+                                               bool& has_ferry) {
+  // recost the edges with the request costing, this adds the turn costs and throws when the path
+  // isn't allowed. complex restrictions are checked against the labels made so far
+  std::vector<PathInfo> path;
+  std::vector<EdgeLabel> edge_labels;
+  edge_labels.reserve(edges.size());
+  bool restricted = false;
+  size_t i = 0;
+  try {
+    recost_forward(
+        graphreader, costing,
+        [&edges, &i]() { return i < edges.size() ? edges[i++] : GraphId{}; },
+        [&](const EdgeLabel& label) {
+          graph_tile_ptr tile;
+          const DirectedEdge* edge = graphreader.directededge(label.edgeid(), tile);
+          if (!edge_labels.empty() && costing.Restricted(edge, edge_labels.back(), edge_labels,
+                                                         tile, label.edgeid(), true)) {
+            restricted = true;
+          }
+          if (label.use() == Use::kFerry) {
+            has_ferry = true;
+          }
+          edge_labels.push_back(label);
+          path.emplace_back(mode, label.cost(), label.edgeid(), 0, label.path_distance(),
+                            label.restriction_idx(), label.transition_cost());
+        },
+        source_percent, target_percent);
+  } catch (const std::exception& e) {
+    LOG_DEBUG("Contraction hierarchy path rejected: " + std::string(e.what()));
+    return {};
+  }
+  if (restricted || path.size() != edges.size()) {
+    return {};
+  }
+  return path;
+}
+
+} // namespace thor
+} // namespace valhalla
@@ -1,5 +1,11 @@
 #include <algorithm>
+#include <atomic>
 #include <cmath>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
 #include <vector>
 
 #include "midgard/logging.h"
@@ -15,6 +21,10 @@ namespace {
 
 constexpr uint32_t kMaxMatrixIterations = 2000000;
 
+// Fewer searches than this take their step on the calling thread, waking the pool for them
+// costs more than it saves
+constexpr uint32_t kMinParallelSearches = 16;
+
 // Find a threshold to continue the search - should be based on
 // the max edge cost in the adjacency set?
 int GetThreshold(const travel_mode_t mode, const int n) {
@@ -33,11 +43,109 @@ namespace thor {
 
 class CostMatrix::TargetMap : public robin_hood::unordered_map<uint64_t, std::vector<uint32_t>> {};
 
+// Runs a batch of tasks on a fixed set of threads plus the calling thread and waits for all of
+// them to finish. The first exception a task throws is rethrown on the calling thread
+class CostMatrix::ThreadPool {
+public:
+  explicit ThreadPool(const uint32_t thread_count)
+      : task_(nullptr), count_(0), next_(0), generation_(0), busy_(0), stop_(false) {
+    for (uint32_t i = 1; i < thread_count; ++i) {
+      threads_.emplace_back(&ThreadPool::work, this);
+    }
+  }
+
+  ~ThreadPool() {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      stop_ = true;
+    }
+    start_cv_.notify_all();
+    for (auto& thread : threads_) {
+      thread.join();
+    }
+  }
+
+  void run(const size_t count, const std::function<void(size_t)>& task) {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      task_ = &task;
+      count_ = count;
+      next_ = 0;
+      busy_ = threads_.size();
+      ++generation_;
+    }
+    start_cv_.notify_all();
+    drain();
+
+    std::exception_ptr error;
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      done_cv_.wait(lock, [this]() { return busy_ == 0; });
+      task_ = nullptr;
+      std::swap(error, error_);
+    }
+    if (error) {
+      std::rethrow_exception(error);
+    }
+  }
+
+private:
+  void work() {
+    uint64_t generation = 0;
+    while (true) {
+      {
+        std::unique_lock<std::mutex> lock(mutex_);
+        start_cv_.wait(lock, [this, generation]() { return stop_ || generation_ != generation; });
+        if (stop_) {
+          return;
+        }
+        generation = generation_;
+      }
+      drain();
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        --busy_;
+      }
+      done_cv_.notify_one();
+    }
+  }
+
+  // take tasks until there are none left
+  void drain() {
+    for (size_t i = next_++; i < count_; i = next_++) {
+      try {
+        (*task_)(i);
+      } catch (...) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!error_) {
+          error_ = std::current_exception();
+        }
+      }
+    }
+  }
+
+  std::vector<std::thread> threads_;
+  std::mutex mutex_;
+  std::condition_variable start_cv_;
+  std::condition_variable done_cv_;
+  const std::function<void(size_t)>* task_;
+  size_t count_;
+  std::atomic<size_t> next_;
+  uint64_t generation_;
+  size_t busy_;
+  bool stop_;
+  std::exception_ptr error_;
+};
+
 // Constructor with cost threshold.
-CostMatrix::CostMatrix()
+CostMatrix::CostMatrix(const boost::property_tree::ptree& config)
     : mode_(travel_mode_t::kDrive), access_mode_(kAutoAccess), source_count_(0),
       remaining_sources_(0), target_count_(0), remaining_targets_(0),
-      current_cost_threshold_(0), targets_{new TargetMap} {
+      current_cost_threshold_(0),
+      queue_type_(baldr::to_queue_type(config.get<std::string>("queue_type", "double_bucket"))),
+      thread_count_(std::max(config.get<uint32_t>("costmatrix_concurrency", 1), 1u)),
+      expanding_targets_in_parallel_(false), expanding_sources_in_parallel_(false),
+      targets_{new TargetMap} {
 }
 
 CostMatrix::~CostMatrix() {
@@ -103,6 +211,8 @@ void CostMatrix::clear() {
   source_status_.clear();
   target_status_.clear();
   best_connection_.clear();
+  deferred_status_.clear();
+  deferred_targets_.clear();
 }
 
 // Form a time distance matrix from the set of source locations
@@ -130,62 +240,45 @@ std::vector<TimeDistance> CostMatrix::SourceToTarget(
   // location set.
   Initialize(source_location_list, target_location_list);
 
+  // Expanding the searches on several threads needs a reader that can hand out tiles to all of them
+  bool parallel = thread_count_ > 1 && graphreader.IsThreadSafe();
+  if (thread_count_ > 1 && !parallel) {
+    LOG_DEBUG("Expanding the matrix serially, the graph reader is not thread-safe");
+  }
+  if (parallel && !pool_) {
+    pool_.reset(new ThreadPool(thread_count_));
+  }
+
   // Perform backward search from all target locations. Perform forward
   // search from all source locations. Connections between the 2 search
   // spaces is checked during the forward search.
   int n = 0;
   while (true) {
     // Iterate all target locations in a backwards search
-    for (uint32_t i = 0; i < target_count_; i++) {
-      if (target_status_[i].threshold > 0) {
-        target_status_[i].threshold--;
-        BackwardSearch(i, graphreader);
-        if (target_status_[i].threshold == 0) {
-          for (uint32_t source = 0; source < source_count_; source++) {
-            //  Get all targets remaining for the origin
-            auto& targets = source_status_[source].remaining_locations;
-            auto it = targets.find(i);
-            if (it != targets.end()) {
-              targets.erase(it);
-              if (targets.empty() && source_status_[source].threshold > 0) {
-                source_status_[i].threshold = -1;
-                if (remaining_sources_ > 0) {
-                  remaining_sources_--;
-                }
-              }
-            }
-          }
-          target_status_[i].threshold = -1;
-          if (remaining_targets_ > 0) {
-            remaining_targets_--;
+    if (parallel) {
+      ExpandInParallel(false, n, graphreader);
+    } else {
+      for (uint32_t i = 0; i < target_count_; i++) {
+        if (target_status_[i].threshold > 0) {
+          target_status_[i].threshold--;
+          BackwardSearch(i, graphreader);
+          if (target_status_[i].threshold == 0) {
+            FinishTarget(i);
           }
         }
       }
     }
 
     // Iterate all source locations in a forward search
-    for (uint32_t i = 0; i < source_count_; i++) {
-      if (source_status_[i].threshold > 0) {
-        source_status_[i].threshold--;
-        ForwardSearch(i, n, graphreader);
-        if (source_status_[i].threshold == 0) {
-          for (uint32_t target = 0; target < target_count_; target++) {
-            //  Get all sources remaining for the destination
-            auto& sources = target_status_[target].remaining_locations;
-            auto it = sources.find(i);
-            if (it != sources.end()) {
-              sources.erase(it);
-              if (sources.empty() && target_status_[target].threshold > 0) {
-                target_status_[i].threshold = -1;
-                if (remaining_targets_ > 0) {
-                  remaining_targets_--;
-                }
-              }
-            }
-          }
-          source_status_[i].threshold = -1;
-          if (remaining_sources_ > 0) {
-            remaining_sources_--;
+    if (parallel) {
+      ExpandInParallel(true, n, graphreader);
+    } else {
+      for (uint32_t i = 0; i < source_count_; i++) {
+        if (source_status_[i].threshold > 0) {
+          source_status_[i].threshold--;
+          ForwardSearch(i, n, graphreader);
+          if (source_status_[i].threshold == 0) {
+            FinishSource(i);
           }
         }
       }
@@ -215,6 +308,126 @@ std::vector<TimeDistance> CostMatrix::SourceToTarget(
   return td;
 }
 
+// Stop expanding a target whose threshold ran out.
+void CostMatrix::FinishTarget(const uint32_t i) {
+  for (uint32_t source = 0; source < source_count_; source++) {
+    //  Get all targets remaining for the origin
+    auto& targets = source_status_[source].remaining_locations;
+    auto it = targets.find(i);
+    if (it != targets.end()) {
+      targets.erase(it);
+      if (targets.empty() && source_status_[source].threshold > 0) {
+        source_status_[i].threshold = -1;
+        if (remaining_sources_ > 0) {
+          remaining_sources_--;
+        }
+      }
+    }
+  }
+  target_status_[i].threshold = -1;
+  if (remaining_targets_ > 0) {
+    remaining_targets_--;
+  }
+}
+
+// Stop expanding a source whose threshold ran out.
+void CostMatrix::FinishSource(const uint32_t i) {
+  for (uint32_t target = 0; target < target_count_; target++) {
+    //  Get all sources remaining for the destination
+    auto& sources = target_status_[target].remaining_locations;
+    auto it = sources.find(i);
+    if (it != sources.end()) {
+      sources.erase(it);
+      if (sources.empty() && target_status_[target].threshold > 0) {
+        target_status_[i].threshold = -1;
+        if (remaining_targets_ > 0) {
+          remaining_targets_--;
+        }
+      }
+    }
+  }
+  source_status_[i].threshold = -1;
+  if (remaining_sources_ > 0) {
+    remaining_sources_--;
+  }
+}
+
+// Let every search on one side take its step, the steps of one side only touch the state of
+// their own location. What they would change on the other side is recorded and applied in
+// location order once all steps are done so the result is the same as expanding serially
+void CostMatrix::ExpandInParallel(const bool forward, const uint32_t n, GraphReader& graphreader) {
+  auto& status = forward ? source_status_ : target_status_;
+  std::vector<uint32_t> active;
+  for (uint32_t i = 0; i < status.size(); i++) {
+    if (status[i].threshold > 0) {
+      active.push_back(i);
+    }
+  }
+
+  // too few to be worth it, take the steps right here
+  if (active.size() < kMinParallelSearches) {
+    for (auto i : active) {
+      status[i].threshold--;
+      if (forward) {
+        ForwardSearch(i, n, graphreader);
+      } else {
+        BackwardSearch(i, graphreader);
+      }
+      if (status[i].threshold == 0 && forward) {
+        FinishSource(i);
+      } else if (status[i].threshold == 0) {
+        FinishTarget(i);
+      }
+    }
+    return;
+  }
+
+  deferred_status_.resize(status.size());
+  if (!forward) {
+    deferred_targets_.resize(target_count_);
+  }
+  expanding_sources_in_parallel_ = forward;
+  expanding_targets_in_parallel_ = !forward;
+  try {
+    pool_->run(active.size(), [&](size_t a) {
+      uint32_t i = active[a];
+      status[i].threshold--;
+      if (forward) {
+        ForwardSearch(i, n, graphreader);
+      } else {
+        BackwardSearch(i, graphreader);
+      }
+    });
+  } catch (...) {
+    expanding_sources_in_parallel_ = expanding_targets_in_parallel_ = false;
+    throw;
+  }
+  expanding_sources_in_parallel_ = expanding_targets_in_parallel_ = false;
+
+  // replay what the steps did to the other side in the order the serial loop would have
+  for (auto i : active) {
+    for (const auto& update : deferred_status_[i]) {
+      if (forward) {
+        UpdateTargetStatus(i, update.first, update.second);
+      } else {
+        UpdateSourceStatus(update.first, i, update.second);
+      }
+    }
+    deferred_status_[i].clear();
+    if (!forward) {
+      for (const auto& edgeid : deferred_targets_[i]) {
+        (*targets_)[edgeid].push_back(i);
+      }
+      deferred_targets_[i].clear();
+    }
+    if (status[i].threshold == 0 && forward) {
+      FinishSource(i);
+    } else if (status[i].threshold == 0) {
+      FinishTarget(i);
+    }
+  }
+}
+
 // Initialize all time distance to "not found". Any locations that
 // are the same get set to 0 time, distance and do not add to the
 // remaining locations set.
@@ -512,7 +725,28 @@ void CostMatrix::CheckForwardConnections(const uint32_t source,
 
 // Update status when a connection is found.
 void CostMatrix::UpdateStatus(const uint32_t source, const uint32_t target) {
-  // Remove the target from the source status
+  uint32_t label_count = source_edgelabel_[source].size() + target_edgelabel_[target].size();
+
+  // Remove the target from the source status, unless the targets are expanding in parallel, then
+  // the source status is updated once they are all done
+  if (expanding_targets_in_parallel_) {
+    deferred_status_[target].emplace_back(source, label_count);
+  } else {
+    UpdateSourceStatus(source, target, label_count);
+  }
+
+  // Remove the source from the target status, likewise for the sources expanding in parallel
+  if (expanding_sources_in_parallel_) {
+    deferred_status_[source].emplace_back(target, label_count);
+  } else {
+    UpdateTargetStatus(source, target, label_count);
+  }
+}
+
+// Remove the target from the source status.
+void CostMatrix::UpdateSourceStatus(const uint32_t source,
+                                    const uint32_t target,
+                                    const uint32_t label_count) {
   auto& s = source_status_[source].remaining_locations;
   auto it = s.find(target);
   if (it != s.end()) {
@@ -520,21 +754,23 @@ void CostMatrix::UpdateStatus(const uint32_t source, const uint32_t target) {
     if (s.empty() && source_status_[source].threshold > 0) {
       // At least 1 connection has been found to each target for this source.
       // Set a threshold to continue search for a limited number of times.
-      source_status_[source].threshold =
-          GetThreshold(mode_, source_edgelabel_[source].size() + target_edgelabel_[target].size());
+      source_status_[source].threshold = GetThreshold(mode_, label_count);
     }
   }
+}
 
-  // Remove the source from the target status
+// Remove the source from the target status.
+void CostMatrix::UpdateTargetStatus(const uint32_t source,
+                                    const uint32_t target,
+                                    const uint32_t label_count) {
   auto& t = target_status_[target].remaining_locations;
-  it = t.find(source);
+  auto it = t.find(source);
   if (it != t.end()) {
     t.erase(it);
     if (t.empty() && target_status_[target].threshold > 0) {
       // At least 1 connection has been found to each source for this target.
       // Set a threshold to continue search for a limited number of times.
-      target_status_[target].threshold =
-          GetThreshold(mode_, source_edgelabel_[source].size() + target_edgelabel_[target].size());
+      target_status_[target].threshold = GetThreshold(mode_, label_count);
     }
   }
 }
@@ -668,8 +904,13 @@ void CostMatrix::BackwardSearch(const uint32_t index, GraphReader& graphreader)
                               restriction_idx);
       adj.add(idx);
 
-      // Add to the list of targets that have reached this edge
-      (*targets_)[edgeid].push_back(index);
+      // Add to the list of targets that have reached this edge, the map is shared by all targets
+      // so this waits until they are done when they expand in parallel
+      if (expanding_targets_in_parallel_) {
+        deferred_targets_[index].push_back(edgeid);
+      } else {
+        (*targets_)[edgeid].push_back(index);
+      }
     }
 
     // Handle transitions - expand from the end node of the transition
@@ -729,9 +970,9 @@ void CostMatrix::SetSources(GraphReader& graphreader,
   for (const auto& origin : sources) {
     // Allocate the adjacency list and hierarchy limits for this source.
     // Use the cost threshold to size the adjacency list.
-    source_adjacency_.emplace_back(DoubleBucketQueue<BDEdgeLabel>(0, current_cost_threshold_,
-                                                                  costing_->UnitSize(),
-                                                                  &source_edgelabel_[index]));
+    source_adjacency_.emplace_back(LabelQueue<BDEdgeLabel>(0, current_cost_threshold_,
+                                                           costing_->UnitSize(),
+                                                           &source_edgelabel_[index], queue_type_));
     source_hierarchy_limits_[index] = costing_->GetHierarchyLimits();
 
     // Iterate through edges and add to adjacency list
@@ -803,9 +1044,9 @@ void CostMatrix::SetTargets(baldr::GraphReader& graphreader,
   for (const auto& dest : targets) {
     // Allocate the adjacency list and hierarchy limits for target location.
     // Use the cost threshold to size the adjacency list.
-    target_adjacency_.emplace_back(DoubleBucketQueue<BDEdgeLabel>(0, current_cost_threshold_,
-                                                                  costing_->UnitSize(),
-                                                                  &target_edgelabel_[index]));
+    target_adjacency_.emplace_back(LabelQueue<BDEdgeLabel>(0, current_cost_threshold_,
+                                                           costing_->UnitSize(),
+                                                           &target_edgelabel_[index], queue_type_));
     target_hierarchy_limits_[index] = costing_->GetHierarchyLimits();
 
     // Iterate through edges and add to adjacency list
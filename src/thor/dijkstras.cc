@@ -47,6 +47,10 @@ Dijkstras::Dijkstras(const boost::property_tree::ptree& config)
       max_reserved_labels_count_(
           config.get<uint32_t>("max_reserved_labels_count", kInitialEdgeLabelCount)),
       clear_reserved_memory_(config.get<bool>("clear_reserved_memory", false)), multipath_(false) {
+  const auto queue_type =
+      baldr::to_queue_type(config.get<std::string>("queue_type", "double_bucket"));
+  adjacencylist_.set_type(queue_type);
+  mmadjacencylist_.set_type(queue_type);
 }
 
 // Clear the temporary information generated during path construction.
@@ -74,7 +78,7 @@ void Dijkstras::Clear() {
 // edgelabels
 template <typename label_container_t>
 void Dijkstras::Initialize(label_container_t& labels,
-                           baldr::DoubleBucketQueue<typename label_container_t::value_type>& queue,
+                           baldr::LabelQueue<typename label_container_t::value_type>& queue,
                            const uint32_t bucket_size) {
   // Set aside some space for edge labels
   uint32_t edge_label_reservation;
@@ -88,11 +92,11 @@ void Dijkstras::Initialize(label_container_t& labels,
 }
 template void
 Dijkstras::Initialize<decltype(Dijkstras::bdedgelabels_)>(decltype(Dijkstras::bdedgelabels_)&,
-                                                          baldr::DoubleBucketQueue<sif::BDEdgeLabel>&,
+                                                          baldr::LabelQueue<sif::BDEdgeLabel>&,
                                                           const uint32_t);
 template void
 Dijkstras::Initialize<decltype(Dijkstras::mmedgelabels_)>(decltype(Dijkstras::mmedgelabels_)&,
-                                                          baldr::DoubleBucketQueue<sif::MMEdgeLabel>&,
+                                                          baldr::LabelQueue<sif::MMEdgeLabel>&,
                                                           const uint32_t);
 
 // Initializes the time of the expansion if there is one
@@ -1,6 +1,7 @@
 #include "sif/autocost.h"
 #include "sif/bicyclecost.h"
 #include "sif/pedestriancost.h"
+#include "thor/bucketmatrix.h"
 #include "thor/costmatrix.h"
 #include "thor/timedistancebssmatrix.h"
 #include "thor/timedistancematrix.h"
@@ -84,6 +85,19 @@ std::string thor_worker_t::matrix(Api& request) {
     case TIME_DISTANCE_MATRIX:
       time_distances = timedistancematrix();
       break;
+    case BUCKET_MATRIX:
+      // Only requests matching the contraction hierarchy can use the buckets, when the costing
+      // rejects one of the paths they found we fall back to the cost matrix
+      if (bucket_matrix_.Matches(options)) {
+        time_distances =
+            bucket_matrix_.SourceToTarget(options.sources(), options.targets(), *reader,
+                                          mode_costing, mode,
+                                          max_matrix_distance.find(costing)->second);
+      }
+      if (time_distances.empty()) {
+        time_distances = costmatrix();
+      }
+      break;
   }
   return tyr::serializeMatrix(request, time_distances, distance_scale);
 }
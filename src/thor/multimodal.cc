@@ -46,6 +46,8 @@ MultiModalPathAlgorithm::MultiModalPathAlgorithm(const boost::property_tree::ptr
                     config.get<bool>("clear_reserved_memory", false)),
       walking_distance_(0), max_label_count_(std::numeric_limits<uint32_t>::max()),
       mode_(travel_mode_t::kPedestrian), travel_type_(0) {
+  adjacencylist_.set_type(
+      baldr::to_queue_type(config.get<std::string>("queue_type", "double_bucket")));
 }
 
 // Destructor
@@ -701,7 +703,7 @@ bool MultiModalPathAlgorithm::ExpandFromNode(baldr::GraphReader& graphreader,
                                              const std::shared_ptr<DynamicCost>& costing,
                                              EdgeStatus& edgestatus,
                                              std::vector<EdgeLabel>& edgelabels,
-                                             DoubleBucketQueue<EdgeLabel>& adjlist,
+                                             LabelQueue<EdgeLabel>& adjlist,
                                              const bool from_transition) {
   // Get the tile and the node info. Skip if tile is null (can happen
   // with regional data sets) or if no access at the node.
@@ -789,7 +791,8 @@ bool MultiModalPathAlgorithm::CanReachDestination(const valhalla::Location& dest
   // Use a simple Dijkstra method - no need to recover the path just need to make sure we can
   // get to a transit stop within the specified max. walking distance
   uint32_t bucketsize = costing->UnitSize();
-  DoubleBucketQueue<EdgeLabel> adjlist(0.0f, kBucketCount * bucketsize, bucketsize, &edgelabels);
+  LabelQueue<EdgeLabel> adjlist(0.0f, kBucketCount * bucketsize, bucketsize, &edgelabels,
+                                adjacencylist_.type());
 
   // Add the opposing destination edges to the priority queue
   uint32_t label_idx = 0;
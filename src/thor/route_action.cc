@@ -239,6 +239,7 @@ thor::PathAlgorithm* thor_worker_t::get_path_algorithm(const std::string& routet
            &timedep_reverse,
            &bidir_astar,
            &bss_astar,
+           &contraction_query,
        }) {
     alg->set_interrupt(interrupt);
   }
@@ -289,6 +290,13 @@ thor::PathAlgorithm* thor_worker_t::get_path_algorithm(const std::string& routet
     }
   }
 
+  // Time independent auto routes without alternates can be answered by the contraction hierarchy
+  // if it was built with the same costing options
+  if (origin.date_time().empty() && destination.date_time().empty() && options.alternates() == 0 &&
+      contraction_query.Matches(options)) {
+    return &contraction_query;
+  }
+
   // No other special cases we land on bidirectional a*
   return &bidir_astar;
 }
@@ -301,6 +309,21 @@ std::vector<std::vector<thor::PathInfo>> thor_worker_t::get_path(PathAlgorithm*
   // Find the path.
   valhalla::sif::cost_ptr_t cost = mode_costing[static_cast<uint32_t>(mode)];
 
+  // The contraction hierarchy only returns paths the costing accepts as they are, when it
+  // can't find one we fall back to bidirectional A* and its usual passes
+  if (path_algorithm == &contraction_query) {
+    cost->set_allow_destination_only(false);
+    cost->set_pass(0);
+    auto paths =
+        path_algorithm->GetBestPath(origin, destination, *reader, mode_costing, mode, options);
+    if (!paths.empty()) {
+      return paths;
+    }
+    path_algorithm->Clear();
+    path_algorithm = &bidir_astar;
+    path_algorithm->Clear();
+  }
+
   // If bidirectional A* disable use of destination-only edges on the
   // first pass. If there is a failure, we allow them on the second pass.
   // Other path algorithms can use destination-only edges on the first pass.
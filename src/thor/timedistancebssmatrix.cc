@@ -36,7 +36,10 @@ namespace valhalla {
 namespace thor {
 
 // Constructor with cost threshold.
-TimeDistanceBSSMatrix::TimeDistanceBSSMatrix() : settled_count_(0), current_cost_threshold_(0) {
+TimeDistanceBSSMatrix::TimeDistanceBSSMatrix(const boost::property_tree::ptree& config)
+    : settled_count_(0), current_cost_threshold_(0) {
+  adjacencylist_.set_type(
+      baldr::to_queue_type(config.get<std::string>("queue_type", "double_bucket")));
 }
 
 float TimeDistanceBSSMatrix::GetCostThreshold(const float max_matrix_distance) const {
@@ -27,8 +27,10 @@ namespace valhalla {
 namespace thor {
 
 // Constructor with cost threshold.
-TimeDistanceMatrix::TimeDistanceMatrix()
+TimeDistanceMatrix::TimeDistanceMatrix(const boost::property_tree::ptree& config)
     : mode_(travel_mode_t::kDrive), settled_count_(0), current_cost_threshold_(0) {
+  adjacencylist_.set_type(
+      baldr::to_queue_type(config.get<std::string>("queue_type", "double_bucket")));
 }
 
 // Compute a cost threshold in seconds based on average speed for the travel mode.
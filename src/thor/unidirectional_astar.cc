@@ -23,6 +23,8 @@ UnidirectionalAStar<expansion_direction, FORWARD>::UnidirectionalAStar(
                     config.get<bool>("clear_reserved_memory", false)),
       max_label_count_(std::numeric_limits<uint32_t>::max()), mode_(travel_mode_t::kDrive),
       travel_type_(0), access_mode_{kAutoAccess} {
+  adjacencylist_.set_type(
+      baldr::to_queue_type(config.get<std::string>("queue_type", "double_bucket")));
 }
 
 // Default constructor
@@ -69,7 +69,11 @@ thor_worker_t::thor_worker_t(const boost::property_tree::ptree& config,
     : service_worker_t(config), mode(valhalla::sif::TravelMode::kPedestrian),
       bidir_astar(config.get_child("thor")), bss_astar(config.get_child("thor")),
       multi_modal_astar(config.get_child("thor")), timedep_forward(config.get_child("thor")),
-      timedep_reverse(config.get_child("thor")), isochrone_gen(config.get_child("thor")),
+      timedep_reverse(config.get_child("thor")), contraction_query(config),
+      costmatrix_(config.get_child("thor")),
+      time_distance_matrix_(config.get_child("thor")),
+      time_distance_bss_matrix_(config.get_child("thor")), bucket_matrix_(config.get_child("thor")),
+      isochrone_gen(config.get_child("thor")),
       reader(graph_reader ? graph_reader
                           : std::make_shared<baldr::GraphReader>(config.get_child("mjolnir"))),
       matcher_factory(config, reader), controller{} {
@@ -94,6 +98,8 @@ thor_worker_t::thor_worker_t(const boost::property_tree::ptree& config,
     source_to_target_algorithm = TIME_DISTANCE_MATRIX;
   } else if (conf_algorithm == "costmatrix") {
     source_to_target_algorithm = COST_MATRIX;
+  } else if (conf_algorithm == "bucket_matrix") {
+    source_to_target_algorithm = BUCKET_MATRIX;
   } else {
     source_to_target_algorithm = SELECT_OPTIMAL;
   }
@@ -101,6 +107,9 @@ thor_worker_t::thor_worker_t(const boost::property_tree::ptree& config,
   max_timedep_distance =
       config.get<float>("service_limits.max_timedep_distance", kDefaultMaxTimeDependentDistance);
 
+  // The bucket matrix searches the same contraction hierarchy as the route queries
+  bucket_matrix_.set_hierarchy(contraction_query.hierarchy());
+
   // signal that the worker started successfully
   started();
 }
@@ -310,10 +319,12 @@ void thor_worker_t::cleanup() {
   timedep_reverse.Clear();
   multi_modal_astar.Clear();
   bss_astar.Clear();
+  contraction_query.Clear();
   trace.clear();
   costmatrix_.clear();
   time_distance_matrix_.clear();
   time_distance_bss_matrix_.clear();
+  bucket_matrix_.clear();
   isochrone_gen.Clear();
   centroid_gen.Clear();
   matcher_factory.ClearFullCache();
@@ -1,10 +1,18 @@
 #include "tyr/actor.h"
 #include "baldr/rapidjson_utils.h"
+#include "baldr/tilehierarchy.h"
 #include "loki/worker.h"
 #include "odin/worker.h"
 #include "thor/worker.h"
 #include "tyr/serializers.h"
 
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <utility>
+
 using namespace valhalla;
 using namespace valhalla::loki;
 using namespace valhalla::thor;
@@ -16,11 +24,11 @@ namespace tyr {
 struct actor_t::pimpl_t {
   pimpl_t(const boost::property_tree::ptree& config)
       : reader(new baldr::GraphReader(config.get_child("mjolnir"))), loki_worker(config, reader),
-        thor_worker(config, reader), odin_worker(config) {
+        thor_worker(config, reader), odin_worker(config), config(config) {
   }
   pimpl_t(const boost::property_tree::ptree& config, baldr::GraphReader& graph_reader)
       : reader(&graph_reader, [](baldr::GraphReader*) {}), loki_worker(config, reader),
-        thor_worker(config, reader), odin_worker(config) {
+        thor_worker(config, reader), odin_worker(config), config(config) {
   }
   void set_interrupts(const std::function<void()>* interrupt_function) {
     loki_worker.set_interrupt(interrupt_function);
@@ -31,11 +39,79 @@ struct actor_t::pimpl_t {
     loki_worker.cleanup();
     thor_worker.cleanup();
     odin_worker.cleanup();
+    for (auto& worker : batch_workers) {
+      worker->cleanup();
+    }
+  }
+  // how many workers a batch of count items gets, more than one only if the reader can be shared
+  size_t batch_concurrency(const std::string& key, size_t count) const {
+    if (!reader->IsThreadSafe()) {
+      return 1;
+    }
+    auto concurrency = config.get<size_t>(key, std::max(std::thread::hardware_concurrency(), 1u));
+    return std::max<size_t>(std::min(concurrency, count), 1);
+  }
+  // runs work for every item of a batch on a pool of workers sharing the reader, we are the first
+  // worker. anything work throws stops the whole batch and is rethrown once all workers are done
+  void batch(size_t count,
+             size_t concurrency,
+             const std::function<void()>* interrupt,
+             const std::function<void(pimpl_t&, size_t)>& work) {
+    while (batch_workers.size() + 1 < concurrency) {
+      batch_workers.emplace_back(new pimpl_t(config, *reader));
+    }
+    std::vector<pimpl_t*> workers{this};
+    for (size_t i = 0; workers.size() < concurrency; ++i) {
+      workers.push_back(batch_workers[i].get());
+    }
+    // the reader is shared so set them all before anyone starts
+    for (auto* worker : workers) {
+      worker->set_interrupts(interrupt);
+    }
+
+    // each worker takes the next item until there are none left
+    std::atomic<size_t> next(0);
+    std::mutex error_lock;
+    std::exception_ptr error;
+    auto take = [&](pimpl_t& worker) {
+      try {
+        for (size_t i = next++; i < count; i = next++) {
+          if (interrupt) {
+            (*interrupt)();
+          }
+          work(worker, i);
+        }
+      } catch (...) {
+        std::lock_guard<std::mutex> lock(error_lock);
+        if (!error) {
+          error = std::current_exception();
+        }
+        next = count;
+      }
+    };
+
+    std::vector<std::thread> threads;
+    threads.reserve(workers.size() - 1);
+    for (size_t i = 1; i < workers.size(); ++i) {
+      threads.emplace_back(take, std::ref(*workers[i]));
+    }
+    take(*workers.front());
+    for (auto& thread : threads) {
+      thread.join();
+    }
+
+    if (error) {
+      cleanup();
+      std::rethrow_exception(error);
+    }
   }
   std::shared_ptr<baldr::GraphReader> reader;
   loki::loki_worker_t loki_worker;
   thor::thor_worker_t thor_worker;
   odin_worker_t odin_worker;
+  // to make more workers for batches, they are kept from one batch to the next
+  boost::property_tree::ptree config;
+  std::vector<std::unique_ptr<pimpl_t>> batch_workers;
 };
 
 actor_t::actor_t(const boost::property_tree::ptree& config, bool auto_cleanup)
@@ -246,6 +322,99 @@ std::string actor_t::trace_attributes(const std::string& request_str,
   return json;
 }
 
+void actor_t::trace_attributes_batch(const std::vector<std::string>& requests,
+                                     const std::function<void(size_t, const std::string&)>& result,
+                                     const std::function<void()>* interrupt) {
+  // a trace that fails only fails itself, anything else (interrupts, exceptions from the
+  // callback) stops the whole batch
+  std::mutex result_lock;
+  pimpl->batch(requests.size(),
+               pimpl->batch_concurrency("meili.batch_concurrency", requests.size()), interrupt,
+               [&](pimpl_t& worker, size_t i) {
+                 Api api;
+                 std::string bytes;
+                 try {
+                   ParseApi(requests[i], Options::trace_attributes, api);
+                   worker.loki_worker.trace(api);
+                   bytes = worker.thor_worker.trace_attributes(api);
+                 } catch (const valhalla_exception_t& e) {
+                   bytes = serialize_error(e, api);
+                 } catch (const std::exception& e) {
+                   bytes = serialize_error({599, std::string(e.what())}, api);
+                 }
+                 // the trace has to go but the caches stay for the next one
+                 worker.loki_worker.cleanup();
+                 worker.thor_worker.cleanup();
+                 std::lock_guard<std::mutex> lock(result_lock);
+                 result(i, bytes);
+               });
+
+  if (auto_cleanup) {
+    cleanup();
+  }
+}
+
+void actor_t::locate_batch(
+    const std::string& request_str,
+    const std::function<void(const std::vector<size_t>&, const std::string&)>& result,
+    const std::function<void()>* interrupt) {
+  Api api;
+  ParseApi(request_str, Options::locate, api);
+  const auto& locations = api.options().locations();
+  if (locations.empty()) {
+    throw valhalla_exception_t{120};
+  }
+
+  // order the locations by the bin they are in so that neighbours end up in the same chunk, the
+  // search of a chunk then visits each of its bins once for all the locations in it
+  const auto& tiles = baldr::TileHierarchy::levels().back().tiles;
+  midgard::Tiles<midgard::PointLL> bins(tiles.TileBounds(), tiles.SubdivisionSize());
+  std::vector<std::pair<int32_t, size_t>> order;
+  order.reserve(locations.size());
+  for (int i = 0; i < locations.size(); ++i) {
+    const auto& ll = locations.Get(i).ll();
+    order.emplace_back(bins.TileId(midgard::PointLL(ll.lng(), ll.lat())), i);
+  }
+  std::sort(order.begin(), order.end());
+
+  // every chunk is a locate request of its own with the options of the whole batch
+  const size_t chunk_size =
+      std::max<size_t>(pimpl->config.get<size_t>("loki.batch_locations", 1000), 1);
+  const size_t chunks = (order.size() + chunk_size - 1) / chunk_size;
+  Options options = api.options();
+  options.clear_locations();
+
+  // a chunk that fails only fails itself, anything else stops the whole batch
+  std::mutex result_lock;
+  pimpl->batch(chunks, pimpl->batch_concurrency("loki.batch_concurrency", chunks), interrupt,
+               [&](pimpl_t& worker, size_t chunk) {
+                 Api chunk_api;
+                 *chunk_api.mutable_options() = options;
+                 std::vector<size_t> indices;
+                 const size_t end = std::min((chunk + 1) * chunk_size, order.size());
+                 for (size_t i = chunk * chunk_size; i < end; ++i) {
+                   indices.push_back(order[i].second);
+                   chunk_api.mutable_options()->add_locations()->CopyFrom(
+                       locations.Get(order[i].second));
+                 }
+                 std::string bytes;
+                 try {
+                   bytes = worker.loki_worker.locate(chunk_api);
+                 } catch (const valhalla_exception_t& e) {
+                   bytes = serialize_error(e, chunk_api);
+                 } catch (const std::exception& e) {
+                   bytes = serialize_error({599, std::string(e.what())}, chunk_api);
+                 }
+                 worker.loki_worker.cleanup();
+                 std::lock_guard<std::mutex> lock(result_lock);
+                 result(indices, bytes);
+               });
+
+  if (auto_cleanup) {
+    cleanup();
+  }
+}
+
 std::string
 actor_t::height(const std::string& request_str, const std::function<void()>* interrupt, Api* api) {
   // set the interrupts
@@ -12,41 +12,77 @@ using namespace valhalla::baldr::json;
 
 namespace {
 using rgba_t = std::tuple<float, float, float>;
+using contour_interval_t = valhalla::midgard::GriddedData<2>::contour_interval_t;
+
+// the supplied color or one computed from the position of the interval, without the leading #
+std::string color(const contour_interval_t& interval, size_t i, size_t count) {
+  // color was supplied
+  if (!std::get<3>(interval).empty()) {
+    return std::get<3>(interval);
+  }
+  // or we compute it..
+  std::stringstream hex;
+  auto h = i * (150.f / count);
+  auto c = .5f;
+  auto x = c * (1 - std::abs(std::fmod(h / 60.f, 2.f) - 1));
+  auto m = .25f;
+  rgba_t rgb = h < 60 ? rgba_t{m + c, m + x, m}
+                      : (h < 120 ? rgba_t{m + x, m + c, m} : rgba_t{m, m + c, m + x});
+  hex << std::hex << static_cast<int>(std::get<0>(rgb) * 255 + .5f) << std::hex
+      << static_cast<int>(std::get<1>(rgb) * 255 + .5f) << std::hex
+      << static_cast<int>(std::get<2>(rgb) * 255 + .5f);
+  return hex.str();
+}
+
+// Fills the isochrone of the request, the snapped locations are already in the options
+void serialize_pbf(valhalla::Api& request,
+                   const std::vector<contour_interval_t>& intervals,
+                   const valhalla::midgard::GriddedData<2>::contours_t& contours,
+                   bool polygons) {
+  auto* isochrone = request.mutable_isochrone();
+  isochrone->set_polygons(polygons);
+  for (size_t contour_index = 0; contour_index < intervals.size(); ++contour_index) {
+    const auto& interval = intervals[contour_index];
+    auto* pbf_interval = isochrone->add_intervals();
+    pbf_interval->set_metric(std::get<0>(interval) == 0 ? valhalla::IsochroneResult::kTime
+                                                        : valhalla::IsochroneResult::kDistance);
+    pbf_interval->set_value(std::get<1>(interval));
+    pbf_interval->set_color(color(interval, contour_index, intervals.size()));
+    for (const auto& feature : contours[contour_index]) {
+      auto* pbf_contour = pbf_interval->add_contours();
+      for (const auto& ring : feature) {
+        auto* coords = pbf_contour->add_geometries()->mutable_coords();
+        coords->Reserve(ring.size() * 2);
+        for (const auto& coord : ring) {
+          coords->Add(static_cast<int32_t>(std::round(coord.first * 1e6)));
+          coords->Add(static_cast<int32_t>(std::round(coord.second * 1e6)));
+        }
+      }
+    }
+  }
 }
+} // namespace
 
 namespace valhalla {
 namespace tyr {
 
-std::string serializeIsochrones(const Api& request,
+std::string serializeIsochrones(Api& request,
                                 std::vector<midgard::GriddedData<2>::contour_interval_t>& intervals,
                                 midgard::GriddedData<2>::contours_t& contours,
                                 bool polygons,
                                 bool show_locations) {
+  assert(intervals.size() == contours.size());
+  if (request.options().format() == Options::pbf) {
+    serialize_pbf(request, intervals, contours, polygons);
+    return serializePbf(request);
+  }
+
   // for each contour interval
-  int i = 0;
   auto features = array({});
-  assert(intervals.size() == contours.size());
   for (size_t contour_index = 0; contour_index < intervals.size(); ++contour_index) {
     const auto& interval = intervals[contour_index];
     const auto& feature_collection = contours[contour_index];
-
-    // color was supplied
-    std::stringstream hex;
-    if (!std::get<3>(interval).empty()) {
-      hex << "#" << std::get<3>(interval);
-    } // or we computed it..
-    else {
-      auto h = i * (150.f / intervals.size());
-      auto c = .5f;
-      auto x = c * (1 - std::abs(std::fmod(h / 60.f, 2.f) - 1));
-      auto m = .25f;
-      rgba_t color = h < 60 ? rgba_t{m + c, m + x, m}
-                            : (h < 120 ? rgba_t{m + x, m + c, m} : rgba_t{m, m + c, m + x});
-      hex << "#" << std::hex << static_cast<int>(std::get<0>(color) * 255 + .5f) << std::hex
-          << static_cast<int>(std::get<1>(color) * 255 + .5f) << std::hex
-          << static_cast<int>(std::get<2>(color) * 255 + .5f);
-    }
-    ++i;
+    const auto hex = "#" + color(interval, contour_index, intervals.size());
 
     // for each feature on that interval
     for (const auto& feature : feature_collection) {
@@ -76,9 +112,9 @@ std::string serializeIsochrones(const Api& request,
           {"properties", map({
                              {"metric", std::get<2>(interval)},
                              {"contour", baldr::json::float_t{std::get<1>(interval)}},
-                             {"color", hex.str()},               // lines
-                             {"fill", hex.str()},                // geojson.io polys
-                             {"fillColor", hex.str()},           // leaflet polys
+                             {"color", hex},                     // lines
+                             {"fill", hex},                      // geojson.io polys
+                             {"fillColor", hex},                 // leaflet polys
                              {"opacity", fixed_t{.33f, 2}},      // lines
                              {"fill-opacity", fixed_t{.33f, 2}}, // geojson.io polys
                              {"fillOpacity", fixed_t{.33f, 2}},  // leaflet polys
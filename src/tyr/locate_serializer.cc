@@ -181,10 +181,25 @@ json::MapPtr serialize(const midgard::PointLL& ll, const std::string& reason, bo
 namespace valhalla {
 namespace tyr {
 
-std::string serializeLocate(const Api& request,
+std::string serializeLocate(Api& request,
                             const std::vector<baldr::Location>& locations,
                             const std::unordered_map<baldr::Location, PathLocation>& projections,
                             GraphReader& reader) {
+  // the locations in the request are parallel to the input locations, we hand back their
+  // correlations and leave those without any empty
+  if (request.options().format() == Options::pbf) {
+    auto* pbf_locations = request.mutable_options()->mutable_locations();
+    for (size_t i = 0; i < locations.size(); ++i) {
+      auto found = projections.find(locations[i]);
+      if (found != projections.cend()) {
+        PathLocation::toPBF(found->second, pbf_locations->Mutable(i), reader);
+      } else {
+        pbf_locations->Mutable(i)->clear_correlation();
+      }
+    }
+    return serializePbf(request);
+  }
+
   auto json = json::array({});
   for (const auto& location : locations) {
     try {
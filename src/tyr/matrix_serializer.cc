@@ -1,4 +1,5 @@
 #include <cstdint>
+#include <limits>
 
 #include "baldr/json.h"
 #include "proto_conversions.h"
@@ -136,12 +137,39 @@ json::MapPtr serialize(const Api& request,
 }
 } // namespace valhalla_serializers
 
+namespace pbf_serializers {
+
+// Fills the matrix of the request straight from the time distances, no intermediate objects needed
+void serialize(Api& request, const std::vector<TimeDistance>& time_distances, double distance_scale) {
+  const auto& options = request.options();
+  auto* matrix = request.mutable_matrix();
+  matrix->set_sources_size(options.sources_size());
+  matrix->set_targets_size(options.targets_size());
+  matrix->mutable_times()->Reserve(time_distances.size());
+  matrix->mutable_distances()->Reserve(time_distances.size());
+  for (const auto& td : time_distances) {
+    // a route wasnt found between these two, mark it so
+    if (td.time == kMaxCost) {
+      matrix->mutable_times()->Add(std::numeric_limits<uint32_t>::max());
+      matrix->mutable_distances()->Add(0.f);
+    } else {
+      matrix->mutable_times()->Add(td.time);
+      matrix->mutable_distances()->Add(td.dist * distance_scale);
+    }
+  }
+}
+} // namespace pbf_serializers
+
 namespace valhalla {
 namespace tyr {
 
-std::string serializeMatrix(const Api& request,
+std::string serializeMatrix(Api& request,
                             const std::vector<TimeDistance>& time_distances,
                             double distance_scale) {
+  if (request.options().format() == Options::pbf) {
+    pbf_serializers::serialize(request, time_distances, distance_scale);
+    return serializePbf(request);
+  }
 
   auto json = request.options().format() == Options::osrm
                   ? osrm_serializers::serialize(request, time_distances, distance_scale)
@@ -124,24 +124,6 @@ std::string serializeStatus(Api& request) {
   return rapidjson::to_string(status_doc);
 }
 
-void route_references(json::MapPtr& route_json, const TripRoute& route, const Options& options) {
-  const bool linear_reference =
-      options.linear_references() &&
-      (options.action() == Options::trace_route || options.action() == Options::route);
-  if (!linear_reference) {
-    return;
-  }
-  json::ArrayPtr references = json::array({});
-  for (const TripLeg& leg : route.legs()) {
-    auto edge_references = openlr_edges(leg);
-    references->reserve(references->size() + edge_references.size());
-    for (const std::string& openlr : edge_references) {
-      references->emplace_back(openlr);
-    }
-  }
-  route_json->emplace("linear_references", references);
-}
-
 void openlr(const valhalla::Api& api, int route_index, rapidjson::writer_wrapper_t& writer) {
   // you have to have requested it and you have to be some kind of route response
   if (!api.options().linear_references() ||
@@ -177,6 +159,16 @@ std::string serializePbf(Api& request) {
       case Options::status:
         selection.set_status(true);
         break;
+      // the correlated locations are part of the request
+      case Options::locate:
+        selection.set_options(true);
+        break;
+      case Options::isochrone:
+        selection.set_isochrone(true);
+        break;
+      case Options::sources_to_targets:
+        selection.set_matrix(true);
+        break;
       // should never get here, actions which dont have pbf yet return json
       default:
         throw std::logic_error("Requested action is not yet serializable as pbf");
@@ -184,8 +176,7 @@ std::string serializePbf(Api& request) {
   }
 
   // if they dont want the options object but its a service request we have to work around it
-  bool skip_options = !request.options().pbf_field_selector().options() && request.has_info() &&
-                      request.info().is_service();
+  bool skip_options = !selection.options() && request.has_info() && request.info().is_service();
   Options dummy;
   if (skip_options) {
     request.mutable_options()->Swap(&dummy);
@@ -198,6 +189,10 @@ std::string serializePbf(Api& request) {
     request.clear_directions();
   if (!selection.status())
     request.clear_status();
+  if (!selection.isochrone())
+    request.clear_isochrone();
+  if (!selection.matrix())
+    request.clear_matrix();
   if (!selection.options())
     request.clear_options();
 
@@ -218,63 +213,73 @@ namespace osrm {
 
 // Serialize a location (waypoint) in OSRM compatible format. Waypoint format is described here:
 //     http://project-osrm.org/docs/v5.5.1/api/#waypoint-object
-valhalla::baldr::json::MapPtr
-waypoint(const valhalla::Location& location, bool is_tracepoint, bool is_optimized) {
+void waypoint(const valhalla::Location& location,
+              rapidjson::writer_wrapper_t& writer,
+              bool is_tracepoint,
+              bool is_optimized) {
   // Create a waypoint to add to the array
-  auto waypoint = json::map({});
+  writer.start_object();
 
   // Output location as a lon,lat array. Note this is the projected
   // lon,lat on the nearest road.
-  auto loc = json::array({});
-  loc->emplace_back(json::fixed_t{location.correlation().edges(0).ll().lng(), 6});
-  loc->emplace_back(json::fixed_t{location.correlation().edges(0).ll().lat(), 6});
-  waypoint->emplace("location", loc);
+  writer.start_array("location");
+  writer(json::fixed_t{location.correlation().edges(0).ll().lng(), 6});
+  writer(json::fixed_t{location.correlation().edges(0).ll().lat(), 6});
+  writer.end_array();
 
   // Add street name.
   std::string name =
       location.correlation().edges_size() && location.correlation().edges(0).names_size()
           ? location.correlation().edges(0).names(0)
           : "";
-  waypoint->emplace("name", name);
+  writer("name", name);
 
   // Add distance in meters from the input location to the nearest
   // point on the road used in the route
   // TODO: since distance was normalized in thor - need to recalculate here
   //       in the future we shall have store separately from score
-  waypoint->emplace("distance",
-                    json::fixed_t{to_ll(location.ll())
-                                      .Distance(to_ll(location.correlation().edges(0).ll())),
-                                  3});
+  writer("distance",
+         json::fixed_t{to_ll(location.ll()).Distance(to_ll(location.correlation().edges(0).ll())),
+                       3});
 
   // If the location was used for a tracepoint we trigger extra serialization
   if (is_tracepoint) {
-    waypoint->emplace("alternatives_count",
-                      static_cast<uint64_t>(location.correlation().edges_size() - 1));
+    writer("alternatives_count", static_cast<uint64_t>(location.correlation().edges_size() - 1));
     if (location.correlation().waypoint_index() == numeric_limits<uint32_t>::max()) {
       // when tracepoint is neither a break nor leg's starting/ending
       // point (shape_index is uint32_t max), we assign null to its waypoint_index
-      waypoint->emplace("waypoint_index", static_cast<std::nullptr_t>(nullptr));
+      writer("waypoint_index", nullptr);
     } else {
-      waypoint->emplace("waypoint_index",
-                        static_cast<uint64_t>(location.correlation().waypoint_index()));
+      writer("waypoint_index", static_cast<uint64_t>(location.correlation().waypoint_index()));
     }
-    waypoint->emplace("matchings_index", static_cast<uint64_t>(location.correlation().route_index()));
+    writer("matchings_index", static_cast<uint64_t>(location.correlation().route_index()));
   }
 
   // If the location was used for optimized route we add trips_index and waypoint
   // index (index of the waypoint in the trip)
   if (is_optimized) {
     int trips_index = 0; // TODO
-    waypoint->emplace("trips_index", static_cast<uint64_t>(trips_index));
-    waypoint->emplace("waypoint_index",
-                      static_cast<uint64_t>(location.correlation().waypoint_index()));
+    writer("trips_index", static_cast<uint64_t>(trips_index));
+    writer("waypoint_index", static_cast<uint64_t>(location.correlation().waypoint_index()));
   }
 
-  return waypoint;
+  writer.end_object();
 }
 
 // Serialize locations (called waypoints in OSRM). Waypoints are described here:
 //     http://project-osrm.org/docs/v5.5.1/api/#waypoint-object
+void waypoints(const google::protobuf::RepeatedPtrField<valhalla::Location>& locations,
+               rapidjson::writer_wrapper_t& writer,
+               bool is_tracepoint) {
+  for (const auto& location : locations) {
+    if (location.correlation().edges().size() == 0) {
+      writer(nullptr);
+    } else {
+      waypoint(location, writer, is_tracepoint);
+    }
+  }
+}
+
 json::ArrayPtr waypoints(const google::protobuf::RepeatedPtrField<valhalla::Location>& locations,
                          bool is_tracepoint) {
   auto waypoints = json::array({});
@@ -282,25 +287,27 @@ json::ArrayPtr waypoints(const google::protobuf::RepeatedPtrField<valhalla::Loca
     if (location.correlation().edges().size() == 0) {
       waypoints->emplace_back(static_cast<std::nullptr_t>(nullptr));
     } else {
-      waypoints->emplace_back(waypoint(location, is_tracepoint));
+      rapidjson::writer_wrapper_t writer(256);
+      waypoint(location, writer, is_tracepoint);
+      waypoints->emplace_back(json::RawJSON{writer.get_buffer()});
     }
   }
   return waypoints;
 }
 
-json::ArrayPtr waypoints(const valhalla::Trip& trip) {
-  auto waypoints = json::array({});
+void waypoints(const valhalla::Trip& trip, rapidjson::writer_wrapper_t& writer) {
   // For multi-route the same waypoints are used for all routes.
+  bool first = true;
   for (const auto& leg : trip.routes(0).legs()) {
     for (int i = 0; i < leg.location_size(); ++i) {
       // we skip the first location of legs > 0 because that would duplicate waypoints
-      if (i == 0 && !waypoints->empty()) {
+      if (i == 0 && !first) {
         continue;
       }
-      waypoints->emplace_back(waypoint(leg.location(i), false));
+      waypoint(leg.location(i), writer, false);
+      first = false;
     }
   }
-  return waypoints;
 }
 
 /*
@@ -310,133 +317,111 @@ json::ArrayPtr waypoints(const valhalla::Trip& trip) {
  * Then we serialize the via_waypoints object.
  *
  */
-json::ArrayPtr intermediate_waypoints(const valhalla::TripLeg& leg) {
-  // Create a vector of indexes based on the number of locations.
-  auto via_waypoints = json::array({});
+void intermediate_waypoints(const valhalla::TripLeg& leg, rapidjson::writer_wrapper_t& writer) {
+  writer.start_array("via_waypoints");
   // only loop thru the locations that are not origin or destinations
   for (const auto& loc : leg.location()) {
     // Only create via_waypoints object if the locations are via or through types
     if (loc.type() == valhalla::Location::kVia || loc.type() == valhalla::Location::kThrough) {
-      auto via_waypoint = json::map({});
-      via_waypoint->emplace("geometry_index",
-                            static_cast<uint64_t>(loc.correlation().leg_shape_index()));
-      via_waypoint->emplace("distance_from_start",
-                            json::fixed_t{loc.correlation().distance_from_leg_origin(), 3});
-      via_waypoint->emplace("waypoint_index",
-                            static_cast<uint64_t>(loc.correlation().original_index()));
-      via_waypoints->emplace_back(via_waypoint);
+      writer.start_object();
+      writer("geometry_index", static_cast<uint64_t>(loc.correlation().leg_shape_index()));
+      writer("distance_from_start",
+             json::fixed_t{loc.correlation().distance_from_leg_origin(), 3});
+      writer("waypoint_index", static_cast<uint64_t>(loc.correlation().original_index()));
+      writer.end_object();
     }
   }
-  return via_waypoints;
+  writer.end_array();
 }
 
-void serializeIncidentProperties(rapidjson::Writer<rapidjson::StringBuffer>& writer,
+void serializeIncidentProperties(rapidjson::writer_wrapper_t& writer,
                                  const valhalla::IncidentsTile::Metadata& incident_metadata,
                                  const int begin_shape_index,
                                  const int end_shape_index,
                                  const std::string& road_class,
                                  const std::string& key_prefix) {
-  writer.Key(key_prefix + "id");
-  writer.String(std::to_string(incident_metadata.id()));
+  writer(key_prefix + "id", std::to_string(incident_metadata.id()));
   {
     // Type is mandatory
-    writer.Key(key_prefix + "type");
-    writer.String(std::string(valhalla::incidentTypeToString(incident_metadata.type())));
+    writer(key_prefix + "type", valhalla::incidentTypeToString(incident_metadata.type()));
   }
   if (!incident_metadata.iso_3166_1_alpha2().empty()) {
-    writer.Key(key_prefix + "iso_3166_1_alpha2");
-    writer.String(incident_metadata.iso_3166_1_alpha2());
+    writer(key_prefix + "iso_3166_1_alpha2", incident_metadata.iso_3166_1_alpha2());
   }
   if (!incident_metadata.iso_3166_1_alpha3().empty()) {
-    writer.Key(key_prefix + "iso_3166_1_alpha3");
-    writer.String(incident_metadata.iso_3166_1_alpha3());
+    writer(key_prefix + "iso_3166_1_alpha3", incident_metadata.iso_3166_1_alpha3());
   }
   if (!incident_metadata.description().empty()) {
-    writer.Key(key_prefix + "description");
-    writer.String(incident_metadata.description());
+    writer(key_prefix + "description", incident_metadata.description());
   }
   if (!incident_metadata.long_description().empty()) {
-    writer.Key(key_prefix + "long_description");
-    writer.String(incident_metadata.long_description());
+    writer(key_prefix + "long_description", incident_metadata.long_description());
   }
   if (incident_metadata.creation_time()) {
-    writer.Key(key_prefix + "creation_time");
-    writer.String(baldr::DateTime::seconds_to_date_utc(incident_metadata.creation_time()));
+    writer(key_prefix + "creation_time",
+           baldr::DateTime::seconds_to_date_utc(incident_metadata.creation_time()));
   }
   if (incident_metadata.start_time() > 0) {
-    writer.Key(key_prefix + "start_time");
-    writer.String(baldr::DateTime::seconds_to_date_utc(incident_metadata.start_time()));
+    writer(key_prefix + "start_time",
+           baldr::DateTime::seconds_to_date_utc(incident_metadata.start_time()));
   }
   if (incident_metadata.end_time()) {
-    writer.Key(key_prefix + "end_time");
-    writer.String(baldr::DateTime::seconds_to_date_utc(incident_metadata.end_time()));
+    writer(key_prefix + "end_time",
+           baldr::DateTime::seconds_to_date_utc(incident_metadata.end_time()));
   }
   if (incident_metadata.impact()) {
-    writer.Key(key_prefix + "impact");
-    writer.String(std::string(valhalla::incidentImpactToString(incident_metadata.impact())));
+    writer(key_prefix + "impact", valhalla::incidentImpactToString(incident_metadata.impact()));
   }
   if (!incident_metadata.sub_type().empty()) {
-    writer.Key(key_prefix + "sub_type");
-    writer.String(incident_metadata.sub_type());
+    writer(key_prefix + "sub_type", incident_metadata.sub_type());
   }
   if (!incident_metadata.sub_type_description().empty()) {
-    writer.Key(key_prefix + "sub_type_description");
-    writer.String(incident_metadata.sub_type_description());
+    writer(key_prefix + "sub_type_description", incident_metadata.sub_type_description());
   }
   if (incident_metadata.alertc_codes_size() > 0) {
-    writer.Key(key_prefix + "alertc_codes");
-    writer.StartArray();
+    writer.start_array(key_prefix + "alertc_codes");
     for (const auto& alertc_code : incident_metadata.alertc_codes()) {
-      writer.Int(static_cast<uint64_t>(alertc_code));
+      writer(static_cast<int64_t>(alertc_code));
     }
-    writer.EndArray();
+    writer.end_array();
   }
   {
-    writer.Key(key_prefix + "lanes_blocked");
-    writer.StartArray();
+    writer.start_array(key_prefix + "lanes_blocked");
     for (const auto& blocked_lane : incident_metadata.lanes_blocked()) {
-      writer.String(blocked_lane);
+      writer(blocked_lane);
     }
-    writer.EndArray();
+    writer.end_array();
   }
   if (incident_metadata.num_lanes_blocked()) {
-    writer.Key(key_prefix + "num_lanes_blocked");
-    writer.Int(incident_metadata.num_lanes_blocked());
+    writer(key_prefix + "num_lanes_blocked",
+           static_cast<int64_t>(incident_metadata.num_lanes_blocked()));
   }
   if (!incident_metadata.clear_lanes().empty()) {
-    writer.Key(key_prefix + "clear_lanes");
-    writer.String(incident_metadata.clear_lanes());
+    writer(key_prefix + "clear_lanes", incident_metadata.clear_lanes());
   }
 
   if (incident_metadata.length() > 0) {
-    writer.Key(key_prefix + "length");
-    writer.Int(incident_metadata.length());
+    writer(key_prefix + "length", static_cast<int64_t>(incident_metadata.length()));
   }
 
   if (incident_metadata.road_closed()) {
-    writer.Key(key_prefix + "closed");
-    writer.Bool(incident_metadata.road_closed());
+    writer(key_prefix + "closed", incident_metadata.road_closed());
   }
   if (!road_class.empty()) {
-    writer.Key(key_prefix + "class");
-    writer.String(road_class);
+    writer(key_prefix + "class", road_class);
   }
 
   if (incident_metadata.has_congestion()) {
-    writer.Key(key_prefix + "congestion");
-    writer.StartObject();
-    writer.Key("value");
-    writer.Int(incident_metadata.congestion().value());
-    writer.EndObject();
+    writer.start_object(key_prefix + "congestion");
+    writer("value", static_cast<int64_t>(incident_metadata.congestion().value()));
+    writer.end_object();
   }
 
   if (begin_shape_index >= 0) {
-    writer.Key(key_prefix + "geometry_index_start");
-    writer.Int(begin_shape_index);
+    writer(key_prefix + "geometry_index_start", static_cast<int64_t>(begin_shape_index));
   }
   if (end_shape_index >= 0) {
-    writer.Key(key_prefix + "geometry_index_end");
-    writer.Int(end_shape_index);
+    writer(key_prefix + "geometry_index_end", static_cast<int64_t>(end_shape_index));
   }
   // TODO Add test of lanes blocked and add missing properties
 }
@@ -12,10 +12,19 @@
 
 void get_samples(valhalla::skadi::sample& sample,
                  const std::vector<std::pair<double, double>>& postings,
-                 size_t id) {
+                 size_t id,
+                 bool batched) {
   LOG_INFO("Thread" + std::to_string(id) + " sampling " + std::to_string(postings.size()) +
-           " postings");
-  auto values = sample.get_all(postings);
+           " postings " + (batched ? "in a batch" : "one at a time"));
+  std::vector<double> values;
+  if (batched) {
+    values = sample.get_all(postings);
+  } else {
+    values.reserve(postings.size());
+    for (const auto& posting : postings) {
+      values.push_back(sample.get(posting));
+    }
+  }
   size_t no_data_value = 0;
   for (auto v : values) {
     no_data_value += v == valhalla::skadi::get_no_data_value();
@@ -61,18 +70,21 @@ int main(int argc, char** argv) {
     posting_count++;
   }
 
-  // run the threads
-  auto start = std::chrono::system_clock::now();
-  std::list<std::thread> threads;
-  size_t id = 0;
-  for (const auto& p : postings) {
-    threads.emplace_back(get_samples, std::ref(sample), std::cref(p), id++);
-  }
-  for (auto& t : threads) {
-    t.join();
+  // run the threads, sampling one posting at a time and then all of them in a batch
+  for (bool batched : {false, true}) {
+    auto start = std::chrono::system_clock::now();
+    std::list<std::thread> threads;
+    size_t id = 0;
+    for (const auto& p : postings) {
+      threads.emplace_back(get_samples, std::ref(sample), std::cref(p), id++, batched);
+    }
+    for (auto& t : threads) {
+      t.join();
+    }
+    std::chrono::duration<double> elapsed = std::chrono::system_clock::now() - start;
+    LOG_INFO(std::to_string(posting_count / elapsed.count()) + " postings per second " +
+             (batched ? "in a batch" : "one at a time"));
   }
-  std::chrono::duration<double> elapsed = std::chrono::system_clock::now() - start;
-  LOG_INFO(std::to_string(posting_count / elapsed.count()) + " postings per second");
 
   return EXIT_SUCCESS;
 }
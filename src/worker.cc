@@ -568,8 +568,9 @@ void from_json(rapidjson::Document& doc, Options::Action action, Api& api) {
   // so that we serialize correctly at the end we fix up any request discrepancies
   if (options.format() == Options::pbf) {
     const std::unordered_set<Options::Action> pbf_actions{
-        Options::route,    Options::optimized_route,  Options::trace_route,
-        Options::centroid, Options::trace_attributes, Options::status,
+        Options::route,     Options::optimized_route,    Options::trace_route,
+        Options::centroid,  Options::trace_attributes,   Options::status,
+        Options::isochrone, Options::sources_to_targets, Options::locate,
     };
     // if its not a pbf supported action we reset to json
     if (pbf_actions.count(options.action()) == 0) {
@@ -1,9 +1,15 @@
 #include <functional>
+#include <mutex>
 #include <sstream>
 #include <stdexcept>
 #include <string>
+#include <thread>
+#include <unordered_set>
+#include <vector>
 
+#include "baldr/rapidjson_utils.h"
 #include "tyr/actor.h"
+#include "worker.h"
 
 #include "test.h"
 
@@ -62,6 +68,26 @@ TEST(Actor, Basic) {
 
 struct test_exception_t {};
 
+// an interrupt that never fires but records the threads a batch ran on. how many of the workers
+// get to take an item depends on the scheduler so only the upper bound is worth checking
+struct thread_recorder_t {
+  std::mutex lock;
+  std::unordered_set<std::thread::id> threads;
+  std::function<void()> interrupt = [this]() {
+    std::lock_guard<std::mutex> guard(lock);
+    threads.insert(std::this_thread::get_id());
+  };
+};
+
+// a batch only runs on more than one thread when the workers can share the tiles
+size_t max_batch_threads(size_t concurrency) {
+#ifdef ENABLE_THREAD_SAFE_TILE_REF_COUNT
+  return concurrency;
+#else
+  return 1;
+#endif
+}
+
 TEST(Actor, Route) {
   tyr::actor_t actor(conf);
   std::string request = R"({"locations":[{"lat":40.546115,"lon":-76.385076,"type":"break"},
@@ -78,6 +104,133 @@ TEST(Actor, TraceAttributes) {
   EXPECT_THROW(actor.trace_attributes(request, &interrupt), test_exception_t);
 }
 
+TEST(Actor, TraceAttributesBatch) {
+  std::vector<std::string> requests;
+  for (int i = 0; i < 12; ++i) {
+    requests.push_back(i == 5 ? R"({"shape":[],"costing":"auto"})"
+                              : R"({"shape":[{"lat":40.546115,"lon":-76.385076},
+        {"lat":40.544232,"lon":-76.385752}],"costing":"auto","shape_match":"map_snap"})");
+  }
+  tyr::actor_t single(conf, true);
+  const auto expected = single.trace_attributes(requests.front());
+
+  // with and without a reader the workers can share, the results are the same on one worker and
+  // on several
+  auto shared = [](const std::string& concurrency) {
+    return test::make_config(VALHALLA_SOURCE_DIR "test/traffic_matcher_tiles",
+                             {{"mjolnir.use_concurrent_mem_cache", "true"},
+                              {"meili.batch_concurrency", concurrency}});
+  };
+  for (const auto& concurrency : {std::make_pair(conf, size_t(1)),
+                                  std::make_pair(shared("1"), size_t(1)),
+                                  std::make_pair(shared("4"), max_batch_threads(4))}) {
+    tyr::actor_t actor(concurrency.first);
+    for (int run = 0; run < 2; ++run) {
+      std::vector<std::string> results(requests.size());
+      size_t calls = 0;
+      thread_recorder_t recorder;
+      actor.trace_attributes_batch(
+          requests,
+          [&](size_t i, const std::string& result) {
+            ++calls;
+            results[i] = result;
+          },
+          &recorder.interrupt);
+      ASSERT_EQ(calls, requests.size());
+      EXPECT_GE(recorder.threads.size(), 1);
+      EXPECT_LE(recorder.threads.size(), concurrency.second);
+      for (size_t i = 0; i < requests.size(); ++i) {
+        if (i == 5) {
+          // a broken trace only breaks itself
+          EXPECT_NE(results[i].find("error_code"), std::string::npos);
+        } else {
+          EXPECT_EQ(results[i], expected) << i;
+        }
+      }
+    }
+  }
+
+  tyr::actor_t actor(conf);
+  std::function<void()> interrupt = [] { throw test_exception_t{}; };
+  EXPECT_THROW(actor.trace_attributes_batch(requests, [](size_t, const std::string&) {}, &interrupt),
+               test_exception_t);
+}
+
+TEST(Actor, LocateBatch) {
+  // a grid of locations around pine grove, listed out of order
+  std::vector<std::string> locations;
+  for (int i = 0; i < 30; ++i) {
+    int x = (i * 7) % 6, y = (i * 11) % 5;
+    locations.push_back("{\"lat\":" + std::to_string(40.540 + y * 0.002) + ",\"lon\":" +
+                        std::to_string(-76.392 + x * 0.003) + "}");
+  }
+  std::string request = R"({"costing":"auto","verbose":true,"locations":[)";
+  for (const auto& location : locations) {
+    request += (&location == &locations.front() ? "" : ",") + location;
+  }
+  request += "]}";
+
+  // what each of them gets when located on its own
+  tyr::actor_t single(conf, true);
+  std::vector<std::string> expected;
+  for (const auto& location : locations) {
+    rapidjson::Document response;
+    auto json = single.locate(R"({"costing":"auto","verbose":true,"locations":[)" + location + "]}");
+    response.Parse(json.c_str());
+    ASSERT_TRUE(response.IsArray());
+    expected.push_back(rapidjson::to_string(response[0]));
+  }
+
+  // with and without a reader the workers can share, the results are the same on one worker and
+  // on several
+  auto shared = [](const std::string& concurrency) {
+    return test::make_config(VALHALLA_SOURCE_DIR "test/traffic_matcher_tiles",
+                             {{"mjolnir.use_concurrent_mem_cache", "true"},
+                              {"loki.batch_locations", "7"},
+                              {"loki.batch_concurrency", concurrency}});
+  };
+  for (const auto& concurrency :
+       {std::make_pair(test::make_config(VALHALLA_SOURCE_DIR "test/traffic_matcher_tiles",
+                                         {{"loki.batch_locations", "7"}}),
+                       size_t(1)),
+        std::make_pair(shared("1"), size_t(1)), std::make_pair(shared("3"), max_batch_threads(3))}) {
+    tyr::actor_t actor(concurrency.first);
+    std::vector<std::string> results(locations.size());
+    size_t chunks = 0;
+    thread_recorder_t recorder;
+    actor.locate_batch(
+        request,
+        [&](const std::vector<size_t>& indices, const std::string& result) {
+          ++chunks;
+          EXPECT_LE(indices.size(), 7);
+          rapidjson::Document response;
+          response.Parse(result.c_str());
+          ASSERT_TRUE(response.IsArray());
+          ASSERT_EQ(response.Size(), indices.size());
+          for (size_t i = 0; i < indices.size(); ++i) {
+            EXPECT_TRUE(results[indices[i]].empty()) << "located twice " << indices[i];
+            results[indices[i]] = rapidjson::to_string(response[i]);
+          }
+        },
+        &recorder.interrupt);
+    EXPECT_EQ(chunks, 5);
+    EXPECT_GE(recorder.threads.size(), 1);
+    EXPECT_LE(recorder.threads.size(), concurrency.second);
+    for (size_t i = 0; i < locations.size(); ++i) {
+      EXPECT_EQ(results[i], expected[i]) << i;
+    }
+  }
+
+  tyr::actor_t actor(conf);
+  std::function<void()> interrupt = [] { throw test_exception_t{}; };
+  EXPECT_THROW(actor.locate_batch(request, [](const std::vector<size_t>&, const std::string&) {},
+                                  &interrupt),
+               test_exception_t);
+  EXPECT_THROW(actor.locate_batch(R"({"costing":"auto","locations":[]})",
+                                  [](const std::vector<size_t>&, const std::string&) {}),
+               valhalla_exception_t);
+}
+
 // TODO: test the rest of them
 
 } // namespace
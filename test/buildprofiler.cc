@@ -0,0 +1,111 @@
+#include "mjolnir/buildprofiler.h"
+#include "baldr/rapidjson_utils.h"
+#include "filesystem.h"
+#include "midgard/util.h"
+
+#include <chrono>
+#include <string>
+#include <thread>
+#include <unordered_set>
+
+#include <boost/property_tree/ptree.hpp>
+
+#include "test.h"
+
+using namespace valhalla::mjolnir;
+
+namespace {
+
+TEST(BuildProfiler, Stages) {
+  BuildProfiler profiler;
+  profiler.EndStage(BuildStage::kInitialize);
+
+  // Keep a worker busy so its thread reports cpu time
+  std::thread thread([]() {
+    BuildProfiler::WorkerScope worker("Worker");
+    volatile uint64_t sum = 0;
+    for (uint64_t i = 0; i < 20000000; ++i) {
+      sum = sum + i;
+    }
+  });
+  thread.join();
+  profiler.EndStage(BuildStage::kBuild);
+
+  const auto& stages = profiler.stages();
+  ASSERT_EQ(stages.size(), 2);
+  EXPECT_EQ(stages[0].stage, BuildStage::kInitialize);
+  EXPECT_TRUE(stages[0].workers.empty());
+  EXPECT_EQ(stages[1].stage, BuildStage::kBuild);
+  ASSERT_EQ(stages[1].workers.size(), 1);
+  EXPECT_EQ(stages[1].workers[0].name, "Worker");
+  EXPECT_GT(stages[1].workers[0].wall_seconds, 0);
+  EXPECT_GE(stages[1].cpu_seconds, stages[1].workers[0].cpu_seconds * 0.5);
+  for (const auto& stage : stages) {
+    EXPECT_GE(stage.wall_seconds, 0);
+    EXPECT_GE(stage.cpu_seconds, 0);
+  }
+}
+
+TEST(BuildProfiler, ScopesOfAThreadAddUp) {
+  BuildProfiler profiler;
+  // A scope per item, the items of one thread make one worker
+  valhalla::midgard::parallel_for(3, 30, [](size_t, size_t) {
+    BuildProfiler::WorkerScope scope("Item");
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  });
+  { BuildProfiler::WorkerScope scope("Other"); }
+  profiler.EndStage(BuildStage::kHierarchy);
+
+  ASSERT_EQ(profiler.stages().size(), 1);
+  const auto& workers = profiler.stages()[0].workers;
+  std::unordered_set<std::thread::id> threads;
+  double wall_seconds = 0;
+  for (const auto& worker : workers) {
+    if (worker.name == "Item") {
+      EXPECT_TRUE(threads.insert(worker.thread).second);
+      wall_seconds += worker.wall_seconds;
+    }
+  }
+  EXPECT_GE(threads.size(), 1);
+  EXPECT_LE(threads.size(), 3);
+  EXPECT_EQ(workers.size(), threads.size() + 1);
+  EXPECT_GE(wall_seconds, 0.03);
+}
+
+TEST(BuildProfiler, WorkerWithoutProfiler) {
+  // Workers outside of a profiled build are not recorded anywhere
+  { BuildProfiler::WorkerScope worker("Worker"); }
+  BuildProfiler profiler;
+  profiler.EndStage(BuildStage::kEnhance);
+  ASSERT_EQ(profiler.stages().size(), 1);
+  EXPECT_TRUE(profiler.stages()[0].workers.empty());
+}
+
+TEST(BuildProfiler, Report) {
+  const std::string report_file = "test_build_report.json";
+  {
+    BuildProfiler profiler;
+    profiler.EndStage(BuildStage::kParseWays);
+    { BuildProfiler::WorkerScope worker("GraphValidator"); }
+    profiler.EndStage(BuildStage::kValidate);
+    ASSERT_TRUE(profiler.WriteReport(report_file));
+  }
+
+  boost::property_tree::ptree report;
+  rapidjson::read_json(report_file, report);
+  auto stages = report.get_child("stages");
+  ASSERT_EQ(stages.size(), 2);
+  EXPECT_EQ(stages.front().second.get<std::string>("stage"), "parseways");
+  EXPECT_EQ(stages.back().second.get<std::string>("stage"), "validate");
+  auto workers = stages.back().second.get_child("workers");
+  ASSERT_EQ(workers.size(), 1);
+  EXPECT_EQ(workers.front().second.get<std::string>("name"), "GraphValidator");
+  for (const auto& key : {"wall_seconds", "cpu_seconds", "utilization", "peak_memory", "bytes_read",
+                          "bytes_written"}) {
+    EXPECT_TRUE(report.get_optional<double>(key)) << key;
+    EXPECT_TRUE(stages.front().second.get_optional<double>(key)) << key;
+  }
+  filesystem::remove(report_file);
+}
+
+} // namespace
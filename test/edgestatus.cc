@@ -66,6 +66,41 @@ TEST(EdgeStatus, TestStatus) {
   TryGet(edgestatus, GraphId(555, 3, 1), EdgeSet::kUnreachedOrReset);
 }
 
+TEST(EdgeStatus, ReuseAfterClear) {
+  EdgeStatus edgestatus;
+
+  GraphTileHeader header;
+  header.set_directededgecount(1000);
+  test_tile* tt = new test_tile;
+  tt->header_ = &header;
+  graph_tile_ptr tile{tt};
+
+  // a few rounds of the same worker doing searches over overlapping tiles
+  for (uint32_t round = 0; round < 5; ++round) {
+    edgestatus.Set(GraphId(round, 2, 10), EdgeSet::kTemporary, round, tile);
+    edgestatus.Set(GraphId(round + 1, 2, 20), EdgeSet::kPermanent, round + 1, tile);
+    edgestatus.Set(GraphId(round, 2, 10), EdgeSet::kTemporary, round + 7, tile, 3);
+    edgestatus.Update(GraphId(round, 2, 10), EdgeSet::kPermanent);
+
+    EXPECT_EQ(edgestatus.Get(GraphId(round, 2, 10)).set(), EdgeSet::kPermanent);
+    EXPECT_EQ(edgestatus.Get(GraphId(round, 2, 10)).index(), round);
+    EXPECT_EQ(edgestatus.Get(GraphId(round + 1, 2, 20)).index(), round + 1);
+    EXPECT_EQ(edgestatus.Get(GraphId(round, 2, 10), 3).set(), EdgeSet::kTemporary);
+    EXPECT_EQ(edgestatus.Get(GraphId(round, 2, 10), 3).index(), round + 7);
+
+    // arrays handed out again must not leak what the previous round left in them
+    TryGet(edgestatus, GraphId(round, 2, 20), EdgeSet::kUnreachedOrReset);
+    TryGet(edgestatus, GraphId(round + 1, 2, 10), EdgeSet::kUnreachedOrReset);
+    TryGet(edgestatus, GraphId(round + 2, 2, 20), EdgeSet::kUnreachedOrReset);
+    EXPECT_EQ(edgestatus.GetPtr(GraphId(round, 2, 20), tile)->set(), EdgeSet::kUnreachedOrReset);
+
+    edgestatus.clear();
+    TryGet(edgestatus, GraphId(round, 2, 10), EdgeSet::kUnreachedOrReset);
+    TryGet(edgestatus, GraphId(round + 1, 2, 20), EdgeSet::kUnreachedOrReset);
+    EXPECT_THROW(edgestatus.Update(GraphId(round, 2, 10), EdgeSet::kPermanent), std::runtime_error);
+  }
+}
+
 } // namespace
 
 int main(int argc, char* argv[]) {
@@ -1,11 +1,14 @@
 #include <cstdint>
+#include <cstring>
 
 #include "baldr/connectivity_map.h"
 #include "baldr/graphreader.h"
 #include "baldr/tilehierarchy.h"
 #include "filesystem.h"
 
+#include <atomic>
 #include <fcntl.h>
+#include <thread>
 
 #include "test.h"
 
@@ -880,6 +883,209 @@ TEST(CacheLruSoft, TrimOnExactlyFullCache) {
   CheckGraphTile(cache.Get(tile2_id), tile2_id, tile2_size);
 }
 
+TEST(ConcurrentCache, PutGetClear) {
+  ConcurrentTileCache cache(400, 4);
+
+  GraphId id1(100, 2, 0);
+  auto tile1 = cache.Put(id1, graph_tile_ptr{new TestGraphTile(id1, 123)}, 123);
+  EXPECT_EQ(cache.Get(id1), tile1);
+  CheckGraphTile(tile1, id1, 123);
+  EXPECT_FALSE(cache.OverCommitted());
+
+  GraphId id2(300, 1, 0);
+  auto tile2 = cache.Put(id2, graph_tile_ptr{new TestGraphTile(id2, 200)}, 200);
+  EXPECT_EQ(cache.Get(id2), tile2);
+  EXPECT_FALSE(cache.OverCommitted());
+
+  GraphId id3(1000, 0, 0);
+  auto tile3 = cache.Put(id3, graph_tile_ptr{new TestGraphTile(id3, 500)}, 500);
+  EXPECT_EQ(cache.Get(id3), tile3);
+  EXPECT_TRUE(cache.OverCommitted());
+
+  // the first put wins, later ones get the cached copy back
+  auto again = cache.Put(id1, graph_tile_ptr{new TestGraphTile(id1, 123)}, 123);
+  EXPECT_EQ(again, tile1);
+
+  EXPECT_TRUE(cache.Contains(id1));
+  EXPECT_TRUE(cache.Contains(id2));
+  EXPECT_TRUE(cache.Contains(id3));
+  EXPECT_FALSE(cache.Contains({101, 2, 0}));
+
+  cache.Clear();
+
+  EXPECT_FALSE(cache.OverCommitted());
+  EXPECT_FALSE(cache.Contains(id1));
+  EXPECT_FALSE(cache.Contains(id2));
+  EXPECT_FALSE(cache.Contains(id3));
+  EXPECT_EQ(cache.Get(id1), nullptr);
+  EXPECT_EQ(cache.Get(id2), nullptr);
+  EXPECT_EQ(cache.Get(id3), nullptr);
+
+  // what we handed out before the clear is still alive
+  CheckGraphTile(tile3, id3, 500);
+}
+
+TEST(ConcurrentCache, TrimUntilNotOvercommitted) {
+  ConcurrentTileCache cache(1000, 8);
+  for (uint32_t i = 0; i < 16; ++i) {
+    GraphId id(i, 2, 0);
+    cache.Put(id, graph_tile_ptr{new TestGraphTile(id, 100)}, 100);
+  }
+  EXPECT_TRUE(cache.OverCommitted());
+
+  cache.Trim();
+  EXPECT_FALSE(cache.OverCommitted());
+
+  // two tiles per shard, whole shards are evicted until we fit
+  size_t remaining = 0;
+  for (uint32_t i = 0; i < 16; ++i) {
+    remaining += cache.Contains({i, 2, 0});
+  }
+  EXPECT_EQ(remaining, 10);
+}
+
+TEST(ConcurrentCache, CopiesShareTiles) {
+  ConcurrentTileCache cache(1000, 2);
+  ConcurrentTileCache other(cache);
+
+  GraphId id(42, 2, 0);
+  auto tile = cache.Put(id, graph_tile_ptr{new TestGraphTile(id, 100)}, 100);
+  EXPECT_EQ(other.Get(id), tile);
+
+  other.Clear();
+  EXPECT_FALSE(cache.Contains(id));
+}
+
+#ifdef ENABLE_THREAD_SAFE_TILE_REF_COUNT
+TEST(ConcurrentCache, ReadWhileClearing) {
+  ConcurrentTileCache cache(1000000, 16);
+  std::atomic<bool> done{false};
+  std::vector<std::thread> readers;
+  for (size_t t = 0; t < 4; ++t) {
+    readers.emplace_back([&cache, &done]() {
+      while (!done) {
+        for (uint32_t i = 0; i < 64; ++i) {
+          GraphId id(i, 2, 0);
+          auto tile = cache.Get(id);
+          if (!tile)
+            tile = cache.Put(id, graph_tile_ptr{new TestGraphTile(id, 100)}, 100);
+          CheckGraphTile(tile, id, 100);
+        }
+      }
+    });
+  }
+
+  for (size_t i = 0; i < 1000; ++i) {
+    cache.Clear();
+  }
+  done = true;
+  for (auto& reader : readers) {
+    reader.join();
+  }
+}
+#endif
+
+TEST(GraphReader, MmapTileFiles) {
+  boost::property_tree::ptree pt;
+  pt.put("tile_dir", "test/data/utrecht_tiles");
+  GraphReader reader(pt);
+  pt.put("mmap_tile_files", true);
+  GraphReader mapped_reader(pt);
+
+  auto tile_ids = reader.GetTileSet();
+  ASSERT_FALSE(tile_ids.empty());
+  for (const auto& tile_id : tile_ids) {
+    auto tile = reader.GetGraphTile(tile_id);
+    auto mapped = mapped_reader.GetGraphTile(tile_id);
+    ASSERT_NE(tile, nullptr);
+    ASSERT_NE(mapped, nullptr);
+    EXPECT_FALSE(tile->mapped());
+    EXPECT_TRUE(mapped->mapped());
+
+    // the same bytes, just not on the heap
+    ASSERT_EQ(tile->header()->end_offset(), mapped->header()->end_offset());
+    EXPECT_EQ(std::memcmp(tile->header(), mapped->header(), tile->header()->end_offset()), 0);
+    EXPECT_EQ(tile->header()->directededgecount(), mapped->header()->directededgecount());
+  }
+}
+
+TEST(GraphReader, CompressedTileExtract) {
+  boost::property_tree::ptree pt;
+  pt.put("tile_dir", "test/data/utrecht_tiles");
+  GraphReader reader(pt);
+  pt.put("tile_extract", "test/data/utrecht_tiles/tiles_compressed.tar");
+  GraphReader compressed_reader(pt);
+
+  // every tile of the extract is decoded to the same bytes as the tile file
+  auto tile_ids = reader.GetTileSet();
+  ASSERT_EQ(compressed_reader.GetTileSet(), tile_ids);
+  for (const auto& tile_id : tile_ids) {
+    auto tile = reader.GetGraphTile(tile_id);
+    auto compressed = compressed_reader.GetGraphTile(tile_id);
+    ASSERT_NE(compressed, nullptr);
+    EXPECT_FALSE(compressed->mapped());
+    ASSERT_EQ(tile->header()->end_offset(), compressed->header()->end_offset());
+    EXPECT_EQ(std::memcmp(tile->header(), compressed->header(), tile->header()->end_offset()), 0);
+  }
+}
+
+TEST(GraphReader, PrefetchTilesAhead) {
+  boost::property_tree::ptree pt;
+  pt.put("tile_dir", "test/data/utrecht_tiles");
+  pt.put("tile_prefetch", true);
+  GraphReader reader(pt);
+
+  // find two tiles next to each other on the same level
+  auto tile_ids = reader.GetTileSet();
+  GraphId from, to;
+  for (const auto& tile_id : tile_ids) {
+    if (tile_id.level() >= TileHierarchy::levels().size()) {
+      continue;
+    }
+    const auto& tiles = TileHierarchy::levels()[tile_id.level()].tiles;
+    GraphId right(tiles.RightNeighbor(tile_id.tileid()), tile_id.level(), 0);
+    if (tile_ids.count(right)) {
+      from = tile_id;
+      to = right;
+      break;
+    }
+  }
+  ASSERT_TRUE(from.Is_Valid());
+
+  // heading east prefetches the tile to the right but not the one we are in
+  const auto& tiles = TileHierarchy::levels()[from.level()].tiles;
+  reader.Prefetch(tiles.Center(from.tileid()), tiles.Center(to.tileid()), from.level());
+  auto stats = reader.GetPrefetchStats();
+  EXPECT_GE(stats.issued, 1);
+  EXPECT_LE(stats.issued, 3);
+  EXPECT_EQ(stats.hits, 0);
+  EXPECT_EQ(stats.misses, 0);
+
+  // nothing is prefetched twice
+  reader.Prefetch(tiles.Center(from.tileid()), tiles.Center(to.tileid()), from.level());
+  EXPECT_EQ(reader.GetPrefetchStats().issued, stats.issued);
+
+  ASSERT_NE(reader.GetGraphTile(to), nullptr);
+  ASSERT_NE(reader.GetGraphTile(from), nullptr);
+  stats = reader.GetPrefetchStats();
+  EXPECT_EQ(stats.hits, 1);
+  EXPECT_EQ(stats.misses, 1);
+
+  // cached tiles aren't prefetched and cache hits aren't counted
+  reader.Prefetch(tiles.Center(to.tileid()), tiles.Center(from.tileid()), from.level());
+  ASSERT_NE(reader.GetGraphTile(from), nullptr);
+  EXPECT_EQ(reader.GetPrefetchStats().hits, 1);
+  EXPECT_EQ(reader.GetPrefetchStats().misses, 1);
+
+  // without the option nothing happens
+  pt.put("tile_prefetch", false);
+  GraphReader plain_reader(pt);
+  plain_reader.Prefetch(tiles.Center(from.tileid()), tiles.Center(to.tileid()), from.level());
+  ASSERT_NE(plain_reader.GetGraphTile(to), nullptr);
+  stats = plain_reader.GetPrefetchStats();
+  EXPECT_EQ(stats.issued + stats.hits + stats.misses, 0);
+}
+
 } // namespace
 
 int main(int argc, char* argv[]) {
@@ -2,6 +2,8 @@
 
 #include "baldr/graphtile.h"
 
+#include <cstring>
+#include <lz4frame.h>
 #include <vector>
 
 #include "test.h"
@@ -122,6 +124,35 @@ TEST(GraphTileIntegrity, SizeLessThanPayload) {
                std::runtime_error);
 }
 
+TEST(GraphTile, DecompressLZ4) {
+  size_t tile_size = 100000;
+  GraphTileHeader header;
+  header.set_end_offset(tile_size);
+  std::vector<char> tile_data(tile_size);
+  for (size_t i = sizeof(header); i < tile_size; ++i) {
+    tile_data[i] = static_cast<char>(i % 7);
+  }
+  memcpy(tile_data.data(), &header, sizeof(header));
+
+  // with and without the tile size in the frame header
+  for (bool store_size : {true, false}) {
+    LZ4F_preferences_t prefs{};
+    prefs.frameInfo.contentSize = store_size ? tile_size : 0;
+    std::vector<char> frame(LZ4F_compressFrameBound(tile_size, &prefs));
+    auto frame_size = LZ4F_compressFrame(frame.data(), frame.size(), tile_data.data(), tile_size,
+                                         &prefs);
+    ASSERT_FALSE(LZ4F_isError(frame_size));
+
+    auto tile = GraphTile::DecompressLZ4(GraphId(), frame.data(), frame_size);
+    ASSERT_NE(tile, nullptr);
+    ASSERT_EQ(tile->header()->end_offset(), tile_size);
+    EXPECT_EQ(memcmp(tile->header(), tile_data.data(), tile_size), 0);
+
+    // a cut off frame is no tile
+    EXPECT_EQ(GraphTile::DecompressLZ4(GraphId(), frame.data(), frame_size / 2), nullptr);
+  }
+}
+
 } // namespace
 
 int main(int argc, char* argv[]) {
@@ -0,0 +1,209 @@
+#include "gurka.h"
+#include "test.h"
+
+#include "baldr/contractionhierarchy.h"
+#include "loki/search.h"
+#include "sif/costfactory.h"
+#include "thor/contraction_query.h"
+
+#include <boost/format.hpp>
+#include <sys/stat.h>
+
+using namespace valhalla;
+
+class ContractionHierarchyTest : public ::testing::Test {
+protected:
+  static gurka::map map;
+  static gurka::map plain_map;
+
+  static void SetUpTestSuite() {
+    const std::string ascii_map = R"(
+      A----B----C----D----E
+      |    |    |    |    |
+      F----G----H----I----J
+      |    |    |    |    |
+      K----L----M----N----O
+      |    |    |    |    |
+      P----Q----R----S----T
+    )";
+
+    const gurka::ways ways = {
+        {"ABCDE", {{"highway", "primary"}}},
+        {"FGHIJ", {{"highway", "residential"}}},
+        {"KLM", {{"highway", "secondary"}}},
+        {"MNO", {{"highway", "secondary"}}},
+        {"PQRST", {{"highway", "residential"}}},
+        {"AFKP", {{"highway", "tertiary"}}},
+        {"BGLQ", {{"highway", "residential"}}},
+        {"CH", {{"highway", "residential"}, {"oneway", "yes"}}},
+        {"HM", {{"highway", "residential"}}},
+        {"MR", {{"highway", "residential"}}},
+        {"DINS", {{"highway", "residential"}}},
+        {"EJOT", {{"highway", "tertiary"}}},
+    };
+
+    const gurka::relations relations = {
+        {{
+             {gurka::way_member, "MNO", "from"},
+             {gurka::way_member, "MR", "to"},
+             {gurka::node_member, "M", "via"},
+         },
+         {
+             {"type", "restriction"},
+             {"restriction", "no_left_turn"},
+         }},
+    };
+
+    const auto layout = gurka::detail::map_to_coordinates(ascii_map, 100);
+    const std::string workdir = "test/data/contraction_hierarchy";
+    map = gurka::buildtiles(layout, ways, {}, relations, workdir,
+                            {{"mjolnir.concurrency", "1"},
+                             {"mjolnir.contraction_hierarchy", workdir + "/hierarchy.bin"}});
+
+    // the same tiles without the hierarchy to compare against
+    plain_map = map;
+    plain_map.config.get_child("mjolnir").erase("contraction_hierarchy");
+  }
+};
+
+gurka::map ContractionHierarchyTest::map = {};
+gurka::map ContractionHierarchyTest::plain_map = {};
+
+TEST_F(ContractionHierarchyTest, BuiltWithTiles) {
+  struct stat s;
+  ASSERT_EQ(stat(map.config.get<std::string>("mjolnir.contraction_hierarchy").c_str(), &s), 0);
+  EXPECT_GT(static_cast<size_t>(s.st_size), sizeof(baldr::ContractionHeader));
+}
+
+TEST_F(ContractionHierarchyTest, MatchesBidirectionalAStar) {
+  const std::vector<std::string> names = {"A", "C", "E", "G", "I", "K", "M", "O", "Q", "S", "T"};
+  size_t hierarchy_routes = 0;
+  for (const auto& from : names) {
+    for (const auto& to : names) {
+      if (from == to) {
+        continue;
+      }
+      auto expected = gurka::do_action(valhalla::Options::route, plain_map, {from, to}, "auto");
+      auto result = gurka::do_action(valhalla::Options::route, map, {from, to}, "auto");
+      const auto& leg = result.trip().routes(0).legs(0);
+      const auto& expected_leg = expected.trip().routes(0).legs(0);
+      // locations on the same or on connected edges are left to time dependent a*, everything
+      // else uses the hierarchy and it never has to fall back to bidirectional a*
+      EXPECT_TRUE(leg.algorithms(0) == "contraction_hierarchy" ||
+                  leg.algorithms(0) == "time_dependent_forward_a*")
+          << from << " -> " << to << " used " << leg.algorithms(0);
+      hierarchy_routes += leg.algorithms(0) == "contraction_hierarchy";
+      EXPECT_EQ(gurka::detail::get_paths(result), gurka::detail::get_paths(expected))
+          << from << " -> " << to;
+      EXPECT_NEAR(leg.node().rbegin()->cost().elapsed_cost().seconds(),
+                  expected_leg.node().rbegin()->cost().elapsed_cost().seconds(), 0.1)
+          << from << " -> " << to;
+    }
+  }
+  EXPECT_GT(hierarchy_routes, 0);
+}
+
+TEST_F(ContractionHierarchyTest, SameEdge) {
+  // the route action never sends these to the hierarchy but the query has to get them right too
+  baldr::GraphReader reader(map.config.get_child("mjolnir"));
+  Options options;
+  rapidjson::Document doc;
+  sif::ParseCosting(doc, "/costing_options", options);
+  options.set_costing_type(Costing::auto_);
+  sif::TravelMode mode = sif::TravelMode::kDrive;
+  auto mode_costing = sif::CostFactory().CreateModeCosting(options, mode);
+
+  // a quarter and three quarters of the way from B to C
+  const auto& b = map.nodes.at("B");
+  const auto& c = map.nodes.at("C");
+  std::vector<baldr::Location> points{baldr::Location(b.PointAlongSegment(c, 0.25)),
+                                      baldr::Location(b.PointAlongSegment(c, 0.75))};
+  auto found = loki::Search(points, reader, mode_costing[static_cast<uint32_t>(mode)]);
+  std::vector<valhalla::Location> locations(2);
+  for (size_t i = 0; i < points.size(); ++i) {
+    baldr::PathLocation::toPBF(found.at(points[i]), &locations[i], reader);
+  }
+  auto bc = std::get<0>(gurka::findEdgeByNodes(reader, map.nodes, "B", "C"));
+  auto cb = std::get<0>(gurka::findEdgeByNodes(reader, map.nodes, "C", "B"));
+
+  // straight along the edge instead of turning around somewhere
+  thor::ContractionQuery query(map.config);
+  auto paths = query.GetBestPath(locations[0], locations[1], reader, mode_costing, mode, options);
+  ASSERT_EQ(paths.size(), 1);
+  ASSERT_EQ(paths.front().size(), 1);
+  EXPECT_EQ(paths.front().front().edgeid, bc);
+  query.Clear();
+
+  // and the other way around
+  paths = query.GetBestPath(locations[1], locations[0], reader, mode_costing, mode, options);
+  ASSERT_EQ(paths.size(), 1);
+  ASSERT_EQ(paths.front().size(), 1);
+  EXPECT_EQ(paths.front().front().edgeid, cb);
+}
+
+TEST_F(ContractionHierarchyTest, RespectsRestrictionsAndOneways) {
+  // no left from MNO onto MR
+  auto result = gurka::do_action(valhalla::Options::route, map, {"O", "R"}, "auto");
+  auto expected = gurka::do_action(valhalla::Options::route, plain_map, {"O", "R"}, "auto");
+  EXPECT_EQ(gurka::detail::get_paths(result), gurka::detail::get_paths(expected));
+  EXPECT_NE(gurka::detail::get_paths(result).front(), std::vector<std::string>({"MNO", "MR"}));
+
+  // CH is oneway towards H
+  result = gurka::do_action(valhalla::Options::route, map, {"H", "C"}, "auto");
+  for (const auto& name : gurka::detail::get_paths(result).front()) {
+    EXPECT_NE(name, "CH");
+  }
+}
+
+TEST_F(ContractionHierarchyTest, OtherProfilesUseBidirectionalAStar) {
+  auto result = gurka::do_action(valhalla::Options::route, map, {"A", "T"}, "auto",
+                                 {{"/costing_options/auto/use_highways", "0.1"}});
+  EXPECT_EQ(result.trip().routes(0).legs(0).algorithms(0), "bidirectional_a*");
+
+  result = gurka::do_action(valhalla::Options::route, map, {"A", "T"}, "bicycle");
+  EXPECT_EQ(result.trip().routes(0).legs(0).algorithms(0), "bidirectional_a*");
+}
+
+TEST_F(ContractionHierarchyTest, BucketMatrix) {
+  auto bucket_map = map;
+  bucket_map.config.put("thor.source_to_target_algorithm", "bucket_matrix");
+  auto cost_map = map;
+  cost_map.config.put("thor.source_to_target_algorithm", "costmatrix");
+
+  const std::vector<std::string> names = {"A", "E", "G", "M", "O", "P", "T"};
+  std::string locations;
+  for (const auto& name : names) {
+    const auto& ll = map.nodes.at(name);
+    locations += (locations.empty() ? "" : ",") +
+                 (boost::format(R"({"lat":%s,"lon":%s})") % std::to_string(ll.lat()) %
+                  std::to_string(ll.lng()))
+                     .str();
+  }
+  const auto request = R"({"sources":[)" + locations + R"(],"targets":[)" + locations +
+                       R"(],"costing":"auto"})";
+
+  std::string bucket_json, cost_json;
+  gurka::do_action(valhalla::Options::sources_to_targets, bucket_map, request, {}, &bucket_json);
+  gurka::do_action(valhalla::Options::sources_to_targets, cost_map, request, {}, &cost_json);
+  rapidjson::Document bucket, cost;
+  bucket.Parse(bucket_json.c_str());
+  cost.Parse(cost_json.c_str());
+  ASSERT_FALSE(bucket.HasParseError());
+  ASSERT_FALSE(cost.HasParseError());
+
+  for (size_t i = 0; i < names.size(); ++i) {
+    for (size_t j = 0; j < names.size(); ++j) {
+      const auto& b = bucket["sources_to_targets"][i][j];
+      const auto& c = cost["sources_to_targets"][i][j];
+      ASSERT_TRUE(b["time"].IsNumber()) << names[i] << " -> " << names[j];
+      if (i == j) {
+        EXPECT_EQ(b["time"].GetDouble(), 0) << names[i];
+        continue;
+      }
+      // the paths are recosted with turn costs and restrictions so they are the same
+      EXPECT_EQ(b["time"].GetDouble(), c["time"].GetDouble()) << names[i] << " -> " << names[j];
+      EXPECT_EQ(b["distance"].GetDouble(), c["distance"].GetDouble())
+          << names[i] << " -> " << names[j];
+    }
+  }
+}
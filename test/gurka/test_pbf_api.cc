@@ -138,3 +138,113 @@ TEST(pbf_api, pbf_error) {
     api.mutable_options()->set_action(Options::route);
   }
 }
+
+TEST(pbf_api, pbf_matrix_isochrone_locate) {
+  const std::string ascii_map = R"(
+    A---B---C
+    |   |   |
+    D---E---F
+    |   |   |
+    G---H---I)";
+
+  const gurka::ways ways = {
+      {"ABC", {{"highway", "residential"}}}, {"DEF", {{"highway", "residential"}}},
+      {"GHI", {{"highway", "residential"}}}, {"ADG", {{"highway", "residential"}}},
+      {"BEH", {{"highway", "residential"}}}, {"CFI", {{"highway", "residential"}}},
+  };
+  const auto layout = gurka::detail::map_to_coordinates(ascii_map, 100);
+  auto map = gurka::buildtiles(layout, ways, {}, {}, "test/data/gurka_api_pbf_out");
+
+  auto location = [&map](const std::string& name) {
+    const auto& ll = map.nodes.at(name);
+    return R"({"lat":)" + std::to_string(ll.lat()) + R"(,"lon":)" + std::to_string(ll.lng()) + "}";
+  };
+  const std::string locations = location("A") + "," + location("C") + "," + location("I");
+
+  // the matrix holds the same times and distances as the json
+  const auto matrix_request = R"({"sources":[)" + locations + R"(],"targets":[)" + locations +
+                              R"(],"costing":"pedestrian")";
+  std::string json, pbf;
+  gurka::do_action(Options::sources_to_targets, map, matrix_request + "}", {}, &json);
+  gurka::do_action(Options::sources_to_targets, map, matrix_request + R"(,"format":"pbf"})", {},
+                   &pbf);
+  rapidjson::Document doc;
+  doc.Parse(json.c_str());
+  ASSERT_FALSE(doc.HasParseError());
+  Api actual;
+  ASSERT_TRUE(actual.ParseFromString(pbf));
+  EXPECT_FALSE(actual.has_options());
+  EXPECT_FALSE(actual.has_isochrone());
+  ASSERT_TRUE(actual.has_matrix());
+  ASSERT_EQ(actual.matrix().sources_size(), 3);
+  ASSERT_EQ(actual.matrix().targets_size(), 3);
+  ASSERT_EQ(actual.matrix().times().size(), 9);
+  ASSERT_EQ(actual.matrix().distances().size(), 9);
+  for (int i = 0; i < 3; ++i) {
+    for (int j = 0; j < 3; ++j) {
+      const auto& pair = doc["sources_to_targets"][i][j];
+      ASSERT_TRUE(pair["time"].IsNumber());
+      EXPECT_EQ(actual.matrix().times(i * 3 + j), pair["time"].GetUint64());
+      EXPECT_NEAR(actual.matrix().distances(i * 3 + j), pair["distance"].GetDouble(), .001);
+    }
+  }
+
+  // every feature of the geojson is a contour of the isochrone with the same rings
+  const auto isochrone_request = R"({"locations":[)" + location("E") +
+                                 R"(],"costing":"pedestrian","contours":[{"time":2},{"time":4}],)"
+                                 R"("polygons":true)";
+  gurka::do_action(Options::isochrone, map, isochrone_request + "}", {}, &json);
+  gurka::do_action(Options::isochrone, map, isochrone_request + R"(,"format":"pbf"})", {}, &pbf);
+  doc.Parse(json.c_str());
+  ASSERT_FALSE(doc.HasParseError());
+  actual.Clear();
+  ASSERT_TRUE(actual.ParseFromString(pbf));
+  EXPECT_FALSE(actual.has_matrix());
+  ASSERT_TRUE(actual.has_isochrone());
+  EXPECT_TRUE(actual.isochrone().polygons());
+  ASSERT_EQ(actual.isochrone().intervals_size(), 2);
+  rapidjson::SizeType feature = 0;
+  for (const auto& interval : actual.isochrone().intervals()) {
+    EXPECT_EQ(interval.metric(), Isochrone::kTime);
+    for (const auto& contour : interval.contours()) {
+      ASSERT_LT(feature, doc["features"].Size());
+      const auto& properties = doc["features"][feature]["properties"];
+      EXPECT_EQ(properties["contour"].GetDouble(), interval.value());
+      EXPECT_EQ(properties["color"].GetString(), "#" + interval.color());
+      const auto& rings = doc["features"][feature]["geometry"]["coordinates"];
+      ASSERT_EQ(rings.Size(), contour.geometries_size());
+      for (int r = 0; r < contour.geometries_size(); ++r) {
+        const auto& coords = contour.geometries(r).coords();
+        ASSERT_EQ(rings[r].Size() * 2, coords.size());
+        for (rapidjson::SizeType c = 0; c < rings[r].Size(); ++c) {
+          EXPECT_NEAR(coords.Get(c * 2) * 1e-6, rings[r][c][0].GetDouble(), 1e-6);
+          EXPECT_NEAR(coords.Get(c * 2 + 1) * 1e-6, rings[r][c][1].GetDouble(), 1e-6);
+        }
+      }
+      ++feature;
+    }
+  }
+  EXPECT_EQ(feature, doc["features"].Size());
+
+  // locate hands back the correlated locations and leaves the ones it couldnt find empty
+  const auto locate_request = R"({"locations":[)" + location("A") +
+                              R"(,{"lat":1.0,"lon":1.0}],"costing":"pedestrian")";
+  gurka::do_action(Options::locate, map, locate_request + "}", {}, &json);
+  gurka::do_action(Options::locate, map, locate_request + R"(,"format":"pbf"})", {}, &pbf);
+  doc.Parse(json.c_str());
+  ASSERT_FALSE(doc.HasParseError());
+  actual.Clear();
+  ASSERT_TRUE(actual.ParseFromString(pbf));
+  ASSERT_TRUE(actual.has_options());
+  ASSERT_EQ(actual.options().locations_size(), 2);
+  const auto& edges = actual.options().locations(0).correlation().edges();
+  ASSERT_EQ(edges.size(), doc[0u]["edges"].Size());
+  for (int e = 0; e < edges.size(); ++e) {
+    EXPECT_NEAR(edges.Get(e).ll().lat(), doc[0u]["edges"][e]["correlated_lat"].GetDouble(), 1e-6);
+    EXPECT_NEAR(edges.Get(e).ll().lng(), doc[0u]["edges"][e]["correlated_lon"].GetDouble(), 1e-6);
+    EXPECT_NEAR(edges.Get(e).percent_along(), doc[0u]["edges"][e]["percent_along"].GetDouble(),
+                1e-5);
+  }
+  EXPECT_TRUE(doc[1]["edges"].IsNull());
+  EXPECT_EQ(actual.options().locations(1).correlation().edges_size(), 0);
+}
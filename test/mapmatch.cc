@@ -1,16 +1,23 @@
 #include <algorithm>
+#include <chrono>
 #include <iostream>
 #include <random>
+#include <thread>
 #include <utility>
 #include <vector>
 
 #include "baldr/json.h"
+#include "baldr/tilehierarchy.h"
 #include "loki/worker.h"
+#include "meili/candidate_index.h"
+#include "meili/map_matcher_factory.h"
+#include "meili/match_session.h"
 #include "midgard/distanceapproximator.h"
 #include "midgard/encoded.h"
 #include "midgard/logging.h"
 #include "midgard/util.h"
 #include "odin/worker.h"
+#include "sif/costfactory.h"
 #include "thor/worker.h"
 #include "tyr/actor.h"
 #include "worker.h"
@@ -1505,6 +1512,186 @@ TEST(Mapmatch, openlr_parameter_falsy_native_api) {
     EXPECT_THROW(response.get_child("trip.linear_references"), std::runtime_error);
   }
 }
+
+// a measurement every 15 meters along a route
+std::vector<meili::Measurement> make_dense_trace(tyr::actor_t& actor) {
+  auto route = test::json_to_pt(actor.route(
+      R"({"costing":"auto","locations":[{"lat":52.09110,"lon":5.09806},{"lat":52.09585,"lon":5.11934}]})"));
+  auto shape = midgard::decode<std::vector<PointLL>>(
+      route.get_child("trip.legs").front().second.get<std::string>("shape"));
+  shape = midgard::resample_spherical_polyline(shape, 15, false);
+  std::vector<meili::Measurement> trace;
+  for (const auto& p : shape) {
+    trace.emplace_back(p, 5.f, 15.f);
+  }
+  return trace;
+}
+
+Options auto_options() {
+  Options options;
+  const rapidjson::Document doc;
+  sif::ParseCosting(doc, "/costing_options", options);
+  options.set_costing_type(Costing::auto_);
+  return options;
+}
+
+std::vector<baldr::GraphId> get_edges(const std::vector<meili::EdgeSegment>& segments) {
+  std::vector<baldr::GraphId> edges;
+  for (const auto& segment : segments) {
+    if (edges.empty() || edges.back() != segment.edgeid) {
+      edges.push_back(segment.edgeid);
+    }
+  }
+  return edges;
+}
+
+TEST(Mapmatch, test_route_cache) {
+  // consecutive points of a dense trace share most of their candidates
+  tyr::actor_t actor(conf, true);
+  const auto trace = make_dense_trace(actor);
+  const auto options = auto_options();
+
+  auto match = [&](bool cache_routes) {
+    auto config = conf;
+    config.put("meili.default.cache_routes", cache_routes);
+    meili::MapMatcherFactory factory(config);
+    std::unique_ptr<meili::MapMatcher> matcher(factory.Create(options));
+    auto results = matcher->OfflineMatch(trace);
+    return std::move(results.front());
+  };
+  auto uncached = match(false);
+  auto cached = match(true);
+
+  // without the cache nothing is counted, with it most transitions are answered from it
+  EXPECT_EQ(uncached.route_cache_hits, 0);
+  EXPECT_EQ(uncached.route_cache_misses, 0);
+  EXPECT_GT(cached.route_cache_hits, 0);
+  EXPECT_GT(cached.route_cache_misses, 0);
+
+  // and the path matched is the same
+  ASSERT_EQ(cached.results.size(), uncached.results.size());
+  for (size_t i = 0; i < cached.results.size(); ++i) {
+    EXPECT_EQ(cached.results[i].edgeid, uncached.results[i].edgeid) << "point " << i;
+  }
+  ASSERT_EQ(cached.segments.size(), uncached.segments.size());
+  for (size_t i = 0; i < cached.segments.size(); ++i) {
+    EXPECT_EQ(cached.segments[i].edgeid, uncached.segments[i].edgeid) << "segment " << i;
+  }
+}
+
+TEST(Mapmatch, test_candidate_index) {
+  auto reader = std::make_shared<baldr::GraphReader>(conf.get_child("mjolnir"));
+
+  // one index per graph reader and cell size
+  auto index = meili::CandidateIndex::Get(*reader, 0.0005f, 0.0005f);
+  EXPECT_EQ(index, meili::CandidateIndex::Get(*reader, 0.0005f, 0.0005f))
+      << "index should be shared on the same graph reader";
+  EXPECT_NE(index, meili::CandidateIndex::Get(*reader, 0.001f, 0.001f))
+      << "index should only be shared with the same cell size";
+
+  // every edge with shape in the range is found
+  const midgard::PointLL center(5.1079374, 52.0887174);
+  const auto range = midgard::ExpandMeters(center, 200);
+  const auto found = index->Query(*reader, range);
+  const auto level = baldr::TileHierarchy::levels().back().level;
+  auto tile = reader->GetGraphTile(baldr::TileHierarchy::GetGraphId(center, level));
+  ASSERT_NE(tile, nullptr);
+  size_t edges = 0;
+  for (size_t bin = 0; bin < baldr::kBinCount; ++bin) {
+    for (const auto& edge_id : tile->GetBin(bin)) {
+      auto edge_tile = tile;
+      const auto* edge = reader->directededge(edge_id, edge_tile);
+      const auto shape = edge_tile->edgeinfo(edge).shape();
+      if (std::any_of(shape.begin(), shape.end(),
+                      [&range](const midgard::PointLL& p) { return range.Contains(p); })) {
+        EXPECT_TRUE(found.count(edge_id)) << edge_id;
+        ++edges;
+      }
+    }
+  }
+  EXPECT_GT(edges, 0);
+
+  // the bins are only indexed once
+  const auto bins = index->size();
+  EXPECT_GT(bins, 0);
+  EXPECT_EQ(index->Query(*reader, range), found);
+  EXPECT_EQ(index->size(), bins);
+}
+
+TEST(Mapmatch, test_online_match) {
+  tyr::actor_t actor(conf, true);
+  const auto trace = make_dense_trace(actor);
+  const auto options = auto_options();
+
+  auto config = conf;
+  config.put("meili.session.max_window", 10);
+  meili::MapMatcherFactory factory(config);
+  std::unique_ptr<meili::MapMatcher> matcher(factory.Create(options));
+  auto offline = matcher->OfflineMatch(trace);
+  const auto& expected = offline.front();
+
+  // push the measurements one by one, the results come back in order and the matcher never holds
+  // more than the window plus the final measurements it didn't drop yet
+  std::vector<meili::MatchResult> results;
+  std::vector<meili::EdgeSegment> segments;
+  for (const auto& measurement : trace) {
+    auto online = matcher->OnlineMatch(measurement);
+    results.insert(results.end(), online.results.begin(), online.results.end());
+    segments.insert(segments.end(), online.segments.begin(), online.segments.end());
+    EXPECT_LE(matcher->state_container().size(), 15);
+  }
+  auto online = matcher->FinishOnlineMatch();
+  results.insert(results.end(), online.results.begin(), online.results.end());
+  segments.insert(segments.end(), online.segments.begin(), online.segments.end());
+  EXPECT_EQ(matcher->state_container().size(), 0);
+
+  ASSERT_EQ(results.size(), expected.results.size());
+  for (size_t i = 0; i < results.size(); ++i) {
+    EXPECT_EQ(results[i].edgeid, expected.results[i].edgeid) << "point " << i;
+  }
+  EXPECT_EQ(get_edges(segments), get_edges(expected.segments));
+  for (const auto& segment : segments) {
+    EXPECT_LT(segment.last_match_idx, static_cast<int>(trace.size()));
+  }
+}
+
+TEST(Mapmatch, test_match_sessions) {
+  tyr::actor_t actor(conf, true);
+  const auto trace = make_dense_trace(actor);
+  const auto options = auto_options();
+
+  // every measurement comes back once, either when final or when the session finishes
+  auto config = conf;
+  config.put("meili.session.max_sessions", 2);
+  meili::MatchSessions sessions(config);
+  size_t matched = 0;
+  for (const auto& measurement : trace) {
+    matched += sessions.Push("a", options, measurement).results.size();
+  }
+  EXPECT_EQ(sessions.size(), 1);
+  matched += sessions.Finish("a").results.size();
+  EXPECT_EQ(matched, trace.size());
+  EXPECT_EQ(sessions.size(), 0);
+  EXPECT_TRUE(sessions.Finish("a").results.empty());
+
+  // the least recently used sessions go first
+  sessions.Push("a", options, trace[0]);
+  sessions.Push("b", options, trace[0]);
+  sessions.Push("a", options, trace[1]);
+  sessions.Push("c", options, trace[0]);
+  EXPECT_EQ(sessions.size(), 2);
+  EXPECT_TRUE(sessions.Finish("b").results.empty());
+  EXPECT_FALSE(sessions.Finish("a").results.empty());
+
+  // and the ones that weren't pushed to for too long
+  config.put("meili.session.ttl", 0);
+  meili::MatchSessions expiring(config);
+  expiring.Push("a", options, trace[0]);
+  std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  expiring.Push("b", options, trace[0]);
+  EXPECT_EQ(expiring.size(), 1);
+  EXPECT_TRUE(expiring.Finish("a").results.empty());
+}
 } // namespace
 
 int main(int argc, char* argv[]) {
@@ -370,6 +370,54 @@ TEST(Matrix, partial_matrix) {
   EXPECT_EQ(found, 2) << " partial result did not find 2 results as expected";
 }
 
+TEST(Matrix, parallel_costmatrix_matches_serial) {
+  // enough locations on each side for the searches to be expanded on the pool
+  std::string locations;
+  for (int i = 0; i < 24; ++i) {
+    locations += (i ? R"(,{"lat":)" : R"({"lat":)") + std::to_string(52.092 + (i % 6) * 0.004) +
+                 R"(,"lon":)" + std::to_string(5.065 + (i / 6) * 0.011) + "}";
+  }
+  auto request_json =
+      R"({"sources":[)" + locations + R"(],"targets":[)" + locations + R"(],"costing":"auto"})";
+
+  loki_worker_t loki_worker(config);
+  Api request;
+  ParseApi(request_json, Options::sources_to_targets, request);
+  loki_worker.matrix(request);
+  adjust_scores(*request.mutable_options());
+
+  // the searches are only expanded in parallel with a reader that is safe to share
+  auto mjolnir = config.get_child("mjolnir");
+  mjolnir.put("use_concurrent_mem_cache", true);
+  GraphReader reader(mjolnir);
+#ifdef ENABLE_THREAD_SAFE_TILE_REF_COUNT
+  // otherwise the parallel matrix quietly expands its searches serially and this checks nothing
+  ASSERT_TRUE(reader.IsThreadSafe());
+#endif
+
+  sif::mode_costing_t mode_costing;
+  mode_costing[0] =
+      CreateSimpleCost(request.options().costings().find(request.options().costing_type())->second);
+
+  CostMatrix serial;
+  auto expected = serial.SourceToTarget(request.options().sources(), request.options().targets(),
+                                        reader, mode_costing, sif::TravelMode::kDrive, 400000.0);
+
+  boost::property_tree::ptree thor;
+  thor.put("costmatrix_concurrency", 4);
+  CostMatrix parallel(thor);
+  for (int run = 0; run < 3; ++run) {
+    auto results = parallel.SourceToTarget(request.options().sources(), request.options().targets(),
+                                           reader, mode_costing, sif::TravelMode::kDrive, 400000.0);
+    ASSERT_EQ(results.size(), expected.size());
+    for (size_t i = 0; i < results.size(); ++i) {
+      EXPECT_EQ(results[i].time, expected[i].time) << "run " << run << " result " << i;
+      EXPECT_EQ(results[i].dist, expected[i].dist) << "run " << run << " result " << i;
+    }
+    parallel.clear();
+  }
+}
+
 int main(int argc, char* argv[]) {
   logging::Configure({{"type", ""}}); // silence logs
   testing::InitGoogleTest(&argc, argv);
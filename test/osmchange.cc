@@ -0,0 +1,291 @@
+#include "mjolnir/osmchange.h"
+#include "baldr/graphreader.h"
+#include "baldr/tilehierarchy.h"
+#include "filesystem.h"
+#include "mjolnir/util.h"
+
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <boost/property_tree/ptree.hpp>
+#include <osmium/handler.hpp>
+#include <osmium/io/pbf_input.hpp>
+#include <osmium/io/pbf_output.hpp>
+#include <osmium/osm.hpp>
+#include <osmium/visitor.hpp>
+
+#include "test.h"
+
+#if !defined(VALHALLA_SOURCE_DIR)
+#define VALHALLA_SOURCE_DIR
+#endif
+
+using boost::property_tree::ptree;
+using namespace valhalla;
+using namespace valhalla::baldr;
+using namespace valhalla::midgard;
+using namespace valhalla::mjolnir;
+
+namespace {
+
+const std::string pbf_file = {VALHALLA_SOURCE_DIR "test/data/harrisburg.osm.pbf"};
+
+void write_file(const std::string& path, const std::string& content) {
+  std::ofstream out(path, std::ios::trunc);
+  out << content;
+}
+
+// Locations of the nodes and node ids of the highways of a pbf
+struct HighwayCollector : public osmium::handler::Handler {
+  void node(const osmium::Node& node) {
+    locations[node.positive_id()] = {node.location().lon(), node.location().lat()};
+  }
+  void way(const osmium::Way& way) {
+    if (way.tags().has_key("highway")) {
+      std::vector<uint64_t> refs;
+      for (const auto& ref : way.nodes()) {
+        refs.push_back(ref.positive_ref());
+      }
+      highways.emplace_back(way.positive_id(), std::move(refs));
+    }
+  }
+  std::unordered_map<uint64_t, PointLL> locations;
+  std::vector<std::pair<uint64_t, std::vector<uint64_t>>> highways;
+};
+
+// Copy a pbf with a node moved to another location and a way deleted
+void rewrite_pbf(const std::string& in_file,
+                 const std::string& out_file,
+                 uint64_t node_id,
+                 const PointLL& location,
+                 uint64_t way_id) {
+  osmium::io::Reader reader{osmium::io::File{in_file, "pbf"}};
+  osmium::io::Writer writer{osmium::io::File{out_file, "pbf"}, reader.header(),
+                            osmium::io::overwrite::allow};
+  while (osmium::memory::Buffer buffer = reader.read()) {
+    osmium::memory::Buffer out{buffer.committed(), osmium::memory::Buffer::auto_grow::yes};
+    for (auto object = buffer.begin<osmium::OSMObject>(); object != buffer.end<osmium::OSMObject>();
+         ++object) {
+      if (object->type() == osmium::item_type::way && object->positive_id() == way_id) {
+        continue;
+      }
+      if (object->type() == osmium::item_type::node && object->positive_id() == node_id) {
+        static_cast<osmium::Node&>(*object).set_location(
+            osmium::Location{location.lng(), location.lat()});
+      }
+      out.add_item(*object);
+      out.commit();
+    }
+    writer(std::move(out));
+  }
+  writer.close();
+  reader.close();
+}
+
+// Every node and directed edge of the actual graph has the same bytes as in the expected graph, the
+// edges have the same way, shape and opposing edge and end at a node in the same place
+void expect_same_graph(const std::string& expected_dir, const std::string& actual_dir) {
+  ptree expected_config, actual_config;
+  expected_config.put("tile_dir", expected_dir);
+  actual_config.put("tile_dir", actual_dir);
+  GraphReader expected(expected_config);
+  GraphReader actual(actual_config);
+  auto tiles = expected.GetTileSet();
+  EXPECT_GT(tiles.size(), 4);
+  ASSERT_EQ(tiles, actual.GetTileSet());
+  for (const auto& tile_id : tiles) {
+    auto expected_tile = expected.GetGraphTile(tile_id);
+    auto actual_tile = actual.GetGraphTile(tile_id);
+    ASSERT_TRUE(expected_tile && actual_tile);
+    ASSERT_EQ(expected_tile->header()->nodecount(), actual_tile->header()->nodecount()) << tile_id;
+    ASSERT_EQ(expected_tile->header()->directededgecount(),
+              actual_tile->header()->directededgecount())
+        << tile_id;
+    for (uint32_t i = 0; i < expected_tile->header()->nodecount(); ++i) {
+      EXPECT_EQ(std::memcmp(expected_tile->node(i), actual_tile->node(i), sizeof(NodeInfo)), 0)
+          << GraphId(tile_id.tileid(), tile_id.level(), i);
+    }
+    for (uint32_t i = 0; i < expected_tile->header()->directededgecount(); ++i) {
+      GraphId edge_id(tile_id.tileid(), tile_id.level(), i);
+      const auto* expected_edge = expected_tile->directededge(i);
+      const auto* actual_edge = actual_tile->directededge(i);
+      ASSERT_EQ(expected_edge->endnode(), actual_edge->endnode()) << edge_id;
+      EXPECT_EQ(std::memcmp(expected_edge, actual_edge, sizeof(DirectedEdge)), 0) << edge_id;
+      EXPECT_EQ(expected_tile->edgeinfo(expected_edge).wayid(),
+                actual_tile->edgeinfo(actual_edge).wayid())
+          << edge_id;
+      EXPECT_EQ(expected_tile->edgeinfo(expected_edge).shape(),
+                actual_tile->edgeinfo(actual_edge).shape())
+          << edge_id;
+
+      auto expected_end = expected.GetGraphTile(expected_edge->endnode());
+      auto actual_end = actual.GetGraphTile(actual_edge->endnode());
+      ASSERT_TRUE(expected_end && actual_end) << edge_id;
+      EXPECT_EQ(expected_end->get_node_ll(expected_edge->endnode()),
+                actual_end->get_node_ll(actual_edge->endnode()))
+          << edge_id;
+      EXPECT_EQ(expected.GetOpposingEdgeId(edge_id), actual.GetOpposingEdgeId(edge_id)) << edge_id;
+    }
+    if (expected.OverCommitted()) {
+      expected.Trim();
+    }
+    if (actual.OverCommitted()) {
+      actual.Trim();
+    }
+  }
+}
+
+TEST(OSMChange, Read) {
+  const std::string osc_file = "test_osmchange.osc";
+  write_file(osc_file, R"(<?xml version="1.0" encoding="UTF-8"?>
+<osmChange version="0.6" generator="test">
+  <create>
+    <node id="1" version="1" lat="40.2655" lon="-76.8846"/>
+    <way id="10" version="1">
+      <nd ref="1"/>
+      <tag k="name" v="a > b"/>
+    </way>
+  </create>
+  <modify>
+    <node id='2' version='2' lon='-76.8' lat='40.3'>
+      <tag k="highway" v="crossing"/>
+    </node>
+    <relation id="100" version="3">
+      <member type="node" ref="3" role="via"/>
+      <member type="way" ref="11" role="from"/>
+      <member type='way' ref='12' role='to'/>
+    </relation>
+  </modify>
+  <delete>
+    <node id="4" version="5"/>
+    <way id="13" version="2"/>
+    <relation id="101" version="1"/>
+    <member type="way" ref="14" role="outer"/>
+  </delete>
+</osmChange>
+)");
+
+  auto change = OSMChange::Read(osc_file);
+  ASSERT_EQ(change.nodes.size(), 2);
+  EXPECT_NEAR(change.nodes[0].lat(), 40.2655, 1e-6);
+  EXPECT_NEAR(change.nodes[0].lng(), -76.8846, 1e-6);
+  EXPECT_NEAR(change.nodes[1].lat(), 40.3, 1e-6);
+  EXPECT_NEAR(change.nodes[1].lng(), -76.8, 1e-6);
+  EXPECT_EQ(change.node_ids, (std::unordered_set<uint64_t>{1, 2, 4}));
+  EXPECT_EQ(change.ways, (std::unordered_set<uint64_t>{10, 11, 12, 13}));
+
+  filesystem::remove(osc_file);
+  EXPECT_THROW(OSMChange::Read(osc_file), std::runtime_error);
+}
+
+// Updating with a change of data that is the same as before builds the same graph as a full build
+TEST(OSMChange, UpdateTileSet) {
+  const std::string full_dir = "test/data/osmchange_full_tiles";
+  const std::string updated_dir = "test/data/osmchange_updated_tiles";
+  const std::string incremental_dir = "test/data/osmchange_incremental_tiles";
+  ptree config;
+  config.put("mjolnir.tile_dir", full_dir);
+  config.put("mjolnir.incremental_dir", incremental_dir);
+  config.put("mjolnir.concurrency", 1);
+  ASSERT_TRUE(build_tile_set(config, {pbf_file}, BuildStage::kInitialize, BuildStage::kCleanup,
+                             false));
+  ASSERT_TRUE(filesystem::is_directory(incremental_dir));
+
+  const std::string osc_file = "test_osmchange_harrisburg.osc";
+  write_file(osc_file, R"(<osmChange version="0.6">
+  <modify><node id="1" version="2" lat="40.2655" lon="-76.8846"/></modify>
+</osmChange>)");
+  config.put("mjolnir.tile_dir", updated_dir);
+  ASSERT_TRUE(update_tile_set(config, {pbf_file}, osc_file));
+
+  expect_same_graph(full_dir, updated_dir);
+
+  filesystem::remove(osc_file);
+  filesystem::remove_all(full_dir);
+  filesystem::remove_all(updated_dir);
+  filesystem::remove_all(incremental_dir);
+}
+
+// Moving a node of a highway into another tile and deleting a highway builds the same graph as a
+// full build of the changed data, including the tiles the moved node left
+TEST(OSMChange, UpdateTileSetWithChanges) {
+  HighwayCollector collector;
+  {
+    osmium::io::Reader reader{osmium::io::File{pbf_file, "pbf"}};
+    osmium::apply(reader, collector);
+    reader.close();
+  }
+
+  // The ways each node is in, the node to move must only be inside of one way so it is not a
+  // node of the graph and only the shape of the edges through it moves
+  std::unordered_map<uint64_t, uint32_t> use_count;
+  for (const auto& highway : collector.highways) {
+    for (const auto& ref : highway.second) {
+      ++use_count[ref];
+    }
+  }
+  const auto& tiles = TileHierarchy::levels().back().tiles;
+  uint64_t moved_node = 0, moved_way = 0;
+  PointLL moved_to;
+  for (const auto& highway : collector.highways) {
+    for (size_t i = 1; moved_node == 0 && i + 1 < highway.second.size(); ++i) {
+      uint64_t ref = highway.second[i];
+      const auto& ll = collector.locations[ref];
+      PointLL to(ll.lng(), ll.lat() + 0.02);
+      if (use_count[ref] == 1 && tiles.TileId(ll) != tiles.TileId(to)) {
+        moved_node = ref;
+        moved_way = highway.first;
+        moved_to = to;
+      }
+    }
+    if (moved_node != 0) {
+      break;
+    }
+  }
+  ASSERT_NE(moved_node, 0);
+  uint64_t deleted_way = collector.highways.back().first;
+  ASSERT_NE(deleted_way, moved_way);
+
+  const std::string changed_pbf = "test_osmchange_harrisburg.osm.pbf";
+  rewrite_pbf(pbf_file, changed_pbf, moved_node, moved_to, deleted_way);
+  const std::string osc_file = "test_osmchange_harrisburg_changes.osc";
+  std::ostringstream osc;
+  osc << std::fixed << std::setprecision(7) << "<osmChange version=\"0.6\">\n"
+      << "  <modify><node id=\"" << moved_node << "\" version=\"2\" lat=\"" << moved_to.lat()
+      << "\" lon=\"" << moved_to.lng() << "\"/></modify>\n"
+      << "  <delete><way id=\"" << deleted_way << "\" version=\"2\"/></delete>\n"
+      << "</osmChange>\n";
+  write_file(osc_file, osc.str());
+
+  // Keep the tiles of the original data, update them with the change and compare the result to a
+  // full build of the changed data
+  const std::string full_dir = "test/data/osmchange_changed_full_tiles";
+  const std::string updated_dir = "test/data/osmchange_changed_updated_tiles";
+  const std::string incremental_dir = "test/data/osmchange_changed_incremental_tiles";
+  ptree config;
+  config.put("mjolnir.concurrency", 1);
+  config.put("mjolnir.tile_dir", full_dir);
+  ASSERT_TRUE(build_tile_set(config, {changed_pbf}, BuildStage::kInitialize, BuildStage::kCleanup,
+                             false));
+
+  config.put("mjolnir.tile_dir", updated_dir);
+  config.put("mjolnir.incremental_dir", incremental_dir);
+  ASSERT_TRUE(build_tile_set(config, {pbf_file}, BuildStage::kInitialize, BuildStage::kCleanup,
+                             false));
+  ASSERT_TRUE(update_tile_set(config, {changed_pbf}, osc_file));
+
+  expect_same_graph(full_dir, updated_dir);
+
+  filesystem::remove(osc_file);
+  filesystem::remove(changed_pbf);
+  filesystem::remove_all(full_dir);
+  filesystem::remove_all(updated_dir);
+  filesystem::remove_all(incremental_dir);
+}
+
+} // namespace
@@ -0,0 +1,203 @@
+#include "mjolnir/osmdata.h"
+#include "baldr/graphconstants.h"
+#include "filesystem.h"
+
+#include <cstdint>
+#include <string>
+
+#include "test.h"
+
+using namespace valhalla::baldr;
+using namespace valhalla::mjolnir;
+
+namespace {
+
+const std::string tile_dir = "test/data/osmdata_budget/";
+
+OSMRestriction restriction(uint64_t to, uint64_t via) {
+  OSMRestriction res;
+  res.set_type(RestrictionType::kNoLeftTurn);
+  res.set_to(to);
+  res.set_via(via);
+  return res;
+}
+
+OSMData make_data() {
+  OSMData osmdata{};
+  osmdata.restrictions.insert({30, restriction(2, 20)});
+  osmdata.restrictions.insert({10, restriction(1, 10)});
+  osmdata.restrictions.insert({30, restriction(3, 30)});
+  OSMAccessRestriction access;
+  access.set_type(AccessType::kMaxHeight);
+  access.set_value(400);
+  osmdata.access_restrictions.insert({20, access});
+  uint32_t name = osmdata.name_offset_map.index("Lancaster Pike");
+  uint32_t ref = osmdata.name_offset_map.index("PA 272");
+  osmdata.bike_relations.insert({40, OSMBike{kRcn, name, ref}});
+  osmdata.lane_connectivity_map.insert({50, OSMLaneConnectivity{50, 60, name, ref}});
+  osmdata.via_set.insert(70);
+  osmdata.way_ref[80] = ref;
+  osmdata.node_names.index("Exit 5");
+  osmdata.sort();
+  return osmdata;
+}
+
+void check_data(const OSMData& osmdata) {
+  auto res = osmdata.restrictions.equal_range(30);
+  ASSERT_EQ(std::distance(res.first, res.second), 2);
+  EXPECT_EQ(res.first->second.to(), 2);
+  EXPECT_EQ((res.first + 1)->second.via(), 30);
+  res = osmdata.restrictions.equal_range(20);
+  EXPECT_EQ(res.first, osmdata.restrictions.end());
+  EXPECT_EQ(res.second, osmdata.restrictions.end());
+
+  auto access = osmdata.access_restrictions.equal_range(20);
+  ASSERT_EQ(std::distance(access.first, access.second), 1);
+  EXPECT_EQ(access.first->second.value(), 400);
+
+  auto bike = osmdata.bike_relations.equal_range(40);
+  ASSERT_EQ(std::distance(bike.first, bike.second), 1);
+  EXPECT_EQ(osmdata.name_offset_map.name(bike.first->second.name_index), "Lancaster Pike");
+  EXPECT_EQ(osmdata.name_offset_map.name(bike.first->second.ref_index), "PA 272");
+
+  auto lanes = osmdata.lane_connectivity_map.equal_range(50);
+  ASSERT_EQ(std::distance(lanes.first, lanes.second), 1);
+  EXPECT_EQ(lanes.first->second.from_way_id, 60);
+
+  EXPECT_EQ(osmdata.via_set.count(70), 1);
+  EXPECT_EQ(osmdata.name_offset_map.name(osmdata.way_ref.at(80)), "PA 272");
+  EXPECT_EQ(osmdata.name_offset_map.Size(), 2);
+  EXPECT_EQ(osmdata.name_offset_map.name(0), "");
+  EXPECT_EQ(osmdata.name_offset_map.name(3), "");
+  EXPECT_EQ(osmdata.node_names.name(1), "Exit 5");
+}
+
+TEST(OSMData, WayIdMultiMap) {
+  WayIdMultiMap<uint32_t> way_map;
+  way_map.insert({5, 1});
+  way_map.insert({3, 2});
+  way_map.insert({5, 3});
+  EXPECT_THROW(way_map.equal_range(5), std::logic_error);
+
+  way_map.sort();
+  ASSERT_EQ(way_map.size(), 3);
+  EXPECT_EQ(way_map.begin()->first, 3);
+  auto range = way_map.equal_range(5);
+  ASSERT_EQ(std::distance(range.first, range.second), 2);
+  // values of a way keep the order they were added in
+  EXPECT_EQ(range.first->second, 1);
+  EXPECT_EQ((range.first + 1)->second, 3);
+  range = way_map.equal_range(4);
+  EXPECT_EQ(range.first, way_map.end());
+  EXPECT_EQ(range.second, way_map.end());
+}
+
+TEST(OSMData, ReadWithoutBudget) {
+  filesystem::create_directories(tile_dir);
+  auto osmdata = make_data();
+  check_data(osmdata);
+  ASSERT_TRUE(osmdata.write_to_temp_files(tile_dir));
+
+  OSMData read{};
+  ASSERT_TRUE(read.read_from_temp_files(tile_dir));
+  check_data(read);
+  EXPECT_EQ(read.restrictions.file(), "");
+  EXPECT_EQ(read.name_offset_map.File(), "");
+  OSMData::cleanup_temp_files(tile_dir);
+}
+
+TEST(OSMData, ReadWithinBudget) {
+  filesystem::create_directories(tile_dir);
+  auto osmdata = make_data();
+  ASSERT_TRUE(osmdata.write_to_temp_files(tile_dir));
+
+  // Everything fits, the names go into arenas on the heap
+  OSMData arena{};
+  ASSERT_TRUE(arena.read_from_temp_files(tile_dir, 1 << 20));
+  check_data(arena);
+  EXPECT_EQ(arena.restrictions.file(), "");
+  EXPECT_EQ(arena.name_offset_map.File(), "");
+  EXPECT_LT(arena.memory_usage(), osmdata.memory_usage());
+  EXPECT_THROW(arena.name_offset_map.index("Main Street"), std::logic_error);
+
+  // Nothing fits, everything is mapped from the files
+  OSMData mapped{};
+  ASSERT_TRUE(mapped.read_from_temp_files(tile_dir, 1));
+  check_data(mapped);
+  EXPECT_EQ(mapped.restrictions.file(), tile_dir + "osmdata_restrictions.bin");
+  EXPECT_EQ(mapped.name_offset_map.File(), tile_dir + "osmdata_unique_strings.bin");
+  EXPECT_EQ(mapped.restrictions.memory_usage(), 0);
+  EXPECT_LT(mapped.memory_usage(), arena.memory_usage());
+
+  // Writing mapped data leaves its files as they are
+  ASSERT_TRUE(mapped.write_to_temp_files(tile_dir));
+  check_data(mapped);
+  OSMData::cleanup_temp_files(tile_dir);
+}
+
+TEST(OSMData, FitMemory) {
+  filesystem::create_directories(tile_dir);
+  auto osmdata = make_data();
+  size_t usage = osmdata.memory_usage();
+  ASSERT_TRUE(osmdata.fit_memory(tile_dir, 0));
+  ASSERT_TRUE(osmdata.fit_memory(tile_dir, usage));
+  EXPECT_EQ(osmdata.memory_usage(), usage);
+
+  // Moving the names into arenas is enough, nothing is written out
+  ASSERT_TRUE(osmdata.fit_memory(tile_dir, usage - 1));
+  EXPECT_LT(osmdata.memory_usage(), usage);
+  EXPECT_EQ(osmdata.name_offset_map.File(), "");
+  EXPECT_THROW(osmdata.name_offset_map.index("Main Street"), std::logic_error);
+  EXPECT_FALSE(filesystem::exists(tile_dir + "osmdata_restrictions.bin"));
+  check_data(osmdata);
+
+  // Not even that fits, the rest is mapped from the temporary files
+  ASSERT_TRUE(osmdata.fit_memory(tile_dir, 1));
+  EXPECT_EQ(osmdata.restrictions.file(), tile_dir + "osmdata_restrictions.bin");
+  EXPECT_EQ(osmdata.name_offset_map.File(), tile_dir + "osmdata_unique_strings.bin");
+  check_data(osmdata);
+  OSMData::cleanup_temp_files(tile_dir);
+  filesystem::remove_all(tile_dir);
+}
+
+TEST(OSMData, FitMemoryWhileParsing) {
+  filesystem::create_directories(tile_dir);
+  auto osmdata = make_data();
+
+  // After the ways only the access restrictions are complete
+  ASSERT_TRUE(osmdata.fit_memory(tile_dir, 1, OSMType::kWay));
+  EXPECT_EQ(osmdata.access_restrictions.file(), tile_dir + "osmdata_access_restrictions.bin");
+  EXPECT_EQ(osmdata.restrictions.file(), "");
+  EXPECT_EQ(osmdata.name_offset_map.File(), "");
+  check_data(osmdata);
+
+  // Relations still add names and restrictions
+  uint32_t name = osmdata.name_offset_map.index("Main Street");
+  osmdata.restrictions.insert({90, restriction(4, 90)});
+  osmdata.sort();
+
+  // After the relations the way names and the rest of the multimaps are complete
+  ASSERT_TRUE(osmdata.fit_memory(tile_dir, 1, OSMType::kRelation));
+  EXPECT_EQ(osmdata.restrictions.file(), tile_dir + "osmdata_restrictions.bin");
+  EXPECT_EQ(osmdata.lane_connectivity_map.file(), tile_dir + "osmdata_lane_connectivity.bin");
+  EXPECT_EQ(osmdata.name_offset_map.File(), tile_dir + "osmdata_unique_strings.bin");
+  EXPECT_EQ(osmdata.name_offset_map.name(name), "Main Street");
+  EXPECT_EQ(osmdata.restrictions.equal_range(90).first->second.to(), 4);
+
+  // Nodes still add node names
+  EXPECT_EQ(osmdata.node_names.index("Exit 6"), 2);
+  EXPECT_EQ(osmdata.node_names.File(), "");
+
+  ASSERT_TRUE(osmdata.fit_memory(tile_dir, 1, OSMType::kNode));
+  EXPECT_EQ(osmdata.node_names.File(), tile_dir + "osmdata_node_names.bin");
+  EXPECT_EQ(osmdata.node_names.name(2), "Exit 6");
+  OSMData::cleanup_temp_files(tile_dir);
+  filesystem::remove_all(tile_dir);
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
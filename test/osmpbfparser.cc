@@ -0,0 +1,112 @@
+#include "mjolnir/osmpbfparser.h"
+#include "test.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <map>
+#include <string>
+#include <vector>
+
+#if !defined(VALHALLA_SOURCE_DIR)
+#define VALHALLA_SOURCE_DIR
+#endif
+
+namespace {
+
+// writes down everything the parser hands us in the order it does so
+struct recording_callback : public OSMPBF::Callback {
+  std::vector<std::string> events;
+
+  static std::string to_string(const OSMPBF::Tags& tags) {
+    // tags are unordered, sort them so that two runs compare equal
+    std::map<std::string, std::string> sorted(tags.begin(), tags.end());
+    std::string result;
+    for (const auto& tag : sorted) {
+      result += tag.first + "=" + tag.second + ";";
+    }
+    return result;
+  }
+
+  void node_callback(const uint64_t osmid,
+                     const double lng,
+                     const double lat,
+                     const OSMPBF::Tags& tags) override {
+    events.push_back("n" + std::to_string(osmid) + " " + std::to_string(lng) + "," +
+                     std::to_string(lat) + " " + to_string(tags));
+  }
+  void way_callback(const uint64_t osmid,
+                    const OSMPBF::Tags& tags,
+                    const std::vector<uint64_t>& nodes) override {
+    std::string event = "w" + std::to_string(osmid) + " " + to_string(tags);
+    for (auto node : nodes) {
+      event += " " + std::to_string(node);
+    }
+    events.push_back(event);
+  }
+  void relation_callback(const uint64_t osmid,
+                         const OSMPBF::Tags& tags,
+                         const std::vector<OSMPBF::Member>& members) override {
+    std::string event = "r" + std::to_string(osmid) + " " + to_string(tags);
+    for (const auto& member : members) {
+      event += " " + std::to_string(member.member_type) + ":" + std::to_string(member.member_id) +
+               ":" + member.role;
+    }
+    events.push_back(event);
+  }
+  void changeset_callback(const uint64_t changeset_id) override {
+    events.push_back("c" + std::to_string(changeset_id));
+  }
+};
+
+// everything, OSMPBF::Interest::ALL leaves out the ways
+const auto kEverything =
+    static_cast<OSMPBF::Interest>(OSMPBF::Interest::NODES | OSMPBF::Interest::WAYS |
+                                  OSMPBF::Interest::RELATIONS | OSMPBF::Interest::CHANGESETS);
+
+std::vector<std::string> parse(const std::string& path, unsigned int threads) {
+  std::ifstream file(path, std::ios::binary);
+  EXPECT_TRUE(file.is_open()) << "Unable to open " << path;
+  recording_callback callback;
+  OSMPBF::Parser::parse(file, kEverything, callback, threads);
+  return callback.events;
+}
+
+TEST(OSMPBFParser, ThreadedParseMatchesSerial) {
+  for (const auto* pbf : {"test/data/liechtenstein-latest.osm.pbf", "test/data/harrisburg.osm.pbf"}) {
+    const auto path = VALHALLA_SOURCE_DIR + std::string(pbf);
+    const auto serial = parse(path, 1);
+    ASSERT_FALSE(serial.empty()) << "Nothing parsed from " << path;
+    for (unsigned int threads : {2, 3, 8}) {
+      EXPECT_EQ(parse(path, threads), serial)
+          << path << " parsed differently with " << threads << " threads";
+    }
+  }
+}
+
+TEST(OSMPBFParser, ThreadedParseThrowsOnCorruptBlob) {
+  // chop a file in the middle of a blob
+  const auto path = VALHALLA_SOURCE_DIR + std::string("test/data/harrisburg.osm.pbf");
+  std::ifstream in(path, std::ios::binary);
+  std::string bytes((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+  const std::string truncated = "test/data/truncated.osm.pbf";
+  {
+    std::ofstream out(truncated, std::ios::binary);
+    out.write(bytes.data(), bytes.size() / 2);
+  }
+
+  for (unsigned int threads : {1, 4}) {
+    std::ifstream file(truncated, std::ios::binary);
+    recording_callback callback;
+    EXPECT_THROW(OSMPBF::Parser::parse(file, kEverything, callback, threads),
+                 std::runtime_error);
+  }
+  std::remove(truncated.c_str());
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
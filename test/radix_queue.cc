@@ -0,0 +1,155 @@
+#include "baldr/label_queue.h"
+#include "baldr/radix_queue.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <random>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+#include "test.h"
+
+using namespace std;
+using namespace valhalla;
+using namespace valhalla::baldr;
+
+namespace {
+
+struct simple_label {
+  float c;
+  float sortcost() const {
+    return c;
+  }
+};
+
+TEST(RadixQueue, TestInvalidConstruction) {
+  std::vector<simple_label> edgelabels;
+  EXPECT_THROW(RadixQueue<simple_label> adjlist(0, 10000, 0, &edgelabels), runtime_error)
+      << "Invalid bucket size not caught";
+  EXPECT_THROW(RadixQueue<simple_label> adjlist(0, 0.0f, 1, &edgelabels), runtime_error)
+      << "Invalid cost range not caught";
+}
+
+TEST(RadixQueue, TestAddRemove) {
+  std::vector<float> costs = {67,  325,   16442, 278,       1000, 100005, 758,         167,
+                              258, 466,   25,    111111000, 0.5f, 0.25f,  1320209856.f};
+  std::vector<simple_label> edgelabels;
+  RadixQueue<simple_label> adjlist(0, 10000, 1, &edgelabels);
+  for (auto cost : costs) {
+    edgelabels.emplace_back(simple_label{cost});
+    adjlist.add(edgelabels.size() - 1);
+  }
+  std::sort(costs.begin(), costs.end());
+  for (auto expected : costs) {
+    const auto label = adjlist.pop();
+    ASSERT_NE(label, kInvalidLabel);
+    EXPECT_EQ(edgelabels[label].sortcost(), expected);
+  }
+  EXPECT_EQ(adjlist.pop(), kInvalidLabel);
+}
+
+TEST(RadixQueue, TestDecreaseSkipsStaleEntries) {
+  std::vector<simple_label> edgelabels = {{100}, {50}, {75}};
+  RadixQueue<simple_label> adjlist(0, 10000, 1, &edgelabels);
+  for (uint32_t i = 0; i < edgelabels.size(); ++i) {
+    adjlist.add(i);
+  }
+  // the queue is told before the label is updated, like the path algorithms do
+  adjlist.decrease(0, 10);
+  edgelabels[0].c = 10;
+
+  EXPECT_EQ(adjlist.pop(), 0);
+  EXPECT_EQ(adjlist.pop(), 1);
+  EXPECT_EQ(adjlist.pop(), 2);
+  EXPECT_EQ(adjlist.pop(), kInvalidLabel) << "Stale entry of the decreased label was popped";
+}
+
+TEST(RadixQueue, TestClear) {
+  std::vector<simple_label> edgelabels;
+  RadixQueue<simple_label> adjlist(0, 10000, 50, &edgelabels);
+  for (float cost : {67.f, 325.f, 25.f, 466.f, 1000.f}) {
+    edgelabels.emplace_back(simple_label{cost});
+    adjlist.add(edgelabels.size() - 1);
+  }
+  adjlist.pop();
+  adjlist.clear();
+  EXPECT_EQ(adjlist.pop(), kInvalidLabel) << "failed to return invalid edge index after clear";
+
+  // after a clear costs lower than the ones popped before are accepted again
+  edgelabels.emplace_back(simple_label{1.f});
+  adjlist.add(edgelabels.size() - 1);
+  EXPECT_EQ(adjlist.pop(), edgelabels.size() - 1);
+}
+
+template <typename queue_t> void TrySimulation(queue_t& queue, std::vector<simple_label>& costs) {
+  std::unordered_set<uint32_t> added;
+  std::mt19937 gen(42);
+  std::uniform_real_distribution<float> dist(1.f, 1000.f);
+
+  costs.push_back({10.f});
+  queue.add(0);
+  for (size_t i = 0; i < 1000; ++i) {
+    const auto key = queue.pop();
+    if (key == kInvalidLabel) {
+      break;
+    }
+    const auto min_cost = costs[key].sortcost();
+    for (auto k : added) {
+      ASSERT_LE(min_cost, costs[k].sortcost()) << "Simulation: minimal cost expected";
+    }
+    added.erase(key);
+
+    for (size_t j = 0; j < 20; ++j) {
+      const auto newcost = std::floor(min_cost + dist(gen));
+      if (j % 2 == 0 && !added.empty()) {
+        const auto idx = *std::next(added.begin(), gen() % added.size());
+        if (newcost < costs[idx].sortcost()) {
+          queue.decrease(idx, newcost);
+          costs[idx] = {newcost};
+        }
+      } else {
+        costs.push_back({newcost});
+        queue.add(costs.size() - 1);
+        added.insert(costs.size() - 1);
+      }
+    }
+  }
+
+  auto previous = -std::numeric_limits<float>::infinity();
+  for (size_t i = 0; i < added.size(); ++i) {
+    const auto top = queue.pop();
+    ASSERT_NE(top, kInvalidLabel);
+    EXPECT_LE(previous, costs[top].sortcost());
+    previous = costs[top].sortcost();
+  }
+  EXPECT_EQ(queue.pop(), kInvalidLabel) << "Simulation: expect queue to be empty";
+}
+
+TEST(RadixQueue, TestSimulation) {
+  std::vector<simple_label> costs;
+  RadixQueue<simple_label> queue(0, 1, 100000, &costs);
+  TrySimulation(queue, costs);
+}
+
+TEST(LabelQueue, TestQueueType) {
+  EXPECT_EQ(to_queue_type("double_bucket"), QueueType::kDoubleBucket);
+  EXPECT_EQ(to_queue_type("radix"), QueueType::kRadix);
+  EXPECT_THROW(to_queue_type("fibonacci"), std::runtime_error);
+}
+
+TEST(LabelQueue, TestSimulation) {
+  for (auto type : {QueueType::kDoubleBucket, QueueType::kRadix}) {
+    std::vector<simple_label> costs;
+    LabelQueue<simple_label> queue(0, 1, 100000, &costs, type);
+    EXPECT_EQ(queue.type(), type);
+    TrySimulation(queue, costs);
+  }
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -5,6 +5,7 @@
 #include "midgard/sequence.h"
 #include "midgard/util.h"
 
+#include <boost/property_tree/ptree.hpp>
 #include <cmath>
 #include <fstream>
 #include <list>
@@ -118,6 +119,78 @@ TEST(Sample, getlz4) {
   _get("test/data/samplelz4");
 };
 
+TEST(Sample, get_all) {
+  // postings going back and forth between a tile with data and tiles without it
+  skadi::sample s("test/data/sample");
+  std::vector<midgard::PointLL> postings;
+  for (size_t i = 0; i < 1000; ++i) {
+    double lng = -77.1 + (i % 37) * 0.04;
+    double lat = 39.9 + (i % 23) * 0.06;
+    postings.emplace_back(lng, lat);
+  }
+  // the corners and last row of the tile
+  postings.emplace_back(-77.0, 40.0);
+  postings.emplace_back(-76.000001, 40.999999);
+  postings.emplace_back(-76.503915, 40.0);
+
+  auto heights = s.get_all(postings);
+  ASSERT_EQ(heights.size(), postings.size());
+  size_t with_data = 0;
+  for (size_t i = 0; i < postings.size(); ++i) {
+    EXPECT_EQ(heights[i], s.get(postings[i])) << "Batch differs at posting " << i;
+    with_data += heights[i] != skadi::get_no_data_value();
+  }
+  EXPECT_GT(with_data, 0);
+  EXPECT_LT(with_data, postings.size());
+}
+
+TEST(Sample, cache) {
+  // the same compressed tile twice, one degree apart
+  for (const auto& dir : {"N40", "N41"}) {
+    const std::string name = std::string("/") + dir + "/" + dir + "W077.hgt";
+    filesystem::create_directories(std::string("test/data/samplecache/gz/") + dir);
+    std::ifstream in("test/data/samplegz/N40/N40W077.hgt.gz", std::ios::binary);
+    std::ofstream out("test/data/samplecache/gz" + name + ".gz", std::ios::binary | std::ios::trunc);
+    out << in.rdbuf();
+    filesystem::remove("test/data/samplecache/raw" + name);
+  }
+
+  boost::property_tree::ptree config;
+  config.put("additional_data.elevation", "test/data/samplecache/gz");
+  config.put("additional_data.elevation_cache_mb", 1);
+  config.put("additional_data.elevation_cache_dir", "test/data/samplecache/raw");
+
+  {
+    // room for one tile only, switching back and forth evicts and inflates them again
+    skadi::sample s(config);
+    for (int i = 0; i < 3; ++i) {
+      EXPECT_NEAR(490, s.get(std::make_pair(-76.503915, 40.678783)), 1.0);
+      EXPECT_NEAR(490, s.get(std::make_pair(-76.503915, 41.678783)), 1.0);
+    }
+    // the inflated tiles were kept raw
+    EXPECT_TRUE(filesystem::exists("test/data/samplecache/raw/N40/N40W077.hgt"));
+    EXPECT_TRUE(filesystem::exists("test/data/samplecache/raw/N41/N41W077.hgt"));
+  }
+
+  // the next one maps those instead, there is nothing left to inflate up front
+  skadi::sample s(config);
+  EXPECT_EQ(s.unpack_to_cache(), 0);
+  EXPECT_NEAR(490, s.get(std::make_pair(-76.503915, 40.678783)), 1.0);
+
+  // precomputing writes the ones that aren't there yet
+  filesystem::remove("test/data/samplecache/raw/N41/N41W077.hgt");
+  EXPECT_EQ(skadi::sample(config).unpack_to_cache(), 1);
+  EXPECT_TRUE(filesystem::exists("test/data/samplecache/raw/N41/N41W077.hgt"));
+
+  // or the config asks for it on startup
+  filesystem::remove("test/data/samplecache/raw/N40/N40W077.hgt");
+  config.put("additional_data.elevation_cache_unpack", true);
+  skadi::sample unpacked(config);
+  EXPECT_TRUE(filesystem::exists("test/data/samplecache/raw/N40/N40W077.hgt"));
+  EXPECT_EQ(unpacked.unpack_to_cache(), 0);
+  EXPECT_NEAR(490, unpacked.get(std::make_pair(-76.503915, 40.678783)), 1.0);
+}
+
 struct testable_sample_t : public skadi::sample {
   testable_sample_t(const std::string& dir) : sample(dir) {
     {
@@ -45,6 +45,28 @@ TEST(UniqueNames, TestAddAndIndex) {
   EXPECT_EQ(names.name(index6), "I-95 N");
 }
 
+TEST(UniqueNames, Compact) {
+  UniqueNames names;
+  uint32_t index1 = names.index("I-95");
+  uint32_t index2 = names.index("");
+  uint32_t index3 = names.index("Interstate 95 Northbound Express Lanes");
+  names.Compact();
+
+  // Indexes and names stay the same but no more can be added
+  EXPECT_EQ(names.Size(), 2);
+  EXPECT_EQ(index2, 0);
+  EXPECT_EQ(names.name(index1), "I-95");
+  EXPECT_EQ(names.name(index2), "");
+  EXPECT_EQ(names.name(index3), "Interstate 95 Northbound Express Lanes");
+  EXPECT_EQ(names.name(index3 + 1), "");
+  EXPECT_THROW(names.index("I-95"), std::logic_error);
+
+  UniqueNames empty;
+  empty.Compact();
+  EXPECT_EQ(empty.Size(), 0);
+  EXPECT_EQ(empty.name(0), "");
+}
+
 } // namespace
 
 int main(int argc, char* argv[]) {
@@ -4,6 +4,7 @@
 #include "midgard/polyline2.h"
 #include "midgard/sequence.h"
 #include "midgard/util.h"
+#include <atomic>
 #include <cmath>
 #include <cstdlib>
 #include <random>
@@ -717,20 +718,83 @@ TEST(UtilMidgard, SequenceSort) {
   std::vector<uint8_t> in_mem;
   valhalla::midgard::sequence<uint8_t> merge("char_sequence_test_merge.bin", true, 1327);
   valhalla::midgard::sequence<uint8_t> standard("char_sequence_test_standard.bin", true, 1327 * 5);
+  valhalla::midgard::sequence<uint8_t> parallel_merge("char_sequence_test_parallel_merge.bin", true);
+  valhalla::midgard::sequence<uint8_t> parallel("char_sequence_test_parallel.bin", true);
 
   for (int i = 0; i < int(1327 * 4.5); ++i) {
     auto n = static_cast<uint8_t>(rand() % std::numeric_limits<uint8_t>::max());
     in_mem.push_back(n);
     merge.push_back(n);
     standard.push_back(n);
+    parallel_merge.push_back(n);
+    parallel.push_back(n);
   }
 
   std::sort(in_mem.begin(), in_mem.end());
   merge.sort(std::less<uint8_t>(), 1327);
   standard.sort(std::less<uint8_t>(), 1327 * 5);
+  parallel_merge.sort(std::less<uint8_t>(), 1327, 3);
+  parallel.sort(std::less<uint8_t>(), 1327 * 5, 4);
 
   EXPECT_TRUE(std::equal(in_mem.begin(), in_mem.end(), merge.begin()));
   EXPECT_TRUE(std::equal(in_mem.begin(), in_mem.end(), standard.begin()));
+  EXPECT_TRUE(std::equal(in_mem.begin(), in_mem.end(), parallel_merge.begin()));
+  EXPECT_TRUE(std::equal(in_mem.begin(), in_mem.end(), parallel.begin()));
+}
+
+TEST(UtilMidgard, SequenceSortMoreThreadsThanElements) {
+  valhalla::midgard::sequence<uint32_t> few("uint_sequence_test_few.bin", true);
+  few.push_back(3);
+  few.push_back(1);
+  few.push_back(2);
+  few.sort(std::less<uint32_t>(), 2, 8);
+  EXPECT_EQ(few.size(), 3);
+  EXPECT_EQ(*few.at(0), 1);
+  EXPECT_EQ(*few.at(1), 2);
+  EXPECT_EQ(*few.at(2), 3);
+}
+
+TEST(UtilMidgard, SequenceSortIsStable) {
+  // Compare only the high byte so there are lots of ties, the low bits remember the input order
+  auto high_byte = [](uint32_t a, uint32_t b) { return (a >> 24) < (b >> 24); };
+  std::vector<uint32_t> in_mem;
+  for (uint32_t i = 0; i < 1327 * 4; ++i) {
+    in_mem.push_back((static_cast<uint32_t>(rand() % 16) << 24) | i);
+  }
+  for (unsigned int concurrency : {1, 3, 4}) {
+    for (size_t buffer_size : {size_t(1327), size_t(1327 * 5)}) {
+      valhalla::midgard::sequence<uint32_t> stable("uint_sequence_test_stable.bin", true);
+      for (auto n : in_mem) {
+        stable.push_back(n);
+      }
+      stable.sort(high_byte, buffer_size, concurrency);
+      auto expected = in_mem;
+      std::stable_sort(expected.begin(), expected.end(), high_byte);
+      EXPECT_TRUE(std::equal(expected.begin(), expected.end(), stable.begin()))
+          << "concurrency " << concurrency << " buffer " << buffer_size;
+    }
+  }
+}
+
+TEST(UtilMidgard, ParallelFor) {
+  for (unsigned int concurrency : {1, 2, 5}) {
+    std::vector<std::atomic<int>> visits(1000);
+    parallel_for(concurrency, visits.size(), [&](size_t worker, size_t i) {
+      EXPECT_LT(worker, concurrency);
+      visits[i]++;
+    });
+    for (const auto& v : visits) {
+      EXPECT_EQ(v, 1);
+    }
+  }
+
+  EXPECT_THROW(parallel_for(4, 1000,
+                            [](size_t, size_t i) {
+                              if (i == 500) {
+                                throw std::runtime_error("500");
+                              }
+                            }),
+               std::runtime_error);
 }
 
 TEST(UtilMidgard, TriangleContains) {
@@ -781,6 +845,53 @@ TEST(UtilMidgard, PolygonArea) {
   }
 }
 
+TEST(UtilMidgard, ProjectShape) {
+  std::mt19937 generator(17);
+  std::uniform_real_distribution<double> offset(-0.01, 0.01);
+  for (size_t count = 0; count < 40; ++count) {
+    for (int trial = 0; trial < 50; ++trial) {
+      projector_t project(PointLL(5.1 + offset(generator), 52.1 + offset(generator)));
+      std::vector<PointLL> shape;
+      shape_buffer_t buffer;
+      for (size_t i = 0; i < count; ++i) {
+        // some zero length segments too
+        shape.push_back(i > 0 && trial % 5 == 0
+                            ? shape.back()
+                            : PointLL(5.1 + offset(generator), 52.1 + offset(generator)));
+        buffer.lngs.push_back(shape.back().lng());
+        buffer.lats.push_back(shape.back().lat());
+      }
+
+      // one segment at a time
+      PointLL closest = count ? shape.front() : PointLL();
+      double closest_sq_distance = std::numeric_limits<double>::max();
+      size_t closest_segment = 0;
+      for (size_t i = 0; i + 1 < count; ++i) {
+        auto point = project(shape[i], shape[i + 1]);
+        auto sq_distance = project.approx.DistanceSquared(point);
+        if (sq_distance < closest_sq_distance) {
+          closest = point;
+          closest_sq_distance = sq_distance;
+          closest_segment = i;
+        }
+      }
+
+      // all at once has to give the very same answer
+      auto projection = project(buffer.lngs.data(), buffer.lats.data(), buffer.size());
+      EXPECT_EQ(std::get<0>(projection), closest) << count;
+      EXPECT_EQ(std::get<1>(projection), closest_sq_distance) << count;
+      EXPECT_EQ(std::get<2>(projection), closest_segment) << count;
+    }
+  }
+
+  // ties go to the first segment
+  projector_t project(PointLL(0.5, 1));
+  shape_buffer_t buffer;
+  buffer.lngs = {0, 1, 0, 1, 0, 1, 0};
+  buffer.lats = {0, 0, 0, 0, 0, 0, 0};
+  EXPECT_EQ(std::get<2>(project(buffer.lngs.data(), buffer.lats.data(), buffer.size())), 0);
+}
+
 } // namespace
 
 int main(int argc, char* argv[]) {
@@ -1,6 +1,7 @@
 #include <fstream>
 #include <sstream>
 #include <unordered_map>
+#include <vector>
 
 #include <boost/property_tree/ptree.hpp>
 
@@ -27,6 +28,70 @@ using valhalla::mjolnir::TileManifest;
 using namespace valhalla;
 using namespace valhalla::midgard;
 
+// Copy the files of a tile directory to another
+void copy_tiles(const std::string& from, const std::string& to) {
+  for (filesystem::recursive_directory_iterator i(from), end; i != end; ++i) {
+    if (!i->is_regular_file()) {
+      continue;
+    }
+    filesystem::path target(to + i->path().string().substr(from.size()));
+    filesystem::create_directories(target.parent_path());
+    std::ifstream in(i->path().string(), std::ios::binary);
+    std::ofstream out(target.string(), std::ios::binary);
+    out << in.rdbuf();
+  }
+}
+
+std::string read_file(const std::string& path) {
+  std::ifstream in(path, std::ios::binary);
+  std::stringstream ss;
+  ss << in.rdbuf();
+  return ss.str();
+}
+
+// The hierarchy and the shortcuts are the same whatever the number of threads building them. This
+// runs before BuildTileSet, which frees the protobuf library once done with parsing
+TEST(UtilMjolnir, HierarchyAndShortcutsIndependentOfConcurrency) {
+  const std::string serial_dir("test/data/util_mjolnir_serial_tiles");
+  const std::string parallel_dir("test/data/util_mjolnir_parallel_tiles");
+  const std::vector<std::string> input_files{VALHALLA_SOURCE_DIR "test/data/harrisburg.osm.pbf"};
+  ptree config;
+  config.put("mjolnir.tile_dir", serial_dir);
+  config.put("mjolnir.concurrency", 1);
+  config.put("mjolnir.parallel_hierarchy", true);
+  ASSERT_TRUE(build_tile_set(config, input_files, mjolnir::BuildStage::kInitialize,
+                             mjolnir::BuildStage::kBss, false));
+  if (filesystem::exists(parallel_dir)) {
+    filesystem::remove_all(parallel_dir);
+  }
+  copy_tiles(serial_dir, parallel_dir);
+
+  ASSERT_TRUE(build_tile_set(config, input_files, mjolnir::BuildStage::kHierarchy,
+                             mjolnir::BuildStage::kShortcuts, false));
+  config.put("mjolnir.tile_dir", parallel_dir);
+  config.put("mjolnir.concurrency", 3);
+  ASSERT_TRUE(build_tile_set(config, input_files, mjolnir::BuildStage::kHierarchy,
+                             mjolnir::BuildStage::kShortcuts, false));
+
+  size_t serial_tiles = 0, parallel_tiles = 0;
+  for (filesystem::recursive_directory_iterator i(serial_dir), end; i != end; ++i) {
+    const auto path = i->path().string();
+    if (i->is_regular_file() && path.find(".gph") != std::string::npos) {
+      const auto parallel_path = parallel_dir + path.substr(serial_dir.size());
+      EXPECT_EQ(read_file(path), read_file(parallel_path)) << parallel_path;
+      ++serial_tiles;
+    }
+  }
+  for (filesystem::recursive_directory_iterator i(parallel_dir), end; i != end; ++i) {
+    parallel_tiles += i->is_regular_file() && i->path().string().find(".gph") != std::string::npos;
+  }
+  EXPECT_GT(serial_tiles, 4);
+  EXPECT_EQ(serial_tiles, parallel_tiles);
+
+  filesystem::remove_all(serial_dir);
+  filesystem::remove_all(parallel_dir);
+}
+
 // Verify that this function runs
 TEST(UtilMjolnir, BuildTileSet) {
   ptree config;
@@ -0,0 +1,175 @@
+#ifndef VALHALLA_BALDR_CONTRACTIONHIERARCHY_H_
+#define VALHALLA_BALDR_CONTRACTIONHIERARCHY_H_
+
+#include <cstdint>
+#include <limits>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <valhalla/baldr/graphid.h>
+#include <valhalla/midgard/sequence.h>
+#include <valhalla/proto/options.pb.h>
+
+namespace valhalla {
+namespace baldr {
+
+// Marks an invalid node or arc index within the contraction hierarchy
+constexpr uint32_t kInvalidContractionIndex = std::numeric_limits<uint32_t>::max();
+
+// Bump this whenever the layout of the file changes
+constexpr uint32_t kContractionHierarchyVersion = 2;
+
+/**
+ * Header of a contraction hierarchy file. The arrays follow it in the order of the members that
+ * describe their sizes, each one starting at a multiple of 8 bytes:
+ *   uint64_t nodes[node_count]           sorted GraphId values of the nodes
+ *   uint32_t forward_offsets[node_count + 1], uint32_t forward[forward_count]
+ *   uint32_t reverse_offsets[node_count + 1], uint32_t reverse[reverse_count]
+ *   ContractionArc arcs[arc_count]
+ */
+struct ContractionHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t spare;
+  // Hash of the serialized costing options the hierarchy was built with
+  uint64_t profile;
+  uint64_t node_count;
+  uint64_t forward_count;
+  uint64_t reverse_count;
+  uint64_t arc_count;
+};
+
+/**
+ * An arc of the contracted graph. Either a directed edge of the routing graph, a transition
+ * between hierarchy levels (no edge and no children) or a shortcut that replaces the two arcs
+ * tail -> via and via -> head, which are its children.
+ */
+struct ContractionArc {
+  uint32_t tail;
+  uint32_t head;
+  float cost;
+  float secs;      // travel time in seconds, without turn costs
+  uint32_t first;
+  uint32_t second;
+  uint32_t length; // length in meters
+  uint32_t spare;
+  uint64_t edgeid;
+
+  bool is_shortcut() const {
+    return first != kInvalidContractionIndex;
+  }
+};
+
+/**
+ * Read only, memory mapped access to a contraction hierarchy built by mjolnir. Every node is only
+ * linked to the arcs leading to higher ranked nodes, in the forward direction by its outbound
+ * arcs and in the reverse direction by its inbound arcs, which is all a bidirectional search of
+ * the hierarchy needs.
+ */
+class ContractionHierarchy {
+public:
+  /**
+   * Maps the file, throws if it is not a contraction hierarchy of the current version.
+   * @param file_name  path to the file written by mjolnir::ContractionBuilder
+   */
+  explicit ContractionHierarchy(const std::string& file_name);
+
+  /**
+   * @return hash of the costing options the hierarchy was built with
+   */
+  uint64_t profile() const {
+    return header_->profile;
+  }
+
+  /**
+   * Was the hierarchy built for the costing of the request, ie. is it an auto request whose
+   * costing options hash to the profile of the hierarchy.
+   * @param options  the request options
+   * @return true if the hierarchy can answer the request
+   */
+  bool matches(const Options& options) const;
+
+  /**
+   * @return number of nodes in the hierarchy
+   */
+  uint32_t node_count() const {
+    return header_->node_count;
+  }
+
+  /**
+   * Finds the index of a node of the routing graph in the hierarchy.
+   * @param node  graph id of the node
+   * @return index of the node or kInvalidContractionIndex if it isn't part of the hierarchy
+   */
+  uint32_t node(const GraphId& node) const;
+
+  /**
+   * @param index  index of a node in the hierarchy
+   * @return graph id of the node
+   */
+  GraphId node_id(const uint32_t index) const {
+    return GraphId(nodes_[index]);
+  }
+
+  /**
+   * @param index  index of a node in the hierarchy
+   * @return range of arc indices leaving the node towards higher ranked nodes
+   */
+  std::pair<const uint32_t*, const uint32_t*> forward_arcs(const uint32_t index) const {
+    return {forward_ + forward_offsets_[index], forward_ + forward_offsets_[index + 1]};
+  }
+
+  /**
+   * @param index  index of a node in the hierarchy
+   * @return range of arc indices entering the node from higher ranked nodes
+   */
+  std::pair<const uint32_t*, const uint32_t*> reverse_arcs(const uint32_t index) const {
+    return {reverse_ + reverse_offsets_[index], reverse_ + reverse_offsets_[index + 1]};
+  }
+
+  /**
+   * @param index  index of an arc
+   * @return the arc
+   */
+  const ContractionArc& arc(const uint32_t index) const {
+    return arcs_[index];
+  }
+
+  /**
+   * Appends the edges of the routing graph an arc stands for, shortcuts are unpacked into the
+   * arcs they replace and transitions between levels have no edge to add.
+   * @param index  index of an arc
+   * @param edges  the edges of the arc are appended to these in path order
+   */
+  void unpack(const uint32_t index, std::vector<GraphId>& edges) const;
+
+  /**
+   * Computes the hash stored as the profile of the hierarchy.
+   * @param bytes  serialized costing options
+   * @return 64 bit FNV-1a hash of the bytes
+   */
+  static uint64_t hash_profile(const std::string& bytes);
+
+  /**
+   * The magic the file starts with
+   */
+  static const char* magic() {
+    return "VALHALCH";
+  }
+
+protected:
+  midgard::mem_map<char> memory_;
+  const ContractionHeader* header_;
+  const uint64_t* nodes_;
+  const uint32_t* forward_offsets_;
+  const uint32_t* forward_;
+  const uint32_t* reverse_offsets_;
+  const uint32_t* reverse_;
+  const ContractionArc* arcs_;
+};
+
+} // namespace baldr
+} // namespace valhalla
+
+#endif // VALHALLA_BALDR_CONTRACTIONHIERARCHY_H_
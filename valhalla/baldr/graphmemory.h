@@ -11,6 +11,15 @@ protected:
 public:
   virtual ~GraphMemory() = default;
 
+  /**
+   * Is the memory a view of a memory mapped file. Mapped memory lives in the page cache, it can be
+   * shared with other processes mapping the same file and the kernel can drop it at any time.
+   * @return true if the memory is mapped rather than owned
+   */
+  virtual bool mapped() const {
+    return false;
+  }
+
   char* data;
   size_t size;
 };
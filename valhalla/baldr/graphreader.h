@@ -1,11 +1,13 @@
 #pragma once
 
 #include <algorithm>
+#include <atomic>
 #include <cstdint>
 #include <memory>
 #include <mutex>
 #include <string>
 #include <unordered_map>
+#include <unordered_set>
 
 #include <boost/property_tree/ptree.hpp>
 
@@ -91,6 +93,14 @@ public:
    *  Some implementations may simply clear the entire cache
    */
   virtual void Trim() = 0;
+
+  /**
+   * Lets you know if many threads can use the cache at once.
+   * @return true if the cache is thread-safe
+   */
+  virtual bool IsThreadSafe() const {
+    return false;
+  }
 };
 
 /**
@@ -409,11 +419,98 @@ public:
    */
   void Trim() override;
 
+  /**
+   * Lets you know if many threads can use the cache at once.
+   * @return true, the cache is thread-safe
+   */
+  bool IsThreadSafe() const override {
+    return true;
+  }
+
 private:
   TileCache& cache_;
   std::mutex& mutex_ref_;
 };
 
+/**
+ * Tile cache meant to be shared by many threads at once. Tiles are kept in a flat, tile-indexed
+ * array of slots (the same layout as FlatTileCache) and writers are serialized per shard, where
+ * the shard of a tile is picked from its tile id and level. Reads never take a lock: a reader
+ * publishes the current epoch in its own cache line, loads the slot and copies the tile pointer.
+ * Clear and Trim detach the slots and wait for every reader that may still be looking at them to
+ * leave its epoch before the entries are released.
+ *
+ * Copies share the same underlying storage which is how the TileCacheFactory hands out one
+ * working set to all of the GraphReaders in a process. It is thread-safe, as long as the tile
+ * references themselves are (i.e. ENABLE_THREAD_SAFE_TILE_REF_COUNT is ON).
+ */
+class ConcurrentTileCache : public TileCache {
+public:
+  /**
+   * Constructor.
+   * @param max_size     maximum size of the cache
+   * @param shard_count  number of independently locked writer shards
+   */
+  ConcurrentTileCache(size_t max_size, size_t shard_count);
+
+  /**
+   * Reserves enough cache to hold (max_cache_size / tile_size) items.
+   * @param tile_size appeoximate size of one tile
+   */
+  void Reserve(size_t tile_size) override;
+
+  /**
+   * Checks if tile exists in the cache.
+   * @param graphid  the graphid of the tile
+   * @return true if tile exists in the cache
+   */
+  bool Contains(const GraphId& graphid) const override;
+
+  /**
+   * Puts a copy of a tile of into the cache. If another thread already cached the tile the
+   * cached copy wins and is returned instead.
+   * @param graphid  the graphid of the tile
+   * @param tile the graph tile
+   * @param size size of the tile in memory
+   */
+  graph_tile_ptr Put(const GraphId& graphid, graph_tile_ptr tile, size_t size) override;
+
+  /**
+   * Get a pointer to a graph tile object given a GraphId.
+   * @param graphid  the graphid of the tile
+   * @return GraphTile* a pointer to the graph tile
+   */
+  graph_tile_ptr Get(const GraphId& graphid) const override;
+
+  /**
+   * Lets you know if the cache is too large.
+   * @return true if the cache is over committed with respect to the limit
+   */
+  bool OverCommitted() const override;
+
+  /**
+   * Clears the cache.
+   */
+  void Clear() override;
+
+  /**
+   *  Evicts whole shards, one after the other, until the cache is no longer overcommitted.
+   */
+  void Trim() override;
+
+  /**
+   * Lets you know if many threads can use the cache at once.
+   * @return true, the cache is thread-safe
+   */
+  bool IsThreadSafe() const override {
+    return true;
+  }
+
+protected:
+  struct store_t;
+  std::shared_ptr<store_t> store_;
+};
+
 /**
  * Creates tile caches.
  */
@@ -519,6 +616,55 @@ public:
     cache_->Trim();
   }
 
+  /**
+   * Lets you know if many threads can get tiles from the reader at once. This needs a thread-safe
+   * cache as well as thread-safe tile references (ENABLE_THREAD_SAFE_TILE_REF_COUNT).
+   * @return true if GetGraphTile is thread-safe
+   */
+  bool IsThreadSafe() const {
+#ifdef ENABLE_THREAD_SAFE_TILE_REF_COUNT
+    return cache_->IsThreadSafe();
+#else
+    return false;
+#endif
+  }
+
+  /**
+   * Lets you know if tiles are read ahead of a search, see mjolnir.tile_prefetch.
+   * @return true if Prefetch does anything
+   */
+  bool PrefetchEnabled() const {
+    return tile_prefetch_;
+  }
+
+  /**
+   * Asks the OS to read ahead the tiles a search is heading for so that loading them later doesn't
+   * block on the disk. These are the neighbours of the tile containing ll on the given level, the
+   * one towards target and the ones diagonally either side of it. Tiles already in the cache or
+   * already prefetched are skipped. Extract tiles are madvised, tile files are fadvised, neither
+   * touches the cache so this is as thread-safe as the cache is.
+   * @param  ll      Where the search is
+   * @param  target  Where the search is going, usually what its A* heuristic measures to
+   * @param  level   Hierarchy level the search is on
+   */
+  void Prefetch(const midgard::PointLL& ll, const midgard::PointLL& target, const uint8_t level);
+
+  // How prefetching is doing: tiles prefetched, loads of prefetched tiles and loads of tiles
+  // that were not prefetched. issued - hits are the prefetches that were not needed (yet)
+  struct prefetch_stats_t {
+    uint64_t issued;
+    uint64_t hits;
+    uint64_t misses;
+  };
+
+  /**
+   * Gets the prefetch counters, these are only kept when prefetching is enabled.
+   * @return the counters since the reader was made
+   */
+  prefetch_stats_t GetPrefetchStats() const {
+    return {prefetch_issued_.load(), prefetch_hits_.load(), prefetch_misses_.load()};
+  }
+
   /**
    * Returns the maximum number of threads that can
    * use the reader concurrently without blocking
@@ -947,6 +1093,8 @@ protected:
     std::shared_ptr<midgard::tar> archive;
     std::shared_ptr<midgard::tar> traffic_archive;
     uint64_t checksum;
+    // whether the tiles are LZ4 frames of their own and have to be decoded when loaded
+    bool compressed = false;
   };
   std::shared_ptr<const tile_extract_t> tile_extract_;
   static std::shared_ptr<const GraphReader::tile_extract_t>
@@ -955,6 +1103,29 @@ protected:
   // Information about where the tiles are kept
   const std::string tile_dir_;
 
+  // Whether tile files are memory mapped instead of read onto the heap
+  const bool mmap_tile_files_;
+
+  // Whether tiles are read ahead of searches, which ones were and how that worked out
+  const bool tile_prefetch_;
+  std::mutex prefetched_lock_;
+  std::unordered_set<GraphId> prefetched_;
+  std::atomic<uint64_t> prefetch_issued_;
+  std::atomic<uint64_t> prefetch_hits_;
+  std::atomic<uint64_t> prefetch_misses_;
+
+  /**
+   * Asks the OS to read ahead a single tile unless it is cached or was already prefetched.
+   * @param  base  the tile
+   */
+  void ReadAhead(const GraphId& base);
+
+  /**
+   * Counts the load of a tile as a prefetch hit or miss.
+   * @param  base  the tile that was not in the cache
+   */
+  void CountPrefetch(const GraphId& base);
+
   // Stuff for getting at remote tiles
   std::unique_ptr<tile_getter_t> tile_getter_;
   const size_t max_concurrent_users_;
@@ -59,11 +59,15 @@ public:
    * into memory.
    * @param  tile_dir   Tile directory.
    * @param  graphid    GraphId (tileid and level)
+   * @param  traffic_memory  Traffic data of the tile if there is any
+   * @param  mmap       Memory map the tile file instead of reading it, gzipped tiles are always
+   *                    inflated onto the heap
    * @return nullptr if the tile could not be loaded. may throw
    */
   static graph_tile_ptr Create(const std::string& tile_dir,
                                const GraphId& graphid,
-                               std::unique_ptr<const GraphMemory>&& traffic_memory = nullptr);
+                               std::unique_ptr<const GraphMemory>&& traffic_memory = nullptr,
+                               const bool mmap = false);
 
   /**
    * Constructs with a given the graph Id, pointer to the tile data, and the
@@ -84,6 +88,33 @@ public:
                                std::unique_ptr<const GraphMemory>&& memory,
                                std::unique_ptr<const GraphMemory>&& traffic_memory = nullptr);
 
+  /**
+   * Constructs a tile from gzipped tile bytes, eg. a downloaded .gph.gz tile.
+   * @param  graphid          Tile Id.
+   * @param  compressed       Pointer to the start of the gzipped tile data.
+   * @param  compressed_size  Size in bytes of the gzipped tile data.
+   * @param  traffic_memory   Traffic data of the tile if there is any.
+   * @return nullptr if the data could not be inflated
+   */
+  static graph_tile_ptr Decompress(const GraphId& graphid,
+                                   const char* compressed,
+                                   size_t compressed_size,
+                                   std::unique_ptr<const GraphMemory>&& traffic_memory = nullptr);
+
+  /**
+   * Constructs a tile from an LZ4 frame of tile bytes, ie. a tile of a compressed tile extract.
+   * @param  graphid          Tile Id.
+   * @param  compressed       Pointer to the start of the LZ4 frame.
+   * @param  compressed_size  Size in bytes of the LZ4 frame.
+   * @param  traffic_memory   Traffic data of the tile if there is any.
+   * @return nullptr if the data could not be decoded
+   */
+  static graph_tile_ptr
+  DecompressLZ4(const GraphId& graphid,
+                const char* compressed,
+                size_t compressed_size,
+                std::unique_ptr<const GraphMemory>&& traffic_memory = nullptr);
+
   /**
    * Constructs a tile given a url for the tile using curl
    * @param  tile_url URL of tile
@@ -141,6 +172,14 @@ public:
     return header_->graphid();
   }
 
+  /**
+   * Is the tile data memory mapped from a file rather than held on the heap.
+   * @return  Returns true if the tile bytes live in the page cache.
+   */
+  bool mapped() const {
+    return memory_ && memory_->mapped();
+  }
+
   /**
    * Gets a pointer to the graph tile header.
    * @return  Returns the header for the graph tile.
@@ -0,0 +1,128 @@
+#pragma once
+
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <valhalla/baldr/double_bucket_queue.h>
+#include <valhalla/baldr/radix_queue.h>
+#include <vector>
+
+namespace valhalla {
+namespace baldr {
+
+// Which priority queue a LabelQueue uses underneath
+enum class QueueType : uint8_t { kDoubleBucket = 0, kRadix = 1 };
+
+/**
+ * Parses the queue type as it is named in the config.
+ * @param  name  "double_bucket" or "radix"
+ * @return the queue type, throws if the name is not known
+ */
+inline QueueType to_queue_type(const std::string& name) {
+  if (name == "double_bucket") {
+    return QueueType::kDoubleBucket;
+  }
+  if (name == "radix") {
+    return QueueType::kRadix;
+  }
+  throw std::runtime_error("Unknown queue_type: " + name);
+}
+
+/**
+ * Priority queue of label indexes used by the path algorithms. Lets the algorithms switch between
+ * the approximate DoubleBucketQueue and the monotone RadixQueue at runtime, both are kept around
+ * so that switching does not throw away their buffers.
+ */
+template <typename label_t> class LabelQueue final {
+public:
+  /**
+   * Default c-tor creates empty object that needs to be initialized with `reuse` method
+   * @param type  Which queue to use underneath
+   */
+  explicit LabelQueue(const QueueType type = QueueType::kDoubleBucket) : type_(type) {
+  }
+
+  /**
+   * Constructor, see DoubleBucketQueue for the meaning of the parameters.
+   * @param mincost    Minimum cost.
+   * @param range      Cost range for low-level buckets.
+   * @param bucketsize Bucket size (range of costs within same bucket).
+   * @param labelcontainer  Container of labels with sortcosts.
+   * @param type       Which queue to use underneath
+   */
+  LabelQueue(const float mincost,
+             const float range,
+             const uint32_t bucketsize,
+             const std::vector<label_t>* labelcontainer,
+             const QueueType type = QueueType::kDoubleBucket)
+      : type_(type) {
+    reuse(mincost, range, bucketsize, labelcontainer);
+  }
+
+  LabelQueue(LabelQueue&&) = default;
+  LabelQueue& operator=(LabelQueue&&) = default;
+  LabelQueue(const LabelQueue&) = delete;
+  LabelQueue& operator=(const LabelQueue&) = delete;
+
+  /**
+   * Switches the underlying queue, should only be done while the queue is empty.
+   * @param type  Which queue to use underneath
+   */
+  void set_type(const QueueType type) {
+    type_ = type;
+  }
+
+  /**
+   * @return which queue is used underneath
+   */
+  QueueType type() const {
+    return type_;
+  }
+
+  void reuse(const float mincost,
+             const float range,
+             const uint32_t bucketsize,
+             const std::vector<label_t>* labelcontainer) {
+    if (type_ == QueueType::kRadix) {
+      radix_.reuse(mincost, range, bucketsize, labelcontainer);
+    } else {
+      buckets_.reuse(mincost, range, bucketsize, labelcontainer);
+    }
+  }
+
+  void clear() {
+    if (type_ == QueueType::kRadix) {
+      radix_.clear();
+    } else {
+      buckets_.clear();
+    }
+  }
+
+  void add(const uint32_t label) {
+    if (type_ == QueueType::kRadix) {
+      radix_.add(label);
+    } else {
+      buckets_.add(label);
+    }
+  }
+
+  void decrease(const uint32_t label, const float newcost) {
+    if (type_ == QueueType::kRadix) {
+      radix_.decrease(label, newcost);
+    } else {
+      buckets_.decrease(label, newcost);
+    }
+  }
+
+  uint32_t pop() {
+    return type_ == QueueType::kRadix ? radix_.pop() : buckets_.pop();
+  }
+
+private:
+  QueueType type_;
+  DoubleBucketQueue<label_t> buckets_;
+  RadixQueue<label_t> radix_;
+};
+
+} // namespace baldr
+} // namespace valhalla
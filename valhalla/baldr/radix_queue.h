@@ -0,0 +1,203 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <valhalla/baldr/graphconstants.h>
+#include <vector>
+
+namespace valhalla {
+namespace baldr {
+
+/**
+ * Radix heap - a monotone priority queue with the same interface as the DoubleBucketQueue.
+ * Costs are keyed by the bit pattern of their (non-negative) float value, which orders the same
+ * way as the floats themselves. A label lives in the bucket of the highest bit in which its key
+ * differs from the last popped key, so refilling only ever redistributes a single bucket and
+ * there is no cost range to overflow. Decreasing a cost does not search for the old entry, it
+ * pushes a new one and the old one is skipped once it is popped since its cost no longer matches
+ * the label's sort cost. Keys smaller than the last popped one (inconsistent heuristics) are
+ * treated as equal to it, much like the DoubleBucketQueue puts them in the current bucket.
+ */
+template <typename label_t> class RadixQueue final {
+public:
+  /**
+   * Default c-tor creates empty object that needs to be initialized with `reuse` method
+   */
+  RadixQueue() {
+    reuse(0.f, 1.f, 1, nullptr);
+  }
+
+  /**
+   * Constructor given the same arguments as the DoubleBucketQueue so they can be swapped.
+   * @param mincost    Minimum cost.
+   * @param range      Cost range, not needed here but validated like the DoubleBucketQueue.
+   * @param bucketsize Bucket size, not needed here but validated like the DoubleBucketQueue.
+   * @param labelcontainer  Container of labels with sortcosts.
+   */
+  RadixQueue(const float mincost,
+             const float range,
+             const uint32_t bucketsize,
+             const std::vector<label_t>* labelcontainer) {
+    reuse(mincost, range, bucketsize, labelcontainer);
+  }
+
+  RadixQueue(RadixQueue&&) = default;
+  RadixQueue& operator=(RadixQueue&&) = default;
+  RadixQueue(const RadixQueue&) = delete;
+  RadixQueue& operator=(const RadixQueue&) = delete;
+
+  /**
+   * The same as c-tor, but without buffers reallocation. Before call this
+   * method you should clean up the current state (call `clear`).
+   * @param mincost    Minimum cost.
+   * @param range      Cost range, must be greater than 0.
+   * @param bucketsize Bucket size, must be 1 or greater.
+   * @param labelcontainer  Container of labels with sortcosts.
+   */
+  void reuse(const float mincost,
+             const float range,
+             const uint32_t bucketsize,
+             const std::vector<label_t>* labelcontainer) {
+    labelcontainer_ = labelcontainer;
+    if (bucketsize < 1) {
+      throw std::runtime_error("Bucketsize must be 1 or greater");
+    }
+    if (range <= 0.f) {
+      throw std::runtime_error("Bucketrange must be greater than 0");
+    }
+    minkey_ = to_key(mincost);
+    lastkey_ = minkey_;
+  }
+
+  /**
+   * Clear all labels from the buckets, the memory of the buckets is kept.
+   */
+  void clear() {
+    for (auto& bucket : buckets_) {
+      bucket.clear();
+    }
+    lastkey_ = minkey_;
+  }
+
+  /**
+   * Adds a label index to the queue.
+   * @param   label  Label index to add to the queue.
+   */
+  void add(const uint32_t label) {
+    push(label, (*labelcontainer_)[label].sortcost());
+  }
+
+  /**
+   * The specified label index now has a smaller cost. Must be called before the label's sort
+   * cost is updated, the entry with the old cost becomes stale and is skipped when popped.
+   * @param  label        Label index to reorder.
+   * @param  newcost      New sort cost.
+   */
+  void decrease(const uint32_t label, const float newcost) {
+    if (newcost != (*labelcontainer_)[label].sortcost()) {
+      push(label, newcost);
+    }
+  }
+
+  /**
+   * Removes the lowest cost label index from the queue.
+   * @return  Returns the label index of the lowest cost label. Returns
+   *          kInvalidLabel if the queue is empty.
+   */
+  uint32_t pop() {
+    while (true) {
+      if (buckets_[0].empty() && !refill()) {
+        return baldr::kInvalidLabel;
+      }
+      const entry_t entry = buckets_[0].back();
+      buckets_[0].pop_back();
+      // skip the entries left behind by decrease
+      if ((*labelcontainer_)[entry.label].sortcost() == entry.cost) {
+        return entry.label;
+      }
+    }
+  }
+
+private:
+  struct entry_t {
+    uint32_t key;
+    uint32_t label;
+    float cost;
+  };
+
+  // Bucket 0 holds keys equal to the last popped one, bucket i keys differing first in bit i-1
+  std::array<std::vector<entry_t>, 33> buckets_;
+
+  // The key we restart from after clear and the last key that was popped
+  uint32_t minkey_;
+  uint32_t lastkey_;
+
+  // Access to a container of labels to get cost given the label index.
+  const std::vector<label_t>* labelcontainer_;
+
+  /**
+   * Non-negative floats order the same as their bit patterns, anything else is clamped to 0
+   */
+  static uint32_t to_key(const float cost) {
+    if (!(cost > 0.f)) {
+      return 0;
+    }
+    uint32_t key;
+    std::memcpy(&key, &cost, sizeof(key));
+    return key;
+  }
+
+  /**
+   * The bucket for a key is the number of significant bits in which it differs from the last key
+   */
+  size_t bucket_index(const uint32_t key) const {
+    uint32_t diff = key ^ lastkey_;
+    if (diff == 0) {
+      return 0;
+    }
+#if defined(__GNUC__) || defined(__clang__)
+    return 32 - __builtin_clz(diff);
+#else
+    size_t index = 0;
+    while (diff) {
+      ++index;
+      diff >>= 1;
+    }
+    return index;
+#endif
+  }
+
+  void push(const uint32_t label, const float cost) {
+    const auto key = std::max(to_key(cost), lastkey_);
+    buckets_[bucket_index(key)].push_back({key, label, cost});
+  }
+
+  /**
+   * Finds the lowest non-empty bucket, makes its minimum the last key and redistributes it,
+   * which moves at least the minimum into bucket 0.
+   * @return false if all the buckets are empty
+   */
+  bool refill() {
+    auto bucket = std::find_if(buckets_.begin() + 1, buckets_.end(),
+                               [](const std::vector<entry_t>& b) { return !b.empty(); });
+    if (bucket == buckets_.end()) {
+      return false;
+    }
+
+    lastkey_ = std::min_element(bucket->begin(), bucket->end(), [](const entry_t& a,
+                                                                   const entry_t& b) {
+                 return a.key < b.key;
+               })->key;
+    for (const auto& entry : *bucket) {
+      buckets_[bucket_index(entry.key)].push_back(entry);
+    }
+    bucket->clear();
+    return true;
+  }
+};
+
+} // namespace baldr
+} // namespace valhalla
@@ -1,6 +1,9 @@
 #ifndef VALHALLA_BALDR_RAPIDJSON_UTILS_H_
 #define VALHALLA_BALDR_RAPIDJSON_UTILS_H_
 
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
 #include <fstream>
 #include <istream>
 #include <locale>
@@ -11,6 +14,8 @@
 #include <boost/lexical_cast.hpp>
 #include <boost/optional.hpp>
 
+#include <valhalla/baldr/json.h>
+
 // rapidjson asserts by default but we dont want to crash running server
 // its more useful to throw and catch for our use case
 #define RAPIDJSON_ASSERT_THROWS
@@ -298,6 +303,11 @@ public:
     writer.StartObject();
   }
 
+  inline void start_object(const std::string& name) {
+    writer.String(name);
+    writer.StartObject();
+  }
+
   inline void start_array() {
     writer.StartArray();
   }
@@ -307,6 +317,11 @@ public:
     writer.StartArray();
   }
 
+  inline void start_array(const std::string& name) {
+    writer.String(name);
+    writer.StartArray();
+  }
+
   inline void end_object() {
     writer.EndObject();
   }
@@ -393,6 +408,16 @@ public:
     writer.Null();
   }
 
+  inline void operator()(const char* key, const valhalla::baldr::json::fixed_t& value) {
+    writer.String(key);
+    operator()(value);
+  }
+
+  inline void operator()(const std::string& key, const valhalla::baldr::json::fixed_t& value) {
+    writer.String(key);
+    operator()(value);
+  }
+
   inline void operator()(const char* value) {
     writer.String(value);
   }
@@ -421,6 +446,19 @@ public:
   inline void operator()(const std::nullptr_t) {
     writer.Null();
   }
+
+  // a fixed number of decimals, rounded the same as streaming the json::fixed_t would
+  inline void operator()(const valhalla::baldr::json::fixed_t& value) {
+    char number[128];
+    int length = std::snprintf(number, sizeof(number), "%.*Lf", static_cast<int>(value.precision),
+                               value.value);
+    length = std::min(length, static_cast<int>(sizeof(number)) - 1);
+    if (std::isfinite(value.value)) {
+      writer.RawValue(number, length, rapidjson::kNumberType);
+    } else {
+      writer.String(number, length);
+    }
+  }
 };
 
 } // namespace rapidjson
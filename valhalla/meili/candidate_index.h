@@ -0,0 +1,102 @@
+// -*- mode: c++ -*-
+#ifndef MMP_CANDIDATE_INDEX_H_
+#define MMP_CANDIDATE_INDEX_H_
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include <valhalla/baldr/graphid.h>
+#include <valhalla/baldr/graphreader.h>
+#include <valhalla/midgard/aabb2.h>
+#include <valhalla/midgard/pointll.h>
+#include <valhalla/midgard/tiles.h>
+
+namespace valhalla {
+namespace meili {
+
+/**
+ * Spatial index of the edge shapes on the local level used to find the candidates of measurements.
+ * Each bin of a graph tile is divided into cells and indexed once into a list of (cell, edge)
+ * pairs sorted by cell. An indexed bin is never modified again so one index is shared by all the
+ * matchers working on the same graph reader, from one trace to the next and across threads.
+ */
+class CandidateIndex {
+public:
+  /**
+   * Constructor
+   * @param cell_width   width of the cells in degrees
+   * @param cell_height  height of the cells in degrees
+   */
+  CandidateIndex(float cell_width, float cell_height);
+
+  /**
+   * Gets the index shared by everyone using the same graph reader and cell size, making it if
+   * there is none yet. The index lives as long as someone holds on to it.
+   * @param reader       the graph reader the edges are read from
+   * @param cell_width   width of the cells in degrees
+   * @param cell_height  height of the cells in degrees
+   * @return the shared index
+   */
+  static std::shared_ptr<CandidateIndex>
+  Get(const baldr::GraphReader& reader, float cell_width, float cell_height);
+
+  /**
+   * Finds the edges with shape in any of the cells the range touches, indexing the bins the range
+   * covers if they weren't yet.
+   * @param reader  the graph reader to read the tiles of unindexed bins with
+   * @param range   the bounding box to search
+   * @return the edges, only one of the two directions of each edge is indexed
+   */
+  std::unordered_set<baldr::GraphId> Query(baldr::GraphReader& reader,
+                                           const midgard::AABB2<midgard::PointLL>& range) const;
+
+  /**
+   * @return the number of bins indexed so far
+   */
+  size_t size() const;
+
+  /**
+   * Drops all the indexed bins, anyone still querying one keeps it until done
+   */
+  void Clear();
+
+protected:
+  // The cells of one bin and the edges with shape in them
+  struct bin_t {
+    midgard::AABB2<midgard::PointLL> bbox;
+    int32_t ncols;
+    int32_t nrows;
+    std::vector<std::pair<uint32_t, baldr::GraphId>> cells; // (row * ncols + col, edge)
+  };
+
+  /**
+   * Gets an indexed bin, indexing it first if need be
+   * @param reader  the graph reader to read the tile of the bin with
+   * @param bin_id  id of the bin among all the bins of the local level
+   * @param tiles   the tiles of the local level
+   * @param bins    the bins of the local level
+   * @return the bin or nullptr if its tile isn't there
+   */
+  std::shared_ptr<const bin_t> GetBin(baldr::GraphReader& reader,
+                                      const int32_t bin_id,
+                                      const midgard::Tiles<midgard::PointLL>& tiles,
+                                      const midgard::Tiles<midgard::PointLL>& bins) const;
+
+  float cell_width_;
+  float cell_height_;
+  uint32_t bin_level_;
+
+  // The indexed bins, guarded by the lock because the index is shared across threads
+  mutable std::mutex lock_;
+  mutable std::unordered_map<int32_t, std::shared_ptr<const bin_t>> bins_;
+};
+
+} // namespace meili
+} // namespace valhalla
+
+#endif // MMP_CANDIDATE_INDEX_H_
@@ -19,7 +19,7 @@
 #include <valhalla/midgard/tiles.h>
 #include <valhalla/sif/dynamiccost.h>
 
-#include <valhalla/meili/grid_range_query.h>
+#include <valhalla/meili/candidate_index.h>
 
 namespace valhalla {
 namespace meili {
@@ -36,8 +36,6 @@ public:
 
 class CandidateGridQuery final : public CandidateQuery {
 public:
-  using grid_t = GridRangeQuery<baldr::GraphId, midgard::PointLL>;
-
   CandidateGridQuery(baldr::GraphReader& reader, float cell_width, float cell_height);
 
   ~CandidateGridQuery() override;
@@ -64,32 +62,27 @@ public:
                                            edgeids.end(), costing);
   }
 
-  std::unordered_map<baldr::GraphId, grid_t>::size_type size() const {
-    return grid_cache_.size();
+  size_t size() const {
+    return index_->size();
   }
 
   void Clear() {
-    grid_cache_.clear();
+    index_->Clear();
   }
 
-private:
-  // Get a grid for a specified bin within a tile. Tile support for
-  // graph tiles and bins is provided to go between bin Ids and tile Ids.
-  const grid_t* GetGrid(const int32_t bin_id,
-                        const midgard::Tiles<midgard::PointLL>& tiles,
-                        const midgard::Tiles<midgard::PointLL>& bins) const;
-
-  std::unordered_set<baldr::GraphId> RangeQuery(const midgard::AABB2<midgard::PointLL>& range) const;
-
-  uint32_t bin_level_;
-
-  float cell_width_;
-  float cell_height_;
+  const std::shared_ptr<CandidateIndex>& index() const {
+    return index_;
+  }
 
-  // Grid cache - cached per "bin" within a graph tile
-  mutable std::unordered_map<int32_t, grid_t> grid_cache_;
+private:
+  std::unordered_set<baldr::GraphId> RangeQuery(const midgard::AABB2<midgard::PointLL>& range) const {
+    return index_->Query(reader_, range);
+  }
 
   baldr::GraphReader& reader_;
+
+  // Spatial index of the edges, shared with every other query on the same graph reader
+  std::shared_ptr<CandidateIndex> index_;
 };
 
 } // namespace meili
@@ -42,6 +42,8 @@ struct Config {
     float turn_penalty_factor = 200.f;
     // define if 'turn_penalty_factor' option can be reassigned with user request
     bool is_turn_penalty_factor_customizable = true;
+    // reuse the routes between pairs of edges found earlier in the trace instead of searching
+    bool cache_routes = false;
 
     void Read(const boost::property_tree::ptree& params);
   };
@@ -66,10 +68,22 @@ struct Config {
     void Read(const boost::property_tree::ptree& params);
   };
 
+  struct Session {
+    // maximum number of measurements an online match keeps before finalizing the older ones
+    size_t max_window = 50;
+    // seconds a session is kept without new measurements
+    float ttl_seconds = 300.f;
+    // maximum number of sessions kept, the least recently used are dropped first
+    size_t max_sessions = 10000;
+
+    void Read(const boost::property_tree::ptree& params);
+  };
+
   CandidateSearch candidate_search{};
   TransitionCost transition_cost{};
   EmissionCost emission_cost{};
   Routing routing{};
+  Session session{};
 };
 
 } // namespace meili
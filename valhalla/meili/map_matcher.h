@@ -69,6 +69,25 @@ public:
   std::vector<MatchResults> OfflineMatch(const std::vector<Measurement>& measurements,
                                          uint32_t k = 1);
 
+  /**
+   * Matches a trace a measurement at a time, as a vehicle sends them. The viterbi search keeps
+   * following every path that could still turn out to be the best one and a measurement becomes
+   * final once all of those paths agree on it. The states of final measurements are dropped every
+   * so often so the matcher never holds more than about session.max_window measurements. If that
+   * many are pending without the paths agreeing the older half is finalized along the best path.
+   * @param measurement  the next measurement of the trace
+   * @return the measurements that became final, possibly none. The match indices of the segments
+   *         are those of the whole trace and the segments continue where the last ones ended
+   */
+  MatchResults OnlineMatch(const Measurement& measurement);
+
+  /**
+   * Finalizes the pending measurements of an online match along the best path, ie at the end of the
+   * trace, and gets the matcher ready for the next trace.
+   * @return the measurements that were pending
+   */
+  MatchResults FinishOnlineMatch();
+
   /**
    * Set a callback that will throw when the map-matching should be aborted
    * @param interrupt_callback  the function to periodically call to see if we should abort
@@ -87,6 +106,13 @@ private:
   void RemoveRedundancies(const std::vector<StateId>& result,
                           const std::vector<MatchResult>& results);
 
+  StateId FinalizeOnline(const StateId& last,
+                         StateId::Time end,
+                         std::vector<MatchResult>& results,
+                         std::vector<EdgeSegment>& segments);
+
+  void CompactOnline(const StateId& pinned);
+
   Config config_;
 
   baldr::GraphReader& graphreader_;
@@ -109,6 +135,12 @@ private:
   EmissionCostModel emission_cost_model_;
 
   TransitionCostModel transition_cost_model_;
+
+  // The measurements of the online match the state container holds, how many of them are final and
+  // how many measurements of the trace came before them
+  std::vector<Measurement> online_measurements_;
+  StateId::Time online_finalized_;
+  size_t online_offset_;
 };
 
 /**
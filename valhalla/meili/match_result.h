@@ -125,6 +125,8 @@ struct MatchResults {
     segments = std::move(o.segments);
     edges = std::move(o.edges);
     score = o.score;
+    route_cache_hits = o.route_cache_hits;
+    route_cache_misses = o.route_cache_misses;
     e1 = segments.empty() || segments.front().source < 1.0f ? edges.cbegin() : edges.cbegin() + 1;
     e2 = segments.empty() || segments.back().target > 0.0f ? edges.cend() : edges.cend() - 1;
   }
@@ -133,6 +135,8 @@ struct MatchResults {
     segments = std::move(o.segments);
     edges = std::move(o.edges);
     score = o.score;
+    route_cache_hits = o.route_cache_hits;
+    route_cache_misses = o.route_cache_misses;
     e1 = segments.empty() || segments.front().source < 1.0f ? edges.cbegin() : edges.cbegin() + 1;
     e2 = segments.empty() || segments.back().target > 0.0f ? edges.cend() : edges.cend() - 1;
     return *this;
@@ -142,6 +146,10 @@ struct MatchResults {
   std::vector<EdgeSegment> segments;
   std::vector<uint64_t> edges;
   float score;
+  // How many transitions were routed with the route cache of the transition cost model and how
+  // many had to search, only counted with cache_routes
+  size_t route_cache_hits = 0;
+  size_t route_cache_misses = 0;
   std::vector<uint64_t>::const_iterator e1;
   std::vector<uint64_t>::const_iterator e2;
 
@@ -0,0 +1,88 @@
+// -*- mode: c++ -*-
+#ifndef MMP_MATCH_SESSION_H_
+#define MMP_MATCH_SESSION_H_
+
+#include <chrono>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#include <boost/property_tree/ptree.hpp>
+
+#include <valhalla/baldr/graphreader.h>
+#include <valhalla/meili/map_matcher.h>
+#include <valhalla/meili/map_matcher_factory.h>
+#include <valhalla/meili/match_result.h>
+#include <valhalla/meili/measurement.h>
+#include <valhalla/proto/options.pb.h>
+
+namespace valhalla {
+namespace meili {
+
+/**
+ * Online map matching sessions, one per vehicle sending its positions as it goes. A session keeps
+ * its matcher alive between the measurements pushed to it and gives back the matches that became
+ * final with each push, see MapMatcher::OnlineMatch. Sessions nobody pushed to for longer than
+ * meili.session.ttl are dropped along with their pending measurements, as are the least recently
+ * used ones when there are more than meili.session.max_sessions. All the sessions share one graph
+ * reader so pushes are serialized.
+ */
+class MatchSessions {
+public:
+  /**
+   * Constructor
+   * @param config  the valhalla config
+   * @param reader  the graph reader to use, one is made from the mjolnir config if there is none
+   */
+  explicit MatchSessions(const boost::property_tree::ptree& config,
+                         const std::shared_ptr<baldr::GraphReader>& reader = {});
+
+  /**
+   * Pushes the next measurement of a session, starting the session if there is none
+   * @param id           the session
+   * @param options      the costing and matching options, only used when the session starts
+   * @param measurement  the measurement
+   * @return the measurements of the session that became final
+   */
+  MatchResults Push(const std::string& id, const Options& options, const Measurement& measurement);
+
+  /**
+   * Finalizes the pending measurements of a session and ends it
+   * @param id  the session
+   * @return the measurements that were pending, none if there is no such session
+   */
+  MatchResults Finish(const std::string& id);
+
+  /**
+   * @return the number of sessions
+   */
+  size_t size() const;
+
+protected:
+  using clock_t = std::chrono::steady_clock;
+
+  struct session_t {
+    std::unique_ptr<MapMatcher> matcher;
+    clock_t::time_point last_push;
+    std::list<std::string>::iterator order;
+  };
+
+  // Drops the sessions that lived past their ttl and the least recently used over the maximum
+  void Evict(const clock_t::time_point& now);
+
+  MapMatcherFactory factory_;
+  std::chrono::duration<float> ttl_;
+  size_t max_sessions_;
+
+  mutable std::mutex lock_;
+  std::unordered_map<std::string, session_t> sessions_;
+  // Session ids, least recently pushed to first
+  std::list<std::string> order_;
+};
+
+} // namespace meili
+} // namespace valhalla
+
+#endif // MMP_MATCH_SESSION_H_
@@ -263,6 +263,12 @@ public:
     dest_status_.clear();
   }
 
+  // Appends a label without queueing it, used for routes that were not searched for
+  uint32_t append(const Label& label) {
+    labels_.push_back(label);
+    return labels_.size() - 1;
+  }
+
 private:
   baldr::DoubleBucketQueue<Label> queue_;                  // Priority queue
   std::unordered_map<baldr::GraphId, Status> node_status_; // Node status
@@ -304,6 +310,84 @@ find_shortest_path(baldr::GraphReader& reader,
                    const float max_dist,
                    const float max_time);
 
+/**
+ * Routes between pairs of edges found by the searches of one trace. Dense traces search from
+ * candidates on the same edges to candidates on the same edges over and over, from one
+ * measurement to the next only how much of the first and the last edge is travelled changes. So
+ * for every pair of origin and destination edge we keep the edges the search went through in
+ * between, or a lower bound on their cost when the search found no route or a cheaper one via
+ * other edges. A search whose destinations can all be settled with these is answered without
+ * searching. The cache is per costing, ie. per TransitionCostModel.
+ */
+class RouteCache {
+public:
+  /**
+   * Tries to answer a search with the cached routes, the parameters are those of
+   * find_shortest_path with the origin at index 0 of the locations.
+   * @return true if every destination was settled from the cache, the results and the labelset
+   *         then hold what find_shortest_path would have produced
+   */
+  bool find(baldr::GraphReader& reader,
+            const std::vector<baldr::PathLocation>& locations,
+            labelset_ptr_t& labelset,
+            std::unordered_map<uint16_t, uint32_t>& results,
+            const sif::cost_ptr_t& costing,
+            const Label* edgelabel,
+            const float max_dist,
+            const float max_time);
+
+  /**
+   * Remembers the routes and lower bounds learned from a search.
+   */
+  void insert(baldr::GraphReader& reader,
+              const std::vector<baldr::PathLocation>& locations,
+              const LabelSet& labelset,
+              const std::unordered_map<uint16_t, uint32_t>& results,
+              const sif::cost_ptr_t& costing,
+              const float max_dist);
+
+  void clear() {
+    routes_.clear();
+    hits_ = misses_ = 0;
+  }
+
+  // Number of searches answered from the cache
+  size_t hits() const {
+    return hits_;
+  }
+
+  // Number of searches that had to search
+  size_t misses() const {
+    return misses_;
+  }
+
+protected:
+  // An edge of a route with what it adds to the cost and turn cost of the route so far
+  struct step_t {
+    baldr::GraphId edgeid;
+    baldr::GraphId nodeid;
+    float cost;
+    float secs;
+    float turn_cost;
+    uint8_t restriction_idx;
+  };
+
+  // Between two edges: the full edges in between followed by the turn onto the last edge, or
+  // only a lower bound on the cost of the edges in between when we don't know them
+  struct route_t {
+    std::vector<step_t> steps;
+    bool known = false;
+    float cost = 0.f;
+    float secs = 0.f;
+    float lower_bound = 0.f;
+  };
+
+  // Routes by origin edge and destination edge
+  std::unordered_map<baldr::GraphId, std::unordered_map<baldr::GraphId, route_t>> routes_;
+  size_t hits_ = 0;
+  size_t misses_ = 0;
+};
+
 // Route path iterator. Methods to assist recovering route paths from Labels.
 class RoutePathIterator : public std::iterator<std::forward_iterator_tag, const Label> {
 public:
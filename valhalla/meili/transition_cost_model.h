@@ -6,6 +6,7 @@
 #include <valhalla/baldr/graphreader.h>
 #include <valhalla/meili/config.h>
 #include <valhalla/meili/measurement.h>
+#include <valhalla/meili/routing.h>
 #include <valhalla/meili/state.h>
 #include <valhalla/meili/topk_search.h>
 #include <valhalla/meili/viterbi_search.h>
@@ -51,6 +52,16 @@ public:
 
   float operator()(const StateId& lhs, const StateId& rhs) const;
 
+  // Routes found so far in the trace, only used with cache_routes
+  const RouteCache& route_cache() const {
+    return route_cache_;
+  }
+
+  // Forget the routes of the last trace
+  void Clear() {
+    route_cache_.clear();
+  }
+
 private:
   void UpdateRoute(const StateId& lhs, const StateId& rhs) const;
 
@@ -93,6 +104,9 @@ private:
   float turn_cost_table_[181];
 
   bool match_on_restrictions_{false};
+
+  bool cache_routes_{false};
+  mutable RouteCache route_cache_;
 };
 
 } // namespace meili
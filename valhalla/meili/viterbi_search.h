@@ -165,6 +165,15 @@ public:
   StateId Predecessor(const StateId& stateid) const override;
   double AccumulatedCost(const StateId& stateid) const override;
 
+  /**
+   * Get the labels the search continues from, ie the labels still queued and the last winner.
+   * Every path the search finds from here on goes through one of them, so once all of their
+   * paths share a state that state is part of the path of every future winner.
+   *
+   * @return the labels, queued ones have the best predecessor found so far
+   */
+  std::vector<StateLabel> Frontier() const;
+
 private:
   // Initialize labels from a column and push them into priority queue
   void InitQueue(const std::vector<StateId>& column);
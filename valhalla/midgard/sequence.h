@@ -22,6 +22,7 @@
 #include <vector>
 
 #include <valhalla/filesystem.h>
+#include <valhalla/midgard/util.h>
 
 #ifdef _WIN32
 #include <io.h>
@@ -259,10 +260,87 @@ protected:
   std::string file_name;
 };
 
+// A tournament over sorted runs in which every inner node remembers the loser of its match. Taking
+// the winner only replays the matches on the path from its run to the root, so merging k runs
+// costs log(k) comparisons per element. Ties go to the earlier run so the merge is stable
+template <class T, class Predicate> class loser_tree {
+public:
+  using run_t = std::pair<const T*, const T*>;
+
+  loser_tree(const std::vector<run_t>& sorted_runs, const Predicate& predicate)
+      : predicate(predicate), leaves(1) {
+    while (leaves < sorted_runs.size()) {
+      leaves *= 2;
+    }
+    // the padding runs are empty and lose every match
+    runs = sorted_runs;
+    runs.resize(leaves, run_t{nullptr, nullptr});
+    tree.resize(leaves);
+    tree[0] = leaves > 1 ? play(1) : 0;
+  }
+
+  bool empty() const {
+    return runs[tree[0]].first == runs[tree[0]].second;
+  }
+
+  const T& top() const {
+    return *runs[tree[0]].first;
+  }
+
+  void pop() {
+    size_t winner = tree[0];
+    ++runs[winner].first;
+    for (size_t node = (winner + leaves) / 2; node > 0; node /= 2) {
+      if (beats(tree[node], winner)) {
+        std::swap(tree[node], winner);
+      }
+    }
+    tree[0] = winner;
+  }
+
+protected:
+  // whether the head of run a comes before the head of run b, exhausted runs never win and equal
+  // heads are won by the earlier run
+  bool beats(size_t a, size_t b) const {
+    if (runs[a].first == runs[a].second) {
+      return false;
+    }
+    if (runs[b].first == runs[b].second) {
+      return true;
+    }
+    if (predicate(*runs[a].first, *runs[b].first)) {
+      return true;
+    }
+    return a < b && !predicate(*runs[b].first, *runs[a].first);
+  }
+
+  // plays all the matches below the node keeping the losers and returns the winner
+  size_t play(size_t node) {
+    if (node >= leaves) {
+      return node - leaves;
+    }
+    size_t left = play(node * 2);
+    size_t right = play(node * 2 + 1);
+    if (beats(right, left)) {
+      tree[node] = left;
+      return right;
+    }
+    tree[node] = right;
+    return left;
+  }
+
+  const Predicate& predicate;
+  size_t leaves;
+  std::vector<run_t> runs;
+  std::vector<size_t> tree;
+};
+
 template <class T> class sequence {
 public:
   // static_assert(std::is_pod<T>::value, "sequence requires POD types for now");
   static const size_t npos = -1;
+  // how many elements to sort in memory at once by default
+  static constexpr size_t kSortBufferSize = 1024 * 1024 * 512 / sizeof(T);
 
   using value_type = T;
 
@@ -325,57 +403,88 @@ public:
     return npos;
   }
 
-  // sort the file based on the predicate, and outputs to output_seq
+  // sort the file based on the predicate, equal elements keep their order whatever the concurrency
   //
-  // Strategy is to first sort sub-ranges of length buffer_size in place.
-  // These should all fit in memory. Then, merge the sub-ranges into the
-  // output sequence via priority queue.
-  void sort(const std::function<bool(const T&, const T&)>& predicate,
-            size_t buffer_size = 1024 * 1024 * 512 / sizeof(T)) {
+  // Strategy is to first sort sub-ranges of at most buffer_size elements in place, as many at a
+  // time as there are threads. These should all fit in memory together. Then, merge the sub-ranges
+  // into a temporary file with a loser tree. The output is cut into one slice per thread at sampled
+  // splitters so the threads can merge their slices into the file at the same time. Equal elements
+  // always land in the same slice and the loser tree prefers the earlier run, so it is stable
+  template <class Predicate>
+  void sort(const Predicate& predicate,
+            size_t buffer_size = kSortBufferSize,
+            unsigned int concurrency = 1) {
     flush();
     // if no elements we are done
-    if (memmap.size() == 0) {
+    const size_t count = memmap.size();
+    if (count == 0) {
       return;
     }
 
+    // the threads share the buffer and if everything fits they get a run each
+    concurrency = std::max(concurrency, 1u);
+    const size_t run_size =
+        std::max<size_t>((std::min(buffer_size, count) + concurrency - 1) / concurrency, 1);
+    T* data = static_cast<T*>(memmap);
+
     // If there wont be any merging we may as well take the simple approach
-    if (buffer_size > memmap.size() + write_buffer.size()) {
-      std::sort(static_cast<T*>(memmap), static_cast<T*>(memmap) + memmap.size(), predicate);
+    if (run_size >= count) {
+      std::stable_sort(data, data + count, predicate);
       return;
     }
 
+    // Sort the subsections
+    std::vector<typename loser_tree<T, Predicate>::run_t> runs;
+    for (size_t i = 0; i < count; i += run_size) {
+      runs.emplace_back(data + i, data + std::min(count, i + run_size));
+    }
+    parallel_for(concurrency, runs.size(), [data, count, run_size, &predicate](size_t, size_t r) {
+      std::stable_sort(data + r * run_size, data + std::min(count, (r + 1) * run_size), predicate);
+    });
+
+    // Pick splitters from an even sample of every run so the slices are about the same size
+    std::vector<T> splitters;
+    if (concurrency > 1) {
+      const size_t per_run = std::max<size_t>(concurrency * 16 / runs.size(), 1);
+      std::vector<T> sample;
+      for (const auto& run : runs) {
+        const size_t size = run.second - run.first;
+        for (size_t k = 0; k < per_run; ++k) {
+          sample.push_back(run.first[size * k / per_run]);
+        }
+      }
+      std::sort(sample.begin(), sample.end(), predicate);
+      for (unsigned int slice = 1; slice < concurrency; ++slice) {
+        splitters.push_back(sample[sample.size() * slice / concurrency]);
+      }
+    }
+
     auto tmp_path = filesystem::path(file_name).replace_filename(
         filesystem::path(file_name).filename().string() + ".tmp");
     {
-      // we need a temporary sequence to merge the sorted subsections into
-      sequence<T> output_seq(tmp_path.string(), true);
-
-      // Comparator needs to be inverted for pq to provide constant time *smallest* lookup
-      // Pq keeps track of element and its index.
-      auto cmp = [&predicate](const std::pair<T, size_t>& a, std::pair<T, size_t>& b) {
-        return predicate(b.first, a.first);
-      };
-      std::priority_queue<std::pair<T, size_t>, std::vector<std::pair<T, size_t>>, decltype(cmp)> pq(
-          cmp);
-
-      // Sort the subsections
-      for (size_t i = 0; i < memmap.size(); i += buffer_size) {
-        std::sort(static_cast<T*>(memmap) + i,
-                  static_cast<T*>(memmap) + std::min(memmap.size(), i + buffer_size), predicate);
-        pq.emplace(*at(i), i);
-      }
-
-      // Perform the merge
-      while (!pq.empty()) {
-        auto tmp = pq.top();
-        pq.pop();
-        output_seq.push_back(tmp.first);
-        size_t new_idx = tmp.second + 1;
-        if (new_idx % buffer_size != 0 && new_idx < memmap.size()) {
-          pq.emplace(*at(new_idx), new_idx);
+      // we need a temporary file to merge the sorted subsections into
+      mem_map<T> output;
+      output.create(tmp_path.string(), count);
+
+      // Perform the merge, every slice holds the elements between two splitters
+      parallel_for(concurrency, splitters.size() + 1, [&](size_t, size_t slice) {
+        std::vector<typename loser_tree<T, Predicate>::run_t> slices;
+        size_t offset = 0;
+        for (const auto& run : runs) {
+          const T* begin = slice == 0 ? run.first
+                                      : std::lower_bound(run.first, run.second,
+                                                         splitters[slice - 1], predicate);
+          const T* end = slice == splitters.size()
+                             ? run.second
+                             : std::lower_bound(begin, run.second, splitters[slice], predicate);
+          slices.emplace_back(begin, end);
+          offset += begin - run.first;
         }
-      }
-      output_seq.flush();
+        T* out = static_cast<T*>(output) + offset;
+        for (loser_tree<T, Predicate> tree(slices, predicate); !tree.empty(); tree.pop()) {
+          *out++ = tree.top();
+        }
+      });
     }
 
     // Forget about this file for a second so we can swap in the temp file
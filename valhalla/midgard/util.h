@@ -1,14 +1,20 @@
 #pragma once
 
+#include <algorithm>
+#include <atomic>
 #include <cstdint>
 #include <cstring>
+#include <exception>
 #include <functional>
 #include <limits>
 #include <memory>
+#include <mutex>
 #include <ostream>
 #include <random>
 #include <stdexcept>
 #include <string>
+#include <thread>
+#include <tuple>
 #include <type_traits>
 #include <unordered_map>
 #include <unordered_set>
@@ -594,7 +600,8 @@ polygon_t to_boundary(const std::unordered_set<uint32_t>& region, const Tiles<Po
  * */
 struct projector_t {
   projector_t(const PointLL& ll)
-      : lon_scale(cos(ll.lat() * kRadPerDegD)), lat(ll.lat()), lng(ll.lng()), approx(ll) {
+      : lon_scale(cos(ll.lat() * kRadPerDegD)), lat(ll.lat()), lng(ll.lng()), approx(ll),
+        m_per_lng_degree(DistanceApproximator<PointLL>::MetersPerLngDegree(ll.lat())) {
   }
 
   // non default constructible and move only type
@@ -636,11 +643,54 @@ struct projector_t {
     return {u.first + bx * scale, u.second + by * scale};
   }
 
+  /**
+   * Projects onto every segment of a polyline and keeps the closest projection. Several segments
+   * are projected at once when the compiler targets SSE2 or AVX, the result is the same as when
+   * projecting the segments one at a time with the operator above and approx.DistanceSquared.
+   * The coordinates come in separate arrays so that consecutive points load into one register,
+   * see shape_buffer_t
+   * @param lngs   the longitudes of the points of the polyline
+   * @param lats   the latitudes of the points of the polyline
+   * @param count  the number of points
+   * @return the closest point, its squared distance in meters and the index of its segment. The
+   *         first point and max distance if there are no segments. Ties go to the first segment
+   */
+  std::tuple<PointLL, double, size_t>
+  operator()(const double* lngs, const double* lats, size_t count) const;
+
   // critical data
   double lon_scale;
   double lat;
   double lng;
   DistanceApproximator<PointLL> approx;
+  double m_per_lng_degree;
+};
+
+/**
+ * The points of an edge shape decoded into separate longitude and latitude arrays for
+ * projector_t. Reusing one buffer from one shape to the next saves the allocations
+ */
+struct shape_buffer_t {
+  template <typename decoder_t> void decode(decoder_t& shape) {
+    lngs.clear();
+    lats.clear();
+    while (!shape.empty()) {
+      auto point = shape.pop();
+      lngs.push_back(point.lng());
+      lats.push_back(point.lat());
+    }
+  }
+
+  size_t size() const {
+    return lngs.size();
+  }
+
+  PointLL operator[](size_t index) const {
+    return {lngs[index], lats[index]};
+  }
+
+  std::vector<double> lngs;
+  std::vector<double> lats;
 };
 
 /**
@@ -718,5 +768,45 @@ unaligned_read(const void* ptr) {
   return r;
 }
 
+/**
+ * Calls work(worker, index) for every index in [0, count) on up to concurrency threads, the calling
+ * thread being one of them. The indices are handed out in increasing order and worker is the number
+ * in [0, concurrency) of the thread doing the call, so that per thread state like a GraphReader can
+ * be kept in a vector. Once all threads are done the first exception thrown by work is rethrown.
+ * @param concurrency  maximum number of threads
+ * @param count        number of indices
+ * @param work         callable taking the worker and the index
+ */
+template <class Work> void parallel_for(unsigned int concurrency, size_t count, const Work& work) {
+  std::atomic<size_t> next(0);
+  std::exception_ptr error;
+  std::mutex lock;
+  auto run = [&](size_t worker) {
+    try {
+      for (size_t i = next++; i < count; i = next++) {
+        work(worker, i);
+      }
+    } catch (...) {
+      // stop handing out indices to the other threads
+      next = count;
+      std::lock_guard<std::mutex> guard(lock);
+      if (!error) {
+        error = std::current_exception();
+      }
+    }
+  };
+  std::vector<std::thread> threads;
+  for (size_t t = 1; t < std::min<size_t>(concurrency, count); ++t) {
+    threads.emplace_back(run, t);
+  }
+  run(0);
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  if (error) {
+    std::rethrow_exception(error);
+  }
+}
+
 } // namespace midgard
 } // namespace valhalla
@@ -0,0 +1,110 @@
+#ifndef VALHALLA_MJOLNIR_BUILDPROFILER_H_
+#define VALHALLA_MJOLNIR_BUILDPROFILER_H_
+
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <valhalla/baldr/json.h>
+#include <valhalla/mjolnir/util.h>
+
+namespace valhalla {
+namespace mjolnir {
+
+/**
+ * Records the resources each stage of a tile build uses: wall and CPU time, peak resident memory
+ * and bytes read from and written to storage. The worker threads of a stage add how busy they kept
+ * their core with a WorkerScope. Metrics the platform does not provide are reported as 0.
+ */
+class BuildProfiler {
+public:
+  // A worker thread of a stage
+  struct Worker {
+    std::string name;
+    std::thread::id thread;
+    double wall_seconds;
+    double cpu_seconds;
+  };
+
+  // The resources a stage used
+  struct Stage {
+    BuildStage stage;
+    double wall_seconds;
+    double cpu_seconds;
+    uint64_t peak_memory;
+    uint64_t bytes_read;
+    uint64_t bytes_written;
+    std::vector<Worker> workers;
+  };
+
+  /**
+   * Measures the thread it is constructed on until it is destroyed and adds it to the stage that
+   * is running, if a build is being profiled. Scopes of the same name on the same thread add up to
+   * one worker, so a scope can also wrap each item a thread takes from a parallel_for.
+   */
+  class WorkerScope {
+  public:
+    explicit WorkerScope(const std::string& name);
+    ~WorkerScope();
+
+  private:
+    std::string name_;
+    std::chrono::steady_clock::time_point start_;
+    double cpu_start_;
+  };
+
+  /**
+   * Starts measuring the first stage. Worker threads report to this profiler until it is
+   * destroyed.
+   */
+  BuildProfiler();
+  ~BuildProfiler();
+
+  BuildProfiler(const BuildProfiler&) = delete;
+  BuildProfiler& operator=(const BuildProfiler&) = delete;
+
+  /**
+   * Ends the stage which ran since the previous one ended, logs what it used and starts measuring
+   * the next one.
+   * @param stage  the stage that ran
+   */
+  void EndStage(BuildStage stage);
+
+  /**
+   * @return the stages that ended so far
+   */
+  const std::vector<Stage>& stages() const {
+    return stages_;
+  }
+
+  /**
+   * @return the stages and the totals over them as json
+   */
+  baldr::json::MapPtr ToJson() const;
+
+  /**
+   * Writes the json report to a file.
+   * @param file  where to write the report
+   * @return whether the report was written
+   */
+  bool WriteReport(const std::string& file) const;
+
+protected:
+  // Counters of the process at the start of the running stage
+  std::chrono::steady_clock::time_point start_;
+  double cpu_start_;
+  uint64_t read_start_;
+  uint64_t written_start_;
+
+  std::mutex workers_lock_;
+  std::vector<Worker> workers_;
+  std::vector<Stage> stages_;
+};
+
+} // namespace mjolnir
+} // namespace valhalla
+
+#endif // VALHALLA_MJOLNIR_BUILDPROFILER_H_
@@ -0,0 +1,28 @@
+#ifndef VALHALLA_MJOLNIR_CONTRACTIONBUILDER_H
+#define VALHALLA_MJOLNIR_CONTRACTIONBUILDER_H
+
+#include <boost/property_tree/ptree.hpp>
+
+namespace valhalla {
+namespace mjolnir {
+
+/**
+ * Class used to build a contraction hierarchy of the whole graph for the default auto costing.
+ * Nodes are contracted one at a time in the order of how few shortcuts they need, with witness
+ * searches deciding which shortcuts are needed. The result is written to the file configured as
+ * mjolnir.contraction_hierarchy, see baldr::ContractionHierarchy for its layout. Turn costs are
+ * not part of the hierarchy, thor recosts the paths it finds with them.
+ */
+class ContractionBuilder {
+public:
+  /**
+   * Build the contraction hierarchy if mjolnir.contraction_hierarchy is configured.
+   * @param pt  the full valhalla config
+   */
+  static void Build(const boost::property_tree::ptree& pt);
+};
+
+} // namespace mjolnir
+} // namespace valhalla
+
+#endif // VALHALLA_MJOLNIR_CONTRACTIONBUILDER_H
@@ -3,6 +3,9 @@
 
 #include <boost/property_tree/ptree.hpp>
 #include <cstdint>
+#include <unordered_set>
+#include <valhalla/baldr/graphid.h>
+#include <valhalla/baldr/graphreader.h>
 #include <valhalla/mjolnir/osmdata.h>
 
 namespace valhalla {
@@ -18,10 +21,23 @@ public:
    * @param pt          property tree containing the hierarchy configuration
    * @param osmdata     OSM data used to enhance the turn lanes.
    * @param access_file where to store the access tags so they are not in memory
+   * @param tiles       local tiles to enhance, all of them when empty
    */
   static void Enhance(const boost::property_tree::ptree& pt,
                       const OSMData& osmdata,
-                      const std::string& access_file);
+                      const std::string& access_file,
+                      const std::unordered_set<baldr::GraphId>& tiles = {});
+
+  /**
+   * Find the local tiles whose enhancement may read any of the given tiles: the tiles with nodes
+   * within the density radius of them and the tiles with nodes within the not thru search of
+   * their nodes.
+   * @param reader  graph reader of the local tiles
+   * @param tiles   local tiles that are read
+   * @return the local tiles reading them, the given ones included
+   */
+  static std::unordered_set<baldr::GraphId> Reach(baldr::GraphReader& reader,
+                                                  const std::unordered_set<baldr::GraphId>& tiles);
 };
 
 } // namespace mjolnir
@@ -0,0 +1,57 @@
+#ifndef VALHALLA_MJOLNIR_OSMCHANGE_H
+#define VALHALLA_MJOLNIR_OSMCHANGE_H
+
+#include <cstdint>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+#include <valhalla/baldr/graphid.h>
+#include <valhalla/midgard/pointll.h>
+
+namespace valhalla {
+namespace mjolnir {
+
+/**
+ * The parts of an osmChange (.osc) diff needed to find the local tiles it touches. Whether an
+ * element was created, modified or deleted does not matter. A changed node changes the ways that
+ * use it, and for every changed way the tiles it went through and the tiles it goes through now
+ * are both rebuilt.
+ */
+struct OSMChange {
+  // Locations of the changed nodes which have one in the diff
+  std::vector<midgard::PointLL> nodes;
+  // Ids of the changed nodes
+  std::unordered_set<uint64_t> node_ids;
+  // Ids of the changed ways and of the ways that are members of changed relations
+  std::unordered_set<uint64_t> ways;
+
+  /**
+   * Read an uncompressed osmChange file. Elements are read one tag at a time so the file is never
+   * held in memory.
+   * @param file  path of the osmChange file
+   * @return the changed node locations and node and way ids
+   */
+  static OSMChange Read(const std::string& file);
+
+  /**
+   * Find the local tiles to rebuild for this change. The ways of the new data that use a changed
+   * node are added to the changed ways first. The tiles to rebuild are then the tiles of the
+   * changed nodes, the tiles the changed ways go through in the new data, the tiles the changed
+   * ways went through in the previous build and, as the node ids of those tiles change, every tile
+   * of the previous build with an edge ending in one of them. The tiles of the previous build whose
+   * enhancement reads the changed tiles are rebuilt as well so they are enhanced again.
+   * @param snapshot_dir    directory with the local tiles of the previous build
+   * @param ways_file       ways parsed from the new data
+   * @param way_nodes_file  way nodes parsed from the new data
+   * @return the local tiles to rebuild
+   */
+  std::unordered_set<baldr::GraphId> AffectedTiles(const std::string& snapshot_dir,
+                                                   const std::string& ways_file,
+                                                   const std::string& way_nodes_file);
+};
+
+} // namespace mjolnir
+} // namespace valhalla
+
+#endif // VALHALLA_MJOLNIR_OSMCHANGE_H
@@ -1,13 +1,18 @@
 #ifndef VALHALLA_MJOLNIR_OSMDATA_H
 #define VALHALLA_MJOLNIR_OSMDATA_H
 
+#include <algorithm>
 #include <cstdint>
 #include <map>
 #include <memory>
+#include <stdexcept>
 #include <string>
 #include <unordered_set>
+#include <utility>
 #include <vector>
 
+#include <valhalla/midgard/sequence.h>
+
 #include <valhalla/mjolnir/osmaccessrestriction.h>
 #include <valhalla/mjolnir/osmnode.h>
 #include <valhalla/mjolnir/osmrestriction.h>
@@ -42,12 +47,139 @@ struct OSMLaneConnectivity {
   uint32_t from_lanes_index; // Index to string in UniqueNames
 };
 
+/**
+ * Multimap from an OSM way Id to values, kept as an array of pairs sorted by the way Id. That takes
+ * about half the memory of a hash multimap and the array can be mapped read only from a file
+ * instead of being held on the heap. Entries are appended while parsing and sorted once all of
+ * them are in, before any of them are looked up.
+ */
+template <class T> class WayIdMultiMap {
+public:
+  using value_type = std::pair<uint64_t, T>;
+  using const_iterator = const value_type*;
+
+  WayIdMultiMap() : sorted_(true) {
+  }
+
+  /**
+   * Add an entry. The entries have to be sorted again before they are looked up.
+   * @param  entry  Way Id and value.
+   */
+  void insert(const value_type& entry) {
+    if (mapped_) {
+      throw std::logic_error("Cannot add to entries mapped from " + mapped_->name());
+    }
+    entries_.push_back(entry);
+    sorted_ = false;
+  }
+
+  /**
+   * Sort the entries by way Id. The values of a way keep the order they were added in.
+   */
+  void sort() {
+    if (!sorted_) {
+      std::stable_sort(entries_.begin(), entries_.end(),
+                       [](const value_type& a, const value_type& b) { return a.first < b.first; });
+      sorted_ = true;
+    }
+  }
+
+  /**
+   * Get the entries of a way.
+   * @param  way_id  Way Id.
+   * @return  Returns the range of entries, both end() if there are none.
+   */
+  std::pair<const_iterator, const_iterator> equal_range(const uint64_t way_id) const {
+    if (!sorted_) {
+      throw std::logic_error("Entries have to be sorted before they are looked up");
+    }
+    auto first = std::lower_bound(begin(), end(), way_id,
+                                  [](const value_type& a, uint64_t id) { return a.first < id; });
+    auto last = std::upper_bound(first, end(), way_id,
+                                 [](uint64_t id, const value_type& a) { return id < a.first; });
+    return first == last ? std::make_pair(end(), end()) : std::make_pair(first, last);
+  }
+
+  /**
+   * Replace the entries.
+   * @param  entries  Way Ids and values.
+   */
+  void assign(std::vector<value_type>&& entries) {
+    clear();
+    entries_ = std::move(entries);
+    sorted_ = std::is_sorted(entries_.begin(), entries_.end(),
+                             [](const value_type& a, const value_type& b) {
+                               return a.first < b.first;
+                             });
+    sort();
+  }
+
+  const_iterator begin() const {
+    return mapped_ ? mapped_->get() : entries_.data();
+  }
+
+  const_iterator end() const {
+    return begin() + size();
+  }
+
+  const_iterator cbegin() const {
+    return begin();
+  }
+
+  const_iterator cend() const {
+    return end();
+  }
+
+  size_t size() const {
+    return mapped_ ? mapped_->size() : entries_.size();
+  }
+
+  void clear() {
+    entries_.clear();
+    entries_.shrink_to_fit();
+    mapped_.reset();
+    sorted_ = true;
+  }
+
+  /**
+   * Replace the entries with sorted ones written to a file, which is mapped read only.
+   * @param  file   File holding nothing but the sorted entries.
+   * @param  count  Number of entries in the file.
+   */
+  void map(const std::string& file, size_t count) {
+    clear();
+    mapped_ = std::make_shared<midgard::mem_map<value_type>>();
+    mapped_->map(file, count, POSIX_MADV_RANDOM, true);
+  }
+
+  /**
+   * Get the file the entries are mapped from.
+   * @return  Returns the file name, empty if the entries are on the heap.
+   */
+  std::string file() const {
+    return mapped_ ? mapped_->name() : std::string();
+  }
+
+  /**
+   * Get the heap memory the entries take. Entries in a mapped file are not counted.
+   * @return  Returns the number of bytes.
+   */
+  size_t memory_usage() const {
+    return entries_.capacity() * sizeof(value_type);
+  }
+
+protected:
+  std::vector<value_type> entries_;
+  std::shared_ptr<midgard::mem_map<value_type>> mapped_;
+  bool sorted_;
+};
+
 // Data types used within OSMData
-using RestrictionsMultiMap = std::unordered_multimap<uint64_t, OSMRestriction>;
+using RestrictionsMultiMap = WayIdMultiMap<OSMRestriction>;
 using ViaSet = std::unordered_set<uint64_t>;
-using AccessRestrictionsMultiMap = std::unordered_multimap<uint64_t, OSMAccessRestriction>;
-using BikeMultiMap = std::unordered_multimap<uint64_t, OSMBike>;
-using OSMLaneConnectivityMultiMap = std::unordered_multimap<uint64_t, OSMLaneConnectivity>;
+using AccessRestrictionsMultiMap = WayIdMultiMap<OSMAccessRestriction>;
+using BikeMultiMap = WayIdMultiMap<OSMBike>;
+using OSMLaneConnectivityMultiMap = WayIdMultiMap<OSMLaneConnectivity>;
 
 // OSMString map uses the way Id as the key and the name index into UniqueNames as the value
 using OSMStringMap = std::unordered_map<uint64_t, uint32_t>;
@@ -64,16 +196,48 @@ struct OSMData {
   bool write_to_temp_files(const std::string& tile_dir);
 
   /**
-   * Read data from temporary files.
+   * Read data from temporary files. With a memory budget the names are read into arenas and each
+   * of them and of the multimaps is read onto the heap if it still fits in the budget, otherwise
+   * it is mapped read only from its file.
+   * @param tile_dir    Directory of the temporary files.
+   * @param max_memory  Heap memory budget in bytes, 0 for no budget.
    * @return Returns true if successful, false if an error occurs.
    */
-  bool read_from_temp_files(const std::string& tile_dir);
+  bool read_from_temp_files(const std::string& tile_dir, size_t max_memory = 0);
 
   /**
    * Read data from temporary unique name file.
+   * @param tile_dir    Directory of the temporary files.
+   * @param max_memory  Heap memory budget in bytes, 0 for no budget. The names are read into an
+   *                    arena with a budget and mapped from the file if that does not fit.
+   * @return Returns true if successful, false if an error occurs.
+   */
+  bool read_from_unique_names_file(const std::string& tile_dir, size_t max_memory = 0);
+
+  /**
+   * Sort the multimaps once they are filled so that their entries can be looked up.
+   */
+  void sort();
+
+  /**
+   * Estimate the heap memory the data takes.
+   * @return Returns the number of bytes.
+   */
+  size_t memory_usage() const;
+
+  /**
+   * Move the data out of the heap when it takes more than a memory budget. The names are moved
+   * into arenas first, if that is not enough the data is written to the temporary files and read
+   * back within the budget. Parsing goes through ways, relations and nodes, only the parts the
+   * later parse stages no longer add to are moved.
+   * @param tile_dir    Directory of the temporary files.
+   * @param max_memory  Heap memory budget in bytes, 0 for no budget.
+   * @param parsed      Type of the OSM elements parsed last, nodes once parsing is done.
    * @return Returns true if successful, false if an error occurs.
    */
-  bool read_from_unique_names_file(const std::string& tile_dir);
+  bool fit_memory(const std::string& tile_dir,
+                  size_t max_memory,
+                  const OSMType parsed = OSMType::kNode);
 
   /**
    * add the direction information to the forward or reverse map for relations.
@@ -3,24 +3,30 @@
 
 #include <algorithm>
 #include <cstdint>
+#include <memory>
+#include <stdexcept>
 #include <string>
 #include <unordered_map>
 #include <vector>
 
+#include <valhalla/midgard/sequence.h>
+
 namespace valhalla {
 namespace mjolnir {
 
 using NamesMap = std::unordered_map<std::string, uint32_t>;
 
 /**
- * Class to hold a list of unique names and indexes to them.
+ * Class to hold a list of unique names and indexes to them. Once no more names are added they can
+ * be moved into an arena of null terminated strings, on the heap or in a file mapped in memory,
+ * which takes a fraction of the memory of the map.
  */
 class UniqueNames {
 public:
   /**
    * Constructor.
    */
-  UniqueNames() {
+  UniqueNames() : arena_data_(nullptr) {
     // Insert dummy so index 0 is never used
     index("");
   }
@@ -32,6 +38,10 @@ public:
    * @return  Returns an index into the unique list of names.
    */
   uint32_t index(const std::string& name) {
+    if (arena_data_ != nullptr) {
+      throw std::logic_error("Names cannot be added once they are in an arena");
+    }
+
     // Find the name in the map. If it is there return the index.
     auto it = names_.find(name);
     if (it != names_.end()) {
@@ -51,7 +61,15 @@ public:
    * @param  index  Index into the unique name list.
    * @return  Returns the name
    */
-  const std::string& name(const uint32_t index) const {
+  std::string name(const uint32_t index) const {
+    if (arena_data_ != nullptr) {
+      if (index == 0 || index >= (uint32_t)offsets_.size()) {
+        return std::string();
+      }
+      // Offsets are of the names from index 1 on, the next one is past the null terminator
+      return std::string(arena_data_ + offsets_[index - 1],
+                         offsets_[index] - offsets_[index - 1] - 1);
+    }
     return (index < (uint32_t)indexes_.size()) ? indexes_[index]->first : indexes_[0]->first;
   }
 
@@ -61,6 +79,12 @@ public:
   void Clear() {
     names_.clear();
     indexes_.clear();
+    arena_.clear();
+    arena_.shrink_to_fit();
+    mapped_arena_.reset();
+    offsets_.clear();
+    offsets_.shrink_to_fit();
+    arena_data_ = nullptr;
   }
 
   /**
@@ -69,16 +93,103 @@ public:
    * @return  Returns the number of unique names.
    */
   size_t Size() const {
-    return names_.size() - 1;
+    return (arena_data_ != nullptr) ? offsets_.size() - 1 : names_.size() - 1;
+  }
+
+  /**
+   * Move the names into an arena on the heap. The indexes stay the same but no more names can be
+   * added.
+   */
+  void Compact() {
+    if (arena_data_ != nullptr) {
+      return;
+    }
+    std::vector<uint32_t> offsets{0};
+    offsets.reserve(indexes_.size());
+    std::vector<char> arena;
+    for (size_t n = 1; n < indexes_.size(); ++n) {
+      const auto& name = indexes_[n]->first;
+      arena.insert(arena.end(), name.c_str(), name.c_str() + name.size() + 1);
+      offsets.push_back(arena.size());
+    }
+    Assign(std::move(arena), std::move(offsets));
+  }
+
+  /**
+   * Replace the names with ones in an arena on the heap.
+   * @param  arena    The names from index 1 on as null terminated strings.
+   * @param  offsets  Offset of each name in the arena, then the offset past the last one.
+   */
+  void Assign(std::vector<char>&& arena, std::vector<uint32_t>&& offsets) {
+    Clear();
+    arena_ = std::move(arena);
+    offsets_ = std::move(offsets);
+    arena_data_ = arena_.empty() ? blank() : arena_.data();
+  }
+
+  /**
+   * Replace the names with ones written to a file, which is mapped read only.
+   * @param  file     File holding the names from index 1 on as null terminated strings.
+   * @param  begin    Offset in the file of the first name.
+   * @param  offsets  Offset of each name from the first one, then the offset past the last one.
+   */
+  void Map(const std::string& file, size_t begin, std::vector<uint32_t>&& offsets) {
+    Clear();
+    mapped_arena_ = std::make_shared<midgard::mem_map<char>>();
+    mapped_arena_->map(file, begin + offsets.back(), POSIX_MADV_RANDOM, true);
+    offsets_ = std::move(offsets);
+    arena_data_ = (mapped_arena_->size() > 0) ? mapped_arena_->get() + begin : blank();
+  }
+
+  /**
+   * Get the file the names are mapped from.
+   * @return  Returns the file name, empty if the names are on the heap.
+   */
+  std::string File() const {
+    return mapped_arena_ ? mapped_arena_->name() : std::string();
+  }
+
+  /**
+   * Estimate the heap memory the names take. Names in a mapped file are not counted.
+   * @return  Returns the number of bytes.
+   */
+  size_t MemoryUsage() const {
+    if (arena_data_ != nullptr) {
+      return arena_.capacity() + offsets_.capacity() * sizeof(uint32_t);
+    }
+    // Every name is a node with the key, the index, the next pointer and the cached hash
+    size_t bytes = names_.bucket_count() * sizeof(void*) + indexes_.capacity() * sizeof(nameiter);
+    for (const auto& name : names_) {
+      bytes += sizeof(NamesMap::value_type) + 2 * sizeof(void*);
+      // Short names are stored in the string itself
+      if (name.first.capacity() > 15) {
+        bytes += name.first.capacity() + 1;
+      }
+    }
+    return bytes;
   }
 
 protected:
+  // Where an arena without any names points to
+  static const char* blank() {
+    static const char terminator = 0;
+    return &terminator;
+  }
+
   // Map of names to indexes
   NamesMap names_;
 
   // List of entries into the map
   using nameiter = NamesMap::iterator;
   std::vector<nameiter> indexes_;
+
+  // The names once they are in an arena, either on the heap or mapped from a file
+  std::vector<char> arena_;
+  std::shared_ptr<midgard::mem_map<char>> mapped_arena_;
+  const char* arena_data_;
+
+  // Offset in the arena of each name from index 1 on, then the offset past the last one
+  std::vector<uint32_t> offsets_;
 };
 
 } // namespace mjolnir
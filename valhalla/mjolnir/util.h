@@ -40,7 +40,8 @@ enum class BuildStage : int8_t {
   kRestrictions = 12,
   kElevation = 13,
   kValidate = 14,
-  kCleanup = 15
+  kContract = 15,
+  kCleanup = 16
 };
 
 constexpr uint8_t kMinor = 1;
@@ -65,6 +66,7 @@ inline BuildStage string_to_buildstage(const std::string& s) {
        {"restrictions", BuildStage::kRestrictions},
        {"elevation", BuildStage::kElevation},
        {"validate", BuildStage::kValidate},
+       {"contract", BuildStage::kContract},
        {"cleanup", BuildStage::kCleanup}};
 
   auto i = stringToBuildStage.find(s);
@@ -89,6 +91,7 @@ inline std::string to_string(BuildStage stg) {
        {static_cast<int8_t>(BuildStage::kRestrictions), "restrictions"},
        {static_cast<int8_t>(BuildStage::kElevation), "elevation"},
        {static_cast<int8_t>(BuildStage::kValidate), "validate"},
+       {static_cast<int8_t>(BuildStage::kContract), "contract"},
        {static_cast<int8_t>(BuildStage::kCleanup), "cleanup"}};
 
   auto i = BuildStageStrings.find(static_cast<int8_t>(stg));
@@ -153,6 +156,21 @@ bool build_tile_set(const ptree& config,
                     const BuildStage end_stage = BuildStage::kValidate,
                     const bool release_osmpbf_memory = true);
 
+/**
+ * Update a tileset built with mjolnir.incremental_dir set, which keeps a copy of the enhanced local
+ * tiles, to new data. Only the local tiles touched by the osmChange of the previous data to the new
+ * one and the local tiles with edges ending in them are built and enhanced, the other ones are taken
+ * from the copy and keep their node ids. The input files are still parsed as a whole and the stages
+ * from filter on still run over the whole graph since the other levels and the validation span it.
+ * @param config       Used to tell the function where and how to build the tiles
+ * @param input_files  Tells what osm pbf files, with the change applied, to build the tiles from
+ * @param osc_file     osmChange file going from the data of the previous build to the input files
+ * @return Returns true if no errors occur, false if an error occurs.
+ */
+bool update_tile_set(const ptree& config,
+                     const std::vector<std::string>& input_files,
+                     const std::string& osc_file);
+
 // The tile manifest is a JSON-serializable index of tiles to be processed during the build stage of
 // valhalla_build_tiles'. It can be used to distribute shard keys when building tiles with
 // parallelized, distributed batch processing. For example, a workflow orchestrator can partition
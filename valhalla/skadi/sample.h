@@ -27,7 +27,11 @@ public:
   sample& operator=(const sample&) = delete;
 
   /**
-   * @brief Constructor
+   * @brief Constructor. Compressed tiles are inflated on demand and kept in memory up to
+   *        additional_data.elevation_cache_mb, evicting the least recently sampled ones. With
+   *        additional_data.elevation_cache_dir they are also kept there as raw tiles to map the
+   *        next time instead of inflating them again. additional_data.elevation_cache_unpack
+   *        inflates all of them into that directory right away, see unpack_to_cache
    * @param[in] config  Configuration settings
    */
   sample(const boost::property_tree::ptree& config);
@@ -48,11 +52,20 @@ public:
   template <class coord_t> double get(const coord_t& coord);
 
   /**
-   * @brief Get multiple samples from the datasource
+   * @brief Get multiple samples from the datasource. The postings are grouped by tile so that
+   *        each tile is looked up once and its postings are interpolated together
    * @param coords  the list of postings at which to sample the datasource
    */
   template <class coords_t> std::vector<double> get_all(const coords_t& coords);
 
+  /**
+   * @brief Inflates all the compressed tiles of the datasource into the directory configured as
+   *        additional_data.elevation_cache_dir. Samples made with the same configuration later
+   *        map those raw tiles instead of inflating the compressed ones on demand
+   * @return the number of tiles written, tiles already in the directory are skipped
+   */
+  size_t unpack_to_cache();
+
 protected:
   /**
    * Get a single sample from the datasource
@@ -64,6 +77,13 @@ protected:
    */
   template <class coord_t> double get(const coord_t& coord, tile_data& tile);
 
+  /**
+   * @brief Get a tile from the cache, loading it from the remote source when it is missing
+   * @param[in] index tile index
+   * @return the tile, empty when there is no data for it
+   */
+  tile_data source(uint16_t index);
+
   /**
    * @return A tile index value from a coordinate
    */
@@ -31,6 +31,7 @@ public:
    *                 cost so that performance is kept high.
    */
   void Init(const midgard::PointLL& ll, const float factor) {
+    ll_ = ll;
     distapprox_.SetTestPoint(ll);
     costfactor_ = factor;
   }
@@ -77,7 +78,16 @@ public:
     return dist * costfactor_;
   }
 
+  /**
+   * Get the destination the heuristic estimates the cost to.
+   * @return  Returns the latitude, longitude of the destination.
+   */
+  const midgard::PointLL& target() const {
+    return ll_;
+  }
+
 private:
+  midgard::PointLL ll_; // Destination
   midgard::DistanceApproximator<midgard::PointLL> distapprox_; // Distance approximation
   float costfactor_; // Cost factor - ensures the cost estimate
                      // underestimates the true cost.
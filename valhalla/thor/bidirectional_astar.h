@@ -8,7 +8,7 @@
 #include <utility>
 #include <vector>
 
-#include <valhalla/baldr/double_bucket_queue.h>
+#include <valhalla/baldr/label_queue.h>
 #include <valhalla/baldr/time_info.h>
 #include <valhalla/proto/api.pb.h>
 #include <valhalla/sif/edgelabel.h>
@@ -107,13 +107,17 @@ protected:
   AStarHeuristic astarheuristic_forward_;
   AStarHeuristic astarheuristic_reverse_;
 
+  // Last tile each direction asked the reader to prefetch ahead of
+  baldr::GraphId prefetched_tile_forward_;
+  baldr::GraphId prefetched_tile_reverse_;
+
   // Vector of edge labels (requires access by index).
   std::vector<sif::BDEdgeLabel> edgelabels_forward_;
   std::vector<sif::BDEdgeLabel> edgelabels_reverse_;
 
   // Adjacency list - approximate double bucket sort
-  baldr::DoubleBucketQueue<sif::BDEdgeLabel> adjacencylist_forward_;
-  baldr::DoubleBucketQueue<sif::BDEdgeLabel> adjacencylist_reverse_;
+  baldr::LabelQueue<sif::BDEdgeLabel> adjacencylist_forward_;
+  baldr::LabelQueue<sif::BDEdgeLabel> adjacencylist_reverse_;
 
   // Edge status. Mark edges that are in adjacency list or settled.
   EdgeStatus edgestatus_forward_;
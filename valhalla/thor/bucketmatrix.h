@@ -0,0 +1,179 @@
+#ifndef VALHALLA_THOR_BUCKETMATRIX_H_
+#define VALHALLA_THOR_BUCKETMATRIX_H_
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <queue>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <boost/property_tree/ptree.hpp>
+
+#include <valhalla/baldr/contractionhierarchy.h>
+#include <valhalla/baldr/graphreader.h>
+#include <valhalla/proto/common.pb.h>
+#include <valhalla/sif/dynamiccost.h>
+#include <valhalla/thor/costmatrix.h>
+
+namespace valhalla {
+namespace thor {
+
+/**
+ * Class to compute time distance matrices with the bucket based many-to-many algorithm on the
+ * contraction hierarchy built by mjolnir, as described by Knopp et al., "Computing Many-to-Many
+ * Shortest Paths Using Highway Hierarchies". One upward search per target leaves an entry in the
+ * bucket of every node it settles, one upward search per source then scans the buckets of the
+ * nodes it settles. That is one search per location instead of the connection bookkeeping of
+ * CostMatrix. The hierarchy doesn't know about turn costs and restrictions, so the best path of
+ * every pair is unpacked and recosted with the request costing like the routes of the hierarchy.
+ */
+class BucketMatrix {
+public:
+  /**
+   * Default constructor. Most internal values are set when a query is made so
+   * the constructor mainly just sets some internals to a default empty value.
+   * @param config A config object of key, value pairs
+   */
+  explicit BucketMatrix(const boost::property_tree::ptree& config = {});
+  ~BucketMatrix();
+
+  /**
+   * Sets the hierarchy to search.
+   * @param hierarchy  the hierarchy, no matrix can be computed without one
+   */
+  void set_hierarchy(const std::shared_ptr<const baldr::ContractionHierarchy>& hierarchy) {
+    hierarchy_ = hierarchy;
+  }
+
+  /**
+   * Can the hierarchy answer the request, ie. was it built with the same costing options.
+   * @param  options  the request options
+   * @return true if there is a hierarchy and it matches the requested auto costing
+   */
+  bool Matches(const Options& options) const {
+    return hierarchy_ && hierarchy_->matches(options);
+  }
+
+  /**
+   * Forms a time distance matrix from the set of source locations
+   * to the set of target locations.
+   * @param  source_location_list  List of source/origin locations.
+   * @param  target_location_list  List of target/destination locations.
+   * @param  graphreader           Graph reader for accessing routing graph.
+   * @param  mode_costing          Costing methods.
+   * @param  mode                  Travel mode to use.
+   * @param  max_matrix_distance   Maximum arc-length distance for current mode.
+   * @return time/distance from origin index to all other locations or nothing when the costing
+   *         rejects one of the paths, the caller is expected to fall back to CostMatrix then
+   */
+  std::vector<TimeDistance>
+  SourceToTarget(const google::protobuf::RepeatedPtrField<valhalla::Location>& source_location_list,
+                 const google::protobuf::RepeatedPtrField<valhalla::Location>& target_location_list,
+                 baldr::GraphReader& graphreader,
+                 const sif::mode_costing_t& mode_costing,
+                 const sif::TravelMode mode,
+                 const float max_matrix_distance);
+
+  /**
+   * Clear the temporary information generated during time+distance
+   * matrix construction.
+   */
+  void clear();
+
+protected:
+  // Cost of a path within the hierarchy and how it got to the node
+  struct label_t {
+    float cost;
+    uint32_t arc;  // arc the node was reached by, kInvalidContractionIndex at a seed
+    uint32_t seed; // index of the edge of the location the path starts or ends with
+  };
+
+  // A node the upward search of a target settled and how far it is from the target
+  struct bucket_t {
+    uint32_t node;
+    uint32_t target;
+    label_t label;
+
+    bool operator<(const bucket_t& other) const {
+      return node < other.node || (node == other.node && target < other.target);
+    }
+  };
+
+  // An origin or destination edge and where along it the location is
+  struct seed_t {
+    uint32_t node;
+    baldr::GraphId edgeid;
+    float percent_along;
+    label_t label;
+  };
+
+  // The best path from a source to a target found so far, either through the node where the
+  // searches met or along a single edge
+  struct connection_t {
+    float cost;
+    uint32_t meet;
+    baldr::GraphId edgeid;
+    float source_percent;
+    float target_percent;
+  };
+
+  std::shared_ptr<const baldr::ContractionHierarchy> hierarchy_;
+  sif::cost_ptr_t costing_;
+
+  // The cost threshold being used for the currently executing query
+  float current_cost_threshold_;
+
+  // Buckets of all the targets, sorted by node and target once the targets are done
+  std::vector<bucket_t> buckets_;
+
+  // The edges each target is entered by
+  std::vector<std::vector<seed_t>> target_seeds_;
+
+  // Labels and queue of the current search, reused from one location to the next
+  std::unordered_map<uint32_t, label_t> labels_;
+  std::priority_queue<std::pair<float, uint32_t>,
+                      std::vector<std::pair<float, uint32_t>>,
+                      std::greater<std::pair<float, uint32_t>>>
+      queue_;
+
+  /**
+   * Finds the hierarchy nodes a location enters or leaves the graph at.
+   * @param graphreader  Graph reader for accessing routing graph.
+   * @param location     the source or target
+   * @param forward      true for a source
+   * @return the nodes with the cost of the partial edges leading to or away from them
+   */
+  std::vector<seed_t>
+  Seed(baldr::GraphReader& graphreader, const valhalla::Location& location, const bool forward);
+
+  /**
+   * Upward search from the seeds of one location. Calls back with every node it settles.
+   * @param seeds    the seeds of the location
+   * @param forward  true to follow the arcs leaving the nodes, false for the arcs entering them
+   * @param settled  called with each settled node and its label
+   */
+  template <typename settled_t>
+  void Search(const std::vector<seed_t>& seeds, const bool forward, const settled_t& settled);
+
+  /**
+   * Unpacks the best path from the source whose forward search just finished to a target.
+   * @param source_seeds    the seeds of the source
+   * @param target          index of the target
+   * @param connection      the best connection between them
+   * @param source_percent  set to where the path starts along its first edge
+   * @param target_percent  set to where the path ends along its last edge
+   * @return the graph edges of the path in order
+   */
+  std::vector<baldr::GraphId> FormPath(const std::vector<seed_t>& source_seeds,
+                                       const uint32_t target,
+                                       const connection_t& connection,
+                                       float& source_percent,
+                                       float& target_percent) const;
+};
+
+} // namespace thor
+} // namespace valhalla
+
+#endif // VALHALLA_THOR_BUCKETMATRIX_H_
@@ -0,0 +1,157 @@
+#ifndef VALHALLA_THOR_CONTRACTION_QUERY_H_
+#define VALHALLA_THOR_CONTRACTION_QUERY_H_
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <queue>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <valhalla/baldr/contractionhierarchy.h>
+#include <valhalla/baldr/graphreader.h>
+#include <valhalla/proto/api.pb.h>
+#include <valhalla/sif/dynamiccost.h>
+#include <valhalla/thor/pathalgorithm.h>
+
+namespace valhalla {
+namespace thor {
+
+/**
+ * Bidirectional search of the contraction hierarchy built by mjolnir. Both searches only follow
+ * arcs towards higher ranked nodes so they settle a tiny fraction of what bidirectional A* does.
+ * The path found is unpacked into graph edges and recosted with the requested costing, which
+ * also applies turn costs and restrictions. When the hierarchy can't be used or the recosting
+ * rejects the path no path is returned and the caller is expected to fall back to another
+ * algorithm.
+ */
+class ContractionQuery : public PathAlgorithm {
+public:
+  /**
+   * Constructor. Loads the hierarchy configured as mjolnir.contraction_hierarchy if there is one.
+   * @param config  the full valhalla config
+   */
+  explicit ContractionQuery(const boost::property_tree::ptree& config = {});
+
+  /**
+   * Destructor
+   */
+  virtual ~ContractionQuery();
+
+  /**
+   * Form path between and origin and destination location using the hierarchy.
+   * @param  origin  Origin location
+   * @param  dest    Destination location
+   * @param  graphreader  Graph reader for accessing routing graph.
+   * @param  mode_costing  An array of costing methods, one per TravelMode.
+   * @param  mode     Travel mode from the origin.
+   * @return  Returns the path edges (and elapsed time/modes at end of
+   *          each edge) or nothing if the hierarchy couldn't find a valid path.
+   */
+  std::vector<std::vector<PathInfo>>
+  GetBestPath(valhalla::Location& origin,
+              valhalla::Location& dest,
+              baldr::GraphReader& graphreader,
+              const sif::mode_costing_t& mode_costing,
+              const sif::TravelMode mode,
+              const Options& options = Options::default_instance()) override;
+
+  /**
+   * Returns the name of the algorithm
+   * @return the name of the algorithm
+   */
+  virtual const char* name() const override {
+    return "contraction_hierarchy";
+  }
+
+  /**
+   * Clear the temporary information generated during path construction.
+   */
+  void Clear() override;
+
+  /**
+   * Can the hierarchy answer the request, ie. was it built with the same costing options.
+   * @param  options  the request options
+   * @return true if there is a hierarchy and it matches the requested auto costing
+   */
+  bool Matches(const Options& options) const;
+
+  /**
+   * @return the hierarchy or nothing if none is configured or it failed to load
+   */
+  std::shared_ptr<const baldr::ContractionHierarchy> hierarchy() const {
+    return hierarchy_;
+  }
+
+  /**
+   * Recosts the graph edges of a path found in the hierarchy with the request costing. This adds
+   * the turn costs and checks the restrictions the hierarchy doesn't know about.
+   * @param graphreader     Graph reader for accessing routing graph.
+   * @param costing         the request costing
+   * @param mode            travel mode of the costing
+   * @param edges           the edges of the path in order
+   * @param source_percent  where the path starts along its first edge
+   * @param target_percent  where the path ends along its last edge
+   * @param has_ferry       set when the path takes a ferry
+   * @return the path or nothing if the costing rejected it
+   */
+  static std::vector<PathInfo> Recost(baldr::GraphReader& graphreader,
+                                      const sif::DynamicCost& costing,
+                                      const sif::TravelMode mode,
+                                      const std::vector<baldr::GraphId>& edges,
+                                      const float source_percent,
+                                      const float target_percent,
+                                      bool& has_ferry);
+
+protected:
+  // Label of a node reached by one of the searches
+  struct label_t {
+    float cost;
+    uint32_t arc;  // arc the node was reached by, kInvalidContractionIndex at a seed
+    uint32_t seed; // index of the origin or destination edge the path starts or ends with
+  };
+  using labels_t = std::unordered_map<uint32_t, label_t>;
+  using queue_t = std::priority_queue<std::pair<float, uint32_t>,
+                                      std::vector<std::pair<float, uint32_t>>,
+                                      std::greater<std::pair<float, uint32_t>>>;
+
+  // An origin or destination edge and where along it the location is
+  struct seed_t {
+    baldr::GraphId edgeid;
+    float percent_along;
+  };
+
+  /**
+   * Labels the hierarchy nodes the search starts from in one direction.
+   * @param graphreader  Graph reader for accessing routing graph.
+   * @param location     Origin or destination location
+   * @param forward      True to seed the forward search from the origin
+   */
+  void Seed(baldr::GraphReader& graphreader, const valhalla::Location& location, bool forward);
+
+  /**
+   * Turns the arcs of the path into the graph edges they stand for and recosts them.
+   * @param graphreader  Graph reader for accessing routing graph.
+   * @param meet         node where the forward and reverse search met
+   * @return the path or nothing if the costing rejected it
+   */
+  std::vector<PathInfo> FormPath(baldr::GraphReader& graphreader, uint32_t meet);
+
+
+  std::shared_ptr<const baldr::ContractionHierarchy> hierarchy_;
+  sif::cost_ptr_t costing_;
+  sif::TravelMode mode_;
+
+  std::vector<seed_t> origins_;
+  std::vector<seed_t> destinations_;
+  labels_t forward_labels_;
+  labels_t reverse_labels_;
+  queue_t forward_queue_;
+  queue_t reverse_queue_;
+};
+
+} // namespace thor
+} // namespace valhalla
+
+#endif // VALHALLA_THOR_CONTRACTION_QUERY_H_
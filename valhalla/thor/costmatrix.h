@@ -8,9 +8,9 @@
 #include <utility>
 #include <vector>
 
-#include <valhalla/baldr/double_bucket_queue.h>
 #include <valhalla/baldr/graphid.h>
 #include <valhalla/baldr/graphreader.h>
+#include <valhalla/baldr/label_queue.h>
 #include <valhalla/proto/common.pb.h>
 #include <valhalla/sif/dynamiccost.h>
 #include <valhalla/sif/edgelabel.h>
@@ -90,8 +90,9 @@ public:
   /**
    * Default constructor. Most internal values are set when a query is made so
    * the constructor mainly just sets some internals to a default empty value.
+   * @param config A config object of key, value pairs
    */
-  CostMatrix();
+  explicit CostMatrix(const boost::property_tree::ptree& config = {});
   ~CostMatrix();
 
   /**
@@ -138,6 +139,20 @@ protected:
   // The cost threshold being used for the currently executing query
   float current_cost_threshold_;
 
+  // Which priority queue the per location adjacency lists use
+  baldr::QueueType queue_type_;
+
+  // How many threads may expand the searches of one request, 1 expands them all serially
+  uint32_t thread_count_;
+
+  // Set while the searches of all targets or of all sources take their step on the thread pool.
+  // Updates to the other side's status and to the target map are then recorded per location and
+  // applied afterwards in location order, which is the order the serial loop applies them in
+  bool expanding_targets_in_parallel_;
+  bool expanding_sources_in_parallel_;
+  std::vector<std::vector<std::pair<uint32_t, uint32_t>>> deferred_status_;
+  std::vector<std::vector<baldr::GraphId>> deferred_targets_;
+
   // Status
   std::vector<LocationStatus> source_status_;
   std::vector<LocationStatus> target_status_;
@@ -145,14 +160,14 @@ protected:
   // Adjacency lists, EdgeLabels, EdgeStatus, and hierarchy limits for each
   // source location (forward traversal)
   std::vector<std::vector<sif::HierarchyLimits>> source_hierarchy_limits_;
-  std::vector<baldr::DoubleBucketQueue<sif::BDEdgeLabel>> source_adjacency_;
+  std::vector<baldr::LabelQueue<sif::BDEdgeLabel>> source_adjacency_;
   std::vector<std::vector<sif::BDEdgeLabel>> source_edgelabel_;
   std::vector<EdgeStatus> source_edgestatus_;
 
   // Adjacency lists, EdgeLabels, EdgeStatus, and hierarchy limits for each
   // target location (reverse traversal)
   std::vector<std::vector<sif::HierarchyLimits>> target_hierarchy_limits_;
-  std::vector<baldr::DoubleBucketQueue<sif::BDEdgeLabel>> target_adjacency_;
+  std::vector<baldr::LabelQueue<sif::BDEdgeLabel>> target_adjacency_;
   std::vector<std::vector<sif::BDEdgeLabel>> target_edgelabel_;
   std::vector<EdgeStatus> target_edgestatus_;
 
@@ -199,6 +214,43 @@ protected:
    */
   void UpdateStatus(const uint32_t source, const uint32_t target);
 
+  /**
+   * Remove the target from the locations the source still has to find.
+   * @param  source       Source index
+   * @param  target       Target index
+   * @param  label_count  Number of edge labels of both searches when the connection was found
+   */
+  void UpdateSourceStatus(const uint32_t source, const uint32_t target, const uint32_t label_count);
+
+  /**
+   * Remove the source from the locations the target still has to find.
+   * @param  source       Source index
+   * @param  target       Target index
+   * @param  label_count  Number of edge labels of both searches when the connection was found
+   */
+  void UpdateTargetStatus(const uint32_t source, const uint32_t target, const uint32_t label_count);
+
+  /**
+   * Stop expanding a target whose threshold ran out.
+   * @param  index  Index of the target location.
+   */
+  void FinishTarget(const uint32_t index);
+
+  /**
+   * Stop expanding a source whose threshold ran out.
+   * @param  index  Index of the source location.
+   */
+  void FinishSource(const uint32_t index);
+
+  /**
+   * Let all targets, or all sources, whose threshold didn't run out take one step of their
+   * search. The steps run on the thread pool when there are enough of them.
+   * @param  forward      true to step the source searches, false for the target searches
+   * @param  n            Iteration counter.
+   * @param  graphreader  Graph reader for accessing routing graph.
+   */
+  void ExpandInParallel(const bool forward, const uint32_t n, baldr::GraphReader& graphreader);
+
   /**
    * Iterate the backward search from the target/destination location.
    * @param  index        Index of the target location.
@@ -250,9 +302,13 @@ protected:
 
 private:
   class TargetMap;
+  class ThreadPool;
 
   // Mark each target edge with a list of target indexes that have reached it
   std::unique_ptr<TargetMap> targets_;
+
+  // Threads expanding the searches, kept from one request to the next
+  std::unique_ptr<ThreadPool> pool_;
 };
 
 } // namespace thor
@@ -8,9 +8,9 @@
 #include <utility>
 #include <vector>
 
-#include <valhalla/baldr/double_bucket_queue.h>
 #include <valhalla/baldr/graphid.h>
 #include <valhalla/baldr/graphreader.h>
+#include <valhalla/baldr/label_queue.h>
 #include <valhalla/baldr/location.h>
 #include <valhalla/baldr/time_info.h>
 #include <valhalla/proto/common.pb.h>
@@ -146,8 +146,8 @@ protected:
   bool clear_reserved_memory_;
 
   // Adjacency list - approximate double bucket sort
-  baldr::DoubleBucketQueue<sif::BDEdgeLabel> adjacencylist_;
-  baldr::DoubleBucketQueue<sif::MMEdgeLabel> mmadjacencylist_;
+  baldr::LabelQueue<sif::BDEdgeLabel> adjacencylist_;
+  baldr::LabelQueue<sif::MMEdgeLabel> mmadjacencylist_;
 
   // Edge status. Mark edges that are in adjacency list or settled.
   EdgeStatus edgestatus_;
@@ -172,7 +172,7 @@ protected:
    */
   template <typename label_container_t>
   void Initialize(label_container_t& labels,
-                  baldr::DoubleBucketQueue<typename label_container_t::value_type>& queue,
+                  baldr::LabelQueue<typename label_container_t::value_type>& queue,
                   const uint32_t bucketsize);
 
   /**
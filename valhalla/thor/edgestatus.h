@@ -1,8 +1,13 @@
 #pragma once
 
-#include <unordered_map>
+#include <algorithm>
+#include <array>
+#include <memory>
+#include <vector>
+
 #include <valhalla/baldr/graphid.h>
 #include <valhalla/baldr/graphtile.h>
+#include <valhalla/baldr/tilehierarchy.h>
 
 // handy macro for shifting the 7bit path index value so that it can be or'd with the tile/level id
 #define SHIFT_path_id(x) (static_cast<uint32_t>(x) << 25u)
@@ -50,37 +55,45 @@ struct EdgeStatusInfo {
  * edges within arrays for each tile. This allows the path algorithms to get
  * a pointer to the first edge status and iterate that pointer over sequential
  * edges. This reduces the number of map lookups.
+ *
+ * Tiles are found without hashing: the level and tile id are turned into a dense tile offset
+ * (the same layout FlatTileCache uses) which is looked up in a lazily allocated page table. The
+ * per tile arrays come from an arena that is kept across clear() calls so that an algorithm
+ * object which is reused request after request stops allocating once it has warmed up. Every
+ * slot in the page table is stamped with the generation it was assigned in, so clear() only has
+ * to bump the generation to forget all the tiles.
  */
 class EdgeStatus {
 public:
   /**
    * Default constructor.
    */
-  EdgeStatus() = default;
+  EdgeStatus() : generation_(1), arrays_used_(0), arrays_capacity_(0) {
+  }
 
-  // in order no to delete objects twice in destructor we should explicitly
-  // forbid copying
+  // the arena owns the arrays we hand out pointers to, copying makes no sense
   EdgeStatus(const EdgeStatus&) = delete;
   EdgeStatus& operator=(const EdgeStatus&) = delete;
   EdgeStatus(EdgeStatus&&) = default;
   EdgeStatus& operator=(EdgeStatus&&) = default;
 
   /**
-   * Destructor. Delete any allocated EdgeStatusInfo arrays.
-   */
-  ~EdgeStatus() {
-    clear();
-  }
-
-  /**
-   * Clear the EdgeStatusInfo arrays and the edge status map.
+   * Forget the status of all edges. The arrays and pages are kept around for the next
+   * search unless the last one was so big that holding on to them would be wasteful.
    */
   void clear() {
-    // Delete any allocated arrays for tiles within the map.
-    for (auto& iter : edgestatus_) {
-      delete[] iter.second;
+    arrays_used_ = 0;
+    while (arrays_capacity_ > kMaxRetainedEdges) {
+      arrays_capacity_ -= arrays_.back().capacity;
+      arrays_.pop_back();
+    }
+    // when the generation wraps around the stale stamps could look valid again
+    if (++generation_ == 0) {
+      for (auto& page : pages_) {
+        std::fill(page.get(), page.get() + kPageSize, slot_t{});
+      }
+      generation_ = 1;
     }
-    edgestatus_.clear();
   }
 
   /**
@@ -98,16 +111,7 @@ public:
            const graph_tile_ptr& tile,
            const uint8_t path_id = 0) {
     assert(path_id <= baldr::kMaxMultiPathId);
-    auto p = edgestatus_.find(edgeid.tile_value() | SHIFT_path_id(path_id));
-    if (p != edgestatus_.end()) {
-      p->second[edgeid.id()] = {set, index};
-    } else {
-      // Tile is not in the map. Add an array of EdgeStatusInfo, sized to
-      // the number of directed edges in the specified tile.
-      auto inserted = edgestatus_.emplace(edgeid.tile_value() | SHIFT_path_id(path_id),
-                                          new EdgeStatusInfo[tile->header()->directededgecount()]);
-      inserted.first->second[edgeid.id()] = {set, index};
-    }
+    get_or_make_array(edgeid, tile, path_id)[edgeid.id()] = {set, index};
   }
 
   /**
@@ -120,9 +124,9 @@ public:
    */
   void Update(const baldr::GraphId& edgeid, const EdgeSet set, const uint8_t path_id = 0) {
     assert(path_id <= baldr::kMaxMultiPathId);
-    const auto p = edgestatus_.find(edgeid.tile_value() | SHIFT_path_id(path_id));
-    if (p != edgestatus_.end()) {
-      p->second[edgeid.id()].set_ = static_cast<uint32_t>(set);
+    auto* array = get_array(edgeid, path_id);
+    if (array) {
+      array[edgeid.id()].set_ = static_cast<uint32_t>(set);
     } else {
       throw std::runtime_error("EdgeStatus Update on edge not previously set");
     }
@@ -137,8 +141,8 @@ public:
    */
   EdgeStatusInfo Get(const baldr::GraphId& edgeid, const uint8_t path_id = 0) const {
     assert(path_id <= baldr::kMaxMultiPathId);
-    const auto p = edgestatus_.find(edgeid.tile_value() | SHIFT_path_id(path_id));
-    return (p == edgestatus_.end()) ? EdgeStatusInfo() : p->second[edgeid.id()];
+    const auto* array = get_array(edgeid, path_id);
+    return array ? array[edgeid.id()] : EdgeStatusInfo();
   }
 
   /**
@@ -154,23 +158,133 @@ public:
   EdgeStatusInfo*
   GetPtr(const baldr::GraphId& edgeid, const graph_tile_ptr& tile, const uint8_t path_id = 0) {
     assert(path_id <= baldr::kMaxMultiPathId);
-    const auto p = edgestatus_.find(edgeid.tile_value() | SHIFT_path_id(path_id));
-    if (p != edgestatus_.end()) {
-      return &p->second[edgeid.id()];
+    return &get_or_make_array(edgeid, tile, path_id)[edgeid.id()];
+  }
+
+protected:
+  // How many tiles share one page of the page table
+  static constexpr uint32_t kPageBits = 10;
+  static constexpr uint32_t kPageSize = 1 << kPageBits;
+  // Arrays beyond this many edges in total are freed on clear rather than kept for the next search
+  static constexpr size_t kMaxRetainedEdges = 1 << 22;
+
+  // Which arena array a tile was given and in which generation
+  struct slot_t {
+    uint32_t generation = 0;
+    uint32_t array = 0;
+  };
+
+  // An arena array along with how many edges it can hold
+  struct array_t {
+    std::unique_ptr<EdgeStatusInfo[]> edges;
+    uint32_t capacity;
+  };
+
+  /**
+   * Where each level starts in the dense tile numbering, laid out like FlatTileCache
+   */
+  static const std::array<uint32_t, 4>& level_offsets() {
+    static const std::array<uint32_t, 4> offsets = []() {
+      std::array<uint32_t, 4> offsets;
+      offsets[0] = 0;
+      offsets[1] = offsets[0] + baldr::TileHierarchy::levels()[0].tiles.TileCount();
+      offsets[2] = offsets[1] + baldr::TileHierarchy::levels()[1].tiles.TileCount();
+      offsets[3] = offsets[2] + baldr::TileHierarchy::levels()[2].tiles.TileCount();
+      return offsets;
+    }();
+    return offsets;
+  }
+
+  /**
+   * The dense tile offset of the tile an edge belongs to
+   */
+  static uint32_t tile_offset(const baldr::GraphId& edgeid) {
+    assert(edgeid.level() < 4);
+    return level_offsets()[edgeid.level()] + edgeid.tileid();
+  }
+
+  /**
+   * Find the slot for a tile/path in the page table
+   * @return nullptr if the page holding the slot was never made
+   */
+  const slot_t* find_slot(const baldr::GraphId& edgeid, const uint8_t path_id) const {
+    const uint32_t offset = tile_offset(edgeid);
+    const uint32_t page_index = offset >> kPageBits;
+    if (path_id >= directories_.size() || page_index >= directories_[path_id].size() ||
+        directories_[path_id][page_index] == 0) {
+      return nullptr;
+    }
+    return &pages_[directories_[path_id][page_index] - 1][offset & (kPageSize - 1)];
+  }
+
+  /**
+   * Get the slot for a tile/path in the page table, making its page if need be
+   */
+  slot_t& make_slot(const baldr::GraphId& edgeid, const uint8_t path_id) {
+    const uint32_t offset = tile_offset(edgeid);
+    const uint32_t page_index = offset >> kPageBits;
+    if (path_id >= directories_.size()) {
+      directories_.resize(path_id + 1);
+    }
+    auto& directory = directories_[path_id];
+    if (page_index >= directory.size()) {
+      directory.resize(page_index + 1, 0);
+    }
+    if (directory[page_index] == 0) {
+      pages_.emplace_back(new slot_t[kPageSize]);
+      directory[page_index] = pages_.size();
+    }
+    return pages_[directory[page_index] - 1][offset & (kPageSize - 1)];
+  }
+
+  /**
+   * Get the status array of a tile if it was touched in this generation
+   */
+  EdgeStatusInfo* get_array(const baldr::GraphId& edgeid, const uint8_t path_id) const {
+    const auto* slot = find_slot(edgeid, path_id);
+    return slot && slot->generation == generation_ ? arrays_[slot->array].edges.get() : nullptr;
+  }
+
+  /**
+   * Get the status array of a tile, handing out a zeroed arena array if it wasnt touched yet
+   */
+  EdgeStatusInfo*
+  get_or_make_array(const baldr::GraphId& edgeid, const graph_tile_ptr& tile, const uint8_t path_id) {
+    auto& slot = make_slot(edgeid, path_id);
+    if (slot.generation == generation_) {
+      return arrays_[slot.array].edges.get();
+    }
+
+    // grab the next arena array, growing it if this tile has more edges than it can hold
+    const uint32_t count = tile->header()->directededgecount();
+    if (arrays_used_ == arrays_.size()) {
+      arrays_.push_back({std::unique_ptr<EdgeStatusInfo[]>(new EdgeStatusInfo[count]), count});
+      arrays_capacity_ += count;
+    } else if (arrays_[arrays_used_].capacity < count) {
+      arrays_capacity_ += count - arrays_[arrays_used_].capacity;
+      arrays_[arrays_used_] = {std::unique_ptr<EdgeStatusInfo[]>(new EdgeStatusInfo[count]), count};
     } else {
-      // Tile is not in the map. Add an array of EdgeStatusInfo, sized to
-      // the number of directed edges in the specified tile.
-      auto inserted = edgestatus_.emplace(edgeid.tile_value() | SHIFT_path_id(path_id),
-                                          new EdgeStatusInfo[tile->header()->directededgecount()]);
-      return &(inserted.first->second)[edgeid.id()];
+      std::fill_n(arrays_[arrays_used_].edges.get(), count, EdgeStatusInfo());
     }
+    slot = {generation_, arrays_used_};
+    return arrays_[arrays_used_++].edges.get();
   }
 
-private:
-  // Edge status - keys are the tile Ids (level and tile Id) and the
-  // values are dynamically allocated arrays of EdgeStatusInfo (sized
-  // based on the directed edge count within the tile).
-  std::unordered_map<uint32_t, EdgeStatusInfo*> edgestatus_;
+  // Current generation, slots stamped with anything else are stale
+  uint32_t generation_;
+
+  // Per path id, which page (1 based, 0 is none) holds the slots of a range of tiles
+  std::vector<std::vector<uint32_t>> directories_;
+
+  // Pages of slots, kept across clears
+  std::vector<std::unique_ptr<slot_t[]>> pages_;
+
+  // Arena of per tile edge status arrays and how many are handed out in this generation
+  std::vector<array_t> arrays_;
+  uint32_t arrays_used_;
+
+  // How many edges the arena arrays can hold all together
+  size_t arrays_capacity_;
 };
 
 } // namespace thor
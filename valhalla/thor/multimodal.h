@@ -8,9 +8,9 @@
 #include <utility>
 #include <vector>
 
-#include <valhalla/baldr/double_bucket_queue.h>
 #include <valhalla/baldr/graphid.h>
 #include <valhalla/baldr/graphreader.h>
+#include <valhalla/baldr/label_queue.h>
 #include <valhalla/baldr/time_info.h>
 #include <valhalla/proto/common.pb.h>
 #include <valhalla/sif/dynamiccost.h>
@@ -103,7 +103,7 @@ protected:
   std::vector<sif::MMEdgeLabel> edgelabels_;
 
   // Adjacency list - approximate double bucket sort
-  baldr::DoubleBucketQueue<sif::MMEdgeLabel> adjacencylist_;
+  baldr::LabelQueue<sif::MMEdgeLabel> adjacencylist_;
 
   // Edge status. Mark edges that are in adjacency list or settled.
   EdgeStatus edgestatus_;
@@ -164,7 +164,7 @@ protected:
                       const std::shared_ptr<sif::DynamicCost>& costing,
                       EdgeStatus& edgestatus,
                       std::vector<sif::EdgeLabel>& edgelabels,
-                      baldr::DoubleBucketQueue<sif::EdgeLabel>& adjlist,
+                      baldr::LabelQueue<sif::EdgeLabel>& adjlist,
                       const bool from_transition);
 
   /**
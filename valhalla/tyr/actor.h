@@ -2,8 +2,10 @@
 #define VALHALLA_TYR_ACTOR_H_
 
 #include <boost/property_tree/ptree.hpp>
+#include <functional>
 #include <memory>
 #include <unordered_map>
+#include <vector>
 
 #include <valhalla/baldr/graphreader.h>
 #include <valhalla/proto/api.pb.h>
@@ -73,6 +75,25 @@ public:
                      const std::function<void()>* interrupt = nullptr,
                      Api* api = nullptr);
 
+  /**
+   * Perform the locate action for a large number of locations at once. The locations are sorted by
+   * the bin of the graph they are in and cut into chunks of loki.batch_locations neighbouring
+   * locations, the search of a chunk visits each bin once for all of the locations in it. The
+   * chunks are spread over a pool of loki.batch_concurrency workers, by default one per core,
+   * sharing the graph reader of this actor. Sharing the reader needs a thread-safe one
+   * (mjolnir.use_concurrent_mem_cache), without it the chunks are located one after the other.
+   * @param request_str  json string of a locate request with any number of locations
+   * @param result       called with the indices of the locations of a chunk in the request and
+   *                     the json or pbf bytes of their locate response, in that order, as soon as
+   *                     the chunk is done. a chunk that fails gets its serialized error instead.
+   *                     the calls come from the workers in the order the chunks finish but never
+   *                     overlap
+   * @param interrupt    allows the whole batch to be aborted via the functor throwing
+   */
+  void locate_batch(const std::string& request_str,
+                    const std::function<void(const std::vector<size_t>&, const std::string&)>& result,
+                    const std::function<void()>* interrupt = nullptr);
+
   /**
    * Perform the matrix action and return json or protobuf depending on which was requested. The
    * request may either be in the form of a json string provided by the request_str parameter or
@@ -143,6 +164,23 @@ public:
                                const std::function<void()>* interrupt = nullptr,
                                Api* api = nullptr);
 
+  /**
+   * Perform the trace_attributes action for many traces at once. The traces are spread over a pool
+   * of workers sharing the graph reader of this actor. Each worker keeps its own loki/thor workers
+   * and with them the map matching candidate cache from one trace, and batch, to the next. Sharing
+   * the reader needs a thread-safe one (mjolnir.use_concurrent_mem_cache), without it the traces
+   * are matched one after the other. The pool has meili.batch_concurrency workers, by default one
+   * per core.
+   * @param requests   json strings, one trace_attributes request per trace
+   * @param result     called with the index of a request and its json or pbf bytes as soon as that
+   *                   trace is done, a trace that fails gets its serialized error instead. the calls
+   *                   come from the workers in the order the traces finish but never overlap
+   * @param interrupt  allows the whole batch to be aborted via the functor throwing
+   */
+  void trace_attributes_batch(const std::vector<std::string>& requests,
+                              const std::function<void(size_t, const std::string&)>& result,
+                              const std::function<void()>* interrupt = nullptr);
+
   /**
    * Perform the height action and return json or protobuf depending on which was requested. The
    * request may either be in the form of a json string provided by the request_str parameter or
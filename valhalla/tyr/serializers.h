@@ -28,19 +28,21 @@ namespace tyr {
 std::string serializeDirections(Api& request);
 
 /**
- * Turn a time distance matrix into json that one can look up location pair results from
+ * Turn a time distance matrix into json that one can look up location pair results from, or into
+ * the matrix of the request when pbf output was requested
  */
-std::string serializeMatrix(const Api& request,
+std::string serializeMatrix(Api& request,
                             const std::vector<thor::TimeDistance>& time_distances,
                             double distance_scale);
 
 /**
- * Turn grid data contours into geojson
+ * Turn grid data contours into geojson, or into the isochrone of the request when pbf output was
+ * requested
  *
  * @param grid_contours    the contours generated from the grid
  * @param colors           the #ABC123 hex string color used in geojson fill color
  */
-std::string serializeIsochrones(const Api& request,
+std::string serializeIsochrones(Api& request,
                                 std::vector<midgard::GriddedData<2>::contour_interval_t>& intervals,
                                 midgard::GriddedData<2>::contours_t& contours,
                                 bool polygons = true,
@@ -58,7 +60,8 @@ std::string serializeHeight(const Api& request,
                             const std::vector<double>& ranges = {});
 
 /**
- * Turn some correlated points on the graph into info about those locations
+ * Turn some correlated points on the graph into info about those locations, when pbf output was
+ * requested the correlations are written to the locations of the request instead
  *
  * @param request      The original request
  * @param locations    The input locations
@@ -66,7 +69,7 @@ std::string serializeHeight(const Api& request,
  * @param reader       A graph reader to get at each correlated points info
  */
 std::string
-serializeLocate(const Api& request,
+serializeLocate(Api& request,
                 const std::vector<baldr::Location>& locations,
                 const std::unordered_map<baldr::Location, baldr::PathLocation>& projections,
                 baldr::GraphReader& reader);
@@ -102,12 +105,6 @@ std::string serializeTraceAttributes(
  */
 std::string serializeStatus(Api& request);
 
-// Return a JSON array of OpenLR 1.5 line location references for each edge of a map matching
-// result. For the time being, result is only non-empty for auto costing requests.
-void route_references(baldr::json::MapPtr& route_json,
-                      const TripRoute& route,
-                      const Options& options);
-
 void openlr(const valhalla::Api& api, int route_index, rapidjson::writer_wrapper_t& writer);
 
 /**
@@ -126,19 +123,24 @@ namespace osrm {
  * Serialize a location into a osrm waypoint
  * http://project-osrm.org/docs/v5.5.1/api/#waypoint-object
  */
-valhalla::baldr::json::MapPtr
-waypoint(const valhalla::Location& location, bool is_tracepoint = false, bool is_optimized = false);
+void waypoint(const valhalla::Location& location,
+              rapidjson::writer_wrapper_t& writer,
+              bool is_tracepoint = false,
+              bool is_optimized = false);
 
 /*
- * Serialize locations into osrm waypoints
+ * Serialize locations into osrm waypoints, into the array the writer is in
  */
+void waypoints(const google::protobuf::RepeatedPtrField<valhalla::Location>& locations,
+               rapidjson::writer_wrapper_t& writer,
+               bool tracepoints = false);
 valhalla::baldr::json::ArrayPtr
 waypoints(const google::protobuf::RepeatedPtrField<valhalla::Location>& locations,
           bool tracepoints = false);
-valhalla::baldr::json::ArrayPtr waypoints(const valhalla::Trip& locations);
-valhalla::baldr::json::ArrayPtr intermediate_waypoints(const valhalla::TripLeg& leg);
+void waypoints(const valhalla::Trip& locations, rapidjson::writer_wrapper_t& writer);
+void intermediate_waypoints(const valhalla::TripLeg& leg, rapidjson::writer_wrapper_t& writer);
 
-void serializeIncidentProperties(rapidjson::Writer<rapidjson::StringBuffer>& writer,
+void serializeIncidentProperties(rapidjson::writer_wrapper_t& writer,
                                  const valhalla::IncidentsTile::Metadata& incident_metadata,
                                  const int begin_shape_index,
                                  const int end_shape_index,